@@ -35,158 +35,24 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
-#include <ctype.h>
-#include <math.h>
+#include <signal.h>
 #include <sys/errno.h>
 
-
-/*
- * defaults
- *
- * OCTET_BITS	number of bits in an 8 bit octet
- *
- * DEF_DEPTH	default tally depth (-b) for each record bit
- *
- * MAX_HISTORY_BITS
- *		We must have this many records before we have a full
- *		history's worth of values for a given bit position in a record.
- *		Bit histories are kept in an unsigned long.
- *
- * MAX_BACK_HISTORY
- *		When we form xors of current values and history values,
- *		we will go back in history up to this many bits.
- *
- * DEF_HISTORY	Default BACK_HISTORY value.
- *
- * MAX_DEPTH	Deeper tally depths require more memory.  An increase in 1
- *		for the depth requires twice as much memory.  A deeper tally
- *		has a shorter history from which bit differences can be
- *		examined.
- *
- *		For each bit depth, we need MAX_BACK_HISTORY more bits in the
- *		history.  So MAX_DEPTH+MAX_BACK_HISTORY is required to
- *		be <= MAX_HISTORY_BITS.  We go one less so that index offsets
- *		fit within signed 32 bits.  Most systems will not be able to
- *		allocate this much memory, but we have to draw a limit
- *		somewhere.
- *
- * DEF_DEPTH_FACTOR
- *		When we calculate entropy at a depth of x, we use the
- *		tally_t of values from [0 .. (1<<x)-1].
- *
- *		However if we have only counted a few bits for a given
- *		slice, this tally_t set will not be very populated.
- *		The required number of cycles to use a depth of x
- *		in calculating entropy is (1<<x) * depth_factor.
- *		This value is the default depth_factor.
- *
- * INV_LN_2	1.0 / Log base e of 2.
- *
- * INVALID_MAX_ENTROPY
- * INVALID_MIN_ENTROPY
- *		Impossible entropy values per bit.
- */
-#define OCTET_BITS 8
-#define DEF_DEPTH 8
-#define MAX_HISTORY_BITS (sizeof(unsigned long)*OCTET_BITS)
-#define MAX_BACK_HISTORY (MAX_HISTORY_BITS/2)
-#define DEF_HISTORY MAX_BACK_HISTORY
-#define MAX_DEPTH (MAX_BACK_HISTORY-1)
-#define DEF_DEPTH_FACTOR 4
-#define INV_LN_2 ((double)1.442695040888963407359924681001892137426646)
-#define INVALID_MAX_ENTROPY ((double)-10.0)
-#define INVALID_MIN_ENTROPY ((double)10.0)
-
-
-
-/*
- * tally_t - tally counter type
- */
-typedef unsigned long tally_t;
-
-
-/*
- * bitslice - tables and tally arrays for a given bit position in the record
- *
- * hist[i]
- *	The tally table for the xor of the current bit history with
- *	the bit history 'i' records back.
- *
- *	The layout of a given tally array is defined in alloc_bittally()'s
- *	comments.  For our example, simply note that hist[i][8] thru
- *	hist[i][15] hold the 8 tally values for all possible 3-bit
- *	combinations.  So hist[i][8] is a tally of all '000' 3-bit values.
- *	And hist[i][9] is a tally of all '001' 3-bit values.
- *	And hist[i][10] is a tally of all '010' 3-bit values.  ...
- *
- *	Therefore hist[5][10] holds a tally of all '010' 3-bit values
- *	that are computed by the xor of the current bit history
- *	and the bit history 5 records back.  If b0 is the current
- *	bit value, b1 is the previous bit value, b2 as the bit value, ...
- *
- *	Using the notation that b0 is the current value, b1 previous,
- *	b2 the bit value before that, we have:
- *
- *	    hist[5][10] = count when xor( b2b1b0 , b7b6b5 ) was '010'
- *	    hist[5][11] = count when xor( b2b1b0 , b7b6b5 ) was '011'
- *	    hist[5][12] = count when xor( b2b1b0 , b7b6b5 ) was '100'
- *
- *	    hist[6][12] = count when xor( b2b1b0 , b8b7b6 ) was '100'
- *	    hist[7][12] = count when xor( b2b1b0 , b9b8b7 ) was '100'
- *
- *	    hist[5][4] = count when xor( b1b0 , b6b5 ) was '00'
- *	    hist[5][5] = count when xor( b1b0 , b6b5 ) was '01'
- *	    hist[5][6] = count when xor( b1b0 , b6b5 ) was '10'
- *	    hist[5][7] = count when xor( b1b0 , b6b5 ) was '11'
- *
- *	    hist[4][4] = count when xor( b1b0 , b5b4 ) was '00'
- *	    hist[4][5] = count when xor( b1b0 , b5b4 ) was '01'
- *	    hist[4][6] = count when xor( b1b0 , b5b4 ) was '10'
- *	    hist[4][7] = count when xor( b1b0 , b5b4 ) was '11'
- *
- *      assuming that the -b bit_depth was deep enough and hist[i] != NULL.
- *
- *	As a special case, hist[0] points to the tally table
- *	of the current values only.  No xor is performed, thus:
- *
- *	    hist[0][10] = count when b2b1b0 was '010'
- *	    hist[0][11] = count when b2b1b0 was '100'
- *	    hist[0][4]  = count when b1b0 was '00'
- *	    hist[0][7]  = count when b1b0 was '11'
- *
- * NOTE: On struct total_ent, the high_entropy is invalid if high_bit_cnt <= 0.
- *       On struct total_ent, the low_entropy is invalid if low_bit_cnt <= 0.
- */
-struct bitslice {
-    int bitnum;			/* bit position in record, 0 ==> low order bit */
-    unsigned long history;	/* history of bit positions, bit 0 ==> most recent */
-    unsigned long ops;		/* total operations on bit, including ignored ones */
-    unsigned long count;	/* number of bits processed for this position */
-    int depth_lim;		/* bit_depth used in this slice */
-    int back_lim;		/* back_history used in this slice */
-    double max_ent[MAX_BACK_HISTORY+1];	/* max entropy estimates of hist[i] */
-    double min_ent[MAX_BACK_HISTORY+1];	/* min entropy estimates of hist[i] */
-    double entropy_high;		/* overall high estimate of entropy */
-    double entropy_low;			/* overall low estimate of entropy */
-    tally_t *hist[MAX_BACK_HISTORY+1];  /* cur & historical xor tally arrays */
-};
-static struct total_ent {
-    double high_entropy;	/* high estimate of overall entropy */
-    int high_bit_cnt;		/* bits used to compute high_entropy or -1 */
-    double low_entropy;		/* low estimate of overall entropy */
-    int low_bit_cnt;		/* bits used to compute low_entropy or -1 */
-    double med_entropy;		/* median entropy or INVALID_MAX_ENTROPY */
-} overall;
+#include "entropic.h"
+#include "entpool.h"
+#include "entread.h"
+#include "entrept.h"
 
 
 /*
  * official version
  */
-#define VERSION "1.17.1 2025-05-05"          /* format: major.minor YYYY-MM-DD */
+#define VERSION ENT_VERSION
 
 
 /*
@@ -194,8 +60,10 @@ static struct total_ent {
  */
 static const char * const usage =
 	"usage: %s [-h] [-v verbose] [-V] [-c rept_cycle] [-b bit_depth]\n"
-	"\t[-B back_history] [-f depth_factor] [-r rec_size]\n"
-	"\tinput_file\n"
+	"\t[-B back_history] [-f depth_factor] [-z conv_cycle] [-L block]\n"
+	"\t[-r rec_size | -R framing] [-U] [-S sample] [-I io] [-H] [-Z]\n"
+	"\t[-s select] [--offset octets] [--length octets] [--records count]\n"
+	"\t[-j workers] [-p] input_file ...\n"
 	"\n"
 	"\t-h\t\t\tprint this help message and exit\n"
 	"\t-v verbose\t\tverbose level (def: 0 ==> none)\n"
@@ -205,13 +73,37 @@ static const char * const usage =
 	"\t-b bit_depth\t\ttally depth for each record bit (def: 8)\n"
 	"\t-B back_history\t\txor diffs this many records back (def: 32)\n"
 	"\t-f depth_factor\t\tave slot tally needed for entropy (def: 4) \n"
+	"\t\t\t\t    -b, -B and -f may be a list such as 4,8,12:\n"
+	"\t\t\t\t    one pass, reporting each combination\n"
+	"\t-z conv_cycle\t\tfreeze converged bits, check each conv_cycle records\n"
+	"\t\t\t\t    (def: 0 ==> never freeze, SIGUSR1 thaws all bits)\n"
+	"\t-L block\t\ttally block records at a time, a bit at a time,\n"
+	"\t\t\t\t    1 to 256 (def: 0 ==> record by record)\n"
 	"\t-r rec_size\t\tread rec_size octet records (def: BUFSIZ (8192))\n"
+	"\t-R framing\t\tread records framed by: nul, u32, varint or\n"
+	"\t\t\t\t    delim:string (u32 and varint are length prefixes)\n"
+	"\t-U\t\t\tdo not decompress gzip, xz or zstd input\n"
+	"\t-S sample\t\tanalyze only a sample of the records: every:N,\n"
+	"\t\t\t\t    hash:fraction, reservoir:K or deadline:seconds\n"
+	"\t--offset octets\t\tstart at the 1st record boundary at or after offset\n"
+	"\t--length octets\t\tonly records that start in length octets from offset\n"
+	"\t--records count\t\tfind at most count records\n"
+	"\t-I io\t\t\tread files with: cache (def), nocache (drop pages\n"
+	"\t\t\t\t    once read), direct (O_DIRECT) or uring (io_uring)\n"
+	"\t-H\t\t\tskip records in the holes of sparse files\n"
+	"\t-Z\t\t\ttally runs of all-zero records in bulk,\n"
+	"\t\t\t\t    hole records are tallied without reading them\n"
+	"\t-s select\t\tanalyze only the selected octets and bits:\n"
+	"\t\t\t\t    N, N-M, N-M:K (low K bits), bN-M (bits), ...\n"
+	"\t\t\t\t    (1st octet is 0, 1st bit is the high bit)\n"
+	"\t-j workers\t\tprocess input files on this many threads (def: 1)\n"
+	"\t-p\t\t\treport on each input file (def: one aggregate report)\n"
 	"\n"
-	"\tinput_file\t\tfile to read records from (- ==> stdin)\n"
+	"\tinput_file ...\t\tfiles or directories to read records from\n"
+	"\t\t\t\t    (- ==> stdin)\n"
 	"\n"
 	"%s version: %s\n";
 
-
 /*
  * static declarations
  */
@@ -220,113 +112,65 @@ static char *prog = NULL;       /* basename of program */
 static const char * const version = VERSION;
 static int v_flag = 0;		/* verbosity level */
 static int rept_cycle = 0;	/* >= 0 ==> rept entropy every so many recs */
-static int bit_depth = DEF_DEPTH;  /* tally bit depth for each bit in record */
-static int back_history = DEF_HISTORY;	/* xor diff back this many records */
-static int depth_factor = DEF_DEPTH_FACTOR;	/* ave slot tally needed */
+static struct ent_cfg cfg;	/* analysis parameters, see entropic.h */
+static volatile sig_atomic_t thaw_request = 0;	/* 1 ==> SIGUSR1 asked to thaw */
 static int rec_size = BUFSIZ;	/* record size */
+static int fixed = 0;		/* 1 ==> -r rec_size was given */
+static int framed = 0;		/* 1 ==> -R framing */
+static struct rd_framing framing;	/* how records are found, see entread.h */
+static int raw_input = 0;	/* 1 ==> -U, do not decompress input */
+static struct rd_sample sample;	/* -S records to analyze, see entread.h */
+static off_t range_offset = 0;	/* --offset octets, 0 ==> start */
+static off_t range_length = 0;	/* --length octets, 0 ==> to EOF */
+static unsigned long range_records = 0;	/* --records count, 0 ==> all */
+static int io_mode = RD_IO_CACHE;	/* -I how input files are read */
+static int skip_holes = 0;	/* 1 ==> -H, skip records in holes */
+static int zero_runs = 0;	/* 1 ==> -Z, tally zero records in bulk */
+
+/*
+ * long options, they have no short form
+ */
+#define OPT_OFFSET 256
+#define OPT_LENGTH 257
+#define OPT_RECORDS 258
+static const struct option long_opts[] = {
+    {"offset", required_argument, NULL, OPT_OFFSET},
+    {"length", required_argument, NULL, OPT_LENGTH},
+    {"records", required_argument, NULL, OPT_RECORDS},
+    {NULL, 0, NULL, 0}
+};
+static struct ent_map *map = NULL;	/* -s select map or NULL */
 static char *filename;		/* name of input file, or - ==> stdin */
+static struct pool_list inputs;	/* input files, directories expanded */
+static int multi = 0;		/* 1 ==> process inputs on a pool */
+static int per_file = 0;	/* 1 ==> report on each input file */
+static int workers = 1;		/* number of worker threads */
 
 
 /*
- * record pre-processing
- *
- * We will document the pre-processing performed on a record in order:
- *
- * octet_map[i] (from -m map_file)
+ * parameter sweep
  *
- *	A string of ASCII "0"'s and "1"'s representing the bit pattern
- *	that a the octet 'i' should be converted into during the
- *	processing of a record.  An empty string means that the
- *	given octet pattern is skipped.
- *
- *	The default octet_map is the 8 bit value of the octet.
+ * The -b, -B and -f options take a comma separated list of values
+ * (see entrept.h).
  */
-static char *octet_map[1 << OCTET_BITS] = {
-    "00000000", "00000001", "00000010", "00000011",
-    "00000100", "00000101", "00000110", "00000111",
-    "00001000", "00001001", "00001010", "00001011",
-    "00001100", "00001101", "00001110", "00001111",
-    "00010000", "00010001", "00010010", "00010011",
-    "00010100", "00010101", "00010110", "00010111",
-    "00011000", "00011001", "00011010", "00011011",
-    "00011100", "00011101", "00011110", "00011111",
-    "00100000", "00100001", "00100010", "00100011",
-    "00100100", "00100101", "00100110", "00100111",
-    "00101000", "00101001", "00101010", "00101011",
-    "00101100", "00101101", "00101110", "00101111",
-    "00110000", "00110001", "00110010", "00110011",
-    "00110100", "00110101", "00110110", "00110111",
-    "00111000", "00111001", "00111010", "00111011",
-    "00111100", "00111101", "00111110", "00111111",
-    "01000000", "01000001", "01000010", "01000011",
-    "01000100", "01000101", "01000110", "01000111",
-    "01001000", "01001001", "01001010", "01001011",
-    "01001100", "01001101", "01001110", "01001111",
-    "01010000", "01010001", "01010010", "01010011",
-    "01010100", "01010101", "01010110", "01010111",
-    "01011000", "01011001", "01011010", "01011011",
-    "01011100", "01011101", "01011110", "01011111",
-    "01100000", "01100001", "01100010", "01100011",
-    "01100100", "01100101", "01100110", "01100111",
-    "01101000", "01101001", "01101010", "01101011",
-    "01101100", "01101101", "01101110", "01101111",
-    "01110000", "01110001", "01110010", "01110011",
-    "01110100", "01110101", "01110110", "01110111",
-    "01111000", "01111001", "01111010", "01111011",
-    "01111100", "01111101", "01111110", "01111111",
-    "10000000", "10000001", "10000010", "10000011",
-    "10000100", "10000101", "10000110", "10000111",
-    "10001000", "10001001", "10001010", "10001011",
-    "10001100", "10001101", "10001110", "10001111",
-    "10010000", "10010001", "10010010", "10010011",
-    "10010100", "10010101", "10010110", "10010111",
-    "10011000", "10011001", "10011010", "10011011",
-    "10011100", "10011101", "10011110", "10011111",
-    "10100000", "10100001", "10100010", "10100011",
-    "10100100", "10100101", "10100110", "10100111",
-    "10101000", "10101001", "10101010", "10101011",
-    "10101100", "10101101", "10101110", "10101111",
-    "10110000", "10110001", "10110010", "10110011",
-    "10110100", "10110101", "10110110", "10110111",
-    "10111000", "10111001", "10111010", "10111011",
-    "10111100", "10111101", "10111110", "10111111",
-    "11000000", "11000001", "11000010", "11000011",
-    "11000100", "11000101", "11000110", "11000111",
-    "11001000", "11001001", "11001010", "11001011",
-    "11001100", "11001101", "11001110", "11001111",
-    "11010000", "11010001", "11010010", "11010011",
-    "11010100", "11010101", "11010110", "11010111",
-    "11011000", "11011001", "11011010", "11011011",
-    "11011100", "11011101", "11011110", "11011111",
-    "11100000", "11100001", "11100010", "11100011",
-    "11100100", "11100101", "11100110", "11100111",
-    "11101000", "11101001", "11101010", "11101011",
-    "11101100", "11101101", "11101110", "11101111",
-    "11110000", "11110001", "11110010", "11110011",
-    "11110100", "11110101", "11110110", "11110111",
-    "11111000", "11111001", "11111010", "11111011",
-    "11111100", "11111101", "11111110", "11111111"
-};
+static struct rept_sweep sweep_vals;	/* -b, -B and -f values */
+static int sweep = 0;			/* 1 ==> report a parameter grid */
 
 
 /*
  * forward declarations
  */
 static void parse_args(int argc, char **argv);
-static tally_t *alloc_bittally(int depth);
-static struct bitslice *alloc_bitslice(int bitnum, int depth);
-static void record_bit(struct bitslice *slice, int value);
-static int read_record(FILE *input, u_int8_t *buf, int buf_size);
-static int pre_process(u_int8_t *inbuf, int inbuf_len, u_int8_t **outbuf,
-		       int *outbuf_len);
-static void rept_entropy(struct bitslice **slice, int bit_buf_used);
+static void run_files(void);
+static int feed_runs(struct ent_ctx *ctx, struct reader *rd);
+static void thaw_handler(int sig);
 static void dbg(int level, char *fmt, ...);
 
 
 /*
  * misc globals and static values
  */
-static tally_t recnum = 0;	/* current record number, starting with 0 */
+static unsigned long recnum = 0;	/* current record number, starting with 0 */
 
 
 /*
@@ -337,206 +181,200 @@ main(int argc, char *argv[])
 {
     extern char *optarg;	/* argument to current option */
     extern int optind;		/* first argv-element that is not an option */
-    FILE *input;		/* stream from which to read records */
-    u_int8_t *raw_buf;		/* malloc-ed raw record input buffer */
-    int raw_len;		/* length of raw record in octets */
-    u_int8_t *bit_buf;		/* malloc-ed buffer of 0x00 or 0x01 octets */
-    int bit_len;		/* length bit_buf */
-    int bit_buf_used;		/* number of octets in bit_buf being used */
-    struct bitslice **bits;	/* bits[i] points to bitslice for bit i */
-    int bits_len;		/* length of bits pointer array */
-    int i;
+    struct reader *rd;		/* reader of the file containing records */
+    u_int8_t *raw_buf[ENT_BATCH];	/* raw records, in the reader buffer */
+    int raw_len[ENT_BATCH];	/* length of each raw record in octets */
+    unsigned long run;		/* -Z records left of a run of raw_buf[0] */
+    unsigned long chunk;	/* records of the batch or run fed at once */
+    unsigned long left;		/* records until the next report, 0 ==> none */
+    int want;			/* records to read in a batch */
+    int ret;			/* records read, 0 ==> EOF, -1 ==> error */
+    unsigned long seen;		/* records found in the input */
+    unsigned long taken;	/* records of them sampled */
+    int bit_buf_used;		/* number of bits processed for the last record */
+    struct ent_ctx *ctx;	/* entropy analysis context */
+    struct ent_rept rept;	/* entropy report */
+    char rept_buf[BUFSIZ+1];	/* formatted entropy report */
+    struct ent_rept *grid;	/* sweep report grid */
 
     /*
      * parse args
      */
-    program = argv[0];
     parse_args(argc, argv);
 
     /*
-     * open the file containing records
+     * multiple input mode does not return
      */
-    if (strcmp(filename, "-") == 0) {
-	/* - means read from stdin */
-	input = stdin;
-    } else {
-	input = fopen(filename, "r");
-    }
-    if (input == NULL) {
-	fprintf(stderr, "%s: unable to open for reading: %s\n",
-		program, filename);
-	exit(1);
+    if (multi) {
+	run_files();
+	/*NOTREACHED*/
     }
 
     /*
-     * allocate raw input buffer and bit buffer with extra room in each
+     * open the file containing records, - means read from stdin
      */
-    raw_buf = (u_int8_t *)malloc(rec_size+1);
-    if (raw_buf == NULL) {
-	fprintf(stderr, "%s: failed to allocate raw buffer: %d octets\n",
-		program, rec_size+1);
+    rd = rd_new(&framing);
+    if (rd == NULL) {
+	fprintf(stderr, "%s: failed to allocate reader: %s\n",
+		program, strerror(errno));
 	exit(2);
     }
-    bit_len = rec_size * OCTET_BITS;
-    bit_buf = (u_int8_t *)malloc((rec_size+1) * OCTET_BITS + 1);
-    if (bit_buf == NULL) {
-	fprintf(stderr, "%s: failed to allocate bit buffer: %d octets\n",
-		program, (rec_size+1) * OCTET_BITS + 1);
+    if (rd_open(rd, filename) < 0) {
+	fprintf(stderr, "%s: unable to open for reading: %s: %s\n",
+		program, filename, strerror(errno));
+	exit(1);
+    }
+
+    /*
+     * setup for entropy calculation
+     */
+    ctx = ent_open(&cfg, map);
+    if (ctx == NULL) {
+	fprintf(stderr, "%s: failed to create entropy context: %s\n",
+		program, strerror(errno));
 	exit(3);
     }
 
     /*
-     * setup for overall entropy calculation
+     * SIGUSR1 thaws any frozen bitslices
      */
-    overall.high_entropy = INVALID_MAX_ENTROPY;
-    overall.high_bit_cnt = 0;
-    overall.low_entropy = INVALID_MIN_ENTROPY;
-    overall.low_bit_cnt = 0;
-    overall.med_entropy = INVALID_MAX_ENTROPY;
+    if (cfg.conv_cycle > 0) {
+	(void) signal(SIGUSR1, thaw_handler);
+    }
 
     /*
-     * process records, one at a time
+     * process records, a batch at a time, or with -Z a run of zero
+     * records at a time
      */
     recnum = 0;
-    bits_len = 0;
-    bits = NULL;
-    do {
+    run = 0;
+    for (;;) {
 
 	/*
-	 * read the next record
+	 * records up to the next report
 	 */
-	dbg(5, "main: reading record: %llu", (unsigned long)recnum);
-	raw_len = read_record(input, raw_buf, rec_size);
-	if (raw_len <= 0) {
-	    break;
-	}
+	left = (rept_cycle > 0) ?
+	       (unsigned long)rept_cycle - recnum % rept_cycle : 0;
 
 	/*
-	 * pre-process raw record and produce a bit buffer
+	 * pre-process the raw records and record their bit values,
+	 * reading the next run unless some of it is left
 	 */
-	bit_buf_used = pre_process(raw_buf, raw_len, &bit_buf, &bit_len);
-	if (bit_buf_used <= 0) {
-	    /* EOF or error */
-	    dbg(5, "main: skipping record, bit_buf_used returned: %d <= 0",
-		    bit_buf_used);
-	    continue;
-	}
-	dbg(5, "main: bit buffer has %d bits", bit_buf_used);
-
-	/*
-	 * allocate bitslices for any new bit positions
-	 */
-	if (bit_buf_used > bits_len) {
-
-	    /*
-	     * expand or create bits pointer array
-	     */
-	    if (bits == NULL) {
-		dbg(2, "creating bits up thru %d", bit_buf_used);
-		bits = (struct bitslice **) malloc(bit_buf_used *
-						   sizeof(struct bitslice *));
-	    } else {
-		dbg(2, "expanding bits from %d bits to %d bits",
-		       bits_len, bit_buf_used);
-		bits = (struct bitslice **) realloc(bits,
-						    bit_buf_used *
-						    sizeof(struct bitslice *));
+	if (zero_runs) {
+	    if (run == 0) {
+		dbg(5, "main: reading record: %lu", recnum);
+		ret = rd_run(rd, &raw_buf[0], &raw_len[0], &run);
+		if (ret <= 0) {
+		    break;
+		}
+		dbg(6, "main: read %d octets for record %lu, %lu in a row",
+		       raw_len[0], recnum, run);
 	    }
-	    if (bits == NULL) {
-		fprintf(stderr, "%s: failed to allocate %d bitslice pointers",
-			program, bit_buf_used);
-		exit(4);
+	    chunk = run;
+	    if (left > 0 && chunk > left) {
+		chunk = left;
 	    }
-
-	    /*
-	     * create new tally_t's for the new bits
-	     */
-	    for (i=bits_len; i < bit_buf_used; ++i) {
-		bits[i] = alloc_bitslice(i, bit_depth);
-		if (bits[i] == NULL) {
-		    fprintf(stderr, "%s: cannot allocate tally_t for bid %d",
-			    program, i);
-		    exit(5);
-		}
+	    run -= chunk;
+	    bit_buf_used = ent_feed_run(ctx, raw_buf[0], raw_len[0], chunk);
+	} else {
+	    want = ENT_BATCH;
+	    if (left > 0 && (unsigned long)want > left) {
+		want = (int)left;
 	    }
-	    bits_len = bit_buf_used;
+	    dbg(5, "main: reading batch at record: %lu", recnum);
+	    ret = rd_batch(rd, raw_buf, raw_len, want);
+	    if (ret <= 0) {
+		break;
+	    }
+	    dbg(6, "main: read %d records at record %lu", ret, recnum);
+	    chunk = (unsigned long)ret;
+	    bit_buf_used = ent_feed_batch(ctx, raw_buf, raw_len, ret);
+	}
+	if (bit_buf_used < 0) {
+	    fprintf(stderr, "%s: failed to process record %lu: %s\n",
+		    program, recnum + chunk-1, strerror(errno));
+	    exit(4);
+	}
+	recnum += chunk;
+	if (bit_buf_used == 0) {
+	    dbg(5, "main: skipping record, no bits to process");
+	    continue;
 	}
+	dbg(5, "main: bit buffer has %d bits", bit_buf_used);
 
 	/*
-	 * record bit values for this record
+	 * thaw bitslices, if needed
 	 */
-	for (i=0; i < bit_buf_used; ++i) {
-	    record_bit(bits[i], bit_buf[i]);
+	if (thaw_request) {
+	    thaw_request = 0;
+	    ent_thaw(ctx);
 	}
 
 	/*
 	 * report the entropy, if needed
 	 */
-	if (rept_cycle > 0 && ((recnum+1) % rept_cycle) == 0) {
-	    rept_entropy(bits, bits_len);
-	    if (overall.high_bit_cnt > 0) {
+	if (rept_cycle > 0 && (recnum % rept_cycle) == 0) {
+	    (void) ent_report(ctx, &rept);
+	    if (rept.high_bit_cnt > 0) {
 		printf("after record %lu for %d bits: "
 		       "high entropy: %f\n",
-		       (unsigned long)recnum+1,
-		       overall.high_bit_cnt, overall.high_entropy);
+		       recnum,
+		       rept.high_bit_cnt, rept.high_entropy);
 	    }
-	    if (overall.low_bit_cnt > 0) {
+	    if (rept.low_bit_cnt > 0) {
 		printf("after record %lu for %d bits: "
 		       "low entropy: %f\n",
-		       (unsigned long)recnum+1,
-		       overall.low_bit_cnt, overall.low_entropy);
+		       recnum,
+		       rept.low_bit_cnt, rept.low_entropy);
 	    }
-	    if (overall.high_bit_cnt > 0 && overall.low_bit_cnt > 0) {
+	    if (rept.high_bit_cnt > 0 && rept.low_bit_cnt > 0) {
 		printf("after record %lu for %d bits: "
 		       "median entropy: %f\n",
-		       (unsigned long)recnum+1,
-		       overall.low_bit_cnt, overall.med_entropy);
+		       recnum,
+		       rept.low_bit_cnt, rept.med_entropy);
 	    }
-	    if (overall.high_bit_cnt > 0) {
+	    if (rept.high_bit_cnt > 0) {
 		fputc('\n', stdout);
 	    }
 	}
-
-    } while (++recnum > 0);
+    }
+    if (ret < 0) {
+	fprintf(stderr, "%s: error reading record %lu: %s: %s\n",
+		program, recnum, filename, strerror(errno));
+	exit(1);
+    }
 
     /*
      * final entropy processing
      */
     dbg(1, "final entropy processing");
-    if (bits == NULL || bits_len <= 0) {
+    (void) ent_report(ctx, &rept);
+    if (rept.bits <= 0) {
 	printf("Error: nothing to process\n");
-    } else {
-	rept_entropy(bits, bits_len);
-    }
-    printf("\nEntropy report:\n");
-    if (overall.high_bit_cnt > 0) {
-	printf("record count: %lu with %d bits: "
-	       "high entropy: %f\n",
-	       (unsigned long)recnum+1,
-	       overall.high_bit_cnt, overall.high_entropy);
-    } else {
-	printf("Error: not enough data to calculate high entropy estimate\n");
-    }
-    if (overall.low_bit_cnt > 0) {
-	printf("record count: %lu with %d bits: "
-	       "low entropy: %f\n",
-	       (unsigned long)recnum+1,
-	       overall.low_bit_cnt, overall.low_entropy);
-    } else {
-	printf("Error: not enough data to calculate low entropy estimate\n");
     }
-    if (overall.high_bit_cnt > 0 && overall.low_bit_cnt > 0) {
-	printf("high, median and low entropy: %f %f %f\n\n",
-	       overall.high_entropy,
-	       overall.med_entropy,
-	       overall.low_entropy);
+    if (sweep) {
+	grid = rept_grid(&sweep_vals, ctx);
+	if (grid == NULL) {
+	    fprintf(stderr, "%s: failed to compute sweep report: %s\n",
+		    program, strerror(errno));
+	    exit(49);
+	}
+	printf("\nEntropy sweep report:\n");
+	rept_print_grid(&sweep_vals, grid, rept.recnum);
+	free(grid);
     } else {
-	printf("Error: not enough data to calculate median entropy estimate\n");
+	rept_format(rept_buf, sizeof(rept_buf), &rept, rept.recnum);
+	printf("\nEntropy report:\n%s", rept_buf);
     }
 
     /*
      * all done!  -- Jessica Noll, Age 2
      */
+    ent_close(ctx);
+    ent_map_free(map);
+    rd_counts(rd, &seen, &taken);
+    dbg(1, "main: sampled %lu of %lu records", taken, seen);
+    rd_free(rd);
     dbg(1, "all done!");
     exit(0);
 }
@@ -548,6 +386,8 @@ main(int argc, char *argv[])
 static void
 parse_args(int argc, char **argv)
 {
+    char errbuf[BUFSIZ+1];	/* select or sweep list error message */
+    char *end;			/* end of a number */
     int i;
 
     /*
@@ -562,7 +402,9 @@ parse_args(int argc, char **argv)
     } else {
         ++prog;
     }
-    while ((i = getopt(argc, argv, "hv:Vc:b:B:f:r:")) != -1) {
+    ent_cfg_init(&cfg);
+    while ((i = getopt_long(argc, argv, "hv:Vc:b:B:f:z:L:r:R:US:I:HZs:j:p",
+			    long_opts, NULL)) != -1) {
 	switch (i) {
 
 	case 'h':	/* print usage message and then exit */
@@ -572,6 +414,7 @@ parse_args(int argc, char **argv)
 
 	case 'v':	/* verbose level */
 	    v_flag = strtol(optarg, NULL, 0);
+	    cfg.v_flag = v_flag;
 	    break;
 
 	case 'V':       /* -V - print version string and exit */
@@ -584,19 +427,132 @@ parse_args(int argc, char **argv)
 	    break;
 
 	case 'b':	/* tally depth */
-	    bit_depth = strtol(optarg, NULL, 0);
+	    sweep_vals.ndepth = rept_list("-b bit_depth", optarg,
+					  sweep_vals.depth,
+					  errbuf, sizeof(errbuf));
+	    if (sweep_vals.ndepth < 0) {
+		fprintf(stderr, "%s: %s\n", program, errbuf);
+		exit(48);
+	    }
 	    break;
 
 	case 'B':	/* back history depth */
-	    back_history = strtol(optarg, NULL, 0);
+	    sweep_vals.nback = rept_list("-B back_history", optarg,
+					 sweep_vals.back,
+					 errbuf, sizeof(errbuf));
+	    if (sweep_vals.nback < 0) {
+		fprintf(stderr, "%s: %s\n", program, errbuf);
+		exit(48);
+	    }
 	    break;
 
 	case 'f':	/* ave slot tally needed for entropy calculation */
-	    depth_factor = strtol(optarg, NULL, 0);
+	    sweep_vals.nfactor = rept_list("-f depth_factor", optarg,
+					   sweep_vals.factor,
+					   errbuf, sizeof(errbuf));
+	    if (sweep_vals.nfactor < 0) {
+		fprintf(stderr, "%s: %s\n", program, errbuf);
+		exit(48);
+	    }
+	    break;
+
+	case 'z':	/* slice convergence check cycle */
+	    cfg.conv_cycle = strtol(optarg, NULL, 0);
+	    break;
+
+	case 'L':	/* records per cache block */
+	    cfg.block = strtol(optarg, NULL, 0);
 	    break;
 
 	case 'r':	/* binary record size */
 	    rec_size = strtol(optarg, NULL, 0);
+	    fixed = 1;
+	    break;
+
+	case 'R':	/* record framing */
+	    if (rd_framing(optarg, &framing) < 0) {
+		fprintf(stderr, "%s: -R framing must be nul, u32, varint or "
+				"delim:string of 1 to %d octets\n",
+			program, RD_MAX_DELIM);
+		exit(50);
+	    }
+	    framed = 1;
+	    break;
+
+	case 'U':	/* do not decompress */
+	    raw_input = 1;
+	    break;
+
+	case OPT_OFFSET:	/* start of the range */
+	    errno = 0;
+	    range_offset = (off_t)strtoll(optarg, &end, 0);
+	    if (*end != '\0' || errno != 0 || range_offset < 0) {
+		fprintf(stderr, "%s: --offset octets must be >= 0\n", program);
+		exit(54);
+	    }
+	    break;
+
+	case OPT_LENGTH:	/* length of the range */
+	    errno = 0;
+	    range_length = (off_t)strtoll(optarg, &end, 0);
+	    if (*end != '\0' || errno != 0 || range_length <= 0) {
+		fprintf(stderr, "%s: --length octets must be > 0\n", program);
+		exit(55);
+	    }
+	    break;
+
+	case OPT_RECORDS:	/* most records to find */
+	    errno = 0;
+	    range_records = strtoul(optarg, &end, 0);
+	    if (*end != '\0' || errno != 0 || range_records == 0 ||
+		optarg[0] == '-') {
+		fprintf(stderr, "%s: --records count must be > 0\n", program);
+		exit(56);
+	    }
+	    break;
+
+	case 'I':	/* how input files are read */
+	    io_mode = rd_io(optarg);
+	    if (io_mode < 0) {
+		fprintf(stderr, "%s: -I io must be cache, nocache, direct or uring\n",
+			program);
+		exit(57);
+	    }
+	    break;
+
+	case 'H':	/* skip holes */
+	    skip_holes = 1;
+	    break;
+
+	case 'Z':	/* tally zero records in bulk */
+	    zero_runs = 1;
+	    break;
+
+	case 'S':	/* record sampling */
+	    if (rd_sample(optarg, &sample) < 0) {
+		fprintf(stderr, "%s: -S sample must be every:N, hash:fraction, "
+				"reservoir:K or deadline:seconds\n", program);
+		exit(53);
+	    }
+	    break;
+
+	case 's':	/* octets and bits to select */
+	    errbuf[0] = '\0';
+	    ent_map_free(map);
+	    map = ent_map_select(optarg, errbuf, sizeof(errbuf));
+	    if (map == NULL) {
+		fprintf(stderr, "%s: -s select: %s\n", program, errbuf);
+		exit(52);
+	    }
+	    break;
+
+	case 'j':	/* worker threads */
+	    workers = strtol(optarg, NULL, 0);
+	    break;
+
+	case 'p':	/* per file reports */
+	    per_file = 1;
+	    multi = 1;
 	    break;
 
 	case ':':
@@ -620,756 +576,263 @@ parse_args(int argc, char **argv)
     }
 
     /*
-     * note the input filename
+     * note the input filenames
      */
     if (optind >= argc) {
 	fprintf(stderr, usage, program, prog, version);
 	exit(7);
     }
-    filename = argv[optind];
-    dbg(1, "main: input file: %s", filename);
-
-    /*
-     * check report cycle
-     */
-    if (rept_cycle < 0) {
-	fprintf(stderr, "%s: -c rept_cycle must be >= 0\n", program);
-	exit(8);
+    for (i=optind; i < argc; ++i) {
+	if (pool_add_path(&inputs, argv[i]) < 0) {
+	    fprintf(stderr, "%s: cannot add input: %s: %s\n",
+		    program, argv[i], strerror(errno));
+	    exit(41);
+	}
     }
-    dbg(1, "main: report cycle: %d", rept_cycle);
-
-    /*
-     * check bit depth
-     */
-    if (bit_depth < 1) {
-	fprintf(stderr, "%s: -b bit_depth must be > 0\n", program);
-	exit(9);
+    if (argc-optind != 1 || inputs.len != 1 ||
+	strcmp(inputs.path[0], argv[optind]) != 0) {
+	multi = 1;
     }
-    if (bit_depth > MAX_DEPTH) {
-	fprintf(stderr, "%s: -b bit_depth must <= %ld\n", program, MAX_DEPTH);
-	exit(10);
+    if (multi == 0) {
+	filename = argv[optind];
+	dbg(1, "main: input file: %s", filename);
+    } else {
+	dbg(1, "main: %d input files", inputs.len);
     }
-    dbg(1, "main: bit_depth: %d", bit_depth);
 
     /*
-     * check back history
+     * check multiple input options
      */
-    if (back_history < 1) {
-	fprintf(stderr, "%s: -B back_history must be > 0\n", program);
-	exit(11);
-    }
-    if (bit_depth > MAX_BACK_HISTORY) {
-	fprintf(stderr, "%s: -B back_history must <= %ld\n",
-		program, MAX_BACK_HISTORY);
-	exit(12);
+    if (workers < 1 || workers > MAX_WORKERS) {
+	fprintf(stderr, "%s: -j workers must be >= 1 and <= %d\n",
+		program, MAX_WORKERS);
+	exit(42);
     }
-    dbg(1, "main: back_history: %d", back_history);
-
-    /*
-     * check depth factor
-     */
-    if (depth_factor < 1) {
-	fprintf(stderr, "%s: -f depth_factor must be > 0\n", program);
-	exit(13);
+    if (multi) {
+	if (rept_cycle != 0) {
+	    fprintf(stderr, "%s: -c rept_cycle requires a single input_file\n",
+		    program);
+	    exit(43);
+	}
+	dbg(1, "main: workers: %d  per file reports: %d", workers, per_file);
     }
-    dbg(1, "main: depth_factor: %d", depth_factor);
 
     /*
-     * check raw record size, if given
+     * check report cycle
      */
-    if (rec_size <= 0) {
-	fprintf(stderr, "%s: -r rec_size: %d must be > 0\n",
-		program, rec_size);
-	exit(14);
-    } else {
-	dbg(1, "main: line mode of up to %d octets", rec_size);
+    if (rept_cycle < 0) {
+	fprintf(stderr, "%s: -c rept_cycle must be >= 0\n", program);
+	exit(8);
     }
-    return;
-}
-
-
-/*
- * alloc_bittally - allocate and initialize the tally array for a bit
- *
- * given:
- *	depth	tally depth, in bits
- *
- * returns:
- *	pointer to allocated and initialized tally array
- *	does not return (exits non-zero) on memory allocation failure
- *
- * The tally array layout:
- *
- *	length in values		(1 value)
- *	unused				(1 value)
- *	tally for depth of 1 bit	(2 values)
- *	tally for depth of 2 bits	(4 values)
- *	tally for depth of 3 bits	(8 values)
- *	...
- *	tally for depth of 'depth' bits	(2**depth values)
- *
- * The total size of the bitslice array is 2**(depth+1) values.
- *
- * The bitslice array is initialized to 0 values.
- */
-static tally_t *
-alloc_bittally(int depth)
-{
-    tally_t *ret;	/* allocated bitslice tally layout */
-    size_t values;	/* number of values in tally array */
+    dbg(1, "main: report cycle: %d", rept_cycle);
 
     /*
-     * firewall
+     * default to a single value for each sweep list
      */
-    if (depth < 1) {
-	fprintf(stderr, "%s: alloc_bittally: depth: %d must be > 0\n",
-		program, depth);
-	exit(24);
-    }
-    values = (1<<(depth+1));
-    if (values < 0 || values == 0) {
-	fprintf(stderr, "%s: alloc_bittally: depth: %d is too large\n",
-		program, depth);
-	exit(25);
+    if (sweep_vals.ndepth == 0) {
+	sweep_vals.depth[sweep_vals.ndepth++] = cfg.bit_depth;
     }
-
-    /*
-     * allocate and zero
-     */
-    ret = (tally_t *)calloc(values, sizeof(tally_t));
-    if (ret == NULL) {
-	fprintf(stderr, "%s: alloc_bittally: "
-			"not enough memory for depth: %d\n",
-		program, depth);
-	exit(26);
+    if (sweep_vals.nback == 0) {
+	sweep_vals.back[sweep_vals.nback++] = cfg.back_history;
     }
-
-    /*
-     * record tally length
-     */
-    ret[0] = values;
-
-    /*
-     * return tally array
-     */
-    return ret;
-}
-
-
-/*
- * alloc_bitslice - allocate and initialize all values given bit position
- *
- * given:
- *	bitnum		bit number in record for which we are allocating
- *	depth	tally depth, in bits
- *
- * returns:
- *	pointer to allocated and initialized bitslice
- *	does not return (exits non-zero) on memory allocation failure
- */
-static struct bitslice *
-alloc_bitslice(int bitnum, int depth)
-{
-    struct bitslice *ret;		/* bit position table */
-    int i;
-
-    /*
-     * firewall
-     */
-    if (depth < 1) {
-	fprintf(stderr, "%s: alloc_bittbl: depth: %d must be > 0\n",
-		program, depth);
-	exit(27);
+    if (sweep_vals.nfactor == 0) {
+	sweep_vals.factor[sweep_vals.nfactor++] = cfg.depth_factor;
     }
+    sweep = (sweep_vals.ndepth > 1 || sweep_vals.nback > 1 ||
+	     sweep_vals.nfactor > 1);
 
     /*
-     * allocate the bitslice
+     * check bit depth, tally with the largest
      */
-    ret = (struct bitslice *)malloc(sizeof(struct bitslice));
-    if (ret == NULL) {
-	fprintf(stderr, "%s: cannot allocate struct bitslice\n", program);
-	exit(28);
+    cfg.bit_depth = sweep_vals.depth[0];
+    for (i=0; i < sweep_vals.ndepth; ++i) {
+	if (sweep_vals.depth[i] < 1) {
+	    fprintf(stderr, "%s: -b bit_depth must be > 0\n", program);
+	    exit(9);
+	}
+	if (sweep_vals.depth[i] > ENT_MAX_DEPTH) {
+	    fprintf(stderr, "%s: -b bit_depth must <= %ld\n",
+		    program, ENT_MAX_DEPTH);
+	    exit(10);
+	}
+	if (sweep_vals.depth[i] > cfg.bit_depth) {
+	    cfg.bit_depth = sweep_vals.depth[i];
+	}
     }
+    dbg(1, "main: bit_depth: %d", cfg.bit_depth);
 
     /*
-     * initialize bitslice
-     */
-    ret->bitnum = bitnum;
-    ret->history = 0;
-    ret->ops = 0;
-    ret->count = 0;
-    ret->back_lim = back_history;
-    ret->depth_lim = depth;
-
-    /*
-     * clear entropy estimates
+     * check back history, tally with the largest
      */
-    for (i=0; i <= MAX_BACK_HISTORY; ++i) {
-	ret->max_ent[i] = INVALID_MAX_ENTROPY;
-	ret->min_ent[i] = INVALID_MIN_ENTROPY;
+    cfg.back_history = sweep_vals.back[0];
+    for (i=0; i < sweep_vals.nback; ++i) {
+	if (sweep_vals.back[i] < 1) {
+	    fprintf(stderr, "%s: -B back_history must be > 0\n", program);
+	    exit(11);
+	}
+	if (sweep_vals.back[i] > ENT_MAX_BACK_HISTORY) {
+	    fprintf(stderr, "%s: -B back_history must <= %ld\n",
+		    program, ENT_MAX_BACK_HISTORY);
+	    exit(12);
+	}
+	if (sweep_vals.back[i] > cfg.back_history) {
+	    cfg.back_history = sweep_vals.back[i];
+	}
     }
-    ret->entropy_high = INVALID_MAX_ENTROPY;
-    ret->entropy_low = INVALID_MIN_ENTROPY;
+    dbg(1, "main: back_history: %d", cfg.back_history);
 
     /*
-     * allocate tally tables for past xor differences
+     * check depth factor
      */
-    for (i=0; i <= back_history; ++i) {
-	ret->hist[i] = alloc_bittally(depth);
-    }
-    while (i <= MAX_BACK_HISTORY) {
-	ret->hist[i++] = NULL;
+    cfg.depth_factor = sweep_vals.factor[0];
+    for (i=0; i < sweep_vals.nfactor; ++i) {
+	if (sweep_vals.factor[i] < 1) {
+	    fprintf(stderr, "%s: -f depth_factor must be > 0\n", program);
+	    exit(13);
+	}
     }
+    dbg(1, "main: depth_factor: %d", cfg.depth_factor);
+    dbg(1, "main: sweep: %d x %d x %d",
+	sweep_vals.ndepth, sweep_vals.nback, sweep_vals.nfactor);
 
     /*
-     * return bitslice
+     * check convergence cycle
      */
-    return ret;
-}
-
-
-/*
- * record_bit - record and tally a bit value for a given bitslice
- *
- * given:
- *	slice	bitslice record for a given bit position in our records
- *	value	next value for the given bit position (0 or 1)
- */
-static void
-record_bit(struct bitslice *slice, int value)
-{
-    int depth;		/* bit depth being processed */
-    int back;		/* number of bits going back into history */
-    u_int32_t offset;	/* tally array offset */
-    u_int32_t cur;	/* current bit values (for a given depth), xor-ed */
-    u_int32_t past;	/* bit values going back into history */
-
-    /*
-     * firewall
-     */
-    if (slice == NULL) {
-	fprintf(stderr, "%s: record_bit: slice is NULL\n", program);
-	exit(29);
+    if (cfg.conv_cycle < 0) {
+	fprintf(stderr, "%s: -z conv_cycle must be >= 0\n", program);
+	exit(40);
     }
+    dbg(1, "main: conv_cycle: %d", cfg.conv_cycle);
 
     /*
-     * push the value onto the history
-     *
-     * The new value is shifted into the 0th bit position of our history.
-     * Bit values are either 0 and 1 (non-zero).
+     * check cache block
      */
-    slice->history <<= 1;
-    if (value != 0) {
-	slice->history |= 1;
+    if (cfg.block < 0 || cfg.block > ENT_BATCH) {
+	fprintf(stderr, "%s: -L block must be >= 0 and <= %d\n",
+		program, ENT_BATCH);
+	exit(59);
     }
+    dbg(1, "main: block: %d", cfg.block);
 
     /*
-     * We do not do anything if we lack a full history.  We want to
-     * be sure that slice->history is full of bit values from actual
-     * records.  Count the bit that we just recorded.
+     * check raw record size, or the record framing
      */
-    if (++slice->ops < back_history+bit_depth) {
+    framing.raw = raw_input;
+    framing.sample = sample;
+    framing.offset = range_offset;
+    framing.length = range_length;
+    framing.records = range_records;
+    framing.io = io_mode;
+    framing.holes = skip_holes;
+    framing.zeros = zero_runs;
+    if (framed) {
+	if (fixed) {
+	    fprintf(stderr, "%s: -r rec_size and -R framing conflict\n",
+		    program);
+	    exit(51);
+	}
+	if (skip_holes || zero_runs) {
+	    fprintf(stderr, "%s: -H and -Z need fixed size records\n",
+		    program);
+	    exit(58);
+	}
+	dbg(1, "main: framing: %d of up to %d octets",
+	       framing.type, framing.rec_size);
 	return;
     }
-    ++slice->count;
-
-    /*
-     * process just the values
-     */
-    for (depth=1, offset=2; depth <= bit_depth; ++depth, offset <<= 1) {
-
-	/* get the i-depth value - (offset-1) is an i-bit mask of 1's */
-	cur = (u_int32_t)slice->history & (offset-1);
-
-	/* tally the i-depth value - no x-or with history in the 0 case */
-	++slice->hist[0][offset + cur];
-
-	/* tally the i-depth value xor-ed with previous history */
-	for (back=1; back <= back_history; ++back) {
-
-	    /* get the i-depth value going back in history h bits */
-	    past = (u_int32_t)(slice->history >> back) & (offset-1);
-
-	    /* tally the i-depth value xor-ed with history back h bits */
-	    ++slice->hist[back][offset + (cur^past)];
-	}
+    if (rec_size <= 0) {
+	fprintf(stderr, "%s: -r rec_size: %d must be > 0\n",
+		program, rec_size);
+	exit(14);
+    }
+    framing.type = RD_FIXED;
+    framing.rec_size = rec_size;
+    if (ent_map_span(map) > rec_size) {
+	fprintf(stderr, "%s: -s select: octet %d is past the end of "
+			"%d octet records\n",
+		program, ent_map_span(map)-1, rec_size);
+	exit(60);
     }
+    dbg(1, "main: binary record size: %d", rec_size);
     return;
 }
 
 
 /*
- * read_record - read the next record from the input file stream
- *
- * given:
- *	input	    input file stream to read
- *	buf	    buffer of buf_size octets if raw_read, else BUFSIZ octets
- *	buf_size    size of raw buffer in octets
+ * run_files - process multiple input files on a pool of workers
  *
- * return:
- *	number of octets read, or -1 ==> error
+ * When given more than one input_file, a directory, or -p, the input
+ * files are processed by rept_files() (see entrept.h).
  *
- * NOTE: We will ensure that the octet beyond the end of the buffer is '\0'.
+ * This function does not return.
  */
-static int
-read_record(FILE *input, u_int8_t *buf, int buf_size)
+static void
+run_files(void)
 {
-    int rec_len;		/* length of raw record in octets */
-
-    /*
-     * setup to read
-     */
-    clearerr(input);
-    errno = 0;
-
-    /*
-     * raw read
-     */
-    rec_len = fread(buf, 1, buf_size, input);
-    if (ferror(input)) {
-	dbg(1, "fread error: %s", strerror(errno));
-    } else if (feof(input)) {
-	if (rec_len > 0) {
-	    dbg(1, "short fread: %d out of %d octets", rec_len, buf_size);
-	} else {
-	    dbg(1, "EOF in fread");
-	}
-    } else if (rec_len <= 0) {
-	dbg(1, "no EOF or error, but fread returned: %d", rec_len);
-	rec_len = -1;	/* force error */
-    } else {
-	dbg(6, "fread %d octets for record %lld",
-		buf_size, (unsigned long)recnum);
-    }
-
-    /*
-     * force trailing '\0'
-     */
-    if (rec_len > 0) {
-	buf[rec_len] = '\0';
-    } else {
-	buf[0] = '\0';
-    }
-
-    /*
-     * return result
-     */
-    return rec_len;
+    struct rept_files rf;	/* input files and how to process them */
+    char errbuf[BUFSIZ+1];	/* rept_files() error message */
+    int failed;			/* number of input files that failed */
+
+    memset(&rf, 0, sizeof(rf));
+    rf.program = program;
+    rf.inputs = &inputs;
+    rf.workers = workers;
+    rf.per_file = per_file;
+    rf.cfg = &cfg;
+    rf.map = map;
+    rf.framing = &framing;
+    rf.sw = sweep ? &sweep_vals : NULL;
+    rf.feed = zero_runs ? feed_runs : NULL;
+    failed = rept_files(&rf, errbuf, sizeof(errbuf));
+    if (failed < 0) {
+	fprintf(stderr, "%s: %s\n", program, errbuf);
+	exit(44);
+    }
+
+    /*
+     * all done!
+     */
+    pool_free(&inputs);
+    ent_map_free(map);
+    dbg(1, "all done!");
+    exit(failed > 0 ? 54 : 0);
 }
 
 
 /*
- * pre_process - convert an input record into bit values to be processed
- *
- * This function will pre-process a raw character based record and produce
- * a bit buffer of bits entropy process.  This function is given records
- * that have just been read and produces a set of 0 and 1 bits that will
- * go into the entropy measurements for a given bit position.
- *
- * The input buffer of a collection of octets starting at "inbuf" and
- * going for inbuf_len octets.  The input buffer may not be a string.
- * The input buffer may not be NUL terminated.
- *
- * The output buffer is a string of octets of either 0x00 or 0x01 value.
- * This function is given a pointer to the output buffer pointer.
- * This function is given a pointer malloc-ed length of outbuf.
- * The output buffer must be a malloc-ed buffer because, if needed,
- * this function will realloc it to a larger size.
+ * feed_runs - feed the records of an open reader, a -Z run at a time
  *
  * given:
- *	inbuf		the raw record buffer
- *	inbuf_len	length of inbuf in octets
- *	outbuf		pointer to a malloc-ed output bit buffer
- *	outbuf_len	pointer to the malloc-ed length of outbuf
+ *	ctx	entropy analysis context
+ *	rd	open reader
  *
  * returns:
- *	the amount of outbuf used
- *
- * NOTE: The inbuf will be altered according to
+ *	0 ==> OK, -1 ==> error, errno is set
  */
 static int
-pre_process(u_int8_t *inbuf, int inbuf_len, u_int8_t **outbuf, int *outbuf_len)
+feed_runs(struct ent_ctx *ctx, struct reader *rd)
 {
-    int orig_inbuf_len = inbuf_len;	/* original inbuf_len value */
-    int outbuf_need;	/* amount of outbuf we will use */
-    int i;
-    u_int8_t *q;
-    u_int8_t *r;
-
-    /*
-     * firewall
-     */
-    if (inbuf == NULL) {
-	fprintf(stderr, "%s: trim_record: inbuf is NULL\n", program);
-	exit(30);
-    }
-    if (inbuf_len < 0) {
-	fprintf(stderr, "%s: trim_record: buf_len <= 0: %d\n",
-		program, inbuf_len);
-	exit(31);
-    }
-    if (outbuf == NULL) {
-	fprintf(stderr, "%s: trim_record: outbuf is NULL\n", program);
-	exit(32);
-    }
-    if (outbuf_len == NULL) {
-	fprintf(stderr, "%s: trim_record: outbuf_len is NULL\n", program);
-	exit(33);
-    }
-    if (*outbuf == NULL) {
-	fprintf(stderr, "%s: trim_record: outbuf points to a NULL\n", program);
-	exit(34);
-    }
-    if (*outbuf_len <= 0) {
-	fprintf(stderr, "%s: trim_record: outbuf_len points to %d <= 0\n",
-		program, *outbuf_len);
-	exit(35);
-    }
-
-    /*
-     * do nothing if input buffer is empty
-     */
-    dbg(9, "pre inbuf len: %d", orig_inbuf_len);
-    if (inbuf_len <= 0) {
-	dbg(5, "trim_record: empty inbuf");
-	return 0;
-    }
-
-    /*
-     * do nothing if trimmed input buffer is empty
-     */
-    if (inbuf_len <= 0) {
-	dbg(5, "trim_record: trimmed inbuf is empty");
-	return 0;
-    }
-
-    /*
-     * determine how many bits we will produce
-     */
-    outbuf_need = 0;
-    for (i=0; i < inbuf_len; ++i) {
-	outbuf_need += strlen(octet_map[inbuf[i]]);
-    }
-
-    /*
-     * do nothing if we will produce no bits
-     */
-    if (outbuf_need <= 0) {
-	dbg(5, "trim_record: line will yield no bits");
-	return 0;
-    }
-
-    /*
-     * be sure we have enough room in our output buffer
-     */
-    if (*outbuf_len < outbuf_need) {
-
-	/* grow output buffer */
-	*outbuf = (u_int8_t *)realloc(*outbuf, outbuf_need+1);
-	if (outbuf == NULL) {
-	    fprintf(stderr, "%s: trim_record: failed to realloc outbuf from "
-			    "%d octets to %d octets\n",
-		    program, *outbuf_len, outbuf_need);
-	    exit(36);
+    u_int8_t *raw_buf;		/* raw record, in the reader buffer */
+    int raw_len;		/* length of the raw record in octets */
+    unsigned long run;		/* records in a row raw_buf stands for */
+    int ret;			/* records read, 0 ==> EOF, -1 ==> error */
+
+    while ((ret = rd_run(rd, &raw_buf, &raw_len, &run)) > 0) {
+	if (ent_feed_run(ctx, raw_buf, raw_len, run) < 0) {
+	    return -1;
 	}
-	dbg(8, "outbuf grew from %d octets to %d octets",
-	       *outbuf_len, outbuf_need);
-	*outbuf_len = outbuf_need;
-	*outbuf[outbuf_need] = '\0';
     }
-
-    /*
-     * load output buffer with 0x00's and 0x01's
-     */
-    r = *outbuf;
-    for (i=0; i < inbuf_len; ++i) {
-	/*
-	 * load 0x01's for every '1' and 0x00's otherwise
-	 */
-	for (q = (u_int8_t *)octet_map[inbuf[i]]; *q != '\0'; ++q) {
-	    *r++ = ((*q == '1') ? 0x01 : 0x00);
-	}
-    }
-    *r = '\0';
-
-    /*
-     * special binary debugging output
-     */
-    if (v_flag >= 7) {
-	r = *outbuf;
-	dbg(7, "initially have %d bits", outbuf_need);
-	fprintf(stderr, "Debug[7]: encoding: ");
-	for (i=0; i < outbuf_need; ++i) {
-	    if (r[i]) {
-		fputc('1', stderr);
-	    } else {
-		fputc('0', stderr);
-	    }
-	}
-	fputc('\n', stderr);
-    }
-
-    /*
-     * return use count
-     */
-    return outbuf_need;
+    return ret;
 }
 
 
 /*
- * rept_entropy - report on current entropy estimate
+ * thaw_handler - SIGUSR1 handler, request that frozen bitslices be thawed
  */
 static void
-rept_entropy(struct bitslice **slice, int bit_buf_used)
+thaw_handler(int sig)
 {
-    unsigned long count;	/* number of bit ops for a bitslice */
-    double inv_count;		/* 1.0/count as a double */
-    int depth_lim;		/* how deep we can calculate entropy */
-    int back_lim;		/* how far back the slice uses history */
-    int bit_num;		/* slice bit number */
-    int hist_num;		/* history level, 0 ==> current */
-    int depth_num;		/* bit depth level */
-    tally_t *tally;		/* tally array for a given bit & history lvl */
-    u_int32_t offset;		/* offset within tally array being used */
-    double p_i;			/* probability of finding an i value */
-    double entropy;		/* entropy sum being calculated */
-    double max_entropy;		/* max entropy found for a given history */
-    int max_ent_depth;		/* depth at which max entropy was found */
-    double min_entropy;		/* min entropy found for a given history */
-    int min_ent_depth;		/* depth at which max entropy was found */
-    double high_bit_ent;	/* high entropy estimate for bit */
-    int high_ent_depth;		/* depth at which max bit entropy was found */
-    int high_ent_hist;		/* hist at which max entropy was found */
-    double low_bit_ent;		/* low entropy estimate for bit */
-    int low_ent_depth;		/* depth at which min bit entropy was found */
-    int low_ent_hist;		/* hist at which min entropy was found */
-    double total_high_ent;	/* overall high entropy total for all bits */
-    int total_high_cnt;		/* number of bits calculating total_high_ent */
-    double total_low_ent;	/* overall low entropy total for all bits */
-    int total_low_cnt;		/* number of bits calculating total_low_ent */
-    int i;
-
-    /*
-     * firewall
-     */
-    if (slice == NULL) {
-	fprintf(stderr, "%s: rept_entropy: slice array is NULL\n", program);
-	exit(37);
-    }
-    if (bit_buf_used <= 0) {
-	dbg(2, "rept_entropy: no bit slices to process\n");
-	return;
-    }
-
-    /*
-     * calculate entropy of each slice
-     */
-    total_high_ent = 0.0;
-    total_high_cnt = 0;
-    total_low_ent = 0.0;
-    total_low_cnt = 0;
-    for (bit_num=0; bit_num < bit_buf_used; ++bit_num) {
-
-	/* firewall */
-	if (slice[bit_num] == NULL) {
-	    dbg(5, "rept_entropy: slice[%d] is NULL", bit_num);
-	    continue;
-	}
-	if (slice[bit_num]->bitnum != bit_num) {
-	    fprintf(stderr, "%s: rept_entropy: slice %d != %d",
-		    program, slice[bit_num]->bitnum, bit_num);
-	    exit(38);
-	}
-
-	/*
-	 * determine the parameters of our count
-	 */
-	count = slice[bit_num]->count;
-	if (count <= 0) {
-	    dbg(9, "rept_entropy: slice[%d] has no count", bit_num);
-	    continue;
-	}
-	inv_count = 1.0 / (double)count;
-	depth_lim = slice[bit_num]->depth_lim;
-	back_lim = slice[bit_num]->back_lim;
-	while (depth_lim > 0 && (count/depth_factor) < (1ULL << depth_lim)) {
-	    --depth_lim;
-	}
-	if (depth_lim <= 0) {
-	    dbg(9, "rept_entropy: slice[%d] has too low of a count: %llu",
-		    bit_num, count);
-	    continue;
-	}
-	dbg(8, "rept_entropy: slice[%d]: count: %lld  depth_lim: %d  back_lim: %d",
-	       bit_num, count, depth_lim, back_lim);
-
-	/*
-	 * setup to calculate high and low entropy estimates for bit
-	 */
-	high_bit_ent = INVALID_MAX_ENTROPY;
-	high_ent_depth = -1;
-	high_ent_hist = -1;
-	low_bit_ent = INVALID_MIN_ENTROPY;
-	low_ent_depth = -1;
-	low_ent_hist = -1;
-
-	/*
-	 * calculate entropy for the back history of this bit
-	 */
-	for (hist_num=0; hist_num <= back_history; ++hist_num) {
-
-	    /*
-	     * setup to process the tally array
-	     */
-	    tally = slice[bit_num]->hist[hist_num];
-	    if (tally == NULL) {
-		fprintf(stderr, "%s: rept_entropy: NULL slice[%d]->hist[%d]",
-			program, bit_num, hist_num);
-		exit(39);
-	    }
-	    max_entropy = INVALID_MAX_ENTROPY;
-	    max_ent_depth = -1;
-	    min_entropy = INVALID_MIN_ENTROPY;
-	    min_ent_depth = -1;
-
-	    /*
-	     * calculate the entropy to appropriate depths
-	     */
-	    for (offset=2, depth_num=1;
-		 depth_num <= depth_lim;
-		 offset <<= 1, ++depth_num) {
-
-		/*
-		 * calculate entropy at this depth
-		 *
-		 * - sum p_i ln_2(p_i);
-		 */
-		entropy = 0.0;
-		for (i=0; i < offset; ++i) {
-
-		    /* ignore of no count */
-		    if (tally[offset+i] > 0) {
-
-			/* probability of find this value at this depth */
-			p_i = (double)tally[offset+i] * inv_count;
-
-			/* add to entropy sum */
-			entropy += p_i * log(p_i);
-		    }
-		}
-		/* entropy is the - sum , and covert log base 2 per bit */
-		entropy = entropy * -INV_LN_2 / depth_num;
-		dbg(9, "rept_entropy: slice[%d]: hist:%d depth:%d: entropy:%f",
-			bit_num, hist_num, depth_num, entropy);
-		if (entropy < 0.0) {
-		    entropy = 0.0;
-		}
-
-		/*
-		 * keep track of maximum and minimum entropy levels
-		 */
-		if (entropy > max_entropy) {
-		    max_entropy = entropy;
-		    max_ent_depth = depth_num;
-		    if (max_entropy > high_bit_ent) {
-			high_bit_ent = max_entropy;
-			high_ent_depth = depth_num;
-			high_ent_hist = hist_num;
-			dbg(6, "rept_entropy: slice[%d]: hist:%d depth:%d "
-			       "new max_entropy:%f",
-			       bit_num, high_ent_hist, high_ent_depth,
-			       high_bit_ent);
-		    }
-		}
-		if (entropy < min_entropy) {
-		    min_entropy = entropy;
-		    min_ent_depth = depth_num;
-		    if (min_entropy < low_bit_ent) {
-			low_bit_ent = min_entropy;
-			low_ent_depth = depth_num;
-			low_ent_hist = hist_num;
-			dbg(6, "rept_entropy: slice[%d]: hist:%d depth:%d "
-			       "new min_entropy:%f",
-			       bit_num, low_ent_hist, low_ent_depth,
-			       low_bit_ent);
-		    }
-		}
-	    }
-
-	    /*
-	     * record entropy for this back history
-	     */
-	    if (max_entropy > INVALID_MAX_ENTROPY) {
-		slice[bit_num]->max_ent[hist_num] = max_entropy;
-		dbg(8, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "max_entropy:%f",
-		       bit_num, hist_num, max_ent_depth, max_entropy);
-	    } else {
-		dbg(7, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "no max_entropy",
-		       bit_num, hist_num, max_ent_depth);
-	    }
-	    if (min_entropy < INVALID_MIN_ENTROPY) {
-		slice[bit_num]->min_ent[hist_num] = min_entropy;
-		dbg(8, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "min_entropy:%f",
-		       bit_num, hist_num, min_ent_depth, min_entropy);
-	    } else {
-		dbg(7, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "no min_entropy",
-		       bit_num, hist_num, min_ent_depth);
-	    }
-	}
-
-	/*
-	 * record entropy for this bit
-	 */
-	if (high_bit_ent > INVALID_MAX_ENTROPY) {
-	    slice[bit_num]->entropy_high = high_bit_ent;
-	    dbg(4, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		    "bit high entropy:%f",
-		   bit_num, high_ent_hist, high_ent_depth,
-		   high_bit_ent);
-	    total_high_ent += high_bit_ent;
-	    ++total_high_cnt;
-	} else {
-	    dbg(5, "rept_entropy: slice[%d]: bit max_entropy unknown",
-		   bit_num);
-	}
-	if (low_bit_ent < INVALID_MIN_ENTROPY) {
-	    slice[bit_num]->entropy_low = low_bit_ent;
-	    dbg(4, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		    "bit low entropy:%f",
-		   bit_num, low_ent_hist, low_ent_depth,
-		   low_bit_ent);
-	    total_low_ent += low_bit_ent;
-	    ++total_low_cnt;
-	} else {
-	    dbg(5, "rept_entropy: slice[%d]: bit min_entropy unknown",
-		   bit_num);
-	}
-    }
-
-    /*
-     * compute overall entropy, if possible
-     */
-    if (total_high_cnt > 0) {
-	overall.high_entropy = total_high_ent;
-	overall.high_bit_cnt = total_high_cnt;
-	dbg(3, "rept_entropy: overall high entropy: %f", overall.high_entropy);
-	dbg(3, "rept_entropy: overall high bits: %d", overall.high_bit_cnt);
-    }
-    if (total_low_cnt > 0) {
-	overall.low_entropy = total_low_ent;
-	overall.low_bit_cnt = total_low_cnt;
-	dbg(3, "rept_entropy: overall low entropy: %f", overall.low_entropy);
-	dbg(3, "rept_entropy: overall low bits: %d", overall.low_bit_cnt);
-    }
-    if (total_high_cnt > 0 && total_low_cnt > 0) {
-	overall.med_entropy = (total_high_ent + total_low_ent) / 2.0;
-	dbg(3, "rept_entropy: overall median entropy: %f",
-	       overall.med_entropy);
-    }
+    thaw_request = 1;
     return;
 }
 
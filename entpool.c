@@ -0,0 +1,383 @@
+/*
+ * entpool - input file lists and a work-stealing pool for entropic tools
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "entpool.h"
+
+
+/*
+ * pool_deque - the jobs still owned by a worker
+ *
+ * The owner takes jobs from the top, in order.  An idle worker steals
+ * from the bottom of some other worker's deque.  Jobs are never added
+ * once the pool is running, so when every deque is empty we are done.
+ */
+struct pool_deque {
+    pthread_mutex_t lock;	/* guards top and bottom */
+    int top;			/* next job the owner will take */
+    int bottom;			/* one beyond the last job */
+};
+struct pool {
+    int workers;		/* number of workers */
+    struct pool_deque *deque;	/* one deque per worker */
+    pool_job *job;		/* job function */
+    void *arg;			/* job function arg */
+};
+struct pool_worker {
+    struct pool *pool;		/* pool this worker belongs to */
+    int worker;			/* worker number */
+};
+
+
+/*
+ * forward declarations
+ */
+static int add_file(struct pool_list *list, const char *path);
+static int add_dir(struct pool_list *list, const char *dir);
+static void *pool_thread(void *arg);
+static int take_job(struct pool *pool, int worker);
+
+
+/*
+ * pool_add_path - add a file, or the files under a directory, to a list
+ *
+ * given:
+ *	list	list of input files to add to
+ *	path	a file, a directory, or - for stdin
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ *
+ * NOTE: Under a directory, only regular files and directories are
+ *	 followed.  Symlinks found under a directory are ignored.
+ */
+int
+pool_add_path(struct pool_list *list, const char *path)
+{
+    struct stat sbuf;		/* path status */
+
+    /*
+     * firewall
+     */
+    if (list == NULL || path == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * - is stdin
+     */
+    if (strcmp(path, "-") == 0) {
+	return add_file(list, path);
+    }
+
+    /*
+     * add a file or walk a directory
+     */
+    if (stat(path, &sbuf) < 0) {
+	return -1;
+    }
+    if (S_ISDIR(sbuf.st_mode)) {
+	return add_dir(list, path);
+    }
+    return add_file(list, path);
+}
+
+
+/*
+ * pool_free - free the paths of a list of input files
+ *
+ * given:
+ *	list	list of input files
+ */
+void
+pool_free(struct pool_list *list)
+{
+    int i;
+
+    if (list == NULL) {
+	return;
+    }
+    for (i=0; i < list->len; ++i) {
+	free(list->path[i]);
+    }
+    if (list->path != NULL) {
+	free(list->path);
+    }
+    list->path = NULL;
+    list->len = 0;
+    list->size = 0;
+    return;
+}
+
+
+/*
+ * pool_run - run jobs on a work-stealing pool of threads
+ *
+ * Jobs are dealt out in contiguous blocks, one block per worker.  A
+ * worker that runs out of jobs steals from the end of another worker's
+ * block, so a few large inputs do not leave the other workers idle.
+ *
+ * The calling thread is worker 0.  If a worker thread cannot be
+ * created, its jobs are stolen by the other workers.
+ *
+ * given:
+ *	workers	number of workers, 1 to MAX_WORKERS
+ *	jobs	number of jobs
+ *	job	function to run for each job
+ *	arg	passed to job
+ *
+ * returns:
+ *	0 ==> all jobs run, -1 ==> error, errno is set
+ */
+int
+pool_run(int workers, int jobs, pool_job *job, void *arg)
+{
+    struct pool pool;		/* the pool */
+    struct pool_worker w[MAX_WORKERS];	/* per worker args */
+    pthread_t tid[MAX_WORKERS];	/* worker threads */
+    int started[MAX_WORKERS];	/* 1 ==> thread was created */
+    int i;
+
+    /*
+     * firewall
+     */
+    if (workers < 1 || workers > MAX_WORKERS || jobs < 0 || job == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (workers > jobs) {
+	workers = (jobs > 0) ? jobs : 1;
+    }
+
+    /*
+     * deal out the jobs
+     */
+    pool.workers = workers;
+    pool.job = job;
+    pool.arg = arg;
+    pool.deque = (struct pool_deque *)calloc(workers,
+					     sizeof(struct pool_deque));
+    if (pool.deque == NULL) {
+	return -1;
+    }
+    for (i=0; i < workers; ++i) {
+	pthread_mutex_init(&pool.deque[i].lock, NULL);
+	pool.deque[i].top = (int)(((long long)jobs * i) / workers);
+	pool.deque[i].bottom = (int)(((long long)jobs * (i+1)) / workers);
+	w[i].pool = &pool;
+	w[i].worker = i;
+	started[i] = 0;
+    }
+
+    /*
+     * run the workers, this thread being worker 0
+     */
+    for (i=1; i < workers; ++i) {
+	if (pthread_create(&tid[i], NULL, pool_thread, &w[i]) == 0) {
+	    started[i] = 1;
+	}
+    }
+    (void) pool_thread(&w[0]);
+    for (i=1; i < workers; ++i) {
+	if (started[i]) {
+	    (void) pthread_join(tid[i], NULL);
+	}
+    }
+
+    /*
+     * cleanup
+     */
+    for (i=0; i < workers; ++i) {
+	pthread_mutex_destroy(&pool.deque[i].lock);
+    }
+    free(pool.deque);
+    return 0;
+}
+
+
+/*
+ * add_file - append a path to a list of input files
+ *
+ * given:
+ *	list	list of input files
+ *	path	path to append
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+add_file(struct pool_list *list, const char *path)
+{
+    char **p;
+
+    if (list->len >= list->size) {
+	p = (char **)realloc(list->path,
+			     (list->size*2 + 16) * sizeof(char *));
+	if (p == NULL) {
+	    return -1;
+	}
+	list->path = p;
+	list->size = list->size*2 + 16;
+    }
+    list->path[list->len] = strdup(path);
+    if (list->path[list->len] == NULL) {
+	return -1;
+    }
+    ++list->len;
+    return 0;
+}
+
+
+/*
+ * add_dir - append the regular files under a directory, in sorted order
+ *
+ * given:
+ *	list	list of input files
+ *	dir	directory to walk
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+add_dir(struct pool_list *list, const char *dir)
+{
+    struct dirent **names;	/* sorted directory entries */
+    struct stat sbuf;		/* entry status */
+    char *path;			/* path of entry */
+    int n;			/* number of entries */
+    int ret;			/* return value */
+    int i;
+
+    n = scandir(dir, &names, NULL, alphasort);
+    if (n < 0) {
+	return -1;
+    }
+    ret = 0;
+    for (i=0; i < n; ++i) {
+	if (ret == 0 &&
+	    strcmp(names[i]->d_name, ".") != 0 &&
+	    strcmp(names[i]->d_name, "..") != 0) {
+	    path = (char *)malloc(strlen(dir) + 1 + strlen(names[i]->d_name) + 1);
+	    if (path == NULL) {
+		ret = -1;
+	    } else {
+		sprintf(path, "%s/%s", dir, names[i]->d_name);
+		if (lstat(path, &sbuf) < 0) {
+		    ret = -1;
+		} else if (S_ISDIR(sbuf.st_mode)) {
+		    ret = add_dir(list, path);
+		} else if (S_ISREG(sbuf.st_mode)) {
+		    ret = add_file(list, path);
+		}
+		free(path);
+	    }
+	}
+	free(names[i]);
+    }
+    free(names);
+    return ret;
+}
+
+
+/*
+ * pool_thread - run jobs until there are none left
+ *
+ * given:
+ *	arg	struct pool_worker of this worker
+ *
+ * returns:
+ *	NULL
+ */
+static void *
+pool_thread(void *arg)
+{
+    struct pool_worker *w = (struct pool_worker *)arg;	/* this worker */
+    int job;			/* job to run */
+
+    while ((job = take_job(w->pool, w->worker)) >= 0) {
+	w->pool->job(w->worker, job, w->pool->arg);
+    }
+    return NULL;
+}
+
+
+/*
+ * take_job - take our next job, or steal one
+ *
+ * given:
+ *	pool	the pool
+ *	worker	worker number
+ *
+ * returns:
+ *	job number, or -1 ==> no jobs remain
+ */
+static int
+take_job(struct pool *pool, int worker)
+{
+    struct pool_deque *d;	/* deque being taken from */
+    int job;			/* job taken */
+    int i;
+
+    /*
+     * take from the top of our own deque
+     */
+    d = &pool->deque[worker];
+    pthread_mutex_lock(&d->lock);
+    job = (d->top < d->bottom) ? d->top++ : -1;
+    pthread_mutex_unlock(&d->lock);
+    if (job >= 0) {
+	return job;
+    }
+
+    /*
+     * steal from the bottom of another deque
+     */
+    for (i=1; i < pool->workers; ++i) {
+	d = &pool->deque[(worker + i) % pool->workers];
+	pthread_mutex_lock(&d->lock);
+	job = (d->top < d->bottom) ? --d->bottom : -1;
+	pthread_mutex_unlock(&d->lock);
+	if (job >= 0) {
+	    return job;
+	}
+    }
+    return -1;
+}
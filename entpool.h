@@ -0,0 +1,80 @@
+/*
+ * entpool.h - input file lists and a work-stealing pool for entropic tools
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+#if !defined(INCLUDE_ENTPOOL_H)
+#define INCLUDE_ENTPOOL_H
+
+#include <stddef.h>
+
+
+/*
+ * MAX_WORKERS	the most worker threads a pool may use
+ */
+#define MAX_WORKERS 256
+
+
+/*
+ * pool_list - list of input files
+ *
+ * A directory given to pool_add_path() is replaced by the regular files
+ * found under it, in sorted order.
+ */
+struct pool_list {
+    char **path;		/* malloc-ed file paths */
+    int len;			/* number of paths */
+    int size;			/* malloc-ed size of path */
+};
+
+
+/*
+ * pool_job - process one job of a pool
+ *
+ * given:
+ *	worker	worker number, 0 to workers-1
+ *	job	job number, 0 to jobs-1
+ *	arg	the arg given to pool_run()
+ *
+ * A job may not run in the same worker thread as the job before it.
+ * All state that a job keeps from one job to the next should be
+ * indexed by worker.
+ */
+typedef void (pool_job)(int worker, int job, void *arg);
+
+
+/*
+ * external functions
+ */
+extern int pool_add_path(struct pool_list *list, const char *path);
+extern void pool_free(struct pool_list *list);
+extern int pool_run(int workers, int jobs, pool_job *job, void *arg);
+
+#endif /* INCLUDE_ENTPOOL_H */
@@ -0,0 +1,3092 @@
+/*
+ * entread - record readers for entropic tools
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+/* for O_DIRECT */
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(HAVE_LZMA)
+#include <lzma.h>
+#endif
+#if defined(HAVE_ZSTD)
+#include <zstd.h>
+#endif
+#if defined(HAVE_IO_URING)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "entread.h"
+
+
+/*
+ * compressed input formats
+ */
+#define ZIN_GZIP 1
+#define ZIN_XZ 2
+#define ZIN_ZSTD 3
+
+
+/*
+ * zinput - a compressed input and the thread that decompresses it
+ *
+ * The thread fills the blocks from head+count onward, while the reader
+ * takes octets from the block at head.  The thread waits while all
+ * RD_ZBLOCKS blocks are full, and the reader waits while none are.
+ * Only head, count, done, err, stop, made and used are shared, under
+ * lock.  made and used give the RD_DEADLINE pace the compression ratio.
+ */
+struct zinput {
+    pthread_t thread;		/* decompression thread */
+    pthread_mutex_t lock;	/* guards head, count, done, err, stop, ... */
+    pthread_cond_t cond;	/* a block was filled or emptied */
+    int fd;			/* compressed input file */
+    int type;			/* ZIN_GZIP, ZIN_XZ or ZIN_ZSTD */
+    u_int8_t *in;		/* malloc-ed compressed input buffer */
+    size_t in_size;		/* size of in */
+    size_t in_pos;		/* start of the undecompressed input */
+    size_t in_len;		/* end of the input read */
+    int in_eof;			/* 1 ==> no more input to read */
+    int io;			/* RD_IO_CACHE, ... */
+    off_t in_off;		/* input offset of the end of in */
+    off_t dropped;		/* RD_IO_NOCACHE pages dropped before */
+    int tee;			/* > 0 ==> copy the input read to this fd */
+    off_t teed;			/* input octets copied to tee */
+    int clean;			/* 1 ==> input ends at the end of a stream */
+    u_int8_t *blk[RD_ZBLOCKS];	/* malloc-ed decompressed blocks */
+    size_t blk_len[RD_ZBLOCKS];	/* octets in each block */
+    int head;			/* block the reader takes octets from */
+    int count;			/* full blocks from head onward */
+    size_t off;			/* octets already taken from the head block */
+    int done;			/* 1 ==> no more blocks will be filled */
+    int err;			/* errno of a failed decompression, or 0 */
+    int stop;			/* 1 ==> the reader asks the thread to end */
+    off_t made;			/* octets decompressed into blocks */
+    off_t used;			/* compressed octets they were made from */
+#if defined(HAVE_ZLIB)
+    z_stream gz;		/* gzip decompression state */
+#endif
+#if defined(HAVE_LZMA)
+    lzma_stream xz;		/* xz decompression state */
+#endif
+#if defined(HAVE_ZSTD)
+    ZSTD_DStream *zs;		/* zstd decompression state */
+#endif
+};
+
+
+/*
+ * uring - RD_IO_URING reads kept in flight
+ *
+ * Block i is read at blk_off[i].  Blocks are read in file order from
+ * head onward, and the reader takes octets from the block at head.
+ * Once it is empty it is read again, RD_QDEPTH blocks further on.
+ */
+#define U_IDLE 0		/* block not being read */
+#define U_BUSY 1		/* block read in flight */
+#define U_DONE 2		/* block read, res is its result */
+
+#if defined(HAVE_IO_URING)
+struct uring {
+    int ring_fd;		/* io_uring, from io_uring_setup */
+    int fd;			/* input file */
+    unsigned *sq_head;		/* submission ring head */
+    unsigned *sq_tail;		/* submission ring tail */
+    unsigned *sq_mask;		/* submission ring index mask */
+    unsigned *sq_array;		/* submission ring of sqe indexes */
+    unsigned *cq_head;		/* completion ring head */
+    unsigned *cq_tail;		/* completion ring tail */
+    unsigned *cq_mask;		/* completion ring index mask */
+    struct io_uring_sqe *sqes;	/* submission queue entries */
+    struct io_uring_cqe *cqes;	/* completion queue entries */
+    void *sq_ring;		/* mmap-ed submission ring */
+    size_t sq_ring_len;		/* length of sq_ring */
+    void *cq_ring;		/* mmap-ed completion ring, or sq_ring */
+    size_t cq_ring_len;		/* length of cq_ring */
+    size_t sqes_len;		/* length of sqes */
+    u_int8_t *blk;		/* RD_QDEPTH aligned blocks of RD_QBLOCK */
+    int fixed;			/* 1 ==> blk is a registered buffer */
+    int state[RD_QDEPTH];	/* U_IDLE, U_BUSY or U_DONE */
+    int res[RD_QDEPTH];		/* U_DONE octets read, or -errno */
+    off_t blk_off[RD_QDEPTH];	/* input offset each block is read at */
+    off_t next_off;		/* input offset of the next block to read */
+    int head;			/* block the reader takes octets from */
+    size_t off;			/* octets already taken from the head block */
+    int inflight;		/* U_BUSY blocks */
+};
+#endif
+
+
+/*
+ * slot - a record kept in an RD_RESERVOIR sample
+ */
+struct slot {
+    unsigned long index;	/* record number in the input, 1st is 0 */
+    u_int8_t *rec;		/* malloc-ed record, NUL terminated */
+    int len;			/* record length */
+    int size;			/* octets that fit in rec, with its NUL */
+};
+
+
+/*
+ * reader - an input file and the buffer its records are found in
+ *
+ * The octets of buf from pos up to len have been read but not yet
+ * returned.  When the next record is not all in the buffer, the unread
+ * octets are moved to the front of buf and more are read after them.
+ * The buffer holds at least one record of the longest length plus its
+ * length or delimiter, so a record is always whole in the buffer.
+ *
+ * The octet after the last record returned is saved in held_octet and
+ * replaced with a NUL, until the next record is asked for.
+ */
+struct reader {
+    struct rd_framing fr;	/* how records are found */
+    int fd;			/* input file, -1 ==> not open */
+    u_int8_t *buf;		/* malloc-ed buffer of size+1 octets */
+    size_t size;		/* octets that may be read into buf */
+    size_t pos;			/* start of the unreturned octets */
+    size_t len;			/* end of the octets read */
+    int eof;			/* 1 ==> no more octets to read */
+    u_int8_t *held;		/* octet replaced with a NUL, or NULL */
+    u_int8_t held_octet;	/* value of the octet replaced */
+    struct zinput *z;		/* decompressed input, or NULL */
+    struct uring *u;		/* RD_IO_URING reads in flight, or NULL */
+    unsigned long seen;		/* records found in this input */
+    unsigned long taken;	/* records sampled from this input */
+    long every;			/* RD_EVERY or RD_DEADLINE N */
+    long left;			/* records to pass over before the next sample */
+    u_int32_t threshold;	/* RD_HASH records hashing below are sampled */
+    u_int64_t rand;		/* RD_RESERVOIR random state */
+    struct slot *slot;		/* RD_RESERVOIR sample, or NULL */
+    long slots;			/* records in the sample */
+    long replay;		/* next slot to return, -1 ==> still reading */
+    off_t total;		/* RD_DEADLINE input size, 0 ==> unknown */
+    double opened;		/* RD_DEADLINE time the input was opened */
+    double deadline;		/* RD_DEADLINE time to be done by */
+    unsigned long check;	/* RD_DEADLINE seen count of the next check */
+    off_t base;			/* input offset of buf[0] */
+    off_t end;			/* records start before, 0 ==> EOF */
+    int io;			/* RD_IO_CACHE, ... for the open input */
+    size_t align;		/* RD_ALIGN ==> O_DIRECT, 1 ==> not */
+    off_t dropped;		/* RD_IO_NOCACHE pages dropped before */
+    off_t hole;			/* next hole starts at, -1 ==> none or not sought */
+    unsigned long zrun;		/* hole records left to return as zero records */
+    u_int8_t *zero;		/* all-zero RD_FIXED record, or NULL */
+    char *path;			/* followed input file, or NULL */
+    int ino;			/* inotify of the followed file, -1 ==> none */
+    int last;			/* 1 ==> followed file was replaced, the partial
+				 * record left is its last */
+    off_t teed;			/* input octets copied to fr.tee */
+    int splice;			/* 1 ==> input and fr.tee are pipes, use tee(2) */
+    int pin;			/* 1 ==> rd_batch records are in buf, do not fill */
+};
+
+
+/*
+ * forward declarations
+ */
+static int find_record(struct reader *rd, u_int8_t **rec, int *len,
+		       size_t *used);
+static u_int8_t *find_delim(const struct rd_framing *fr,
+			    u_int8_t *p, size_t avail);
+static int fill(struct reader *rd);
+static ssize_t splice_read(struct reader *rd, size_t want);
+static int pass_hole(struct reader *rd);
+static off_t next_hole(struct reader *rd, off_t at);
+static int follow_check(struct reader *rd);
+static int tee_write(int fd, const u_int8_t *p, size_t n, off_t at,
+		     off_t *teed);
+static void follow_watch(struct reader *rd);
+static int next_record(struct reader *rd, u_int8_t **rec, int *len);
+static int sampled(struct reader *rd, u_int8_t **rec, int *len);
+static int reservoir(struct reader *rd, u_int8_t **rec, int *len);
+static long skip_fixed(struct reader *rd, long n);
+static int pace(struct reader *rd);
+static double now(void);
+static int slot_cmp(const void *a, const void *b);
+static int detect(struct reader *rd);
+static int seek_range(struct reader *rd);
+static void advise(int fd, int io, off_t at, size_t next, off_t *dropped);
+static int u_start(struct reader *rd);
+static void u_stop(struct reader *rd);
+#if defined(HAVE_IO_URING)
+static ssize_t u_read(struct uring *u, u_int8_t *dst, size_t len);
+static int u_submit(struct uring *u, int i);
+static int u_wait(struct uring *u);
+static int u_restart(struct uring *u, off_t at);
+#endif
+static int z_start(struct reader *rd, int type);
+static void z_stop(struct reader *rd);
+static ssize_t z_read(struct zinput *z, u_int8_t *dst, size_t len);
+static void *z_thread(void *arg);
+static ssize_t z_inflate(struct zinput *z, u_int8_t *out, size_t size,
+			 int *end);
+#if defined(HAVE_ZLIB) || defined(HAVE_LZMA) || defined(HAVE_ZSTD)
+static int z_refill(struct zinput *z);
+#endif
+static void z_free(struct zinput *z);
+
+
+/*
+ * rd_framing - parse a record framing name
+ *
+ * given:
+ *	arg	nul, u32, varint or delim:string
+ *	fr	where to put the framing
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> unknown framing or bad delimiter
+ *
+ * A delim:string may use the escapes \n \r \t \0 \\ and \xHH.
+ */
+int
+rd_framing(const char *arg, struct rd_framing *fr)
+{
+    const char *p;		/* next char of the delimiter */
+    char hex[3];		/* \xHH digits */
+    char *end;			/* end of the \xHH digits */
+
+    /*
+     * firewall
+     */
+    if (arg == NULL || fr == NULL) {
+	return -1;
+    }
+    memset(fr, 0, sizeof(*fr));
+    fr->rec_size = RD_MAX_REC;
+
+    /*
+     * fixed names
+     */
+    if (strcmp(arg, "nul") == 0) {
+	fr->type = RD_NUL;
+	return 0;
+    } else if (strcmp(arg, "u32") == 0) {
+	fr->type = RD_U32;
+	return 0;
+    } else if (strcmp(arg, "varint") == 0) {
+	fr->type = RD_VARINT;
+	return 0;
+    } else if (strncmp(arg, "delim:", sizeof("delim:")-1) != 0) {
+	return -1;
+    }
+
+    /*
+     * delim:string
+     */
+    fr->type = RD_DELIM;
+    for (p = arg + sizeof("delim:")-1; *p != '\0'; ++p) {
+	if (fr->delim_len >= RD_MAX_DELIM) {
+	    return -1;
+	}
+	if (*p != '\\') {
+	    fr->delim[fr->delim_len++] = (u_int8_t)*p;
+	    continue;
+	}
+	switch (*++p) {
+	case 'n':
+	    fr->delim[fr->delim_len++] = '\n';
+	    break;
+	case 'r':
+	    fr->delim[fr->delim_len++] = '\r';
+	    break;
+	case 't':
+	    fr->delim[fr->delim_len++] = '\t';
+	    break;
+	case '0':
+	    fr->delim[fr->delim_len++] = '\0';
+	    break;
+	case '\\':
+	    fr->delim[fr->delim_len++] = '\\';
+	    break;
+	case 'x':
+	    if (p[1] == '\0' || p[2] == '\0') {
+		return -1;
+	    }
+	    hex[0] = p[1];
+	    hex[1] = p[2];
+	    hex[2] = '\0';
+	    fr->delim[fr->delim_len++] = (u_int8_t)strtol(hex, &end, 16);
+	    if (*end != '\0') {
+		return -1;
+	    }
+	    p += 2;
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    return (fr->delim_len > 0) ? 0 : -1;
+}
+
+
+/*
+ * rd_sample - parse a record sampling
+ *
+ * given:
+ *	arg	every:N, hash:fraction, reservoir:K or deadline:seconds
+ *	sp	where to put the sampling
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> unknown sampling or bad value
+ */
+int
+rd_sample(const char *arg, struct rd_sample *sp)
+{
+    const char *val;		/* value after the : */
+    char *end;			/* end of the value */
+
+    /*
+     * firewall
+     */
+    if (arg == NULL || sp == NULL) {
+	return -1;
+    }
+    memset(sp, 0, sizeof(*sp));
+    val = strchr(arg, ':');
+    if (val == NULL || *++val == '\0') {
+	return -1;
+    }
+    errno = 0;
+
+    /*
+     * name:value
+     */
+    if (strncmp(arg, "every:", sizeof("every:")-1) == 0) {
+	sp->type = RD_EVERY;
+	sp->every = strtol(val, &end, 0);
+	return (*end != '\0' || errno != 0 || sp->every < 1) ? -1 : 0;
+    } else if (strncmp(arg, "hash:", sizeof("hash:")-1) == 0) {
+	sp->type = RD_HASH;
+	sp->fraction = strtod(val, &end);
+	return (*end != '\0' || errno != 0 ||
+		!(sp->fraction > 0.0 && sp->fraction <= 1.0)) ? -1 : 0;
+    } else if (strncmp(arg, "reservoir:", sizeof("reservoir:")-1) == 0) {
+	sp->type = RD_RESERVOIR;
+	sp->reservoir = strtol(val, &end, 0);
+	return (*end != '\0' || errno != 0 || sp->reservoir < 1 ||
+		sp->reservoir > RD_MAX_RESERVOIR) ? -1 : 0;
+    } else if (strncmp(arg, "deadline:", sizeof("deadline:")-1) == 0) {
+	sp->type = RD_DEADLINE;
+	sp->budget = strtod(val, &end);
+	return (*end != '\0' || errno != 0 ||
+		!(sp->budget > 0.0)) ? -1 : 0;
+    }
+    return -1;
+}
+
+
+/*
+ * rd_io - parse how input files are read
+ *
+ * given:
+ *	arg	cache, nocache, direct or uring
+ *
+ * returns:
+ *	RD_IO_CACHE, RD_IO_NOCACHE, RD_IO_DIRECT or RD_IO_URING,
+ *	-1 ==> unknown
+ */
+int
+rd_io(const char *arg)
+{
+    if (arg == NULL) {
+	return -1;
+    } else if (strcmp(arg, "cache") == 0) {
+	return RD_IO_CACHE;
+    } else if (strcmp(arg, "nocache") == 0) {
+	return RD_IO_NOCACHE;
+    } else if (strcmp(arg, "direct") == 0) {
+	return RD_IO_DIRECT;
+    } else if (strcmp(arg, "uring") == 0) {
+	return RD_IO_URING;
+    }
+    return -1;
+}
+
+
+/*
+ * rd_new - allocate a reader
+ *
+ * given:
+ *	fr	how records are found
+ *
+ * returns:
+ *	reader, not yet open, or NULL ==> error, errno is set
+ */
+struct reader *
+rd_new(const struct rd_framing *fr)
+{
+    struct reader *rd;		/* new reader */
+
+    /*
+     * firewall
+     */
+    if (fr == NULL || fr->rec_size <= 0 ||
+	(fr->type == RD_DELIM &&
+	 (fr->delim_len < 1 || fr->delim_len > RD_MAX_DELIM))) {
+	errno = EINVAL;
+	return NULL;
+    }
+
+    /*
+     * allocate the reader and its buffer
+     *
+     * The buffer holds the longest record, and its length or delimiter.
+     */
+    rd = (struct reader *)calloc(1, sizeof(struct reader));
+    if (rd == NULL) {
+	return NULL;
+    }
+    rd->fr = *fr;
+    rd->fd = -1;
+    rd->ino = -1;
+    rd->size = (size_t)fr->rec_size + RD_MAX_DELIM + sizeof(u_int32_t) + 1;
+    if (rd->size < RD_BUF) {
+	rd->size = RD_BUF;
+    }
+    if (fr->io == RD_IO_DIRECT) {
+	/* room to align the unreturned octets and a whole read after them */
+	rd->size += 2*RD_ALIGN;
+	if (posix_memalign((void **)&rd->buf, RD_ALIGN, rd->size + 1) != 0) {
+	    rd->buf = NULL;
+	}
+    } else {
+	rd->buf = (u_int8_t *)malloc(rd->size + 1);
+    }
+    if (rd->buf == NULL) {
+	free(rd);
+	return NULL;
+    }
+    if (fr->type == RD_FIXED && (fr->holes || fr->zeros)) {
+	rd->zero = (u_int8_t *)calloc((size_t)fr->rec_size + 1, 1);
+	if (rd->zero == NULL) {
+	    free(rd->buf);
+	    free(rd);
+	    return NULL;
+	}
+    }
+
+    /*
+     * set up the sampling
+     *
+     * The RD_DEADLINE budget starts now, for all inputs of the reader.
+     */
+    if (fr->sample.type == RD_RESERVOIR) {
+	if (fr->sample.reservoir < 1 ||
+	    fr->sample.reservoir > RD_MAX_RESERVOIR) {
+	    free(rd->buf);
+	    free(rd->zero);
+	    free(rd);
+	    errno = EINVAL;
+	    return NULL;
+	}
+	rd->slot = (struct slot *)calloc(fr->sample.reservoir,
+					 sizeof(struct slot));
+	if (rd->slot == NULL) {
+	    free(rd->buf);
+	    free(rd->zero);
+	    free(rd);
+	    return NULL;
+	}
+    } else if (fr->sample.type == RD_HASH) {
+	rd->threshold = (fr->sample.fraction >= 1.0) ? 0xffffffffU :
+	    (u_int32_t)(fr->sample.fraction * 4294967296.0);
+    } else if (fr->sample.type == RD_DEADLINE) {
+	rd->deadline = now() + fr->sample.budget;
+    }
+    return rd;
+}
+
+
+/*
+ * rd_open - open an input file for reading records
+ *
+ * given:
+ *	rd	reader, closed
+ *	path	file to read, - ==> stdin
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+int
+rd_open(struct reader *rd, const char *path)
+{
+    /*
+     * firewall
+     */
+    if (rd == NULL || path == NULL || rd->fd >= 0) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * open, O_DIRECT if asked for and the file system has it
+     */
+    if (strcmp(path, "-") == 0) {
+	rd->fd = 0;
+    } else {
+	rd->fd = -1;
+	if (rd->fr.io == RD_IO_DIRECT && !rd->fr.follow) {
+	    rd->fd = open(path, O_RDONLY | O_DIRECT);
+	    if (rd->fd < 0 && errno != EINVAL) {
+		return -1;
+	    }
+	}
+	if (rd->fd < 0) {
+	    rd->fd = open(path, O_RDONLY);
+	    if (rd->fd < 0) {
+		return -1;
+	    }
+	}
+	if (rd->fr.follow) {
+	    rd->path = strdup(path);
+	    if (rd->path == NULL) {
+		(void) close(rd->fd);
+		rd->fd = -1;
+		return -1;
+	    }
+	}
+    }
+    rd->last = 0;
+    rd->teed = 0;
+    return detect(rd);
+}
+
+
+/*
+ * rd_next - return the next record
+ *
+ * given:
+ *	rd	open reader
+ *	rec	where to put a pointer to the record
+ *	len	where to put the length of the record
+ *
+ * returns:
+ *	1 ==> a record, 0 ==> EOF, -1 ==> error, errno is set
+ *
+ * NOTE: The record is in the reader buffer and is followed by a NUL.
+ *	 The record and that NUL may be changed, and are valid until
+ *	 the next call on this reader.
+ *
+ * NOTE: An input that ends in the middle of an RD_U32 or RD_VARINT
+ *	 record is an error (EIO), as is a length longer than rec_size
+ *	 (EMSGSIZE).
+ */
+int
+rd_next(struct reader *rd, u_int8_t **rec, int *len)
+{
+    int ret;
+
+    /*
+     * firewall
+     */
+    if (rd == NULL || rec == NULL || len == NULL || rd->fd < 0) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * return the next sampled record
+     */
+    switch (rd->fr.sample.type) {
+    case RD_ALL:
+	ret = next_record(rd, rec, len);
+	if (ret > 0) {
+	    ++rd->seen;
+	    ++rd->taken;
+	}
+	return ret;
+    case RD_RESERVOIR:
+	return reservoir(rd, rec, len);
+    default:
+	return sampled(rd, rec, len);
+    }
+}
+
+
+/*
+ * rd_run - return the next record, and how many times in a row it repeats
+ *
+ * given:
+ *	rd	open reader
+ *	rec	where to put a pointer to the record
+ *	len	where to put the length of the record
+ *	count	where to put how many records in a row *rec stands for
+ *
+ * returns:
+ *	1 ==> a record, 0 ==> EOF, -1 ==> error, errno is set
+ *
+ * With zeros framing, RD_FIXED records and no sampling, a run of
+ * all-zero records is returned as one zero record, whether they are
+ * in the buffer or passed over in a hole.  Otherwise *count is 1.
+ */
+int
+rd_run(struct reader *rd, u_int8_t **rec, int *len, unsigned long *count)
+{
+    size_t size;		/* record size */
+    int ret;
+
+    /*
+     * firewall
+     */
+    if (count == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+    *count = 1;
+
+    /*
+     * the next record, which may be the 1st of a run
+     */
+    ret = rd_next(rd, rec, len);
+    if (ret <= 0 || !rd->fr.zeros || rd->zero == NULL ||
+	rd->fr.sample.type != RD_ALL) {
+	return ret;
+    }
+    size = (size_t)rd->fr.rec_size;
+
+    /*
+     * the rest of the zero records of a hole
+     */
+    if (*rec == rd->zero) {
+	*count += rd->zrun;
+	rd->seen += rd->zrun;
+	rd->taken += rd->zrun;
+	rd->zrun = 0;
+	return ret;
+    }
+
+    /*
+     * zero records that follow in the buffer
+     */
+    if ((size_t)*len != size || memcmp(*rec, rd->zero, size) != 0) {
+	return ret;
+    }
+    if (rd->held != NULL) {
+	*rd->held = rd->held_octet;
+	rd->held = NULL;
+    }
+    *rec = rd->zero;
+    while (rd->len - rd->pos >= size &&
+	   memcmp(rd->buf + rd->pos, rd->zero, size) == 0 &&
+	   (rd->end == 0 || rd->base + (off_t)rd->pos < rd->end) &&
+	   (rd->fr.records == 0 || rd->seen < rd->fr.records)) {
+	rd->pos += size;
+	++rd->seen;
+	++rd->taken;
+	++*count;
+    }
+    return ret;
+}
+
+
+/*
+ * rd_batch - return a batch of the next records
+ *
+ * given:
+ *	rd	open reader
+ *	rec	rec[i] is where to put a pointer to the ith record
+ *	len	len[i] is where to put the length of the ith record
+ *	n	most records to return, >= 1
+ *
+ * returns:
+ *	records returned, 0 ==> EOF, -1 ==> error, errno is set
+ *
+ * The records are those that n calls of rd_next() would return, but
+ * a batch ends early rather than read into the buffer that holds the
+ * records before.  So a batch is at least 1 record, unless at EOF.
+ *
+ * NOTE: The records are in the reader buffer, and are valid until the
+ *	 next call on this reader.  Only the last record is followed by
+ *	 a NUL, and the records must not be changed.
+ */
+int
+rd_batch(struct reader *rd, u_int8_t **rec, int *len, int n)
+{
+    int ret;
+    int i;
+
+    /*
+     * firewall
+     */
+    if (rd == NULL || rec == NULL || len == NULL || n < 1 || rd->fd < 0) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * once the 1st record is found, the buffer may not be filled
+     */
+    for (i=0, ret=1; i < n; ++i) {
+	switch (rd->fr.sample.type) {
+	case RD_ALL:
+	    ret = next_record(rd, &rec[i], &len[i]);
+	    if (ret > 0) {
+		++rd->seen;
+		++rd->taken;
+	    }
+	    break;
+	case RD_RESERVOIR:
+	    ret = reservoir(rd, &rec[i], &len[i]);
+	    break;
+	default:
+	    ret = sampled(rd, &rec[i], &len[i]);
+	    break;
+	}
+	if (ret <= 0) {
+	    break;
+	}
+	rd->pin = 1;
+    }
+    rd->pin = 0;
+    return (ret < 0) ? -1 : i;
+}
+
+
+/*
+ * rd_rewind - go back to the start of the input file
+ *
+ * given:
+ *	rd	open reader
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set (ESPIPE ==> not seekable)
+ */
+int
+rd_rewind(struct reader *rd)
+{
+    if (rd == NULL || rd->fd < 0) {
+	errno = EINVAL;
+	return -1;
+    }
+    z_stop(rd);
+    u_stop(rd);
+    if (lseek(rd->fd, (off_t)0, SEEK_SET) < 0) {
+	return -1;
+    }
+    return detect(rd);
+}
+
+
+/*
+ * rd_counts - return how many records were found and sampled
+ *
+ * given:
+ *	rd	reader
+ *	seen	where to put the records found in the current input
+ *	taken	where to put the records of it that were sampled
+ */
+void
+rd_counts(const struct reader *rd, unsigned long *seen, unsigned long *taken)
+{
+    if (rd == NULL || seen == NULL || taken == NULL) {
+	return;
+    }
+    *seen = rd->seen;
+    *taken = rd->taken;
+    return;
+}
+
+
+/*
+ * rd_follow - wait for a followed input file to grow or be replaced
+ *
+ * given:
+ *	rd	open reader with follow framing, rd_next returned EOF
+ *	timeout	most seconds to wait
+ *
+ * returns:
+ *	1 ==> there may be more records, 0 ==> nothing new yet,
+ *	-1 ==> error, errno is set
+ *
+ * The directory of the file is watched with inotify, so the wait ends
+ * as soon as the file is written, renamed or created.  Without inotify,
+ * or on a file system where it sees no writes, the file is checked
+ * once the timeout is up.  A file truncated in place is read again from
+ * its start.  A file replaced by another, as when a log is rotated, has
+ * its last records read, and then the new file is opened and read.
+ * A signal also ends the wait.
+ */
+int
+rd_follow(struct reader *rd, double timeout)
+{
+    u_int8_t ev[4096];		/* inotify events, only their arrival matters */
+    struct pollfd pfd;		/* inotify to wait on */
+    int ret;
+
+    /*
+     * firewall
+     */
+    if (rd == NULL || rd->fd < 0 || rd->path == NULL || timeout < 0.0) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * watch before checking, so that no write is missed
+     */
+    if (rd->ino < 0) {
+	follow_watch(rd);
+    }
+    ret = follow_check(rd);
+    if (ret != 0) {
+	return ret;
+    }
+
+    /*
+     * wait for an event, then check again
+     */
+    pfd.fd = rd->ino;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, (rd->ino < 0) ? 0 : 1, (int)(timeout * 1000.0)) < 0) {
+	return (errno == EINTR) ? 0 : -1;
+    }
+    if (rd->ino >= 0) {
+	while (read(rd->ino, ev, sizeof(ev)) > 0) {
+	    /* drain the events */
+	}
+    }
+    return follow_check(rd);
+}
+
+
+/*
+ * rd_close - close the input file of a reader
+ *
+ * given:
+ *	rd	reader, stdin is not closed
+ */
+void
+rd_close(struct reader *rd)
+{
+    if (rd == NULL || rd->fd < 0) {
+	return;
+    }
+    z_stop(rd);
+    u_stop(rd);
+    if (rd->fd != 0) {
+	(void) close(rd->fd);
+    }
+    rd->fd = -1;
+    rd->held = NULL;
+    if (rd->ino >= 0) {
+	(void) close(rd->ino);
+	rd->ino = -1;
+    }
+    free(rd->path);
+    rd->path = NULL;
+    return;
+}
+
+
+/*
+ * rd_free - close and free a reader
+ *
+ * given:
+ *	rd	reader, or NULL
+ */
+void
+rd_free(struct reader *rd)
+{
+    long i;
+
+    if (rd == NULL) {
+	return;
+    }
+    rd_close(rd);
+    if (rd->slot != NULL) {
+	for (i=0; i < rd->fr.sample.reservoir; ++i) {
+	    free(rd->slot[i].rec);
+	}
+	free(rd->slot);
+    }
+    free(rd->buf);
+    free(rd->zero);
+    free(rd);
+    return;
+}
+
+
+/*
+ * next_record - return the next record of the input, sampled or not
+ *
+ * given:
+ *	rd	open reader
+ *	rec	where to put a pointer to the record
+ *	len	where to put the length of the record
+ *
+ * returns:
+ *	1 ==> a record, 0 ==> EOF, -1 ==> error, errno is set
+ */
+static int
+next_record(struct reader *rd, u_int8_t **rec, int *len)
+{
+    size_t used;		/* octets of input used by the record */
+    int ret;
+
+    /*
+     * put back the octet after the previous record
+     */
+    if (rd->held != NULL) {
+	*rd->held = rd->held_octet;
+	rd->held = NULL;
+    }
+
+    for (;;) {
+	/*
+	 * records of a hole passed over are zero records
+	 */
+	if (rd->zrun > 0) {
+	    --rd->zrun;
+	    *rec = rd->zero;
+	    *len = rd->fr.rec_size;
+	    return 1;
+	}
+
+	/*
+	 * no records start past the end of the range, or past --records
+	 */
+	if ((rd->end > 0 && rd->base + (off_t)rd->pos >= rd->end) ||
+	    (rd->fr.records > 0 && rd->seen >= rd->fr.records)) {
+	    return 0;
+	}
+
+	/*
+	 * pass over a hole, once the records before it are returned
+	 */
+	if (rd->hole < 0 || rd->pos < rd->len ||
+	    rd->base + (off_t)rd->len < rd->hole) {
+	    break;
+	}
+	if (pass_hole(rd) < 0) {
+	    return -1;
+	}
+    }
+
+    /*
+     * find a whole record, reading more as needed
+     */
+    while ((ret = find_record(rd, rec, len, &used)) == 0) {
+	if (rd->eof || rd->pin) {
+	    return 0;
+	}
+	if (fill(rd) < 0) {
+	    return -1;
+	}
+    }
+    if (ret < 0) {
+	return -1;
+    }
+
+    /*
+     * NUL terminate the record in place
+     */
+    rd->pos += used;
+    rd->held = *rec + *len;
+    rd->held_octet = *rd->held;
+    *rd->held = '\0';
+    return 1;
+}
+
+
+/*
+ * sampled - return the next RD_EVERY, RD_HASH or RD_DEADLINE record
+ *
+ * given:
+ *	rd	open reader
+ *	rec	where to put a pointer to the record
+ *	len	where to put the length of the record
+ *
+ * returns:
+ *	1 ==> a record, 0 ==> EOF, -1 ==> error, errno is set
+ */
+static int
+sampled(struct reader *rd, u_int8_t **rec, int *len)
+{
+    u_int32_t hash;		/* FNV-1a hash of the record */
+    long n;			/* records skipped */
+    int take;			/* 1 ==> the record is sampled */
+    int ret;
+    int i;
+
+    for (;;) {
+	/*
+	 * pass over fixed size records without finding them
+	 */
+	if (rd->left > 0 && rd->fr.type == RD_FIXED) {
+	    n = skip_fixed(rd, rd->left);
+	    if (n < 0) {
+		return -1;
+	    }
+	    rd->left -= n;
+	    rd->seen += n;
+	}
+
+	/*
+	 * the next record, past the deadline there are none
+	 */
+	if (rd->fr.sample.type == RD_DEADLINE && rd->seen >= rd->check &&
+	    pace(rd)) {
+	    if (rd->held != NULL) {
+		*rd->held = rd->held_octet;
+		rd->held = NULL;
+	    }
+	    rd->pos = rd->len;
+	    rd->eof = 1;
+	    return 0;
+	}
+	ret = next_record(rd, rec, len);
+	if (ret <= 0) {
+	    return ret;
+	}
+	++rd->seen;
+
+	/*
+	 * is it sampled
+	 */
+	if (rd->fr.sample.type == RD_HASH) {
+	    hash = 2166136261U;
+	    for (i=0; i < *len; ++i) {
+		hash = (hash ^ (*rec)[i]) * 16777619U;
+	    }
+	    take = (hash <= rd->threshold);
+	} else if (rd->left > 0) {
+	    --rd->left;
+	    take = 0;
+	} else {
+	    rd->left = rd->every - 1;
+	    take = 1;
+	}
+	if (take) {
+	    ++rd->taken;
+	    return 1;
+	}
+    }
+}
+
+
+/*
+ * reservoir - return the next record of an RD_RESERVOIR sample
+ *
+ * given:
+ *	rd	open reader
+ *	rec	where to put a pointer to the record
+ *	len	where to put the length of the record
+ *
+ * returns:
+ *	1 ==> a record, 0 ==> EOF, -1 ==> error, errno is set
+ *
+ * The whole input is read on the first call, keeping each record with
+ * a chance of K / records seen (Algorithm R).  The sample is then
+ * returned in input order.
+ */
+static int
+reservoir(struct reader *rd, u_int8_t **rec, int *len)
+{
+    long k = rd->fr.sample.reservoir;	/* records to sample */
+    struct slot *s;		/* where to keep the record */
+    u_int8_t *r;		/* record found */
+    int n;			/* length of r */
+    u_int64_t x;		/* splitmix64 output */
+    int ret;
+
+    /*
+     * read the whole input, keeping the sample
+     */
+    while (rd->replay < 0) {
+	ret = next_record(rd, &r, &n);
+	if (ret < 0) {
+	    return -1;
+	} else if (ret == 0) {
+	    qsort(rd->slot, rd->slots, sizeof(struct slot), slot_cmp);
+	    rd->replay = 0;
+	    break;
+	}
+	if (rd->seen < (unsigned long)k) {
+	    s = &rd->slot[rd->slots++];
+	} else {
+	    rd->rand += 0x9e3779b97f4a7c15ULL;
+	    x = rd->rand;
+	    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	    x ^= x >> 31;
+	    x %= (u_int64_t)rd->seen + 1;
+	    if (x >= (u_int64_t)k) {
+		++rd->seen;
+		continue;
+	    }
+	    s = &rd->slot[x];
+	}
+	if (s->size < n+1) {
+	    free(s->rec);
+	    s->rec = (u_int8_t *)malloc(n+1);
+	    if (s->rec == NULL) {
+		s->size = 0;
+		return -1;
+	    }
+	    s->size = n+1;
+	}
+	memcpy(s->rec, r, n+1);
+	s->len = n;
+	s->index = rd->seen++;
+    }
+
+    /*
+     * return the sample
+     */
+    if (rd->replay >= rd->slots) {
+	return 0;
+    }
+    s = &rd->slot[rd->replay++];
+    *rec = s->rec;
+    *len = s->len;
+    ++rd->taken;
+    return 1;
+}
+
+
+/*
+ * skip_fixed - pass over RD_FIXED records
+ *
+ * given:
+ *	rd	open reader with RD_FIXED framing
+ *	n	records to pass over
+ *
+ * returns:
+ *	records passed over, < n ==> the rest must be found one by one,
+ *	-1 ==> error, errno is set
+ *
+ * Records in the buffer are passed over by moving past them.  The rest
+ * are passed over with lseek, when the input is seekable, not compressed,
+ * not O_DIRECT or io_uring, not copied to a tee, and far enough ahead to
+ * be worth it.
+ */
+static long
+skip_fixed(struct reader *rd, long n)
+{
+    size_t rec = (size_t)rd->fr.rec_size;	/* record size */
+    size_t avail;		/* unreturned octets */
+    long k;			/* records in the buffer */
+    off_t ahead;		/* octets after the buffer to pass over */
+
+    /*
+     * put back the octet after the previous record
+     */
+    if (rd->held != NULL) {
+	*rd->held = rd->held_octet;
+	rd->held = NULL;
+    }
+
+    /*
+     * do not pass over records after the last one to find
+     */
+    if (rd->fr.records > 0 && rd->seen + (unsigned long)n > rd->fr.records) {
+	n = (rd->seen < rd->fr.records) ? (long)(rd->fr.records - rd->seen) : 0;
+    }
+
+    /*
+     * records in the buffer
+     */
+    avail = rd->len - rd->pos;
+    k = (long)(avail / rec);
+    if (k >= n) {
+	rd->pos += (size_t)n * rec;
+	return n;
+    }
+
+    /*
+     * records after the buffer
+     */
+    ahead = (off_t)(n - k) * (off_t)rec - (off_t)(avail - (size_t)k * rec);
+    if (rd->z != NULL || rd->u != NULL || rd->align > 1 || rd->eof ||
+	rd->fr.tee > 0 ||
+	ahead < (off_t)rd->size) {
+	rd->pos += (size_t)k * rec;
+	return k;
+    }
+    if (lseek(rd->fd, ahead, SEEK_CUR) < 0) {
+	if (errno != ESPIPE) {
+	    return -1;
+	}
+	rd->pos += (size_t)k * rec;
+	return k;
+    }
+    rd->base += (off_t)rd->len + ahead;
+    rd->pos = 0;
+    rd->len = 0;
+    return n;
+}
+
+
+/*
+ * pace - adapt the RD_DEADLINE rate to finish the input by the deadline
+ *
+ * given:
+ *	rd	open reader with RD_DEADLINE sampling
+ *
+ * returns:
+ *	1 ==> the deadline has passed, 0 ==> keep going
+ *
+ * N is set so that the records left, at the time each record sampled
+ * has taken so far, are done by the deadline.  The records left are
+ * estimated from the octets of the input left past the records found,
+ * not from how far the input has been read ahead.  The decompressed size
+ * of a compressed file is estimated from the compression ratio so far.
+ * The size of an input that is not a regular file is not known, so it
+ * is read at N = 1 until the deadline.
+ */
+static int
+pace(struct reader *rd)
+{
+    double t = now();		/* time now */
+    double per_rec;		/* seconds each record sampled has taken */
+    double recs_left;		/* records left to find */
+    double n;			/* N to finish by the deadline */
+    off_t at;			/* input offset of the next record */
+    off_t total;		/* input size, decompressed */
+    off_t end;			/* end of the range */
+    off_t made;			/* octets decompressed so far */
+    off_t used;			/* compressed octets they were made from */
+
+    rd->check = rd->seen + RD_PACE;
+    if (t >= rd->deadline) {
+	return 1;
+    }
+    if (rd->total <= 0 || rd->deadline <= rd->opened) {
+	return 0;
+    }
+    at = rd->base + (off_t)rd->pos;
+    total = rd->total;
+    if (rd->z != NULL) {
+	pthread_mutex_lock(&rd->z->lock);
+	made = rd->z->made;
+	used = rd->z->used;
+	pthread_mutex_unlock(&rd->z->lock);
+	if (made <= 0 || used <= 0) {
+	    return 0;
+	}
+	total = (off_t)((double)rd->total * (double)made / (double)used);
+    }
+    end = (rd->end > 0 && rd->end < total) ? rd->end : total;
+    if (rd->taken == 0 || at <= rd->fr.offset || end <= at) {
+	return 0;
+    }
+
+    /*
+     * records left, at the octets per record found so far
+     */
+    recs_left = (double)(end - at) * (double)rd->seen /
+		(double)(at - rd->fr.offset);
+    if (rd->fr.records > 0 &&
+	recs_left > (double)(rd->fr.records - rd->seen)) {
+	recs_left = (double)(rd->fr.records - rd->seen);
+    }
+
+    /*
+     * sample 1 of each N, so that they take no more than the time left
+     */
+    per_rec = (t - rd->opened) / (double)rd->taken;
+    n = recs_left * per_rec / (rd->deadline - t);
+    if (n <= 1.0) {
+	rd->every = 1;
+    } else if (n >= (double)RD_MAX_EVERY) {
+	rd->every = RD_MAX_EVERY;
+    } else {
+	rd->every = (long)n;
+	if ((double)rd->every < n) {
+	    ++rd->every;
+	}
+    }
+    if (rd->left >= rd->every) {
+	rd->left = rd->every - 1;
+    }
+    return 0;
+}
+
+
+/*
+ * now - return the monotonic time in seconds
+ */
+static double
+now(void)
+{
+    struct timespec ts;		/* time now */
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * slot_cmp - order RD_RESERVOIR slots by record number, for qsort
+ */
+static int
+slot_cmp(const void *a, const void *b)
+{
+    const struct slot *x = (const struct slot *)a;
+    const struct slot *y = (const struct slot *)b;
+
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+
+/*
+ * find_record - find the next record in the buffer
+ *
+ * given:
+ *	rd	open reader
+ *	rec	where to put a pointer to the record
+ *	len	where to put the length of the record
+ *	used	where to put the octets of input used by the record
+ *
+ * returns:
+ *	1 ==> a record, 0 ==> more input is needed, or EOF
+ *	-1 ==> error, errno is set
+ *
+ * At EOF, the unreturned octets are a record of their own.
+ */
+static int
+find_record(struct reader *rd, u_int8_t **rec, int *len, size_t *used)
+{
+    const struct rd_framing *fr = &rd->fr;	/* how records are found */
+    u_int8_t *p = rd->buf + rd->pos;	/* start of the unreturned octets */
+    size_t avail = rd->len - rd->pos;	/* unreturned octets */
+    size_t max = (size_t)fr->rec_size;	/* longest record */
+    size_t hdr;			/* octets of a length or delimiter */
+    size_t n;			/* record length */
+    u_int8_t *end;		/* end of the record */
+
+    switch (fr->type) {
+    case RD_FIXED:
+	if (avail >= max) {
+	    *rec = p;
+	    *len = (int)max;
+	    *used = max;
+	    return 1;
+	}
+	break;
+
+    case RD_LINE:
+	/*
+	 * as with fgets() and strlen(), a line stops at a NUL, but the
+	 * rest of it, up to and including the newline, is still used
+	 */
+	end = (u_int8_t *)memchr(p, '\n', (avail < max) ? avail : max);
+	if (end != NULL) {
+	    n = end+1 - p;
+	} else if (avail >= max) {
+	    n = max;
+	} else {
+	    break;
+	}
+	*rec = p;
+	*used = n;
+	end = (u_int8_t *)memchr(p, '\0', n);
+	*len = (int)((end != NULL) ? (size_t)(end - p) : n);
+	return 1;
+
+    case RD_NUL:
+    case RD_DELIM:
+	hdr = (fr->type == RD_NUL) ? 1 : fr->delim_len;
+	end = find_delim(fr, p, avail);
+	if (end != NULL) {
+	    *rec = p;
+	    *len = (int)(end - p);
+	    *used = end - p + hdr;
+	    return 1;
+	} else if (avail >= max + hdr) {
+	    *rec = p;
+	    *len = (int)max;
+	    *used = max;
+	    return 1;
+	}
+	break;
+
+    case RD_U32:
+    case RD_VARINT:
+	if (avail == 0) {
+	    return 0;
+	}
+	if (fr->type == RD_U32) {
+	    hdr = sizeof(u_int32_t);
+	    if (avail < hdr) {
+		break;
+	    }
+	    n = ((size_t)p[0] << 24) | ((size_t)p[1] << 16) |
+		((size_t)p[2] << 8) | (size_t)p[3];
+	} else {
+	    for (n=0, hdr=0; hdr < avail && hdr < 5; ++hdr) {
+		n |= (size_t)(p[hdr] & 0x7f) << (7*hdr);
+		if ((p[hdr] & 0x80) == 0) {
+		    break;
+		}
+	    }
+	    if (hdr >= 5) {
+		errno = EMSGSIZE;
+		return -1;
+	    } else if (hdr >= avail) {
+		break;
+	    }
+	    ++hdr;
+	}
+	if (n > max) {
+	    errno = EMSGSIZE;
+	    return -1;
+	}
+	if (avail >= hdr + n) {
+	    *rec = p + hdr;
+	    *len = (int)n;
+	    *used = hdr + n;
+	    return 1;
+	}
+	break;
+
+    default:
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * a partial record: more input is needed, or it is the last record,
+     * unless more may yet be written to a followed file
+     */
+    if (rd->eof == 0 || avail == 0 || (fr->follow && !rd->last)) {
+	return 0;
+    }
+    if (fr->type == RD_U32 || fr->type == RD_VARINT) {
+	errno = EIO;
+	return -1;
+    }
+    *rec = p;
+    *len = (int)avail;
+    *used = avail;
+    if (fr->type == RD_LINE) {
+	end = (u_int8_t *)memchr(p, '\0', avail);
+	if (end != NULL) {
+	    *len = (int)(end - p);
+	}
+    }
+    return 1;
+}
+
+
+/*
+ * find_delim - find the NUL or delimiter that ends a record
+ *
+ * given:
+ *	fr	RD_NUL or RD_DELIM framing
+ *	p	start of the record
+ *	avail	octets that may be searched
+ *
+ * returns:
+ *	start of the NUL or delimiter, or NULL ==> none within rec_size
+ */
+static u_int8_t *
+find_delim(const struct rd_framing *fr, u_int8_t *p, size_t avail)
+{
+    size_t max = (size_t)fr->rec_size;	/* longest record */
+    u_int8_t *q;		/* possible delimiter */
+    u_int8_t *last;		/* last place a delimiter may start */
+
+    if (fr->type == RD_NUL) {
+	return (u_int8_t *)memchr(p, '\0', (avail < max+1) ? avail : max+1);
+    }
+    if (avail < (size_t)fr->delim_len) {
+	return NULL;
+    }
+    last = p + avail - fr->delim_len;
+    if (last > p + max) {
+	last = p + max;
+    }
+    for (q = p;
+	 (q = (u_int8_t *)memchr(q, fr->delim[0], last+1 - q)) != NULL;
+	 ++q) {
+	if (memcmp(q, fr->delim, fr->delim_len) == 0) {
+	    return q;
+	}
+	if (q >= last) {
+	    break;
+	}
+    }
+    return NULL;
+}
+
+
+/*
+ * fill - read more input into the buffer
+ *
+ * given:
+ *	rd	open reader
+ *
+ * returns:
+ *	0 ==> OK (rd->eof is set at EOF), -1 ==> error, errno is set
+ */
+static int
+fill(struct reader *rd)
+{
+    ssize_t n;			/* octets read */
+    size_t tail;		/* unreturned octets */
+    size_t front;		/* where the unreturned octets go */
+    size_t want;		/* octets to read */
+    off_t at;			/* input offset to read at */
+
+    /*
+     * move the unreturned octets to the front, for O_DIRECT to just
+     * before an aligned offset
+     */
+    tail = rd->len - rd->pos;
+    front = (rd->align > 1) ?
+	    ((tail + rd->align-1) & ~(rd->align-1)) - tail : 0;
+    if (rd->pos != front) {
+	if (tail > 0) {
+	    memmove(rd->buf + front, rd->buf + rd->pos, tail);
+	}
+	rd->base += (off_t)rd->pos - (off_t)front;
+	rd->pos = front;
+	rd->len = front + tail;
+    }
+    want = rd->size - rd->len;
+    if (rd->align > 1) {
+	want &= ~(rd->align-1);
+    }
+
+    /*
+     * read up to the next hole, in a hole only to the next record
+     */
+    if (rd->hole >= 0) {
+	at = rd->base + (off_t)rd->len;
+	if (at < rd->hole) {
+	    if ((off_t)want > rd->hole - at) {
+		want = (size_t)(rd->hole - at);
+	    }
+	} else if (want > (size_t)rd->fr.rec_size - tail) {
+	    want = (size_t)rd->fr.rec_size - tail;
+	}
+    }
+
+    /*
+     * read, take from io_uring or decompress as much as fits
+     */
+    if (rd->z != NULL) {
+	n = z_read(rd->z, rd->buf + rd->len, want);
+#if defined(HAVE_IO_URING)
+    } else if (rd->u != NULL) {
+	n = u_read(rd->u, rd->buf + rd->len, want);
+#endif
+    } else if (rd->splice) {
+	n = splice_read(rd, want);
+    } else {
+	do {
+	    n = read(rd->fd, rd->buf + rd->len, want);
+	} while (n < 0 && errno == EINTR);
+	if (n > 0 && rd->total > 0) {
+	    advise(rd->fd, rd->io, rd->base + (off_t)(rd->len + n),
+		   rd->size, &rd->dropped);
+	}
+    }
+
+    /*
+     * copy what was read to the tee, from the buffer it was read into
+     */
+    if (n > 0 && rd->fr.tee > 0 && rd->z == NULL && !rd->splice &&
+	tee_write(rd->fr.tee, rd->buf + rd->len, (size_t)n,
+		  rd->base + (off_t)rd->len, &rd->teed) < 0) {
+	return -1;
+    }
+    if (n < 0) {
+	return -1;
+    } else if (n == 0) {
+	rd->eof = 1;
+    }
+    rd->len += n;
+    return 0;
+}
+
+
+/*
+ * detect - start reading an input, decompressing it if it is compressed
+ *
+ * given:
+ *	rd	reader whose fd was just opened or rewound
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set, the reader is closed
+ */
+static int
+detect(struct reader *rd)
+{
+    static const u_int8_t gz_magic[] = { 0x1f, 0x8b, 0x08 };
+    static const u_int8_t xz_magic[] = { 0xfd, '7', 'z', 'X', 'Z', 0x00 };
+    static const u_int8_t zs_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+    int type = 0;		/* compressed format, 0 ==> not compressed */
+    int saved_errno;		/* errno of a failed start */
+    struct stat st;		/* input file status */
+    struct stat tst;		/* tee status */
+
+    /*
+     * start with an empty buffer and a new sample
+     */
+    rd->pos = 0;
+    rd->len = 0;
+    rd->eof = 0;
+    rd->held = NULL;
+    rd->seen = 0;
+    rd->taken = 0;
+    rd->every = (rd->fr.sample.type == RD_EVERY) ? rd->fr.sample.every : 1;
+    rd->left = 0;
+    rd->rand = 0;
+    rd->slots = 0;
+    rd->replay = -1;
+    rd->total = (fstat(rd->fd, &st) == 0 && S_ISREG(st.st_mode)) ?
+		st.st_size : 0;
+    rd->check = 0;
+    rd->base = 0;
+    rd->end = (rd->fr.length > 0) ? rd->fr.offset + rd->fr.length : 0;
+    rd->hole = -1;
+    rd->zrun = 0;
+    rd->splice = (rd->fr.tee > 0 &&
+		  fstat(rd->fd, &st) == 0 && S_ISFIFO(st.st_mode) &&
+		  fstat(rd->fr.tee, &tst) == 0 && S_ISFIFO(tst.st_mode));
+
+    /*
+     * hint how a regular file will be read
+     */
+    rd->align = 1;
+    rd->io = RD_IO_CACHE;
+    rd->dropped = 0;
+    if (rd->total > 0) {
+	rd->io = rd->fr.io;
+	if (rd->io == RD_IO_DIRECT) {
+	    if (fcntl(rd->fd, F_GETFL) & O_DIRECT) {
+		rd->align = RD_ALIGN;
+	    } else {
+		rd->io = RD_IO_NOCACHE;
+	    }
+	}
+	(void) posix_fadvise(rd->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	if (rd->io == RD_IO_NOCACHE || rd->io == RD_IO_DIRECT) {
+	    (void) posix_fadvise(rd->fd, 0, 0, POSIX_FADV_NOREUSE);
+	}
+    }
+    if (rd->fr.sample.type == RD_DEADLINE) {
+	rd->opened = now();
+    }
+    if (rd->fr.raw || rd->fr.follow) {
+	goto range;
+    }
+
+    /*
+     * read enough to see the longest magic number
+     */
+    while (rd->len < sizeof(xz_magic) && rd->eof == 0) {
+	if (fill(rd) < 0) {
+	    goto fail;
+	}
+    }
+    if (rd->len >= sizeof(gz_magic) &&
+	memcmp(rd->buf, gz_magic, sizeof(gz_magic)) == 0) {
+	type = ZIN_GZIP;
+    } else if (rd->len >= sizeof(xz_magic) &&
+	       memcmp(rd->buf, xz_magic, sizeof(xz_magic)) == 0) {
+	type = ZIN_XZ;
+    } else if (rd->len >= sizeof(zs_magic) &&
+	       memcmp(rd->buf, zs_magic, sizeof(zs_magic)) == 0) {
+	type = ZIN_ZSTD;
+    } else {
+	goto range;
+    }
+
+    /*
+     * hand what was read to a decompression thread
+     */
+    if (z_start(rd, type) < 0) {
+	goto fail;
+    }
+    rd->len = 0;
+    rd->eof = 0;
+
+    /*
+     * go to the start of the range
+     */
+range:
+    if (seek_range(rd) < 0) {
+	goto fail;
+    }
+
+    /*
+     * keep reads in flight after what was read, if there is io_uring
+     */
+    if (rd->io == RD_IO_URING && rd->z == NULL && rd->total > 0 &&
+	rd->eof == 0 && !rd->fr.follow) {
+	(void) u_start(rd);
+    }
+
+    /*
+     * find the 1st hole of a sparse file read with read(),
+     * putting back what was read of it
+     */
+    if (rd->zero != NULL && rd->z == NULL && rd->u == NULL &&
+	rd->align == 1 && rd->total > 0) {
+	rd->hole = next_hole(rd, rd->base + (off_t)rd->pos);
+	if (rd->hole >= 0 && rd->hole < rd->base + (off_t)rd->len) {
+	    if (lseek(rd->fd, rd->hole, SEEK_SET) < 0) {
+		goto fail;
+	    }
+	    rd->len = (size_t)(rd->hole - rd->base);
+	    rd->eof = 0;
+	}
+    }
+    return 0;
+
+fail:
+    saved_errno = errno;
+    rd_close(rd);
+    errno = saved_errno;
+    return -1;
+}
+
+
+/*
+ * seek_range - go to the first record boundary at or after the offset
+ *
+ * given:
+ *	rd	reader at the start of its input
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+seek_range(struct reader *rd)
+{
+    const struct rd_framing *fr = &rd->fr;	/* how records are found */
+    off_t start = fr->offset;	/* where the first record may start */
+    u_int8_t delim = '\n';	/* newline or NUL, or 1st delimiter octet */
+    size_t hdr = 0;		/* octets of newline, NUL or delimiter */
+    off_t target;		/* where to look for a boundary */
+    off_t aligned;		/* target, O_DIRECT aligned */
+    u_int8_t *q;		/* possible boundary */
+    u_int8_t *last;		/* last place a boundary may start */
+
+    if (start <= 0) {
+	return 0;
+    }
+
+    /*
+     * a boundary ends just before the first record
+     */
+    switch (fr->type) {
+    case RD_FIXED:
+	start = (start + fr->rec_size-1) / fr->rec_size * fr->rec_size;
+	break;
+    case RD_LINE:
+	hdr = 1;
+	break;
+    case RD_NUL:
+	hdr = 1;
+	delim = '\0';
+	break;
+    case RD_DELIM:
+	hdr = (size_t)fr->delim_len;
+	delim = fr->delim[0];
+	break;
+    default:
+	break;
+    }
+    target = (start > (off_t)hdr) ? start - (off_t)hdr : 0;
+
+    /*
+     * get to the target: in the buffer, by lseek, or by reading up to it
+     *
+     * With O_DIRECT the lseek is to an aligned offset before the target.
+     */
+    aligned = target & ~((off_t)rd->align-1);
+    if (target > rd->base + (off_t)rd->len && rd->z == NULL &&
+	lseek(rd->fd, aligned, SEEK_SET) == aligned) {
+	rd->base = aligned;
+	rd->pos = 0;
+	rd->len = 0;
+	rd->eof = 0;
+    }
+    while (target > rd->base + (off_t)rd->len && rd->eof == 0) {
+	rd->pos = rd->len;
+	if (fill(rd) < 0) {
+	    return -1;
+	}
+    }
+    rd->pos = (target > rd->base + (off_t)rd->len) ?
+	      rd->len : (size_t)(target - rd->base);
+    if (hdr == 0) {
+	return 0;
+    }
+
+    /*
+     * start just after the next boundary
+     */
+    for (;;) {
+	if (rd->len - rd->pos >= hdr) {
+	    last = rd->buf + rd->len - hdr;
+	    for (q = rd->buf + rd->pos;
+		 (q = (u_int8_t *)memchr(q, delim, last+1 - q)) != NULL; ++q) {
+		if (fr->type != RD_DELIM ||
+		    memcmp(q, fr->delim, hdr) == 0) {
+		    rd->pos = q + hdr - rd->buf;
+		    return 0;
+		}
+		if (q >= last) {
+		    break;
+		}
+	    }
+	    rd->pos = rd->len - (hdr-1);
+	}
+	if (rd->eof) {
+	    rd->pos = rd->len;
+	    return 0;
+	}
+	if (fill(rd) < 0) {
+	    return -1;
+	}
+    }
+}
+
+
+/*
+ * advise - hint the page cache after a read of a regular file
+ *
+ * given:
+ *	fd	input file
+ *	io	RD_IO_CACHE, RD_IO_NOCACHE, ...
+ *	at	input offset just read up to
+ *	next	octets of the next read
+ *	dropped	RD_IO_NOCACHE pages before this offset were dropped
+ *
+ * The next read is asked for ahead of time.  With RD_IO_NOCACHE, pages
+ * that were read are dropped, once there are RD_BUF octets of them.
+ */
+static void
+advise(int fd, int io, off_t at, size_t next, off_t *dropped)
+{
+    if (io == RD_IO_DIRECT) {
+	return;
+    }
+    (void) posix_fadvise(fd, at, (off_t)next, POSIX_FADV_WILLNEED);
+    if (io == RD_IO_NOCACHE && at - *dropped >= RD_BUF) {
+	(void) posix_fadvise(fd, *dropped, at - *dropped, POSIX_FADV_DONTNEED);
+	*dropped = at;
+    }
+    return;
+}
+
+
+/*
+ * splice_read - read from a pipe, copying it to a tee pipe with tee(2)
+ *
+ * given:
+ *	rd	open reader, its input and tee are pipes
+ *	want	most octets to read
+ *
+ * returns:
+ *	octets read, 0 ==> EOF, -1 ==> error, errno is set
+ *
+ * tee(2) copies the input pipe to the tee pipe inside the kernel, without
+ * consuming it, and the same octets are then read into the buffer.  If
+ * tee(2) cannot be used, the octets are read and written instead.
+ */
+static ssize_t
+splice_read(struct reader *rd, size_t want)
+{
+    ssize_t n;			/* octets copied to the tee */
+    ssize_t got;		/* octets of them read */
+    ssize_t ret;
+
+    /*
+     * copy what the input pipe holds to the tee pipe
+     */
+    do {
+	n = tee(rd->fd, rd->fr.tee, want, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+	if (errno != EINVAL) {
+	    return -1;
+	}
+	rd->splice = 0;
+	do {
+	    n = read(rd->fd, rd->buf + rd->len, want);
+	} while (n < 0 && errno == EINTR);
+	return n;
+    }
+
+    /*
+     * read the same octets
+     */
+    for (got=0; got < n; got += ret) {
+	do {
+	    ret = read(rd->fd, rd->buf + rd->len + got, (size_t)(n - got));
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+	    return -1;
+	} else if (ret == 0) {
+	    errno = EIO;
+	    return -1;
+	}
+    }
+    rd->teed = rd->base + (off_t)rd->len + n;
+    return n;
+}
+
+
+/*
+ * tee_write - copy octets read to a tee, each input octet only once
+ *
+ * given:
+ *	fd	tee to write to
+ *	p	octets read
+ *	n	number of octets
+ *	at	input offset they were read at
+ *	teed	input octets already written, updated
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ *
+ * Octets read again, after a rewind, were already written.
+ */
+static int
+tee_write(int fd, const u_int8_t *p, size_t n, off_t at, off_t *teed)
+{
+    ssize_t ret;
+
+    if (at + (off_t)n <= *teed) {
+	return 0;
+    } else if (at < *teed) {
+	p += *teed - at;
+	n -= (size_t)(*teed - at);
+    } else {
+	*teed = at;
+    }
+    while (n > 0) {
+	ret = write(fd, p, n);
+	if (ret < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return -1;
+	}
+	p += ret;
+	n -= (size_t)ret;
+	*teed += ret;
+    }
+    return 0;
+}
+
+
+/*
+ * pass_hole - pass over the RD_FIXED records of a hole in a sparse file
+ *
+ * given:
+ *	rd	open reader, at a record boundary at or after rd->hole
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ *
+ * The records wholly in the hole are passed over with lseek, without
+ * reading them.  Unless the framing skips holes, they are returned as
+ * zero records, as read() would have.  A record only partly in the hole
+ * is read.  rd->hole is then moved on to the next hole.
+ */
+static int
+pass_hole(struct reader *rd)
+{
+    off_t rec = (off_t)rd->fr.rec_size;	/* record size */
+    off_t at = rd->base + (off_t)rd->len;	/* input offset */
+    off_t data;			/* where the data after the hole starts */
+    off_t n;			/* records wholly in the hole */
+
+    /*
+     * find the end of the hole, a hole at the end of the file has no data
+     */
+    data = lseek(rd->fd, at, SEEK_DATA);
+    if (data < 0) {
+	if (errno != ENXIO) {
+	    return -1;
+	}
+	data = rd->total;
+    }
+
+    /*
+     * records wholly in the hole, not past the range or --records
+     */
+    n = (at % rec == 0 && data > at) ? (data - at) / rec : 0;
+    if (rd->end > 0 && n > (rd->end - at + rec-1) / rec) {
+	n = (rd->end - at + rec-1) / rec;
+    }
+    if (rd->fr.records > 0 && !rd->fr.holes &&
+	n > (off_t)(rd->fr.records - rd->seen)) {
+	n = (off_t)(rd->fr.records - rd->seen);
+    }
+
+    /*
+     * pass over them
+     */
+    if (n > 0) {
+	if (lseek(rd->fd, at + n*rec, SEEK_SET) < 0) {
+	    return -1;
+	}
+	rd->base = at + n*rec;
+	rd->pos = 0;
+	rd->len = 0;
+	if (!rd->fr.holes) {
+	    rd->zrun = (unsigned long)n;
+	}
+	if (rd->base < data) {
+	    /* a record partly in the hole is left */
+	    return 0;
+	}
+    } else if (lseek(rd->fd, at, SEEK_SET) < 0) {
+	return -1;
+    }
+
+    /*
+     * the next hole, a hole shorter than a record is read
+     */
+    rd->hole = next_hole(rd, data);
+    return 0;
+}
+
+
+/*
+ * next_hole - find the next hole of a sparse file
+ *
+ * given:
+ *	rd	open reader of a regular file
+ *	at	input offset to look from
+ *
+ * returns:
+ *	where the next hole starts, -1 ==> no more holes
+ *
+ * The input offset is left as it was.
+ */
+static off_t
+next_hole(struct reader *rd, off_t at)
+{
+    off_t cur = rd->base + (off_t)rd->len;	/* input offset */
+    off_t hole;			/* where the hole starts */
+
+    if (at >= rd->total) {
+	return -1;
+    }
+    hole = lseek(rd->fd, at, SEEK_HOLE);
+    if (lseek(rd->fd, cur, SEEK_SET) != cur) {
+	return -1;
+    }
+    return (hole < 0 || hole >= rd->total) ? -1 : hole;
+}
+
+
+/*
+ * follow_check - see if a followed input file grew or was replaced
+ *
+ * given:
+ *	rd	open reader with follow framing, at EOF
+ *
+ * returns:
+ *	1 ==> there may be more records, 0 ==> nothing new,
+ *	-1 ==> error, errno is set
+ */
+static int
+follow_check(struct reader *rd)
+{
+    struct stat fst;		/* status of the open file */
+    struct stat pst;		/* status of the file now at the path */
+    off_t at = rd->base + (off_t)rd->len;	/* input offset read up to */
+    unsigned long seen;		/* records found in the replaced file */
+    unsigned long taken;	/* records sampled from the replaced file */
+    int fd;
+
+    /*
+     * more was written
+     */
+    if (fstat(rd->fd, &fst) < 0) {
+	return -1;
+    }
+    if (fst.st_size > at) {
+	rd->eof = 0;
+	return 1;
+    }
+
+    /*
+     * truncated in place: read it again from the start
+     */
+    if (fst.st_size < at) {
+	if (lseek(rd->fd, (off_t)0, SEEK_SET) < 0) {
+	    return -1;
+	}
+	if (rd->held != NULL) {
+	    *rd->held = rd->held_octet;
+	    rd->held = NULL;
+	}
+	rd->base = 0;
+	rd->pos = 0;
+	rd->len = 0;
+	rd->eof = 0;
+	rd->dropped = 0;
+	return 1;
+    }
+
+    /*
+     * replaced: return the last partial record, then open the new file
+     */
+    if (stat(rd->path, &pst) < 0 ||
+	(pst.st_dev == fst.st_dev && pst.st_ino == fst.st_ino)) {
+	return 0;
+    }
+    if (rd->last == 0 && rd->len > rd->pos) {
+	rd->last = 1;
+	return 1;
+    }
+    fd = open(rd->path, O_RDONLY);
+    if (fd < 0) {
+	return (errno == ENOENT) ? 0 : -1;
+    }
+    (void) close(rd->fd);
+    rd->fd = fd;
+    rd->last = 0;
+    seen = rd->seen;
+    taken = rd->taken;
+    if (detect(rd) < 0) {
+	return -1;
+    }
+    rd->seen = seen;
+    rd->taken = taken;
+    return 1;
+}
+
+
+/*
+ * follow_watch - watch the directory of a followed input file
+ *
+ * given:
+ *	rd	open reader with follow framing
+ *
+ * Any write, create or rename in the directory wakes rd_follow, so a
+ * replacement file is seen as soon as it appears.  Without inotify,
+ * rd->ino stays -1.
+ */
+static void
+follow_watch(struct reader *rd)
+{
+    char *dir;			/* directory of the file */
+    char *slash;		/* last / of the path */
+
+    rd->ino = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (rd->ino < 0) {
+	return;
+    }
+    dir = strdup(rd->path);
+    if (dir == NULL) {
+	(void) close(rd->ino);
+	rd->ino = -1;
+	return;
+    }
+    slash = strrchr(dir, '/');
+    if (slash == NULL) {
+	strcpy(dir, ".");
+    } else if (slash == dir) {
+	slash[1] = '\0';
+    } else {
+	*slash = '\0';
+    }
+    if (inotify_add_watch(rd->ino, dir,
+			  IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE |
+			  IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE |
+			  IN_ATTRIB) < 0) {
+	(void) close(rd->ino);
+	rd->ino = -1;
+    }
+    free(dir);
+    return;
+}
+
+
+/*
+ * z_start - start decompressing the input
+ *
+ * given:
+ *	rd	open reader, its buffer holds the start of the input
+ *	type	ZIN_GZIP, ZIN_XZ or ZIN_ZSTD
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+z_start(struct reader *rd, int type)
+{
+    struct zinput *z;		/* new compressed input */
+    int ret = -1;		/* decompressor setup, 0 ==> OK */
+    int i;
+
+    /*
+     * allocate the compressed input and its blocks
+     *
+     * The octets already read are the first compressed input.
+     */
+    z = (struct zinput *)calloc(1, sizeof(struct zinput));
+    if (z == NULL) {
+	return -1;
+    }
+    z->fd = rd->fd;
+    z->type = type;
+    z->in_size = rd->size & ~((size_t)RD_ALIGN-1);
+    if (posix_memalign((void **)&z->in, RD_ALIGN, rd->size) != 0) {
+	z->in = NULL;
+	goto fail;
+    }
+    z->io = (rd->total > 0) ? rd->io : -1;
+    z->tee = rd->fr.tee;
+    z->teed = rd->teed;
+    z->in_off = (off_t)rd->len;
+    memcpy(z->in, rd->buf, rd->len);
+    z->in_len = rd->len;
+    z->in_eof = rd->eof;
+    for (i=0; i < RD_ZBLOCKS; ++i) {
+	z->blk[i] = (u_int8_t *)malloc(RD_ZBLOCK);
+	if (z->blk[i] == NULL) {
+	    goto fail;
+	}
+    }
+
+    /*
+     * set up the decompressor
+     */
+    switch (type) {
+#if defined(HAVE_ZLIB)
+    case ZIN_GZIP:
+	ret = (inflateInit2(&z->gz, 15+16) == Z_OK) ? 0 : -1;
+	break;
+#endif
+#if defined(HAVE_LZMA)
+    case ZIN_XZ:
+	{
+	    lzma_stream init = LZMA_STREAM_INIT;
+
+	    z->xz = init;
+	    ret = (lzma_stream_decoder(&z->xz, UINT64_MAX,
+				       LZMA_CONCATENATED) == LZMA_OK) ? 0 : -1;
+	}
+	break;
+#endif
+#if defined(HAVE_ZSTD)
+    case ZIN_ZSTD:
+	z->zs = ZSTD_createDStream();
+	ret = (z->zs != NULL &&
+	       !ZSTD_isError(ZSTD_initDStream(z->zs))) ? 0 : -1;
+	break;
+#endif
+    default:
+	errno = EPROTONOSUPPORT;
+	goto fail;
+    }
+    if (ret < 0) {
+	errno = ENOMEM;
+	goto fail;
+    }
+
+    /*
+     * start the decompression thread
+     */
+    pthread_mutex_init(&z->lock, NULL);
+    pthread_cond_init(&z->cond, NULL);
+    rd->z = z;
+    ret = pthread_create(&z->thread, NULL, z_thread, z);
+    if (ret != 0) {
+	rd->z = NULL;
+	pthread_mutex_destroy(&z->lock);
+	pthread_cond_destroy(&z->cond);
+	errno = ret;
+	ret = -1;
+	goto fail;
+    }
+    return 0;
+
+fail:
+    i = errno;
+    z_free(z);
+    errno = i;
+    return -1;
+}
+
+
+/*
+ * z_stop - stop decompressing the input
+ *
+ * given:
+ *	rd	reader, its decompression thread is ended and freed
+ */
+static void
+z_stop(struct reader *rd)
+{
+    struct zinput *z = rd->z;	/* compressed input */
+
+    if (z == NULL) {
+	return;
+    }
+    pthread_mutex_lock(&z->lock);
+    z->stop = 1;
+    pthread_cond_broadcast(&z->cond);
+    pthread_mutex_unlock(&z->lock);
+    (void) pthread_join(z->thread, NULL);
+    pthread_mutex_destroy(&z->lock);
+    pthread_cond_destroy(&z->cond);
+    if (z->teed > rd->teed) {
+	rd->teed = z->teed;
+    }
+    z_free(z);
+    rd->z = NULL;
+    return;
+}
+
+
+/*
+ * z_free - end the decompressor and free a compressed input
+ *
+ * given:
+ *	z	compressed input whose thread is not running
+ *
+ * NOTE: Ending a decompressor that was never set up does nothing,
+ *	 as z was calloc-ed.
+ */
+static void
+z_free(struct zinput *z)
+{
+    int i;
+
+#if defined(HAVE_ZLIB)
+    if (z->type == ZIN_GZIP) {
+	(void) inflateEnd(&z->gz);
+    }
+#endif
+#if defined(HAVE_LZMA)
+    if (z->type == ZIN_XZ) {
+	lzma_end(&z->xz);
+    }
+#endif
+#if defined(HAVE_ZSTD)
+    if (z->type == ZIN_ZSTD) {
+	(void) ZSTD_freeDStream(z->zs);
+    }
+#endif
+    for (i=0; i < RD_ZBLOCKS; ++i) {
+	free(z->blk[i]);
+    }
+    free(z->in);
+    free(z);
+    return;
+}
+
+
+/*
+ * z_read - take decompressed octets, waiting for a block if need be
+ *
+ * given:
+ *	z	compressed input
+ *	dst	where to put the octets
+ *	len	most octets to take
+ *
+ * returns:
+ *	octets taken, 0 ==> EOF, -1 ==> error, errno is set
+ */
+static ssize_t
+z_read(struct zinput *z, u_int8_t *dst, size_t len)
+{
+    size_t n;			/* octets taken */
+    int err;			/* errno of the decompression */
+
+    /*
+     * wait for a full block
+     */
+    pthread_mutex_lock(&z->lock);
+    while (z->count == 0 && z->done == 0) {
+	pthread_cond_wait(&z->cond, &z->lock);
+    }
+    if (z->count == 0) {
+	err = z->err;
+	pthread_mutex_unlock(&z->lock);
+	if (err != 0) {
+	    errno = err;
+	    return -1;
+	}
+	return 0;
+    }
+    pthread_mutex_unlock(&z->lock);
+
+    /*
+     * take from the head block, handing it back once it is empty
+     */
+    n = z->blk_len[z->head] - z->off;
+    if (n > len) {
+	n = len;
+    }
+    memcpy(dst, z->blk[z->head] + z->off, n);
+    z->off += n;
+    if (z->off == z->blk_len[z->head]) {
+	z->off = 0;
+	pthread_mutex_lock(&z->lock);
+	z->head = (z->head + 1) % RD_ZBLOCKS;
+	--z->count;
+	pthread_cond_broadcast(&z->cond);
+	pthread_mutex_unlock(&z->lock);
+    }
+    return (ssize_t)n;
+}
+
+
+/*
+ * z_thread - decompress the input into blocks until EOF, error or stop
+ *
+ * given:
+ *	arg	compressed input
+ *
+ * returns:
+ *	NULL
+ */
+static void *
+z_thread(void *arg)
+{
+    struct zinput *z = (struct zinput *)arg;	/* compressed input */
+    ssize_t n;			/* octets decompressed */
+    int end;			/* 1 ==> end of input, -1 ==> error */
+    int slot;			/* block to fill */
+    int done;			/* 1 ==> no more blocks */
+
+    do {
+	/*
+	 * wait for an empty block
+	 */
+	pthread_mutex_lock(&z->lock);
+	while (z->count >= RD_ZBLOCKS && z->stop == 0) {
+	    pthread_cond_wait(&z->cond, &z->lock);
+	}
+	if (z->stop) {
+	    pthread_mutex_unlock(&z->lock);
+	    break;
+	}
+	slot = (z->head + z->count) % RD_ZBLOCKS;
+	pthread_mutex_unlock(&z->lock);
+
+	/*
+	 * fill it, outside of the lock
+	 */
+	end = 0;
+	n = z_inflate(z, z->blk[slot], RD_ZBLOCK, &end);
+
+	/*
+	 * hand it to the reader
+	 */
+	pthread_mutex_lock(&z->lock);
+	if (n > 0) {
+	    z->blk_len[slot] = (size_t)n;
+	    ++z->count;
+	    z->made += n;
+	    z->used = z->in_off - (off_t)(z->in_len - z->in_pos);
+	}
+	if (end < 0) {
+	    z->err = errno;
+	}
+	if (end != 0) {
+	    z->done = 1;
+	}
+	done = z->done;
+	pthread_cond_broadcast(&z->cond);
+	pthread_mutex_unlock(&z->lock);
+    } while (done == 0);
+    return NULL;
+}
+
+
+/*
+ * z_inflate - decompress input into a block
+ *
+ * given:
+ *	z	compressed input
+ *	out	block to fill
+ *	size	size of the block
+ *	end	where to put 1 ==> the compressed input is at its end,
+ *		-1 ==> error, errno is set
+ *
+ * returns:
+ *	octets decompressed, before any error
+ *
+ * Concatenated gzip members, xz streams and zstd frames are one input.
+ * Input that ends within a member, stream or frame is an error (EIO).
+ */
+static ssize_t
+z_inflate(struct zinput *z, u_int8_t *out, size_t size, int *end)
+{
+    switch (z->type) {
+#if defined(HAVE_ZLIB)
+    case ZIN_GZIP:
+	{
+	    z_stream *gz = &z->gz;	/* gzip decompression state */
+	    int ret;			/* inflate return */
+
+	    gz->next_out = out;
+	    gz->avail_out = (uInt)size;
+	    while (gz->avail_out > 0) {
+		if (z_refill(z) < 0) {
+		    *end = -1;
+		    break;
+		}
+		gz->next_in = z->in + z->in_pos;
+		gz->avail_in = (uInt)(z->in_len - z->in_pos);
+		ret = inflate(gz, Z_NO_FLUSH);
+		z->in_pos = z->in_len - gz->avail_in;
+		if (ret == Z_STREAM_END) {
+		    /* end of a member, another may follow */
+		    z->clean = 1;
+		    if (inflateReset(gz) != Z_OK) {
+			errno = EIO;
+			*end = -1;
+			break;
+		    }
+		} else if (ret == Z_OK) {
+		    z->clean = 0;
+		} else if (ret != Z_BUF_ERROR) {
+		    errno = EIO;
+		    *end = -1;
+		    break;
+		} else if (z->in_pos >= z->in_len && z->in_eof) {
+		    if (z->clean == 0) {
+			errno = EIO;
+			*end = -1;
+			break;
+		    }
+		    *end = 1;
+		    break;
+		}
+	    }
+	    return (ssize_t)(size - gz->avail_out);
+	}
+#endif
+#if defined(HAVE_LZMA)
+    case ZIN_XZ:
+	{
+	    lzma_stream *xz = &z->xz;	/* xz decompression state */
+	    lzma_ret ret;		/* lzma_code return */
+
+	    xz->next_out = out;
+	    xz->avail_out = size;
+	    while (xz->avail_out > 0) {
+		if (z_refill(z) < 0) {
+		    *end = -1;
+		    break;
+		}
+		xz->next_in = z->in + z->in_pos;
+		xz->avail_in = z->in_len - z->in_pos;
+		ret = lzma_code(xz, z->in_eof ? LZMA_FINISH : LZMA_RUN);
+		z->in_pos = z->in_len - xz->avail_in;
+		if (ret == LZMA_STREAM_END) {
+		    *end = 1;
+		    break;
+		} else if (ret != LZMA_OK) {
+		    errno = EIO;
+		    *end = -1;
+		    break;
+		}
+	    }
+	    return (ssize_t)(size - xz->avail_out);
+	}
+#endif
+#if defined(HAVE_ZSTD)
+    case ZIN_ZSTD:
+	{
+	    ZSTD_inBuffer in;		/* compressed input */
+	    ZSTD_outBuffer o;		/* decompressed output */
+	    size_t in_pos;		/* in.pos before decompressing */
+	    size_t out_pos;		/* o.pos before decompressing */
+	    size_t ret;			/* ZSTD_decompressStream return */
+
+	    o.dst = out;
+	    o.size = size;
+	    o.pos = 0;
+	    while (o.pos < o.size) {
+		if (z_refill(z) < 0) {
+		    *end = -1;
+		    break;
+		}
+		in.src = z->in;
+		in.size = z->in_len;
+		in.pos = z->in_pos;
+		in_pos = in.pos;
+		out_pos = o.pos;
+		ret = ZSTD_decompressStream(z->zs, &o, &in);
+		z->in_pos = in.pos;
+		if (ZSTD_isError(ret)) {
+		    errno = EIO;
+		    *end = -1;
+		    break;
+		}
+		if (in.pos != in_pos || o.pos != out_pos) {
+		    /* 0 ==> end of a frame, another may follow */
+		    z->clean = (ret == 0);
+		} else if (z->in_pos >= z->in_len && z->in_eof) {
+		    if (z->clean == 0) {
+			errno = EIO;
+			*end = -1;
+			break;
+		    }
+		    *end = 1;
+		    break;
+		}
+	    }
+	    return (ssize_t)o.pos;
+	}
+#endif
+    default:
+	errno = EPROTONOSUPPORT;
+	*end = -1;
+	return 0;
+    }
+}
+
+
+#if defined(HAVE_ZLIB) || defined(HAVE_LZMA) || defined(HAVE_ZSTD)
+/*
+ * z_refill - read more compressed input once it is all used
+ *
+ * given:
+ *	z	compressed input
+ *
+ * returns:
+ *	0 ==> OK (z->in_eof is set at EOF), -1 ==> error, errno is set
+ */
+static int
+z_refill(struct zinput *z)
+{
+    ssize_t n;			/* octets read */
+
+    if (z->in_pos < z->in_len || z->in_eof) {
+	return 0;
+    }
+    do {
+	n = read(z->fd, z->in, z->in_size);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+	return -1;
+    } else if (n == 0) {
+	z->in_eof = 1;
+    }
+    if (n > 0 && z->tee > 0 &&
+	tee_write(z->tee, z->in, (size_t)n, z->in_off, &z->teed) < 0) {
+	return -1;
+    }
+    z->in_pos = 0;
+    z->in_len = (size_t)n;
+    z->in_off += n;
+    if (n > 0 && z->io >= 0) {
+	advise(z->fd, z->io, z->in_off, z->in_size, &z->dropped);
+    }
+    return 0;
+}
+#endif
+
+
+/*
+ * u_start - start keeping RD_IO_URING reads in flight
+ *
+ * given:
+ *	rd	open reader of an uncompressed regular file
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> no io_uring, errno is set, read() is used
+ *
+ * Reads start after what is in the buffer.  The blocks are registered
+ * with the io_uring when the memlock limit allows, else they are
+ * read into as ordinary buffers.
+ */
+static int
+u_start(struct reader *rd)
+{
+#if defined(HAVE_IO_URING)
+    struct uring *u;		/* new reads in flight */
+    struct io_uring_params p;	/* io_uring parameters */
+    struct iovec iov;		/* blocks to register */
+    int saved_errno;		/* errno of a failed start */
+    int i;
+
+    /*
+     * allocate the blocks
+     */
+    u = (struct uring *)calloc(1, sizeof(struct uring));
+    if (u == NULL) {
+	return -1;
+    }
+    u->ring_fd = -1;
+    u->fd = rd->fd;
+    u->next_off = rd->base + (off_t)rd->len;
+    if (posix_memalign((void **)&u->blk, RD_ALIGN,
+		       (size_t)RD_QDEPTH * RD_QBLOCK) != 0) {
+	free(u);
+	errno = ENOMEM;
+	return -1;
+    }
+
+    /*
+     * set up the io_uring and map its rings
+     */
+    memset(&p, 0, sizeof(p));
+    u->ring_fd = (int)syscall(__NR_io_uring_setup, RD_QDEPTH, &p);
+    if (u->ring_fd < 0) {
+	goto fail;
+    }
+    u->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_ring_len = p.cq_off.cqes +
+		     p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+	if (u->cq_ring_len > u->sq_ring_len) {
+	    u->sq_ring_len = u->cq_ring_len;
+	}
+	u->cq_ring_len = 0;
+    }
+    u->sq_ring = mmap(NULL, u->sq_ring_len, PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ring == MAP_FAILED) {
+	u->sq_ring = NULL;
+	goto fail;
+    }
+    if (u->cq_ring_len == 0) {
+	u->cq_ring = u->sq_ring;
+    } else {
+	u->cq_ring = mmap(NULL, u->cq_ring_len, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, u->ring_fd,
+			  IORING_OFF_CQ_RING);
+	if (u->cq_ring == MAP_FAILED) {
+	    u->cq_ring = NULL;
+	    goto fail;
+	}
+    }
+    u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe *)mmap(NULL, u->sqes_len,
+					  PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE,
+					  u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+	u->sqes = NULL;
+	goto fail;
+    }
+    u->sq_head = (unsigned *)((char *)u->sq_ring + p.sq_off.head);
+    u->sq_tail = (unsigned *)((char *)u->sq_ring + p.sq_off.tail);
+    u->sq_mask = (unsigned *)((char *)u->sq_ring + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)((char *)u->sq_ring + p.sq_off.array);
+    u->cq_head = (unsigned *)((char *)u->cq_ring + p.cq_off.head);
+    u->cq_tail = (unsigned *)((char *)u->cq_ring + p.cq_off.tail);
+    u->cq_mask = (unsigned *)((char *)u->cq_ring + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)((char *)u->cq_ring + p.cq_off.cqes);
+
+    /*
+     * register the blocks, if the memlock limit allows
+     */
+    iov.iov_base = u->blk;
+    iov.iov_len = (size_t)RD_QDEPTH * RD_QBLOCK;
+    u->fixed = (syscall(__NR_io_uring_register, u->ring_fd,
+			IORING_REGISTER_BUFFERS, &iov, 1) == 0);
+
+    /*
+     * start reading every block
+     */
+    rd->u = u;
+    for (i=0; i < RD_QDEPTH; ++i) {
+	if (u_submit(u, i) < 0) {
+	    rd->u = NULL;
+	    goto fail;
+	}
+    }
+    return 0;
+
+fail:
+    saved_errno = errno;
+    rd->u = u;
+    u_stop(rd);
+    errno = saved_errno;
+    return -1;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+/*
+ * u_stop - stop keeping RD_IO_URING reads in flight
+ *
+ * given:
+ *	rd	reader, its io_uring is closed and freed
+ *
+ * The reads in flight are waited for first, as they read into the blocks.
+ */
+static void
+u_stop(struct reader *rd)
+{
+#if defined(HAVE_IO_URING)
+    struct uring *u = rd->u;	/* reads in flight */
+
+    if (u == NULL) {
+	return;
+    }
+    rd->u = NULL;
+    while (u->inflight > 0) {
+	if (u_wait(u) < 0) {
+	    /* the blocks may still be read into, so they are not freed */
+	    return;
+	}
+    }
+    if (u->sqes != NULL) {
+	(void) munmap(u->sqes, u->sqes_len);
+    }
+    if (u->cq_ring != NULL && u->cq_ring != u->sq_ring) {
+	(void) munmap(u->cq_ring, u->cq_ring_len);
+    }
+    if (u->sq_ring != NULL) {
+	(void) munmap(u->sq_ring, u->sq_ring_len);
+    }
+    if (u->ring_fd >= 0) {
+	(void) close(u->ring_fd);
+    }
+    free(u->blk);
+    free(u);
+#endif
+    return;
+}
+
+
+#if defined(HAVE_IO_URING)
+/*
+ * u_read - take octets read in file order, waiting for a block if need be
+ *
+ * The octets are copied out of the block, so that records are found in
+ * the reader's buffer as with read(): a record may span two blocks, and
+ * the NUL put after a returned record must not land in a block being
+ * read.
+ *
+ * given:
+ *	u	reads in flight
+ *	dst	where to put the octets
+ *	len	most octets to take
+ *
+ * returns:
+ *	octets taken, 0 ==> EOF, -1 ==> error, errno is set
+ */
+static ssize_t
+u_read(struct uring *u, u_int8_t *dst, size_t len)
+{
+    int i = u->head;		/* block to take from */
+    size_t n;			/* octets taken */
+
+    /*
+     * wait for the head block
+     */
+    while (u->state[i] == U_BUSY) {
+	if (u_wait(u) < 0) {
+	    return -1;
+	}
+    }
+    if (u->state[i] != U_DONE || u->res[i] == 0) {
+	return 0;
+    } else if (u->res[i] < 0) {
+	errno = -u->res[i];
+	return -1;
+    }
+
+    /*
+     * take from it, reading it again further on once it is empty
+     */
+    n = (size_t)u->res[i] - u->off;
+    if (n > len) {
+	n = len;
+    }
+    memcpy(dst, u->blk + (size_t)i * RD_QBLOCK + u->off, n);
+    u->off += n;
+    if (u->off == (size_t)u->res[i]) {
+	u->off = 0;
+	u->state[i] = U_IDLE;
+	if (u->res[i] < RD_QBLOCK) {
+	    /* a short read: the blocks after it are read again after it */
+	    if (u_restart(u, u->blk_off[i] + u->res[i]) < 0) {
+		return -1;
+	    }
+	} else {
+	    if (u_submit(u, i) < 0) {
+		return -1;
+	    }
+	    u->head = (i + 1) % RD_QDEPTH;
+	}
+    }
+    return (ssize_t)n;
+}
+
+
+/*
+ * u_submit - start reading a block at the next input offset
+ *
+ * given:
+ *	u	reads in flight
+ *	i	U_IDLE block
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+u_submit(struct uring *u, int i)
+{
+    struct io_uring_sqe *sqe;	/* submission queue entry */
+    unsigned tail;		/* submission ring tail */
+    unsigned idx;		/* index of sqe */
+    int ret;
+
+    tail = *u->sq_tail;
+    idx = tail & *u->sq_mask;
+    sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = u->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = u->fd;
+    sqe->addr = (u_int64_t)(uintptr_t)(u->blk + (size_t)i * RD_QBLOCK);
+    sqe->len = RD_QBLOCK;
+    sqe->off = (u_int64_t)u->next_off;
+    sqe->buf_index = 0;
+    sqe->user_data = (u_int64_t)i;
+    u->sq_array[idx] = idx;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    u->blk_off[i] = u->next_off;
+    u->next_off += RD_QBLOCK;
+    u->state[i] = U_BUSY;
+    ++u->inflight;
+    do {
+	ret = (int)syscall(__NR_io_uring_enter, u->ring_fd, 1, 0, 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    return (ret < 0) ? -1 : 0;
+}
+
+
+/*
+ * u_wait - wait for at least one read to complete
+ *
+ * given:
+ *	u	reads in flight
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+u_wait(struct uring *u)
+{
+    struct io_uring_cqe *cqe;	/* completion queue entry */
+    unsigned head;		/* completion ring head */
+    unsigned tail;		/* completion ring tail */
+    int i;
+    int ret;
+
+    head = *u->cq_head;
+    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+	do {
+	    ret = (int)syscall(__NR_io_uring_enter, u->ring_fd, 0, 1,
+			       IORING_ENTER_GETEVENTS, NULL, 0);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+	    return -1;
+	}
+    }
+    tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+	cqe = &u->cqes[head & *u->cq_mask];
+	i = (int)cqe->user_data;
+	if (i >= 0 && i < RD_QDEPTH && u->state[i] == U_BUSY) {
+	    u->res[i] = cqe->res;
+	    u->state[i] = U_DONE;
+	    --u->inflight;
+	}
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    return 0;
+}
+
+
+/*
+ * u_restart - read every block again, starting at an input offset
+ *
+ * given:
+ *	u	reads in flight
+ *	at	input offset to read from
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+u_restart(struct uring *u, off_t at)
+{
+    int i;
+
+    while (u->inflight > 0) {
+	if (u_wait(u) < 0) {
+	    return -1;
+	}
+    }
+    u->next_off = at;
+    u->head = 0;
+    u->off = 0;
+    for (i=0; i < RD_QDEPTH; ++i) {
+	u->state[i] = U_IDLE;
+	if (u_submit(u, i) < 0) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+#endif
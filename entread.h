@@ -0,0 +1,226 @@
+/*
+ * entread.h - record readers for entropic tools
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+#if !defined(INCLUDE_ENTREAD_H)
+#define INCLUDE_ENTREAD_H
+
+#include <sys/types.h>
+
+
+/*
+ * record framings
+ *
+ * RD_LINE	lines of up to rec_size octets, each with its newline.
+ *		A longer line is split into rec_size octet records.
+ * RD_FIXED	rec_size octet records, the last record may be short
+ * RD_NUL	records ended by a NUL octet, the NUL is not in the record
+ * RD_DELIM	records ended by a delimiter of 1 to RD_MAX_DELIM octets,
+ *		the delimiter is not in the record
+ * RD_U32	each record follows its length as a u32 in network byte order
+ * RD_VARINT	each record follows its length as an unsigned LEB128 varint
+ *
+ * An RD_NUL or RD_DELIM record longer than rec_size octets is split
+ * into rec_size octet records.  An RD_U32 or RD_VARINT length longer
+ * than rec_size is an error.  The input need not end with a newline,
+ * NUL or delimiter.
+ *
+ * RD_MAX_DELIM	longest RD_DELIM delimiter
+ * RD_MAX_REC	longest RD_NUL, RD_DELIM, RD_U32 or RD_VARINT record
+ * RD_BUF	smallest reader buffer
+ */
+#define RD_LINE 0
+#define RD_FIXED 1
+#define RD_NUL 2
+#define RD_DELIM 3
+#define RD_U32 4
+#define RD_VARINT 5
+#define RD_MAX_DELIM 16
+#define RD_MAX_REC (1024*1024)
+#define RD_BUF (1024*1024)
+
+
+/*
+ * record samplings
+ *
+ * RD_ALL	every record
+ * RD_EVERY	the 1st record and each Nth record after it
+ * RD_HASH	records whose FNV-1a hash falls in a fraction of the range,
+ *		so a record is sampled or not whatever its position
+ * RD_RESERVOIR	a uniform sample of K records, returned in input order
+ *		once the input is read
+ * RD_DEADLINE	each Nth record, N adapted so the input ends by a deadline,
+ *		no records after it
+ *
+ * Records not sampled are still found, but are not returned.  Fixed size
+ * records not sampled are skipped with lseek when the input is seekable
+ * and not compressed.  The RD_RESERVOIR sample is drawn with a fixed
+ * seed, so each sampling is the same from run to run.
+ *
+ * RD_MAX_RESERVOIR	largest RD_RESERVOIR K
+ * RD_MAX_EVERY		largest RD_DEADLINE N
+ * RD_PACE		records between RD_DEADLINE rate checks
+ */
+#define RD_ALL 0
+#define RD_EVERY 1
+#define RD_HASH 2
+#define RD_RESERVOIR 3
+#define RD_DEADLINE 4
+#define RD_MAX_RESERVOIR (1<<24)
+#define RD_MAX_EVERY (1L<<30)
+#define RD_PACE 256
+
+
+/*
+ * how input files are read
+ *
+ * RD_IO_CACHE		through the page cache, read sequentially ahead
+ * RD_IO_NOCACHE	as RD_IO_CACHE, dropping pages once they are read
+ * RD_IO_DIRECT		O_DIRECT aligned reads around the page cache,
+ *			RD_IO_NOCACHE if the file system has no O_DIRECT
+ * RD_IO_URING		RD_QDEPTH reads of RD_QBLOCK octets kept in flight
+ *			with io_uring, ordinary reads where there is none
+ *
+ * Regular files are read with POSIX_FADV_SEQUENTIAL, and each read asks
+ * for the next buffer with POSIX_FADV_WILLNEED.  Stdin is read through
+ * the page cache, as is compressed input.
+ *
+ * RD_ALIGN	O_DIRECT buffer, offset and length alignment
+ * RD_QDEPTH	RD_IO_URING reads in flight, a power of 2
+ * RD_QBLOCK	RD_IO_URING octets per read
+ */
+#define RD_IO_CACHE 0
+#define RD_IO_NOCACHE 1
+#define RD_IO_DIRECT 2
+#define RD_IO_URING 3
+#define RD_ALIGN 4096
+#define RD_QDEPTH 8
+#define RD_QBLOCK (1024*1024)
+
+
+/*
+ * rd_sample - which records of an input are returned
+ */
+struct rd_sample {
+    int type;			/* RD_ALL, RD_EVERY, ... */
+    long every;			/* RD_EVERY N */
+    double fraction;		/* RD_HASH fraction, > 0 and <= 1 */
+    long reservoir;		/* RD_RESERVOIR K */
+    double budget;		/* RD_DEADLINE seconds from rd_new */
+};
+
+
+/*
+ * rd_framing - how records are found in an input
+ */
+struct rd_framing {
+    int type;			/* RD_LINE, RD_FIXED, ... */
+    int rec_size;		/* RD_FIXED record size, else longest record */
+    u_int8_t delim[RD_MAX_DELIM];	/* RD_DELIM delimiter */
+    int delim_len;		/* length of delim */
+    int raw;			/* 1 ==> do not decompress the input */
+    struct rd_sample sample;	/* which records are returned */
+    off_t offset;		/* first record starts at or after, 0 ==> start */
+    off_t length;		/* records start before offset+length, 0 ==> EOF */
+    unsigned long records;	/* most records to find, 0 ==> all */
+    int io;			/* RD_IO_CACHE, RD_IO_NOCACHE, ... */
+    int holes;			/* 1 ==> skip RD_FIXED records in holes */
+    int zeros;			/* 1 ==> rd_run returns runs of zero records */
+    int follow;			/* 1 ==> the input may grow, see rd_follow */
+    int tee;			/* > 0 ==> copy the input read to this fd */
+};
+
+
+/*
+ * reader - an input file and the buffer its records are found in
+ *
+ * A reader may be opened on one input file after another, keeping
+ * its buffer.  Records are returned in place, from the buffer.
+ *
+ * A reader may read only a range of an input.  It starts at the first
+ * record boundary at or after offset: just after a newline, NUL or
+ * delimiter, or at a multiple of the RD_FIXED record size.  RD_U32 and
+ * RD_VARINT inputs have no boundary to find, so offset must be one.
+ * Only records that start before offset+length are returned, so ranges
+ * that cover an input find each record once.  The offset and length
+ * count decompressed octets.  A seekable, uncompressed input is seeked,
+ * others are read up to the offset.
+ *
+ * Unless the framing is raw, an input that starts with a gzip, xz or
+ * zstd magic number is decompressed by a thread of its own, in blocks
+ * of RD_ZBLOCK octets, while records are found in the blocks before.
+ * A format that was not compiled in is an error (EPROTONOSUPPORT), as
+ * is corrupt or truncated compressed input (EIO).
+ *
+ * A sparse regular file read with RD_FIXED framing and holes or zeros
+ * is read around its holes, found with SEEK_HOLE and SEEK_DATA, when it
+ * is not compressed, O_DIRECT or io_uring.  With holes, the records
+ * wholly in a hole are skipped.  Otherwise they are zero records, as if
+ * read, and with zeros rd_run returns them as one run.
+ *
+ * A followed input is read the way tail -F reads it.  At EOF, a partial
+ * last record is kept until the rest of it is written, and rd_follow
+ * waits for more.  It is never decompressed, and is read through the
+ * page cache even with RD_IO_DIRECT or RD_IO_URING.
+ *
+ * With a tee, each octet of the input is written to the tee fd as it is
+ * read, from the buffer it was read into, compressed input as it is.
+ * When the input and the tee are both pipes, tee(2) copies the input
+ * inside the kernel.  Records are not passed over with lseek.
+ *
+ * RD_ZBLOCK	octets of decompressed input in a block
+ * RD_ZBLOCKS	blocks decompressed ahead of the records found
+ */
+#define RD_ZBLOCK (1024*1024)
+#define RD_ZBLOCKS 4
+struct reader;
+
+
+/*
+ * external functions
+ */
+extern int rd_framing(const char *arg, struct rd_framing *fr);
+extern int rd_sample(const char *arg, struct rd_sample *sp);
+extern int rd_io(const char *arg);
+extern struct reader *rd_new(const struct rd_framing *fr);
+extern int rd_open(struct reader *rd, const char *path);
+extern int rd_next(struct reader *rd, u_int8_t **rec, int *len);
+extern int rd_run(struct reader *rd, u_int8_t **rec, int *len,
+		  unsigned long *count);
+extern int rd_batch(struct reader *rd, u_int8_t **rec, int *len, int n);
+extern int rd_rewind(struct reader *rd);
+extern int rd_follow(struct reader *rd, double timeout);
+extern void rd_counts(const struct reader *rd,
+		      unsigned long *seen, unsigned long *taken);
+extern void rd_close(struct reader *rd);
+extern void rd_free(struct reader *rd);
+
+#endif /* INCLUDE_ENTREAD_H */
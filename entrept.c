@@ -0,0 +1,507 @@
+/*
+ * entrept - reports, sweeps and multiple input files for entropic tools
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "entropic.h"
+#include "entpool.h"
+#include "entread.h"
+#include "entrept.h"
+
+
+/*
+ * files_run - the state of a rept_files() run
+ */
+struct files_worker {
+    struct ent_ctx *ctx;	/* entropy context of this worker */
+    struct reader *rd;		/* record reader of this worker */
+};
+struct files_rept {
+    struct ent_rept rept;	/* report of the file when per_file */
+    struct ent_rept *grid;	/* sweep report grid of the file when per_file */
+    int err;			/* 0 ==> OK, else errno of failure */
+};
+struct files_run {
+    const struct rept_files *rf;	/* files and how to process them */
+    struct files_worker *worker;	/* per worker state */
+    struct files_rept *file;		/* per input file results */
+};
+
+
+/*
+ * forward declarations
+ */
+static void file_job(int w, int job, void *arg);
+static int feed_batch(struct ent_ctx *ctx, struct reader *rd);
+static void print_rept(const struct rept_sweep *sw, const struct ent_rept *rept,
+		       const struct ent_rept *grid, unsigned long count);
+
+
+/*
+ * rept_format - format an entropy report
+ *
+ * given:
+ *	buf	where to write the report
+ *	len	size of buf
+ *	rept	entropy report to format
+ *	count	record count to print
+ */
+void
+rept_format(char *buf, size_t len, const struct ent_rept *rept,
+	    unsigned long count)
+{
+    int n;			/* octets written so far */
+
+    n = 0;
+    buf[0] = '\0';
+    if (rept->high_bit_cnt > 0) {
+	n += snprintf(buf+n, len-n, "record count: %lu with %d bits: "
+				    "high entropy: %f\n",
+		      count, rept->high_bit_cnt, rept->high_entropy);
+    } else {
+	n += snprintf(buf+n, len-n, "Error: not enough data to calculate "
+				    "high entropy estimate\n");
+    }
+    if (n >= len) {
+	return;
+    }
+    if (rept->low_bit_cnt > 0) {
+	n += snprintf(buf+n, len-n, "record count: %lu with %d bits: "
+				    "low entropy: %f\n",
+		      count, rept->low_bit_cnt, rept->low_entropy);
+    } else {
+	n += snprintf(buf+n, len-n, "Error: not enough data to calculate "
+				    "low entropy estimate\n");
+    }
+    if (n >= len) {
+	return;
+    }
+    if (rept->high_bit_cnt > 0 && rept->low_bit_cnt > 0) {
+	snprintf(buf+n, len-n, "high, median and low entropy: %f %f %f\n\n",
+		 rept->high_entropy, rept->med_entropy, rept->low_entropy);
+    } else {
+	snprintf(buf+n, len-n, "Error: not enough data to calculate "
+			       "median entropy estimate\n");
+    }
+    return;
+}
+
+
+/*
+ * rept_list - parse a comma separated list of sweep values
+ *
+ * given:
+ *	opt	option name for error messages
+ *	arg	comma separated list of integers
+ *	list	where to store up to MAX_SWEEP values
+ *	errbuf	where to write an error message, or NULL
+ *	errlen	size of errbuf
+ *
+ * returns:
+ *	number of values in list, or -1 ==> error, errno is set
+ */
+int
+rept_list(const char *opt, const char *arg, int *list,
+	  char *errbuf, size_t errlen)
+{
+    const char *p;		/* next value to parse */
+    char *end;			/* end of parsed value */
+    int n;			/* number of values */
+
+    n = 0;
+    p = arg;
+    do {
+	if (n >= MAX_SWEEP) {
+	    if (errbuf != NULL && errlen > 0) {
+		snprintf(errbuf, errlen, "%s list may have at most %d values",
+			 opt, MAX_SWEEP);
+	    }
+	    errno = E2BIG;
+	    return -1;
+	}
+	list[n++] = strtol(p, &end, 0);
+	if (end == p || (*end != ',' && *end != '\0')) {
+	    if (errbuf != NULL && errlen > 0) {
+		snprintf(errbuf, errlen,
+			 "%s list must be integers separated by ,'s: %s",
+			 opt, arg);
+	    }
+	    errno = EINVAL;
+	    return -1;
+	}
+	p = end+1;
+    } while (*end == ',');
+    return n;
+}
+
+
+/*
+ * rept_grid - compute the sweep report grid of a context
+ *
+ * The grid has a report for each -b bit_depth, -B back_history and
+ * -f depth_factor value, in that order, the last varying fastest.
+ *
+ * given:
+ *	sw	values of the sweep
+ *	ctx	entropy analysis context
+ *
+ * returns:
+ *	malloc-ed grid of ndepth * nback * nfactor reports, or NULL on error
+ */
+struct ent_rept *
+rept_grid(const struct rept_sweep *sw, struct ent_ctx *ctx)
+{
+    struct ent_rept *grid;	/* sweep report grid */
+    int n;			/* grid reports computed */
+    int b;
+    int h;
+    int f;
+
+    grid = (struct ent_rept *)malloc(sw->ndepth * sw->nback * sw->nfactor *
+				     sizeof(struct ent_rept));
+    if (grid == NULL) {
+	return NULL;
+    }
+    n = 0;
+    for (b=0; b < sw->ndepth; ++b) {
+	for (h=0; h < sw->nback; ++h) {
+	    for (f=0; f < sw->nfactor; ++f) {
+		if (ent_report_at(ctx, sw->depth[b], sw->back[h],
+				  sw->factor[f], &grid[n++]) < 0) {
+		    free(grid);
+		    return NULL;
+		}
+	    }
+	}
+    }
+    return grid;
+}
+
+
+/*
+ * rept_print_grid - print a sweep report grid on stdout
+ *
+ * Each line is a bit_depth, back_history and depth_factor followed by
+ * the high, median and low entropy estimates.  An estimate that could
+ * not be calculated is printed as a -.
+ *
+ * given:
+ *	sw	values of the sweep
+ *	grid	sweep report grid from rept_grid()
+ *	count	record count to print
+ */
+void
+rept_print_grid(const struct rept_sweep *sw, const struct ent_rept *grid,
+		unsigned long count)
+{
+    const struct ent_rept *r;	/* grid report being printed */
+    int b;
+    int h;
+    int f;
+
+    printf("record count: %lu\n", count);
+    printf("bit_depth back_history depth_factor high median low\n");
+    r = grid;
+    for (b=0; b < sw->ndepth; ++b) {
+	for (h=0; h < sw->nback; ++h) {
+	    for (f=0; f < sw->nfactor; ++f, ++r) {
+		printf("%d %d %d", sw->depth[b], sw->back[h], sw->factor[f]);
+		if (r->high_bit_cnt > 0) {
+		    printf(" %f", r->high_entropy);
+		} else {
+		    printf(" -");
+		}
+		if (r->high_bit_cnt > 0 && r->low_bit_cnt > 0) {
+		    printf(" %f", r->med_entropy);
+		} else {
+		    printf(" -");
+		}
+		if (r->low_bit_cnt > 0) {
+		    printf(" %f\n", r->low_entropy);
+		} else {
+		    printf(" -\n");
+		}
+	    }
+	}
+    }
+    fputc('\n', stdout);
+    return;
+}
+
+
+/*
+ * rept_files - process multiple input files on a pool of workers
+ *
+ * The reports are printed on stdout, and each file that failed is
+ * named on stderr.
+ *
+ * given:
+ *	rf	input files and how to process them
+ *	errbuf	where to write an error message, or NULL
+ *	errlen	size of errbuf
+ *
+ * returns:
+ *	number of input files that failed, or -1 ==> error, errno is set
+ */
+int
+rept_files(const struct rept_files *rf, char *errbuf, size_t errlen)
+{
+    struct files_run run;	/* state of this run */
+    struct ent_rept rept;	/* entropy report */
+    struct ent_rept *grid;	/* sweep report grid */
+    const char *what;		/* what failed */
+    int failed;			/* number of input files that failed */
+    int saved_errno;		/* errno of the failure */
+    int w;			/* worker number */
+    int i;
+
+    /*
+     * allocate per worker state and per file results
+     */
+    memset(&run, 0, sizeof(run));
+    run.rf = rf;
+    failed = -1;
+    what = "failed to allocate worker state";
+    run.worker = (struct files_worker *)calloc(rf->workers,
+						sizeof(struct files_worker));
+    run.file = (struct files_rept *)calloc(rf->inputs->len+1,
+					    sizeof(struct files_rept));
+    if (run.worker == NULL || run.file == NULL) {
+	goto done;
+    }
+    for (w=0; w < rf->workers; ++w) {
+	run.worker[w].ctx = ent_open(rf->cfg, rf->map);
+	run.worker[w].rd = rd_new(rf->framing);
+	if (run.worker[w].ctx == NULL || run.worker[w].rd == NULL) {
+	    goto done;
+	}
+    }
+
+    /*
+     * process the input files
+     */
+    what = "failed to run worker pool";
+    if (pool_run(rf->workers, rf->inputs->len, file_job, &run) < 0) {
+	goto done;
+    }
+
+    /*
+     * report failed files
+     */
+    failed = 0;
+    for (i=0; i < rf->inputs->len; ++i) {
+	if (run.file[i].err != 0) {
+	    fprintf(stderr, "%s: %s: %s\n",
+		    rf->program, rf->inputs->path[i], strerror(run.file[i].err));
+	    ++failed;
+	}
+    }
+
+    /*
+     * report on each file, in the order given
+     */
+    if (rf->per_file) {
+	for (i=0; i < rf->inputs->len; ++i) {
+	    if (run.file[i].err != 0) {
+		continue;
+	    }
+	    printf("\nEntropy %sreport: %s\n",
+		   (rf->sw != NULL) ? "sweep " : "", rf->inputs->path[i]);
+	    print_rept(rf->sw, &run.file[i].rept, run.file[i].grid,
+		       run.file[i].rept.recnum);
+	}
+
+    /*
+     * merge the workers for one aggregate report
+     */
+    } else {
+	what = "failed to merge workers";
+	for (w=1; w < rf->workers; ++w) {
+	    if (ent_merge(run.worker[0].ctx, run.worker[w].ctx) < 0) {
+		failed = -1;
+		goto done;
+	    }
+	}
+	(void) ent_report(run.worker[0].ctx, &rept);
+	grid = NULL;
+	if (rf->sw != NULL) {
+	    what = "failed to compute sweep report";
+	    grid = rept_grid(rf->sw, run.worker[0].ctx);
+	    if (grid == NULL) {
+		failed = -1;
+		goto done;
+	    }
+	}
+	printf("\nEntropy %sreport: %d files\n",
+	       (rf->sw != NULL) ? "sweep " : "", rf->inputs->len-failed);
+	print_rept(rf->sw, &rept, grid, rept.recnum);
+	free(grid);
+    }
+
+    /*
+     * all done!
+     */
+done:
+    saved_errno = errno;
+    if (failed < 0 && errbuf != NULL && errlen > 0) {
+	snprintf(errbuf, errlen, "%s: %s", what, strerror(saved_errno));
+    }
+    if (run.worker != NULL) {
+	for (w=0; w < rf->workers; ++w) {
+	    ent_close(run.worker[w].ctx);
+	    rd_free(run.worker[w].rd);
+	}
+	free(run.worker);
+    }
+    if (run.file != NULL) {
+	for (i=0; i < rf->inputs->len; ++i) {
+	    free(run.file[i].grid);
+	}
+	free(run.file);
+    }
+    errno = saved_errno;
+    return failed;
+}
+
+
+/*
+ * file_job - process one input file on a worker
+ *
+ * given:
+ *	w	worker number
+ *	job	index of the file in the input files
+ *	arg	state of the rept_files() run
+ */
+static void
+file_job(int w, int job, void *arg)
+{
+    struct files_run *run = (struct files_run *)arg;	/* this run */
+    const struct rept_files *rf = run->rf;	/* files and how */
+    struct files_worker *wk = &run->worker[w];	/* this worker */
+    struct files_rept *fr = &run->file[job];	/* this file */
+
+    /*
+     * open the file using the reader of this worker
+     */
+    if (rd_open(wk->rd, rf->inputs->path[job]) < 0) {
+	fr->err = errno;
+	return;
+    }
+
+    /*
+     * start a new context or a new stream of records
+     */
+    if (rf->per_file) {
+	ent_reset(wk->ctx);
+    } else {
+	ent_restart(wk->ctx);
+    }
+
+    /*
+     * process records
+     */
+    if (((rf->feed != NULL) ? rf->feed : feed_batch)(wk->ctx, wk->rd) < 0) {
+	fr->err = errno;
+    }
+    rd_close(wk->rd);
+
+    /*
+     * save the report of this file
+     */
+    if (rf->per_file && fr->err == 0) {
+	(void) ent_report(wk->ctx, &fr->rept);
+	if (rf->sw != NULL) {
+	    fr->grid = rept_grid(rf->sw, wk->ctx);
+	    if (fr->grid == NULL) {
+		fr->err = errno;
+	    }
+	}
+    }
+    return;
+}
+
+
+/*
+ * feed_batch - feed the records of an open reader, a batch at a time
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	rd	open reader
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+static int
+feed_batch(struct ent_ctx *ctx, struct reader *rd)
+{
+    u_int8_t *raw_buf[ENT_BATCH];	/* raw records, in the reader buffer */
+    int raw_len[ENT_BATCH];	/* length of each raw record in octets */
+    int ret;			/* records read, 0 ==> EOF, -1 ==> error */
+
+    while ((ret = rd_batch(rd, raw_buf, raw_len, ENT_BATCH)) > 0) {
+	if (ent_feed_batch(ctx, raw_buf, raw_len, ret) < 0) {
+	    return -1;
+	}
+    }
+    return ret;
+}
+
+
+/*
+ * print_rept - print an entropy report, or a sweep report grid
+ *
+ * given:
+ *	sw	values of the sweep, NULL ==> print rept
+ *	rept	entropy report
+ *	grid	sweep report grid when sw != NULL
+ *	count	record count to print
+ */
+static void
+print_rept(const struct rept_sweep *sw, const struct ent_rept *rept,
+	   const struct ent_rept *grid, unsigned long count)
+{
+    char rept_buf[BUFSIZ+1];	/* formatted entropy report */
+
+    if (rept->bits <= 0) {
+	printf("Error: nothing to process\n");
+    }
+    if (sw != NULL) {
+	rept_print_grid(sw, grid, count);
+    } else {
+	rept_format(rept_buf, sizeof(rept_buf), rept, count);
+	fputs(rept_buf, stdout);
+    }
+    return;
+}
@@ -0,0 +1,109 @@
+/*
+ * entrept.h - reports, sweeps and multiple input files for entropic tools
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+#if !defined(INCLUDE_ENTREPT_H)
+#define INCLUDE_ENTREPT_H
+
+#include <stddef.h>
+
+#include "entropic.h"
+#include "entpool.h"
+#include "entread.h"
+
+
+/*
+ * rept_sweep - the values of a parameter sweep
+ *
+ * The -b, -B and -f options take a comma separated list of values.
+ * When any list has more than one value, records are tallied once with
+ * the largest bit_depth and back_history, and the final report is a
+ * grid with a line for every combination of values (see ent_report_at()).
+ *
+ * MAX_SWEEP	most values in a -b, -B or -f list
+ */
+#define MAX_SWEEP 16
+struct rept_sweep {
+    int depth[MAX_SWEEP];	/* -b bit_depth values */
+    int ndepth;			/* number of -b bit_depth values */
+    int back[MAX_SWEEP];	/* -B back_history values */
+    int nback;			/* number of -B back_history values */
+    int factor[MAX_SWEEP];	/* -f depth_factor values */
+    int nfactor;		/* number of -f depth_factor values */
+};
+
+
+/*
+ * rept_files - multiple input files, and how to process them
+ *
+ * When given more than one input_file, a directory, or -p, the
+ * input files are processed by a pool of worker threads (see entpool.h).
+ * Each worker has its own entropy context and reader, which are reused
+ * from one file to the next.
+ *
+ * With per_file, the worker context is reset before each file and a
+ * report is printed for each file.  Otherwise each file is added to the
+ * worker context as an independent stream of records (see ent_restart())
+ * and the worker contexts are merged for one aggregate report.
+ *
+ * The records of each file are fed by the feed function, or when it is
+ * NULL, a batch at a time by ent_feed_batch().  A feed function feeds
+ * all the records of an open reader to a context, and returns 0, or
+ * -1 ==> error, errno is set.
+ */
+typedef int (rept_feed)(struct ent_ctx *ctx, struct reader *rd);
+struct rept_files {
+    const char *program;		/* program name for error messages */
+    const struct pool_list *inputs;	/* input files */
+    int workers;			/* number of worker threads */
+    int per_file;			/* 1 ==> report on each file */
+    const struct ent_cfg *cfg;		/* config of each worker context */
+    const struct ent_map *map;		/* map of each worker context */
+    const struct rd_framing *framing;	/* how records are found */
+    const struct rept_sweep *sw;	/* sweep values, NULL ==> no grid */
+    rept_feed *feed;			/* feeds an open reader, or NULL */
+};
+
+
+/*
+ * external functions
+ */
+extern void rept_format(char *buf, size_t len, const struct ent_rept *rept,
+			unsigned long count);
+extern int rept_list(const char *opt, const char *arg, int *list,
+		     char *errbuf, size_t errlen);
+extern struct ent_rept *rept_grid(const struct rept_sweep *sw,
+				  struct ent_ctx *ctx);
+extern void rept_print_grid(const struct rept_sweep *sw,
+			    const struct ent_rept *grid, unsigned long count);
+extern int rept_files(const struct rept_files *rf, char *errbuf, size_t errlen);
+
+#endif /* INCLUDE_ENTREPT_H */
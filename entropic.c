@@ -32,158 +32,31 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
-#include <math.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
 #include <sys/errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
 
-
-/*
- * defaults
- *
- * OCTET_BITS	number of bits in an 8 bit octet
- *
- * DEF_DEPTH	default tally depth (-b) for each record bit
- *
- * MAX_HISTORY_BITS
- *		We must have this many records before we have a full
- *		history's worth of values for a given bit position in a record.
- *		Bit histories are kept in an unsigned long.
- *
- * MAX_BACK_HISTORY
- *		When we form xors of current values and history values,
- *		we will go back in history up to this many bits.
- *
- * DEF_HISTORY	Default BACK_HISTORY value.
- *
- * MAX_DEPTH	Deeper tally depths require more memory.  An increase in 1
- *		for the depth requires twice as much memory.  A deeper tally
- *		has a shorter history from which bit differences can be
- *		examined.
- *
- *		For each bit depth, we need MAX_BACK_HISTORY more bits in the
- *		history.  So MAX_DEPTH+MAX_BACK_HISTORY is required to
- *		be <= MAX_HISTORY_BITS.  We go one less so that index offsets
- *		fit within signed 32 bits.  Most systems will not be able to
- *		allocate this much memory, but we have to draw a limit
- *		somewhere.
- *
- * DEF_DEPTH_FACTOR
- *		When we calculate entropy at a depth of x, we use the
- *		tally_t of values from [0 .. (1<<x)-1].
- *
- *		However if we have only counted a few bits for a given
- *		slice, this tally_t set will not be very populated.
- *		The required number of cycles to use a depth of x
- *		in calculating entropy is (1<<x) * depth_factor.
- *		This value is the default depth_factor.
- *
- * INV_LN_2	1.0 / Log base e of 2.
- *
- * INVALID_MAX_ENTROPY
- * INVALID_MIN_ENTROPY
- *		Impossible entropy values per bit.
- */
-#define OCTET_BITS 8
-#define DEF_DEPTH 8
-#define MAX_HISTORY_BITS (sizeof(unsigned long)*OCTET_BITS)
-#define MAX_BACK_HISTORY (MAX_HISTORY_BITS/2)
-#define DEF_HISTORY MAX_BACK_HISTORY
-#define MAX_DEPTH (MAX_BACK_HISTORY-1)
-#define DEF_DEPTH_FACTOR 4
-#define INV_LN_2 ((double)1.442695040888963407359924681001892137426646)
-#define INVALID_MAX_ENTROPY ((double)-10.0)
-#define INVALID_MIN_ENTROPY ((double)10.0)
-
-
-
-/*
- * tally_t - tally counter type
- */
-typedef unsigned long tally_t;
-
-
-/*
- * bitslice - tables and tally arrays for a given bit position in the record
- *
- * hist[i]
- *	The tally table for the xor of the current bit history with
- *	the bit history 'i' records back.
- *
- *	The layout of a given tally array is defined in alloc_bittally()'s
- *	comments.  For our example, simply note that hist[i][8] thru
- *	hist[i][15] hold the 8 tally values for all possible 3-bit
- *	combinations.  So hist[i][8] is a tally of all '000' 3-bit values.
- *	And hist[i][9] is a tally of all '001' 3-bit values.
- *	And hist[i][10] is a tally of all '010' 3-bit values.  ...
- *
- *	Therefore hist[5][10] holds a tally of all '010' 3-bit values
- *	that are computed by the xor of the current bit history
- *	and the bit history 5 records back.  If b0 is the current
- *	bit value, b1 is the previous bit value, b2 as the bit value, ...
- *
- *	Using the notation that b0 is the current value, b1 previous,
- *	b2 the bit value before that, we have:
- *
- *	    hist[5][10] = count when xor( b2b1b0 , b7b6b5 ) was '010'
- *	    hist[5][11] = count when xor( b2b1b0 , b7b6b5 ) was '011'
- *	    hist[5][12] = count when xor( b2b1b0 , b7b6b5 ) was '100'
- *
- *	    hist[6][12] = count when xor( b2b1b0 , b8b7b6 ) was '100'
- *	    hist[7][12] = count when xor( b2b1b0 , b9b8b7 ) was '100'
- *
- *	    hist[5][4] = count when xor( b1b0 , b6b5 ) was '00'
- *	    hist[5][5] = count when xor( b1b0 , b6b5 ) was '01'
- *	    hist[5][6] = count when xor( b1b0 , b6b5 ) was '10'
- *	    hist[5][7] = count when xor( b1b0 , b6b5 ) was '11'
- *
- *	    hist[4][4] = count when xor( b1b0 , b5b4 ) was '00'
- *	    hist[4][5] = count when xor( b1b0 , b5b4 ) was '01'
- *	    hist[4][6] = count when xor( b1b0 , b5b4 ) was '10'
- *	    hist[4][7] = count when xor( b1b0 , b5b4 ) was '11'
- *
- *      assuming that the -b bit_depth was deep enough and hist[i] != NULL.
- *
- *	As a special case, hist[0] points to the tally table
- *	of the current values only.  No xor is performed, thus:
- *
- *	    hist[0][10] = count when b2b1b0 was '010'
- *	    hist[0][11] = count when b2b1b0 was '100'
- *	    hist[0][4]  = count when b1b0 was '00'
- *	    hist[0][7]  = count when b1b0 was '11'
- *
- * NOTE: On struct total_ent, the high_entropy is invalid if high_bit_cnt <= 0.
- *       On struct total_ent, the low_entropy is invalid if low_bit_cnt <= 0.
- */
-struct bitslice {
-    int bitnum;			/* bit position in record, 0 ==> low order bit */
-    unsigned long history;	/* history of bit positions, bit 0 ==> most recent */
-    unsigned long ops;		/* total operations on bit, including ignored ones */
-    unsigned long count;	/* number of bits processed for this position */
-    int depth_lim;		/* bit_depth used in this slice */
-    int back_lim;		/* back_history used in this slice */
-    double max_ent[MAX_BACK_HISTORY+1];	/* max entropy estimates of hist[i] */
-    double min_ent[MAX_BACK_HISTORY+1];	/* min entropy estimates of hist[i] */
-    double entropy_high;		/* overall high estimate of entropy */
-    double entropy_low;			/* overall low estimate of entropy */
-    tally_t *hist[MAX_BACK_HISTORY+1];  /* cur & historical xor tally arrays */
-};
-static struct total_ent {
-    double high_entropy;	/* high estimate of overall entropy */
-    int high_bit_cnt;		/* bits used to compute high_entropy or -1 */
-    double low_entropy;		/* low estimate of overall entropy */
-    int low_bit_cnt;		/* bits used to compute low_entropy or -1 */
-    double med_entropy;		/* median entropy or INVALID_MAX_ENTROPY */
-} overall;
+#include "entropic.h"
+#include "entpool.h"
+#include "entread.h"
+#include "entrept.h"
 
 
 /*
  * official version
  */
-#define VERSION "1.17.1 2025-05-05"          /* format: major.minor YYYY-MM-DD */
+#define VERSION ENT_VERSION
 
 
 /*
@@ -191,8 +64,14 @@ static struct total_ent {
  */
 static const char * const usage =
 	"usage: %s [-h] [-v verbose] [-c rept_cycle] [-b bit_depth]\n"
-	"\t[-B back_history] [-f depth_factor] [-r rec_size] [-k]\n"
-	"\t[-m map_file] [-C] input_file\n"
+	"\t[-B back_history] [-f depth_factor] [-z conv_cycle] [-L block]\n"
+	"\t[-r rec_size | -R framing] [-k] [-m map_file ...] [-E encoding ...] [-C]\n"
+	"\t[[-t sep] -n field | -K key | -J key] [-G group_key] [-M mem_MiB]\n"
+	"\t[-U] [-S sample] [--offset octets] [--length octets] [--records count]\n"
+	"\t[-I io] [-F] [-T fd] [-j workers] [-p]\n"
+	"\t[-a alpha_map | -A alpha_map] [-N alpha_recs] input_file ...\n"
+	"\n"
+	"    or: %s [options ...] -D socket_path\n"
 	"\n"
 	"\t-h\t\t\tprint this help message and exit\n"
 	"\t-v verbose\t\tverbose level (def: 0 ==> none)\n"
@@ -202,13 +81,55 @@ static const char * const usage =
 	"\t-b bit_depth\t\ttally depth for each record bit (def: 8)\n"
 	"\t-B back_history\t\txor diffs this many records back (def: 32)\n"
 	"\t-f depth_factor\t\tave slot tally needed for entropy (def: 4) \n"
+	"\t\t\t\t    -b, -B and -f may be a list such as 4,8,12:\n"
+	"\t\t\t\t    one pass, reporting each combination\n"
+	"\t-z conv_cycle\t\tfreeze converged bits, check each conv_cycle records\n"
+	"\t\t\t\t    (def: 0 ==> never freeze, SIGUSR1 thaws all bits)\n"
+	"\t-L block\t\ttally block records at a time, a bit at a time,\n"
+	"\t\t\t\t    1 to 256 (def: 0 ==> record by record)\n"
 	"\t-r rec_size\t\tread rec_size octet records (def: line mode)\n"
+	"\t-R framing\t\tread records framed by: nul, u32, varint or\n"
+	"\t\t\t\t    delim:string (u32 and varint are length prefixes)\n"
+	"\t-U\t\t\tdo not decompress gzip, xz or zstd input\n"
+	"\t-S sample\t\tanalyze only a sample of the records: every:N,\n"
+	"\t\t\t\t    hash:fraction, reservoir:K or deadline:seconds\n"
+	"\t--offset octets\t\tstart at the 1st record boundary at or after offset\n"
+	"\t--length octets\t\tonly records that start in length octets from offset\n"
+	"\t--records count\t\tfind at most count records\n"
+	"\t-I io\t\t\tread files with: cache (def), nocache (drop pages\n"
+	"\t\t\t\t    once read), direct (O_DIRECT) or uring (io_uring)\n"
+	"\t-F\t\t\tfollow input_file as it grows and is rotated,\n"
+	"\t\t\t\t    reporting when caught up (or each -c rept_cycle)\n"
+	"\t-T fd\t\t\tcopy the input unchanged to fd as it is read\n"
+	"\t\t\t\t    (1 ==> stdout, reports then go to stderr)\n"
 	"\t-k\t\t\tdo not discard newlines (not with -r)\n"
 	"\t-m map_file\t\toctet mask, octet to bit map, bit mask\n"
+	"\t\t\t\t    (may be repeated: one pass, a report per map)\n"
+	"\t-E encoding\t\tuse a built-in map: hex, b32, b32rfc, b64, b64url\n"
+	"\t\t\t\t    (may be repeated and mixed with -m)\n"
 	"\t-C\t\t\tkeep after 1st = before 1st ; (not with -r)\n"
+	"\t\t\t\t    (-C -C ==> each = to ; value is a record)\n"
+	"\t-t sep\t\t\tfield separator octet, tab ==> \\t (def: ,)\n"
+	"\t-n field\t\tanalyze only field number field (1st is 1)\n"
+	"\t-K key\t\t\tanalyze only the value of key in key=value pairs\n"
+	"\t-J key\t\t\tanalyze only the value of key in a JSON object\n"
+	"\t\t\t\t    (-n, -K and -J are not with -r)\n"
+	"\t-G group_key\t\treport on each group of records with the same key:\n"
+	"\t\t\t\t    cookie, field:N, kv:key, json:key or prefix:N\n"
+	"\t-M mem_MiB\t\tmost memory for -G group or -D context tallies\n"
+	"\t\t\t\t    (def: half of physical memory)\n"
+	"\t-D socket_path\t\tserve named contexts on a UNIX socket\n"
+	"\t-j workers\t\tprocess input files or maps on this many threads\n"
+	"\t\t\t\t    (def: 1)\n"
+	"\t-p\t\t\treport on each input file (def: one aggregate report)\n"
+	"\t-a alpha_map\t\twrite a dense map of the alphabet found and exit\n"
+	"\t-A alpha_map\t\twrite a dense map of the alphabet found and use it\n"
+	"\t-N alpha_recs\t\trecords to scan for the alphabet (def: 65536)\n"
 	"\n"
-	"\tinput_file\t\tfile to read records from (- ==> stdin)\n"
-	"\n"
+	"\tinput_file ...\t\tfiles or directories to read records from\n"
+	"\t\t\t\t    (- ==> stdin)\n"
+	"\n";
+static const char * const map_usage =
 	"\tThe map_file syntax:\n"
 	"\n"
 	"\t# comments start with a # and go thru the end of the line\n"
@@ -229,6 +150,31 @@ static const char * const usage =
 	"\t# maps the octet 0x61 ('a') into 5 bits: 0, 1, 0, 0, and 1.\n"
 	"\t[0-9a-fA-F][0-9a-fA-F]=[01]*\n"
 	"\n"
+	"\t# A U+ line maps a Unicode code point (given in hex) into 0 or\n"
+	"\t#\tmore bits, and puts the map in UTF-8 mode: records are\n"
+	"\t#\tdecoded as UTF-8, charmask and columns count characters,\n"
+	"\t#\tcode points below U+0080 use the octet map, and invalid\n"
+	"\t#\tUTF-8 octets yield no bits.\n"
+	"\t# So:\n"
+	"\t#\tU+00E9=11010\n"
+	"\t# maps the character e with acute accent into 5 bits.\n"
+	"\tU+[0-9a-fA-F]+=[01]*\n"
+	"\n"
+	"\t# A columns line starts an octet map for a range of character\n"
+	"\t#\tpositions (1st char is 1, counted after the charmask).\n"
+	"\t#\tThe octet map lines that follow apply only to that range.\n"
+	"\t#\tOctets not given yield no bits in that range.  Positions\n"
+	"\t#\tin no range use the octet map lines before any columns line.\n"
+	"\t#\tRanges may not overlap, and N and M are at most 1048576.\n"
+	"\t# So:\n"
+	"\t#\tcolumns=1-8\t# hex prefix\n"
+	"\t#\t30=0000\n"
+	"\t#\t...\n"
+	"\t#\tcolumns=9-\t# base64 body\n"
+	"\t#\t41=000000\n"
+	"\t#\t...\n"
+	"\tcolumns=N | columns=N-M | columns=N-\n"
+	"\n"
 	"\t# The bitmask line contains only x's and b's after the =\n"
 	"\t# The bitmask is optional, default is process all bits\n"
 	"\tbitmask=[xb]+\n"
@@ -264,190 +210,242 @@ static char *prog = NULL;       /* basename of program */
 static const char * const version = VERSION;
 static int v_flag = 0;		/* verbosity level */
 static int rept_cycle = 0;	/* >= 0 ==> rept entropy every so many recs */
-static int bit_depth = DEF_DEPTH;  /* tally bit depth for each bit in record */
-static int back_history = DEF_HISTORY;	/* xor diff back this many records */
-static int depth_factor = DEF_DEPTH_FACTOR;	/* ave slot tally needed */
+static struct ent_cfg cfg;	/* analysis parameters, see entropic.h */
+static volatile sig_atomic_t thaw_request = 0;	/* 1 ==> SIGUSR1 asked to thaw */
 static int rec_size = 0;	/* > 0 ==> record size, 0 ==> line mode */
 static int line_mode = 1;	/* 0 ==> read binary recs, 1 ==> read lines */
-static char *map_file = NULL;	/* x ==> remove, v ==> keep, else remove */
+static int framed = 0;		/* 1 ==> -R framing */
+static struct rd_framing framing;	/* how records are found, see entread.h */
+static int raw_input = 0;	/* 1 ==> -U, do not decompress input */
+static struct rd_sample sample;	/* -S records to analyze, see entread.h */
+static off_t range_offset = 0;	/* --offset octets, 0 ==> start */
+static off_t range_length = 0;	/* --length octets, 0 ==> to EOF */
+static unsigned long range_records = 0;	/* --records count, 0 ==> all */
+static int io_mode = RD_IO_CACHE;	/* -I how input files are read */
+static int follow = 0;		/* 1 ==> -F, follow the input file */
+#define FOLLOW_WAIT 1.0		/* -F most seconds between checks */
+static int tee_fd = 0;		/* > 0 ==> -T, copy the input to this fd */
+
+/*
+ * long options, they have no short form
+ */
+#define OPT_OFFSET 256
+#define OPT_LENGTH 257
+#define OPT_RECORDS 258
+static const struct option long_opts[] = {
+    {"offset", required_argument, NULL, OPT_OFFSET},
+    {"length", required_argument, NULL, OPT_LENGTH},
+    {"records", required_argument, NULL, OPT_RECORDS},
+    {NULL, 0, NULL, 0}
+};
+static struct ent_map *map = NULL;	/* loaded map_file or NULL */
 static char *filename;		/* name of input file, or - ==> stdin */
+static struct pool_list inputs;	/* input files, directories expanded */
+static int multi = 0;		/* 1 ==> process inputs on a pool */
+static int per_file = 0;	/* 1 ==> report on each input file */
+static int workers = 1;		/* number of worker threads */
+static char *sock_path = NULL;	/* != NULL ==> daemon mode socket */
+static size_t mem_max = 0;	/* -M limit of -G or -D context octets */
+static volatile sig_atomic_t stop_request = 0;	/* 1 ==> daemon or -F should stop */
 
 
 /*
- * record pre-processing
+ * daemon mode
  *
- * We will document the pre-processing performed on a record in order:
+ * In daemon mode (-D socket_path) entropic listens on a UNIX domain
+ * stream socket.  Clients send frames, and each frame is answered
+ * with exactly one reply frame.
  *
- * keep_newline	(-k)
+ * A frame is:
  *
- *	If line_mode == 0: (-r rec_size)
- *	     do nothing
+ *	u32	frame length, not counting these 4 octets
+ *	u8	op
+ *	u8	name length, 1 to 255
+ *	...	context name (not NUL terminated)
+ *	...	op payload, the rest of the frame
  *
- *	If line_mode == 1: (without -r)
- *	     keep_newline == 0   ==>   discard trailing \n, \r, \r\n, or \n\r
- *	     keep_newline == 1   ==>   do nothing
+ * The ops are:
  *
- * cookie_trim (-c)
+ *	'F'	feed: the payload is zero or more records, each a u32
+ *		record length followed by the record octets.  The named
+ *		context is created on first use.  Reply: OK records_fed
+ *	'R'	report: reply with an entropy report of the named context
+ *	'T'	thaw: thaw the frozen bitslices of the named context
+ *	'X'	drop: free the named context
  *
- *	If line_mode == 0: (-r rec_size)
- *	     do cookie_trim
+ * A reply is a u32 reply length followed by that many octets of text.
+ * Failed ops reply with a line that starts with ERR.  Once the contexts
+ * hold more than -M mem_MiB, feeds fail until contexts are dropped.
  *
- *	If line_mode == 1: (without -r)
- *	     cookie_trim == 0   ==>   do nothing
- *	     cookie_trim == 1   ==>   keep text after 1st = and before 1st ;
+ * All u32 values are in network byte order.  All contexts share the
+ * command line analysis parameters and map file.
  *
- * char_mask (from -m map_file)
+ * Client sockets are non-blocking.  Replies are queued on the client
+ * and sent as the client reads them, so a client that stops reading
+ * does not hold up the others.  No more of its frames are read or
+ * processed while it has more than CLIENT_OUT octets of replies queued.
  *
- *	A string of "x"'s and "c"'s that indicate which chars in
- *	an input record will be processed.  An "x" means that a
- *	character in the input record is ignored.  A "c" means
- *	that the character will be processed.
+ * MAX_CLIENTS	    the most clients that may connect at the same time
+ * MAX_FRAME	    the largest frame we will accept
+ * CLIENT_BUF	    initial size of the client input buffer
+ * CLIENT_OUT	    most queued reply octets before a client is not served
+ */
+#define MAX_CLIENTS 64
+#define MAX_FRAME (64*1024*1024)
+#define CLIENT_BUF (1024*1024)
+#define CLIENT_OUT (64*1024)
+struct dctx {
+    char *name;			/* malloc-ed context name */
+    struct ent_ctx *ctx;	/* entropy analysis context */
+    size_t size;		/* octets of ctx counted in dctx_mem */
+    struct dctx *next;		/* next named context or NULL */
+};
+struct client {
+    int fd;			/* client socket */
+    u_int8_t *buf;		/* malloc-ed input buffer */
+    size_t len;			/* octets in buf */
+    size_t size;		/* malloc-ed size of buf */
+    char *out;			/* malloc-ed replies not yet sent */
+    size_t out_len;		/* octets in out */
+    size_t out_size;		/* malloc-ed size of out */
+    int closing;		/* 1 ==> no more frames, drop once out is sent */
+};
+static struct dctx *dctx_list = NULL;	/* named daemon contexts */
+static size_t dctx_mem = 0;		/* octets held by named contexts */
+
+
+/*
+ * multiple maps
+ *
+ * The -m option may be given more than once.  With more than one map,
+ * records are read and have their newline and cookie trimmed just once
+ * (see ent_trim()).  Each map has its own entropy context, and the
+ * contexts are fed the same batch of trimmed records on a pool of -j
+ * worker threads, one map per job.  A report is printed for each map.
+ * The trimmed records of a batch are copied, one after another, into
+ * batch_buf, which grows as needed, and each job feeds the whole batch
+ * to its context with ent_feed_batch().
+ *
+ * A -E encoding is a built-in map (see ent_map_builtin()) and is
+ * counted as one of the maps.
+ *
+ * MAX_MAPS	most -m map_file and -E encoding options
+ * BATCH_RECS	records read before the map contexts are fed
+ */
+#define MAX_MAPS 16
+#define BATCH_RECS 4096
+static char *map_files[MAX_MAPS];	/* -m map_file or -E encoding names */
+static int map_builtin[MAX_MAPS];	/* 1 ==> -E encoding, 0 ==> -m */
+static struct ent_map *maps[MAX_MAPS];	/* loaded maps */
+static struct ent_ctx *map_ctx[MAX_MAPS];	/* entropy context of each map */
+static int map_err[MAX_MAPS];		/* 0 ==> OK, else errno of failure */
+static int nmaps = 0;			/* number of -m and -E options */
+static u_int8_t *batch_buf;		/* batch of trimmed records */
+static size_t batch_size;		/* malloc-ed size of batch_buf */
+static size_t batch_off[BATCH_RECS];	/* offset of each trimmed record */
+static u_int8_t *batch_rec[BATCH_RECS];	/* each trimmed record, in batch_buf */
+static int batch_len[BATCH_RECS];	/* length of each trimmed record */
+static int batch_recs;			/* records in the batch */
+
+
+/*
+ * group by key
  *
- *	NULL ==> process all characters (the default)
+ * With -G group_key, each record is routed to an entropy context of
+ * its own key, found in a hash table, and a report is printed for each
+ * key.  The group_key is one of:
  *
- * octet_map[i] (from -m map_file)
+ *	cookie		the name of each cookie, each cookie value being a
+ *			record (as with -C -C)
+ *	field:N		field N of the line (see -t sep)
+ *	kv:key		the value of key in key=value pairs
+ *	json:key	the value of key in a JSON object
+ *	prefix:N	the first N octets of the record
  *
- *	A string of ASCII "0"'s and "1"'s representing the bit pattern
- *	that a the octet 'i' should be converted into during the
- *	processing of a record.  An empty string means that the
- *	given octet pattern is skipped.
+ * The key is found in the line before -n, -K or -J select the record,
+ * except for prefix:N, which is taken from the record.
  *
- *	The default octet_map is the 8 bit value of the octet.
+ * Each group has its own tallies, held to -M mem_MiB in all (see mem_max).
+ */
+#define GROUP_COOKIE 1		/* -G cookie */
+#define GROUP_FIELD 2		/* -G field:N, kv:key or json:key */
+#define GROUP_PREFIX 3		/* -G prefix:N */
+struct group {
+    char *key;			/* malloc-ed key, NUL terminated */
+    int key_len;		/* length of key */
+    u_int32_t hash;		/* hash of key */
+    struct ent_ctx *ctx;	/* entropy context of the group */
+    struct group *next;		/* next group in the hash chain */
+};
+static int group_mode = 0;		/* 0 ==> no -G, else GROUP_XYZ */
+static int group_prefix = 0;		/* -G prefix:N length */
+static struct ent_cfg group_cfg;	/* finds the -G field:N, kv or json key */
+static struct ent_cfg group_ctx_cfg;	/* config of the group contexts */
+static struct group **group_hash;	/* hash chains of groups */
+static int group_hash_len;		/* number of hash chains, a power of 2 */
+static struct group **group;		/* groups in order of creation */
+static int ngroups = 0;			/* number of groups */
+static size_t group_mem = 0;		/* octets held by group contexts */
+
+
+/*
+ * alphabet discovery
  *
- * bit_mask (from -m map_file)
+ * With -a alpha_map or -A alpha_map, the first alpha_recs records are
+ * scanned for the octets used at each character position, and a dense
+ * map file is written to alpha_map (see ent_alpha_write()).  With -a we
+ * exit once the map is written.  With -A the input is rewound and
+ * analyzed using the new map.
  *
- *	A string of "x"'s and "b"'s that indicate which bits will
- *	be processed.  An "x" means that a bit will be ignored.
- *	A "b" means that the bit will be processed.
+ * DEF_ALPHA_RECS	default -N alpha_recs
+ */
+#define DEF_ALPHA_RECS 65536
+static char *alpha_file = NULL;		/* != NULL ==> write discovered map */
+static int alpha_use = 0;		/* 1 ==> analyze using alpha_file */
+static unsigned long alpha_recs = DEF_ALPHA_RECS;	/* records to scan */
+
+
+/*
+ * parameter sweep
  *
- *	NULL ==> process all bits (the default)
+ * The -b, -B and -f options take a comma separated list of values
+ * (see entrept.h).
  */
-static int keep_newline = 0;	/* 0 ==> discard newline, 1 ==> keep them */
-static int cookie_trim = 0;	/* 1 ==> keep after 1st = and before 1st ; */
-static char *char_mask = NULL;
-static char *octet_map[1 << OCTET_BITS] = {
-    "00000000", "00000001", "00000010", "00000011",
-    "00000100", "00000101", "00000110", "00000111",
-    "00001000", "00001001", "00001010", "00001011",
-    "00001100", "00001101", "00001110", "00001111",
-    "00010000", "00010001", "00010010", "00010011",
-    "00010100", "00010101", "00010110", "00010111",
-    "00011000", "00011001", "00011010", "00011011",
-    "00011100", "00011101", "00011110", "00011111",
-    "00100000", "00100001", "00100010", "00100011",
-    "00100100", "00100101", "00100110", "00100111",
-    "00101000", "00101001", "00101010", "00101011",
-    "00101100", "00101101", "00101110", "00101111",
-    "00110000", "00110001", "00110010", "00110011",
-    "00110100", "00110101", "00110110", "00110111",
-    "00111000", "00111001", "00111010", "00111011",
-    "00111100", "00111101", "00111110", "00111111",
-    "01000000", "01000001", "01000010", "01000011",
-    "01000100", "01000101", "01000110", "01000111",
-    "01001000", "01001001", "01001010", "01001011",
-    "01001100", "01001101", "01001110", "01001111",
-    "01010000", "01010001", "01010010", "01010011",
-    "01010100", "01010101", "01010110", "01010111",
-    "01011000", "01011001", "01011010", "01011011",
-    "01011100", "01011101", "01011110", "01011111",
-    "01100000", "01100001", "01100010", "01100011",
-    "01100100", "01100101", "01100110", "01100111",
-    "01101000", "01101001", "01101010", "01101011",
-    "01101100", "01101101", "01101110", "01101111",
-    "01110000", "01110001", "01110010", "01110011",
-    "01110100", "01110101", "01110110", "01110111",
-    "01111000", "01111001", "01111010", "01111011",
-    "01111100", "01111101", "01111110", "01111111",
-    "10000000", "10000001", "10000010", "10000011",
-    "10000100", "10000101", "10000110", "10000111",
-    "10001000", "10001001", "10001010", "10001011",
-    "10001100", "10001101", "10001110", "10001111",
-    "10010000", "10010001", "10010010", "10010011",
-    "10010100", "10010101", "10010110", "10010111",
-    "10011000", "10011001", "10011010", "10011011",
-    "10011100", "10011101", "10011110", "10011111",
-    "10100000", "10100001", "10100010", "10100011",
-    "10100100", "10100101", "10100110", "10100111",
-    "10101000", "10101001", "10101010", "10101011",
-    "10101100", "10101101", "10101110", "10101111",
-    "10110000", "10110001", "10110010", "10110011",
-    "10110100", "10110101", "10110110", "10110111",
-    "10111000", "10111001", "10111010", "10111011",
-    "10111100", "10111101", "10111110", "10111111",
-    "11000000", "11000001", "11000010", "11000011",
-    "11000100", "11000101", "11000110", "11000111",
-    "11001000", "11001001", "11001010", "11001011",
-    "11001100", "11001101", "11001110", "11001111",
-    "11010000", "11010001", "11010010", "11010011",
-    "11010100", "11010101", "11010110", "11010111",
-    "11011000", "11011001", "11011010", "11011011",
-    "11011100", "11011101", "11011110", "11011111",
-    "11100000", "11100001", "11100010", "11100011",
-    "11100100", "11100101", "11100110", "11100111",
-    "11101000", "11101001", "11101010", "11101011",
-    "11101100", "11101101", "11101110", "11101111",
-    "11110000", "11110001", "11110010", "11110011",
-    "11110100", "11110101", "11110110", "11110111",
-    "11111000", "11111001", "11111010", "11111011",
-    "11111100", "11111101", "11111110", "11111111"
-};
-static char *bit_mask = NULL;
+static struct rept_sweep sweep_vals;	/* -b, -B and -f values */
+static int sweep = 0;			/* 1 ==> report a parameter grid */
 
 
 /*
  * forward declarations
  */
 static void parse_args(int argc, char **argv);
-static void load_map_file(char *map_file);
-static tally_t *alloc_bittally(int depth);
-static struct bitslice *alloc_bitslice(int bitnum, int depth);
-static void record_bit(struct bitslice *slice, int value);
-static int read_record(FILE *input, u_int8_t *buf, int buf_size,
-		       int read_line);
-static int pre_process(u_int8_t *inbuf, int inbuf_len, u_int8_t **outbuf,
-		       int *outbuf_len);
-static void rept_entropy(struct bitslice **slice, int bit_buf_used);
+static void cycle_rept(struct ent_ctx *ctx, unsigned long count);
+static void discover(struct reader *rd);
+static void run_maps(void);
+static void parse_group(const char *arg);
+static void run_groups(void);
+static void group_feed(const u_int8_t *key, int key_len,
+		       const u_int8_t *rec, int len);
+static struct group *find_group(const u_int8_t *key, int key_len);
+static int group_cmp(const void *a, const void *b);
+static void map_job(int w, int job, void *arg);
+static void run_files(void);
+static void run_daemon(void);
+static struct dctx *find_dctx(const char *name, int name_len, int create);
+static void drop_dctx(const char *name, int name_len);
+static int serve_client(struct client *c, int can_read);
+static int do_frame(struct client *c, u_int8_t *frame, u_int32_t frame_len);
+static int reply(struct client *c, const char *fmt, ...);
+static int send_replies(struct client *c);
+static void thaw_handler(int sig);
+static void stop_handler(int sig);
 static void dbg(int level, char *fmt, ...);
 
 
 /*
  * misc globals and static values
  */
-static tally_t recnum = 0;	/* current record number, starting with 0 */
-static int hex_to_value[1 << OCTET_BITS] = {
-    /* 00 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 08 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 10 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 18 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 20 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 28 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 30 */	0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7,
-    /* 38 */    0x8, 0x9, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 40 */    0x0, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf, 0x0,
-    /* 48 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 50 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 58 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 60 */    0x0, 0xA, 0xB, 0xC, 0xD, 0xE, 0xF, 0x0,
-    /* 68 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 70 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 78 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 80 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 88 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 90 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* 98 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* a0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* a8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* b0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* b8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* c0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* c8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* d0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* d8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* e0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* e8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* f0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-    /* f8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
-};
+static unsigned long recnum = 0;	/* current record number, starting with 0 */
 
 
 /*
@@ -458,15 +456,19 @@ main(int argc, char *argv[])
 {
     extern char *optarg;	/* argument to current option */
     extern int optind;		/* first argv-element that is not an option */
-    FILE *input;		/* stream from which to read records */
-    u_int8_t *raw_buf;		/* malloc-ed raw record input buffer */
-    int raw_len;		/* length of raw record in octets */
-    u_int8_t *bit_buf;		/* malloc-ed buffer of 0x00 or 0x01 octets */
-    int bit_len;		/* length bit_buf */
-    int bit_buf_used;		/* number of octets in bit_buf being used */
-    struct bitslice **bits;	/* bits[i] points to bitslice for bit i */
-    int bits_len;		/* length of bits pointer array */
-    int i;
+    struct reader *rd;		/* reader of the file containing records */
+    u_int8_t *raw_buf[ENT_BATCH];	/* raw records, in the reader buffer */
+    int raw_len[ENT_BATCH];	/* length of each raw record in octets */
+    int want;			/* records to read in the batch */
+    int ret;			/* records read, 0 ==> EOF, -1 ==> error */
+    unsigned long seen;		/* records found in the input */
+    unsigned long taken;	/* records of them sampled */
+    int bit_buf_used;		/* number of bits processed for the last record */
+    struct ent_ctx *ctx;	/* entropy analysis context */
+    struct ent_rept rept;	/* entropy report */
+    unsigned long reported;	/* -F record count of the last report */
+    char rept_buf[BUFSIZ+1];	/* formatted entropy report */
+    struct ent_rept *grid;	/* sweep report grid */
 
     /*
      * parse args
@@ -474,189 +476,186 @@ main(int argc, char *argv[])
     parse_args(argc, argv);
 
     /*
-     * open the file containing records
+     * daemon mode and multiple input mode do not return
      */
-    if (strcmp(filename, "-") == 0) {
-	/* - means read from stdin */
-	input = stdin;
-    } else {
-	input = fopen(filename, "r");
+    if (sock_path != NULL) {
+	run_daemon();
+	/*NOTREACHED*/
     }
-    if (input == NULL) {
-	fprintf(stderr, "%s: unable to open for reading: %s\n",
-		program, filename);
-	exit(1);
+    if (multi) {
+	run_files();
+	/*NOTREACHED*/
+    }
+    if (nmaps > 1) {
+	run_maps();
+	/*NOTREACHED*/
+    }
+    if (group_mode != 0) {
+	run_groups();
+	/*NOTREACHED*/
     }
 
     /*
-     * allocate raw input buffer and bit buffer with extra room in each
+     * open the file containing records, - means read from stdin
      */
-    raw_buf = (u_int8_t *)malloc(rec_size+1);
-    if (raw_buf == NULL) {
-	fprintf(stderr, "%s: failed to allocate raw buffer: %d octets\n",
-		program, rec_size+1);
+    rd = rd_new(&framing);
+    if (rd == NULL) {
+	fprintf(stderr, "%s: failed to allocate reader: %s\n",
+		program, strerror(errno));
 	exit(2);
     }
-    bit_len = rec_size * OCTET_BITS;
-    bit_buf = (u_int8_t *)malloc((rec_size+1) * OCTET_BITS + 1);
-    if (bit_buf == NULL) {
-	fprintf(stderr, "%s: failed to allocate bit buffer: %d octets\n",
-		program, (rec_size+1) * OCTET_BITS + 1);
-	exit(3);
+    if (rd_open(rd, filename) < 0) {
+	fprintf(stderr, "%s: unable to open for reading: %s: %s\n",
+		program, filename, strerror(errno));
+	exit(1);
     }
 
     /*
-     * setup for overall entropy calculation
+     * discover the alphabet, if requested
      */
-    overall.high_entropy = INVALID_MAX_ENTROPY;
-    overall.high_bit_cnt = 0;
-    overall.low_entropy = INVALID_MIN_ENTROPY;
-    overall.low_bit_cnt = 0;
-    overall.med_entropy = INVALID_MAX_ENTROPY;
+    if (alpha_file != NULL) {
+	discover(rd);
+	if (alpha_use == 0) {
+	    exit(0);
+	}
+    }
 
     /*
-     * process records, one at a time
+     * setup for entropy calculation
      */
-    recnum = 0;
-    bits_len = 0;
-    bits = NULL;
-    do {
+    ctx = ent_open(&cfg, map);
+    if (ctx == NULL) {
+	fprintf(stderr, "%s: failed to create entropy context: %s\n",
+		program, strerror(errno));
+	exit(3);
+    }
 
-	/*
-	 * read the next record
-	 */
-	dbg(5, "main: reading record: %llu", (unsigned long)recnum);
-	raw_len = read_record(input, raw_buf, rec_size, line_mode);
-	if (raw_len <= 0) {
-	    break;
-	}
+    /*
+     * SIGUSR1 thaws any frozen bitslices
+     */
+    if (cfg.conv_cycle > 0) {
+	(void) signal(SIGUSR1, thaw_handler);
+    }
 
-	/*
-	 * pre-process raw record and produce a bit buffer
-	 */
-	bit_buf_used = pre_process(raw_buf, raw_len, &bit_buf, &bit_len);
-	if (bit_buf_used <= 0) {
-	    /* EOF or error */
-	    dbg(5, "main: skipping record, bit_buf_used returned: %d <= 0",
-		    bit_buf_used);
-	    continue;
-	}
-	dbg(5, "main: bit buffer has %d bits", bit_buf_used);
+    /*
+     * SIGINT and SIGTERM end following with the final report
+     */
+    if (follow) {
+	(void) signal(SIGINT, stop_handler);
+	(void) signal(SIGTERM, stop_handler);
+    }
 
-	/*
-	 * allocate bitslices for any new bit positions
-	 */
-	if (bit_buf_used > bits_len) {
+    /*
+     * process records, a batch at a time, and with -F as the file grows
+     */
+    recnum = 0;
+    reported = 0;
+    for (;;) {
+	for (;;) {
 
 	    /*
-	     * expand or create bits pointer array
+	     * read the next batch, up to the next report
 	     */
-	    if (bits == NULL) {
-		dbg(2, "creating bits up thru %d", bit_buf_used);
-		bits = (struct bitslice **) malloc(bit_buf_used *
-						   sizeof(struct bitslice *));
-	    } else {
-		dbg(2, "expanding bits from %d bits to %d bits",
-		       bits_len, bit_buf_used);
-		bits = (struct bitslice **) realloc(bits,
-						    bit_buf_used *
-						    sizeof(struct bitslice *));
+	    if (stop_request) {
+		ret = 0;
+		break;
+	    }
+	    want = ENT_BATCH;
+	    if (rept_cycle > 0 &&
+		(unsigned long)want > rept_cycle - recnum % rept_cycle) {
+		want = (int)(rept_cycle - recnum % rept_cycle);
+	    }
+	    dbg(5, "main: reading batch at record: %lu", recnum);
+	    ret = rd_batch(rd, raw_buf, raw_len, want);
+	    if (ret <= 0) {
+		break;
 	    }
-	    if (bits == NULL) {
-		fprintf(stderr, "%s: failed to allocate %d bitslice pointers",
-			program, bit_buf_used);
+	    dbg(6, "main: read %d records at record %lu", ret, recnum);
+
+	    /*
+	     * pre-process raw records and record their bit values
+	     */
+	    bit_buf_used = ent_feed_batch(ctx, raw_buf, raw_len, ret);
+	    if (bit_buf_used < 0) {
+		fprintf(stderr, "%s: failed to process records %lu to %lu: %s\n",
+			program, recnum, recnum + ret-1, strerror(errno));
 		exit(4);
 	    }
+	    recnum += ret;
+	    if (bit_buf_used == 0) {
+		dbg(5, "main: last record of the batch has no bits");
+		continue;
+	    }
 
 	    /*
-	     * create new tally_t's for the new bits
+	     * thaw bitslices, if needed
 	     */
-	    for (i=bits_len; i < bit_buf_used; ++i) {
-		bits[i] = alloc_bitslice(i, bit_depth);
-		if (bits[i] == NULL) {
-		    fprintf(stderr, "%s: cannot allocate tally_t for bid %d",
-			    program, i);
-		    exit(5);
-		}
+	    if (thaw_request) {
+		thaw_request = 0;
+		ent_thaw(ctx);
 	    }
-	    bits_len = bit_buf_used;
-	}
 
-	/*
-	 * record bit values for this record
-	 */
-	for (i=0; i < bit_buf_used; ++i) {
-	    record_bit(bits[i], bit_buf[i]);
+	    /*
+	     * report the entropy, if needed
+	     */
+	    if (rept_cycle > 0 && (recnum % rept_cycle) == 0) {
+		cycle_rept(ctx, recnum);
+	    }
+	}
+	if (ret < 0) {
+	    fprintf(stderr, "%s: error reading record %lu: %s: %s\n",
+		    program, recnum, filename, strerror(errno));
+	    exit(1);
 	}
 
 	/*
-	 * report the entropy, if needed
+	 * with -F, report once caught up, and wait for more
 	 */
-	if (rept_cycle > 0 && ((recnum+1) % rept_cycle) == 0) {
-	    rept_entropy(bits, bits_len);
-	    if (overall.high_bit_cnt > 0) {
-		printf("after record %lu for %d bits: "
-		       "high entropy: %f\n",
-		       (unsigned long)recnum+1,
-		       overall.high_bit_cnt, overall.high_entropy);
-	    }
-	    if (overall.low_bit_cnt > 0) {
-		printf("after record %lu for %d bits: "
-		       "low entropy: %f\n",
-		       (unsigned long)recnum+1,
-		       overall.low_bit_cnt, overall.low_entropy);
-	    }
-	    if (overall.high_bit_cnt > 0 && overall.low_bit_cnt > 0) {
-		printf("after record %lu for %d bits: "
-		       "median entropy: %f\n",
-		       (unsigned long)recnum+1,
-		       overall.low_bit_cnt, overall.med_entropy);
-	    }
-	    if (overall.high_bit_cnt > 0) {
-		fputc('\n', stdout);
-	    }
+	if (follow == 0 || stop_request) {
+	    break;
 	}
-
-    } while (++recnum > 0);
+	if (rept_cycle == 0 && recnum > reported) {
+	    cycle_rept(ctx, recnum);
+	    reported = recnum;
+	}
+	if (rd_follow(rd, FOLLOW_WAIT) < 0) {
+	    fprintf(stderr, "%s: error following: %s: %s\n",
+		    program, filename, strerror(errno));
+	    exit(1);
+	}
+    }
 
     /*
      * final entropy processing
      */
     dbg(1, "final entropy processing");
-    if (bits == NULL || bits_len <= 0) {
+    (void) ent_report(ctx, &rept);
+    if (rept.bits <= 0) {
 	printf("Error: nothing to process\n");
-    } else {
-	rept_entropy(bits, bits_len);
-    }
-    printf("\nEntropy report:\n");
-    if (overall.high_bit_cnt > 0) {
-	printf("record count: %lu with %d bits: "
-	       "high entropy: %f\n",
-	       (unsigned long)recnum+1,
-	       overall.high_bit_cnt, overall.high_entropy);
-    } else {
-	printf("Error: not enough data to calculate high entropy estimate\n");
-    }
-    if (overall.low_bit_cnt > 0) {
-	printf("record count: %lu with %d bits: "
-	       "low entropy: %f\n",
-	       (unsigned long)recnum+1,
-	       overall.low_bit_cnt, overall.low_entropy);
-    } else {
-	printf("Error: not enough data to calculate low entropy estimate\n");
     }
-    if (overall.high_bit_cnt > 0 && overall.low_bit_cnt > 0) {
-	printf("high, median and low entropy: %f %f %f\n\n",
-	       overall.high_entropy,
-	       overall.med_entropy,
-	       overall.low_entropy);
+    if (sweep) {
+	grid = rept_grid(&sweep_vals, ctx);
+	if (grid == NULL) {
+	    fprintf(stderr, "%s: failed to compute sweep report: %s\n",
+		    program, strerror(errno));
+	    exit(56);
+	}
+	printf("\nEntropy sweep report:\n");
+	rept_print_grid(&sweep_vals, grid, rept.recnum);
+	free(grid);
     } else {
-	printf("Error: not enough data to calculate median entropy estimate\n");
+	rept_format(rept_buf, sizeof(rept_buf), &rept, rept.recnum);
+	printf("\nEntropy report:\n%s", rept_buf);
     }
 
     /*
      * all done!  -- Jessica Noll, Age 2
      */
+    ent_close(ctx);
+    ent_map_free(map);
+    rd_counts(rd, &seen, &taken);
+    dbg(1, "main: sampled %lu of %lu records", taken, seen);
+    rd_free(rd);
     dbg(1, "all done!");
     exit(0);
 }
@@ -668,6 +667,11 @@ main(int argc, char *argv[])
 static void
 parse_args(int argc, char **argv)
 {
+    char errbuf[BUFSIZ+1];	/* map file or sweep list error message */
+    int field_opts = 0;		/* number of -n, -K and -J options */
+    char *end;			/* end of a number */
+    long n;			/* -M mem_MiB */
+    struct stat sbuf;		/* -A input_file status */
     int i;
 
     /*
@@ -682,16 +686,22 @@ parse_args(int argc, char **argv)
     } else {
         ++prog;
     }
-    while ((i = getopt(argc, argv, "hv:Vc:b:B:f:r:km:C")) != -1) {
+    ent_cfg_init(&cfg);
+    cfg.text = 1;
+    cfg.keep_newline = 0;
+    while ((i = getopt_long(argc, argv, "hv:Vc:b:B:f:z:L:r:R:US:I:FT:km:E:Ct:n:K:J:G:M:D:j:pa:A:N:",
+			    long_opts, NULL)) != -1) {
 	switch (i) {
 
 	case 'h':	/* print usage message and then exit */
-	    fprintf(stderr, usage, program, prog, version);
+	    fprintf(stderr, usage, program, program);
+	    fprintf(stderr, map_usage, prog, version);
 	    exit(2);
 	    /*NOTREACHED*/
 
 	case 'v':	/* verbose level */
 	    v_flag = strtol(optarg, NULL, 0);
+	    cfg.v_flag = v_flag;
 	    break;
 
 	case 'V':       /* -V - print version string and exit */
@@ -704,1208 +714,1976 @@ parse_args(int argc, char **argv)
 	    break;
 
 	case 'b':	/* tally depth */
-	    bit_depth = strtol(optarg, NULL, 0);
+	    sweep_vals.ndepth = rept_list("-b bit_depth", optarg,
+					  sweep_vals.depth,
+					  errbuf, sizeof(errbuf));
+	    if (sweep_vals.ndepth < 0) {
+		fprintf(stderr, "%s: %s\n", program, errbuf);
+		exit(55);
+	    }
 	    break;
 
 	case 'B':	/* back history depth */
-	    back_history = strtol(optarg, NULL, 0);
+	    sweep_vals.nback = rept_list("-B back_history", optarg,
+					 sweep_vals.back,
+					 errbuf, sizeof(errbuf));
+	    if (sweep_vals.nback < 0) {
+		fprintf(stderr, "%s: %s\n", program, errbuf);
+		exit(55);
+	    }
 	    break;
 
 	case 'f':	/* ave slot tally needed for entropy calculation */
-	    depth_factor = strtol(optarg, NULL, 0);
+	    sweep_vals.nfactor = rept_list("-f depth_factor", optarg,
+					   sweep_vals.factor,
+					   errbuf, sizeof(errbuf));
+	    if (sweep_vals.nfactor < 0) {
+		fprintf(stderr, "%s: %s\n", program, errbuf);
+		exit(55);
+	    }
+	    break;
+
+	case 'z':	/* slice convergence check cycle */
+	    cfg.conv_cycle = strtol(optarg, NULL, 0);
+	    break;
+
+	case 'L':	/* records per cache block */
+	    cfg.block = strtol(optarg, NULL, 0);
 	    break;
 
 	case 'r':	/* binary record size */
 	    rec_size = strtol(optarg, NULL, 0);
 	    line_mode = 0;
+	    cfg.text = 0;
+	    break;
+
+	case 'R':	/* record framing */
+	    if (rd_framing(optarg, &framing) < 0) {
+		fprintf(stderr, "%s: -R framing must be nul, u32, varint or "
+				"delim:string of 1 to %d octets\n",
+			program, RD_MAX_DELIM);
+		exit(75);
+	    }
+	    framed = 1;
+	    if (framing.type == RD_U32 || framing.type == RD_VARINT) {
+		/* length prefixed records are binary, keep their newlines */
+		cfg.text = 0;
+		cfg.keep_newline = 1;
+	    }
+	    break;
+
+	case 'U':	/* do not decompress */
+	    raw_input = 1;
+	    break;
+
+	case OPT_OFFSET:	/* start of the range */
+	    errno = 0;
+	    range_offset = (off_t)strtoll(optarg, &end, 0);
+	    if (*end != '\0' || errno != 0 || range_offset < 0) {
+		fprintf(stderr, "%s: --offset octets must be >= 0\n", program);
+		exit(78);
+	    }
+	    break;
+
+	case OPT_LENGTH:	/* length of the range */
+	    errno = 0;
+	    range_length = (off_t)strtoll(optarg, &end, 0);
+	    if (*end != '\0' || errno != 0 || range_length <= 0) {
+		fprintf(stderr, "%s: --length octets must be > 0\n", program);
+		exit(79);
+	    }
+	    break;
+
+	case OPT_RECORDS:	/* most records to find */
+	    errno = 0;
+	    range_records = strtoul(optarg, &end, 0);
+	    if (*end != '\0' || errno != 0 || range_records == 0 ||
+		optarg[0] == '-') {
+		fprintf(stderr, "%s: --records count must be > 0\n", program);
+		exit(80);
+	    }
+	    break;
+
+	case 'I':	/* how input files are read */
+	    io_mode = rd_io(optarg);
+	    if (io_mode < 0) {
+		fprintf(stderr, "%s: -I io must be cache, nocache, direct or uring\n",
+			program);
+		exit(81);
+	    }
+	    break;
+
+	case 'F':	/* follow the input file */
+	    follow = 1;
+	    break;
+
+	case 'T':	/* copy the input to a file descriptor */
+	    errno = 0;
+	    tee_fd = (int)strtol(optarg, &end, 0);
+	    if (*end != '\0' || errno != 0 || tee_fd <= 0 ||
+		fcntl(tee_fd, F_GETFL) < 0) {
+		fprintf(stderr, "%s: -T fd must be an open file descriptor > 0\n",
+			program);
+		exit(83);
+	    }
+	    break;
+
+	case 'S':	/* record sampling */
+	    if (rd_sample(optarg, &sample) < 0) {
+		fprintf(stderr, "%s: -S sample must be every:N, hash:fraction, "
+				"reservoir:K or deadline:seconds\n", program);
+		exit(77);
+	    }
 	    break;
 
 	case 'k':	/* keep newlines */
-	    keep_newline = 1;
+	    cfg.keep_newline = 1;
 	    break;
 
 	case 'm':	/* map filename */
-	    map_file = optarg;
+	case 'E':	/* built-in encoding */
+	    if (nmaps >= MAX_MAPS) {
+		fprintf(stderr, "%s: at most %d -m map_file and -E encoding "
+				"options\n", program, MAX_MAPS);
+		exit(57);
+	    }
+	    map_builtin[nmaps] = (i == 'E');
+	    map_files[nmaps++] = optarg;
+	    break;
+
+	case 'C':	/* cookie trim, -C -C ==> every cookie */
+	    if (cfg.cookie_trim < 2) {
+		++cfg.cookie_trim;
+	    }
+	    break;
+
+	case 'D':	/* daemon mode socket */
+	    sock_path = optarg;
+	    break;
+
+	case 'j':	/* worker threads */
+	    workers = strtol(optarg, NULL, 0);
+	    break;
+
+	case 'p':	/* per file reports */
+	    per_file = 1;
+	    multi = 1;
+	    break;
+
+	case 'a':	/* write discovered map and exit */
+	    alpha_file = optarg;
+	    alpha_use = 0;
+	    break;
+
+	case 'A':	/* write discovered map and use it */
+	    alpha_file = optarg;
+	    alpha_use = 1;
+	    break;
+
+	case 'N':	/* records to scan for the alphabet */
+	    alpha_recs = strtoul(optarg, NULL, 0);
+	    break;
+
+	case 'G':	/* group by key */
+	    parse_group(optarg);
+	    break;
+
+	case 'M':	/* memory limit of group or daemon contexts */
+	    n = strtol(optarg, &end, 0);
+	    if (n <= 0 || *end != '\0' ||
+		(unsigned long)n > (size_t)-1 / (1024*1024)) {
+		fprintf(stderr, "%s: -M mem_MiB must be a number > 0\n",
+			program);
+		exit(86);
+	    }
+	    mem_max = (size_t)n * 1024*1024;
+	    break;
+
+	case 't':	/* field separator */
+	    if (strcmp(optarg, "tab") == 0 || strcmp(optarg, "\\t") == 0) {
+		cfg.field_sep = '\t';
+	    } else if (strlen(optarg) == 1) {
+		cfg.field_sep = (u_int8_t)optarg[0];
+	    } else {
+		fprintf(stderr, "%s: -t sep must be one octet or tab\n",
+			program);
+		exit(67);
+	    }
 	    break;
 
-	case 'C':	/* cookie trim */
-	    cookie_trim = 1;
+	case 'n':	/* field number */
+	    cfg.field_num = strtol(optarg, NULL, 0);
+	    cfg.field_mode = ENT_FIELD_DELIM;
+	    ++field_opts;
+	    break;
+
+	case 'K':	/* key of key=value pairs */
+	case 'J':	/* key of a JSON object */
+	    if (strlen(optarg) > ENT_MAX_KEY) {
+		fprintf(stderr, "%s: -%c key must be at most %d octets\n",
+			program, i, ENT_MAX_KEY);
+		exit(68);
+	    }
+	    strcpy(cfg.field_key, optarg);
+	    cfg.field_mode = (i == 'K') ? ENT_FIELD_KV : ENT_FIELD_JSON;
+	    ++field_opts;
 	    break;
 
 	case ':':
             (void) fprintf(stderr, "%s: ERROR: requires an argument -- %c\n", program, optopt);
-	    fprintf(stderr, usage, program, prog, version);
+	    fprintf(stderr, usage, program, program);
+	    fprintf(stderr, map_usage, prog, version);
             exit(3); /* ooo */
             /*NOTREACHED*/
 
         case '?':
             (void) fprintf(stderr, "%s: ERROR: illegal option -- %c\n", program, optopt);
-	    fprintf(stderr, usage, program, prog, version);
+	    fprintf(stderr, usage, program, program);
+	    fprintf(stderr, map_usage, prog, version);
             exit(3); /* ooo */
             /*NOTREACHED*/
 
         default:
             fprintf(stderr, "%s: ERROR: invalid -flag\n", program);
-	    fprintf(stderr, usage, program, prog, version);
+	    fprintf(stderr, usage, program, program);
+	    fprintf(stderr, map_usage, prog, version);
             exit(3); /* ooo */
             /*NOTREACHED*/
 	}
     }
 
     /*
-     * note the input filename
+     * note the input filename, daemon mode has none
      */
-    if (optind >= argc) {
-	fprintf(stderr, "usage: %s %s\n", program, usage);
+    if (sock_path != NULL) {
+	if (optind < argc) {
+	    fprintf(stderr, "%s: -D socket_path and input_file conflict\n",
+		    program);
+	    exit(41);
+	}
+	dbg(1, "main: daemon socket: %s", sock_path);
+    } else if (optind >= argc) {
+	fprintf(stderr, usage, program, program);
+	fprintf(stderr, map_usage, prog, version);
 	exit(7);
+    } else {
+	for (i=optind; i < argc; ++i) {
+	    if (pool_add_path(&inputs, argv[i]) < 0) {
+		fprintf(stderr, "%s: cannot add input: %s: %s\n",
+			program, argv[i], strerror(errno));
+		exit(47);
+	    }
+	}
+	if (argc-optind != 1 || inputs.len != 1 ||
+	    strcmp(inputs.path[0], argv[optind]) != 0) {
+	    multi = 1;
+	}
+	if (multi == 0) {
+	    filename = argv[optind];
+	    dbg(1, "main: input file: %s", filename);
+	} else {
+	    dbg(1, "main: %d input files", inputs.len);
+	}
     }
-    filename = argv[optind];
-    dbg(1, "main: input file: %s", filename);
 
     /*
-     * check report cycle
+     * check multiple input options
      */
-    if (rept_cycle < 0) {
-	fprintf(stderr, "%s: -c rept_cycle must be >= 0\n", program);
-	exit(8);
+    if (workers < 1 || workers > MAX_WORKERS) {
+	fprintf(stderr, "%s: -j workers must be >= 1 and <= %d\n",
+		program, MAX_WORKERS);
+	exit(48);
+    }
+    if (multi) {
+	if (rept_cycle != 0) {
+	    fprintf(stderr, "%s: -c rept_cycle requires a single input_file\n",
+		    program);
+	    exit(49);
+	}
+	if (sock_path != NULL) {
+	    fprintf(stderr, "%s: -D socket_path and -p conflict\n",
+		    program);
+	    exit(50);
+	}
+	dbg(1, "main: workers: %d  per file reports: %d", workers, per_file);
     }
-    dbg(1, "main: report cycle: %d", rept_cycle);
 
     /*
-     * check bit depth
+     * check group by options
      */
-    if (bit_depth < 1) {
-	fprintf(stderr, "%s: -b bit_depth must be > 0\n", program);
-	exit(9);
-    }
-    if (bit_depth > MAX_DEPTH) {
-	fprintf(stderr, "%s: -b bit_depth must <= %ld\n", program, MAX_DEPTH);
-	exit(10);
+    if (group_mode != 0) {
+	if (multi || sock_path != NULL || nmaps > 1 || alpha_file != NULL) {
+	    fprintf(stderr, "%s: -G group_key requires a single input_file "
+			    "and map, and no -a or -A\n", program);
+	    exit(72);
+	}
+	if (rept_cycle != 0) {
+	    fprintf(stderr, "%s: -c rept_cycle and -G group_key conflict\n",
+		    program);
+	    exit(72);
+	}
+	if (line_mode == 0 && group_mode != GROUP_PREFIX) {
+	    fprintf(stderr, "%s: -r rec_size requires -G prefix:N\n",
+		    program);
+	    exit(72);
+	}
+	if (group_mode == GROUP_FIELD) {
+	    group_cfg.keep_newline = cfg.keep_newline;
+	    group_cfg.field_sep = cfg.field_sep;
+	    group_cfg.v_flag = cfg.v_flag;
+	}
+	if (group_mode == GROUP_COOKIE) {
+	    cfg.cookie_trim = 2;
+	}
     }
-    dbg(1, "main: bit_depth: %d", bit_depth);
 
     /*
-     * check back history
+     * -G groups and -D contexts are held to -M mem_MiB, by default
+     * half of physical memory, or no limit if that is not known
      */
-    if (back_history < 1) {
-	fprintf(stderr, "%s: -B back_history must be > 0\n", program);
-	exit(11);
-    }
-    if (bit_depth > MAX_BACK_HISTORY) {
-	fprintf(stderr, "%s: -B back_history must <= %ld\n",
-		program, MAX_BACK_HISTORY);
-	exit(12);
+    if (group_mode != 0 || sock_path != NULL) {
+	if (mem_max == 0 && sysconf(_SC_PHYS_PAGES) > 0 &&
+	    sysconf(_SC_PAGESIZE) > 0) {
+	    mem_max = (size_t)sysconf(_SC_PHYS_PAGES) / 2 *
+		      (size_t)sysconf(_SC_PAGESIZE);
+	}
+	dbg(1, "main: context memory limit: %lu MiB",
+	    (unsigned long)(mem_max / (1024*1024)));
     }
-    dbg(1, "main: back_history: %d", back_history);
 
     /*
-     * check depth factor
+     * check multiple map options
      */
-    if (depth_factor < 1) {
-	fprintf(stderr, "%s: -f depth_factor must be > 0\n", program);
-	exit(13);
+    if (nmaps > 1) {
+	if (multi || sock_path != NULL) {
+	    fprintf(stderr, "%s: more than one -m map_file requires "
+			    "a single input_file\n", program);
+	    exit(58);
+	}
+	if (rept_cycle != 0) {
+	    fprintf(stderr, "%s: -c rept_cycle and more than one "
+			    "-m map_file conflict\n", program);
+	    exit(59);
+	}
+	dbg(1, "main: maps: %d  workers: %d", nmaps, workers);
     }
-    dbg(1, "main: depth_factor: %d", depth_factor);
 
     /*
-     * check raw record size, if given
+     * check follow options
      */
-    if (line_mode == 0 && rec_size <= 0) {
-	fprintf(stderr, "%s: -r rec_size: %d must be > 0\n",
-		program, rec_size);
-	exit(14);
-    } else if (line_mode == 0) {
-	dbg(1, "main: binary record size: %d", rec_size);
-    } else {
-	rec_size = BUFSIZ;
-	dbg(1, "main: line mode of up to %d octets", rec_size);
+    if (follow) {
+	if (multi || sock_path != NULL || nmaps > 1 || group_mode != 0 ||
+	    strcmp(filename, "-") == 0) {
+	    fprintf(stderr, "%s: -F requires a single input_file, not stdin, "
+			    "and no -D, -G or more than one map\n", program);
+	    exit(82);
+	}
+	if (sample.type != RD_ALL || range_offset != 0 || range_length != 0 ||
+	    range_records != 0) {
+	    fprintf(stderr, "%s: -F and -S, --offset, --length or --records "
+			    "conflict\n", program);
+	    exit(82);
+	}
+	dbg(1, "main: following: %s", filename);
     }
 
     /*
-     * -k implies line mode, but -r rec_size implies raw mode
+     * check tee options, -T 1 moves the reports to stderr
      */
-    if (line_mode == 0 && keep_newline) {
-	fprintf(stderr, "%s: -r rec_size and -k conflict\n", program);
-	exit(15);
+    if (tee_fd > 0) {
+	if (multi || sock_path != NULL) {
+	    fprintf(stderr, "%s: -T fd requires a single input_file\n",
+		    program);
+	    exit(84);
+	}
+	if (sample.type == RD_DEADLINE || range_offset != 0 ||
+	    range_length != 0 || range_records != 0) {
+	    fprintf(stderr, "%s: -T fd and -S deadline, --offset, --length "
+			    "or --records conflict\n", program);
+	    exit(84);
+	}
+	if (tee_fd == 1) {
+	    fflush(stdout);
+	    tee_fd = dup(1);
+	    if (tee_fd < 0 || dup2(2, 1) < 0) {
+		fprintf(stderr, "%s: cannot move reports to stderr: %s\n",
+			program, strerror(errno));
+		exit(84);
+	    }
+	}
+	dbg(1, "main: tee: %d", tee_fd);
     }
 
     /*
-     * -c implies line mode, but -r rec_size implies raw mode
+     * check report cycle
      */
-    if (line_mode == 0 && cookie_trim) {
-	fprintf(stderr, "%s: -r rec_size and -c conflict\n", program);
-	exit(16);
+    if (rept_cycle < 0) {
+	fprintf(stderr, "%s: -c rept_cycle must be >= 0\n", program);
+	exit(8);
     }
+    dbg(1, "main: report cycle: %d", rept_cycle);
 
     /*
-     * map_file processing
+     * default to a single value for each sweep list
      */
-    if (map_file != NULL) {
-	(void) load_map_file(map_file);
+    if (sweep_vals.ndepth == 0) {
+	sweep_vals.depth[sweep_vals.ndepth++] = cfg.bit_depth;
     }
-    return;
-}
-
-
-/*
- * load_map_file - parse and load a map file (-m map_file)
- *
- * See the usage string above for the map_file syntax.
- *
- * given:
- *	map_file	map filename
- *
- * This function will modify:
- *
- *	keep_newline
- *	cookie_trim
- *	char_mask
- *	octet_map
- *	bit_mask
- *
- * This function does not return on error.
- */
-static void
-load_map_file(char *map_file)
-{
-    FILE *map;			/* map file stream */
-    char buf[BUFSIZ+1];		/* input buffer */
-    int len;			/* length of input line */
-    int linenum;		/* map file line number */
-    int seen_octet_map;		/* 1 ==> already saw a octet map directive */
-    int octet;			/* octet being mapped */
-    char *p;
-    int i;
+    if (sweep_vals.nback == 0) {
+	sweep_vals.back[sweep_vals.nback++] = cfg.back_history;
+    }
+    if (sweep_vals.nfactor == 0) {
+	sweep_vals.factor[sweep_vals.nfactor++] = cfg.depth_factor;
+    }
+    sweep = (sweep_vals.ndepth > 1 || sweep_vals.nback > 1 ||
+	     sweep_vals.nfactor > 1);
 
     /*
-     * firewall
+     * check bit depth, tally with the largest
      */
-    if (map_file == 0) {
-	fprintf(stderr, "%s: map_file arg is NULL\n", program);
-	exit(16);
+    cfg.bit_depth = sweep_vals.depth[0];
+    for (i=0; i < sweep_vals.ndepth; ++i) {
+	if (sweep_vals.depth[i] < 1) {
+	    fprintf(stderr, "%s: -b bit_depth must be > 0\n", program);
+	    exit(9);
+	}
+	if (sweep_vals.depth[i] > ENT_MAX_DEPTH) {
+	    fprintf(stderr, "%s: -b bit_depth must <= %ld\n",
+		    program, ENT_MAX_DEPTH);
+	    exit(10);
+	}
+	if (sweep_vals.depth[i] > cfg.bit_depth) {
+	    cfg.bit_depth = sweep_vals.depth[i];
+	}
     }
-    buf[BUFSIZ] = '\0';
+    dbg(1, "main: bit_depth: %d", cfg.bit_depth);
 
     /*
-     * open the map file
+     * check back history, tally with the largest
      */
-    dbg(1, "load_map_file: opening map file: %s", map_file);
-    map = fopen(map_file, "r");
-    if (map == NULL) {
-	fprintf(stderr, "%s: failed to open map file: %s\n",
-		program, map_file);
-	exit(17);
+    cfg.back_history = sweep_vals.back[0];
+    for (i=0; i < sweep_vals.nback; ++i) {
+	if (sweep_vals.back[i] < 1) {
+	    fprintf(stderr, "%s: -B back_history must be > 0\n", program);
+	    exit(11);
+	}
+	if (sweep_vals.back[i] > ENT_MAX_BACK_HISTORY) {
+	    fprintf(stderr, "%s: -B back_history must <= %ld\n",
+		    program, ENT_MAX_BACK_HISTORY);
+	    exit(12);
+	}
+	if (sweep_vals.back[i] > cfg.back_history) {
+	    cfg.back_history = sweep_vals.back[i];
+	}
     }
+    dbg(1, "main: back_history: %d", cfg.back_history);
 
     /*
-     * read lines until EOF
+     * check depth factor
      */
-    seen_octet_map = 0;
-    linenum = 0;
-    while (fgets(buf, BUFSIZ, map) != NULL) {
-
-	/*
-	 * remove # comments
-	 */
-	++linenum;
-	p = strchr(buf, '#');
-	if (p != NULL) {
-	    *p = '\0';
-	}
-
-	/*
-	 * remove trailing newline and whitespace
-	 */
-	len = strlen(buf);
-	while (len > 0 && isspace(buf[len-1])) {
-	    buf[len-1] = '\0';
-	    --len;
+    cfg.depth_factor = sweep_vals.factor[0];
+    for (i=0; i < sweep_vals.nfactor; ++i) {
+	if (sweep_vals.factor[i] < 1) {
+	    fprintf(stderr, "%s: -f depth_factor must be > 0\n", program);
+	    exit(13);
 	}
+    }
+    dbg(1, "main: depth_factor: %d", cfg.depth_factor);
+    dbg(1, "main: sweep: %d x %d x %d",
+	sweep_vals.ndepth, sweep_vals.nback, sweep_vals.nfactor);
 
-	/*
-	 * ignore blank / empty lines
-	 */
-	if (len <= 0) {
-	    continue;
-	}
-	dbg(9, "load_map_file: line %d: %s", linenum, buf);
-
-	/*
-	 * case: charmask line
-	 */
-	if (strncmp(buf, "charmask=", sizeof("charmask=")-1) == 0) {
-
-	    /*
-	     * must have only one or more x's and c's
-	     */
-	    p = buf + sizeof("charmask=")-1;
-	    dbg(4, "charmask: %s", p);
-	    if (strspn(p, "xc") != len-(sizeof("charmask=")-1)) {
-		fprintf(stderr, "%s: map file: %s line %d charmask "
-				"may only have x's and c's\n",
-			program, map_file, linenum);
-		exit(18);
-
-	    }
-
-	    /*
-	     * save charmask
-	     */
-	    if (char_mask != NULL) {
-		free(char_mask);
-	    }
-	    char_mask = strdup(p);
-	    if (char_mask == NULL) {
-		fprintf(stderr, "%s: failed to malloc charmask\n", program);
-		exit(19);
-	    }
-
-	/*
-	 * case: bitmask line
-	 */
-	} else if (strncmp(buf, "bitmask=", sizeof("bitmask=")-1) == 0) {
+    /*
+     * check convergence cycle
+     */
+    if (cfg.conv_cycle < 0) {
+	fprintf(stderr, "%s: -z conv_cycle must be >= 0\n", program);
+	exit(40);
+    }
+    dbg(1, "main: conv_cycle: %d", cfg.conv_cycle);
 
-	    /*
-	     * must have only one or more x's and b's
-	     */
-	    p = buf + sizeof("bitmask=")-1;
-	    dbg(4, "bit mask: %s", p);
-	    if (strspn(p, "xb") != len-(sizeof("bitmask=")-1)) {
-		fprintf(stderr, "%s: map file: %s line %d bitmask "
-				"may only have x's and b's\n",
-			program, map_file, linenum);
-		exit(20);
+    /*
+     * check cache block
+     */
+    if (cfg.block < 0 || cfg.block > ENT_BATCH) {
+	fprintf(stderr, "%s: -L block must be >= 0 and <= %d\n",
+		program, ENT_BATCH);
+	exit(85);
+    }
+    dbg(1, "main: block: %d", cfg.block);
 
-	    }
+    /*
+     * check raw record size, if given
+     */
+    if (line_mode == 0 && rec_size <= 0) {
+	fprintf(stderr, "%s: -r rec_size: %d must be > 0\n",
+		program, rec_size);
+	exit(14);
+    } else if (line_mode == 0) {
+	dbg(1, "main: binary record size: %d", rec_size);
+    } else if (framed == 0) {
+	rec_size = BUFSIZ;
+	dbg(1, "main: line mode of up to %d octets", rec_size);
+    }
 
-	    /*
-	     * save bitmask
-	     */
-	    if (bit_mask != NULL) {
-		free(bit_mask);
-	    }
-	    bit_mask = strdup(p);
-	    if (bit_mask == NULL) {
-		fprintf(stderr, "%s: failed to malloc bitmask\n", program);
-		exit(21);
-	    }
+    /*
+     * how records are found: -R framing, -r rec_size or lines
+     */
+    if (framed) {
+	if (line_mode == 0) {
+	    fprintf(stderr, "%s: -r rec_size and -R framing conflict\n",
+		    program);
+	    exit(76);
+	}
+	rec_size = framing.rec_size;
+	dbg(1, "main: framing: %d of up to %d octets", framing.type, rec_size);
+    } else if (line_mode == 0) {
+	framing.type = RD_FIXED;
+	framing.rec_size = rec_size;
+    } else {
+	framing.type = RD_LINE;
+	framing.rec_size = rec_size-1;
+    }
+    framing.raw = raw_input;
+    framing.sample = sample;
+    framing.offset = range_offset;
+    framing.length = range_length;
+    framing.records = range_records;
+    framing.io = io_mode;
+    framing.follow = follow;
+    framing.tee = tee_fd;
 
-	/*
-	 * octet map line
-	 */
-	} else if (isxdigit(buf[0]) && isxdigit(buf[1]) && buf[2] == '=') {
+    /*
+     * -k implies line mode, but -r rec_size implies raw mode
+     */
+    if (line_mode == 0 && cfg.keep_newline) {
+	fprintf(stderr, "%s: -r rec_size and -k conflict\n", program);
+	exit(15);
+    }
 
-	    /*
-	     * clear old octet map if we found our first octet map directive
-	     */
-	    if (seen_octet_map == 0) {
-		for (i=0; i < 1 << OCTET_BITS; ++i) {
-		    octet_map[i] = "";
-		}
-		seen_octet_map = 1;
-	    }
+    /*
+     * -c implies line mode, but -r rec_size implies raw mode
+     */
+    if (line_mode == 0 && cfg.cookie_trim) {
+	fprintf(stderr, "%s: -r rec_size and -c conflict\n", program);
+	exit(16);
+    }
 
-	    /*
-	     * determine which octet is being mapped
-	     */
-	    octet = (hex_to_value[(int)buf[0]]<<4) + hex_to_value[(int)buf[1]];
+    /*
+     * field extraction is for text lines
+     */
+    if (field_opts > 1) {
+	fprintf(stderr, "%s: only one of -n, -K and -J may be given\n",
+		program);
+	exit(69);
+    }
+    if (cfg.field_mode == ENT_FIELD_DELIM && cfg.field_num < 1) {
+	fprintf(stderr, "%s: -n field must be >= 1\n", program);
+	exit(70);
+    }
+    if (line_mode == 0 && cfg.field_mode != ENT_FIELD_NONE) {
+	fprintf(stderr, "%s: -r rec_size and -n, -K or -J conflict\n",
+		program);
+	exit(66);
+    }
 
-	    /*
-	     * add to octet map
-	     */
-	    octet_map[octet] = strdup(buf+3);
-	    if (octet_map[octet] == NULL) {
-		fprintf(stderr, "%s: failed to malloc octet map\n", program);
-		exit(22);
-	    }
+    /*
+     * check alphabet discovery options
+     */
+    if (alpha_file != NULL) {
+	if (nmaps > 0) {
+	    fprintf(stderr, "%s: -a or -A alpha_map and -m or -E conflict\n",
+		    program);
+	    exit(60);
+	}
+	if (multi || sock_path != NULL) {
+	    fprintf(stderr, "%s: -a or -A alpha_map requires "
+			    "a single input_file\n", program);
+	    exit(61);
+	}
+	if (alpha_recs <= 0) {
+	    fprintf(stderr, "%s: -N alpha_recs must be > 0\n", program);
+	    exit(62);
+	}
+	if (alpha_use && (strcmp(filename, "-") == 0 ||
+			  (stat(filename, &sbuf) == 0 &&
+			   (S_ISFIFO(sbuf.st_mode) || S_ISSOCK(sbuf.st_mode))))) {
+	    /* the input is rewound after the scan */
+	    fprintf(stderr, "%s: -A alpha_map requires a seekable input_file, "
+			    "not stdin or a pipe\n", program);
+	    exit(65);
+	}
+	dbg(1, "main: alpha_map: %s  use: %d  records: %lu",
+	       alpha_file, alpha_use, alpha_recs);
+    }
 
-	/*
-	 * unknown line
-	 */
+    /*
+     * map_file processing
+     */
+    for (i=0; i < nmaps; ++i) {
+	errbuf[0] = '\0';
+	if (map_builtin[i]) {
+	    maps[i] = ent_map_builtin(map_files[i], errbuf, sizeof(errbuf));
 	} else {
-	    fprintf(stderr, "%s: map file: %s line %d unknown directive\n",
-		    program, map_file, linenum);
-	    exit(23);
+	    maps[i] = ent_map_load(map_files[i], v_flag,
+				   errbuf, sizeof(errbuf));
+	}
+	if (maps[i] == NULL) {
+	    fprintf(stderr, "%s: %s\n", program, errbuf);
+	    exit(17);
 	}
     }
-    dbg(4, "load_map_file: processed %d lines from map file: %s",
-	     linenum, map_file);
+    map = maps[0];
     return;
 }
 
 
 /*
- * alloc_bittally - allocate and initialize the tally array for a bit
+ * cycle_rept - print the entropy so far, as -c rept_cycle does
  *
  * given:
- *	depth	tally depth, in bits
- *
- * returns:
- *	pointer to allocated and initialized tally array
- *	does not return (exits non-zero) on memory allocation failure
- *
- * The tally array layout:
+ *	ctx	entropy analysis context
+ *	count	records so far
+ */
+static void
+cycle_rept(struct ent_ctx *ctx, unsigned long count)
+{
+    struct ent_rept rept;	/* entropy report */
+
+    (void) ent_report(ctx, &rept);
+    if (rept.high_bit_cnt > 0) {
+	printf("after record %lu for %d bits: "
+	       "high entropy: %f\n",
+	       count,
+	       rept.high_bit_cnt, rept.high_entropy);
+    }
+    if (rept.low_bit_cnt > 0) {
+	printf("after record %lu for %d bits: "
+	       "low entropy: %f\n",
+	       count,
+	       rept.low_bit_cnt, rept.low_entropy);
+    }
+    if (rept.high_bit_cnt > 0 && rept.low_bit_cnt > 0) {
+	printf("after record %lu for %d bits: "
+	       "median entropy: %f\n",
+	       count,
+	       rept.low_bit_cnt, rept.med_entropy);
+    }
+    if (rept.high_bit_cnt > 0) {
+	fputc('\n', stdout);
+    }
+    if (follow) {
+	fflush(stdout);
+    }
+    return;
+}
+
+
+/*
+ * discover - write a dense map of the alphabet found in the input
  *
- *	length in values		(1 value)
- *	unused				(1 value)
- *	tally for depth of 1 bit	(2 values)
- *	tally for depth of 2 bits	(4 values)
- *	tally for depth of 3 bits	(8 values)
- *	...
- *	tally for depth of 'depth' bits	(2**depth values)
+ * With -A, the input is rewound and the new map is loaded for use.
  *
- * The total size of the bitslice array is 2**(depth+1) values.
+ * given:
+ *	rd	reader of the file containing records
  *
- * The bitslice array is initialized to 0 values.
+ * This function does not return on error.
  */
-static tally_t *
-alloc_bittally(int depth)
+static void
+discover(struct reader *rd)
 {
-    tally_t *ret;	/* allocated bitslice tally layout */
-    size_t values;	/* number of values in tally array */
+    char errbuf[BUFSIZ+1];	/* map file error message */
+    struct ent_alpha *alpha;	/* alphabet being collected */
+    FILE *out;			/* map file being written */
+    unsigned long n;		/* records scanned */
+    u_int8_t *raw_buf;		/* raw record, in the reader buffer */
+    int raw_len;		/* length of raw record in octets */
+    u_int8_t *p;		/* rest of the line when -C -C */
+    int val;			/* offset of a cookie value */
+    int val_len;		/* length of a cookie value */
+    int used;			/* octets used by a cookie */
 
     /*
-     * firewall
+     * scan the records
      */
-    if (depth < 1) {
-	fprintf(stderr, "%s: alloc_bittally: depth: %d must be > 0\n",
-		program, depth);
-	exit(24);
-    }
-    values = (1<<(depth+1));
-    if (values < 0 || values == 0) {
-	fprintf(stderr, "%s: alloc_bittally: depth: %d is too large\n",
-		program, depth);
-	exit(25);
+    alpha = ent_alpha_open();
+    if (alpha == NULL) {
+	fprintf(stderr, "%s: failed to allocate alphabet\n", program);
+	exit(63);
     }
+    for (n=0; n < alpha_recs; ++n) {
+	if (rd_next(rd, &raw_buf, &raw_len) <= 0) {
+	    break;
+	}
+	raw_len = ent_trim(&cfg, raw_buf, raw_len);
+	if (cfg.cookie_trim != 2) {
+	    if (ent_alpha_add(alpha, raw_buf, raw_len) < 0) {
+		fprintf(stderr, "%s: failed to add record %lu to alphabet: "
+				"%s\n", program, n, strerror(errno));
+		exit(63);
+	    }
+	    continue;
+	}
 
-    /*
-     * allocate and zero
-     */
-    ret = (tally_t *)calloc(values, sizeof(tally_t));
-    if (ret == NULL) {
-	fprintf(stderr, "%s: alloc_bittally: "
-			"not enough memory for depth: %d\n",
-		program, depth);
-	exit(26);
+	/*
+	 * with -C -C, each cookie of the line is a record
+	 */
+	for (p = raw_buf;
+	     (used = ent_cookie(p, raw_len, &val, &val_len)) > 0;
+	     p += used, raw_len -= used) {
+	    if (ent_alpha_add(alpha, p+val, val_len) < 0) {
+		fprintf(stderr, "%s: failed to add record %lu to alphabet: "
+				"%s\n", program, n, strerror(errno));
+		exit(63);
+	    }
+	}
     }
+    dbg(1, "discover: scanned %lu records", n);
 
     /*
-     * record tally length
+     * write the map
      */
-    ret[0] = values;
+    out = fopen(alpha_file, "w");
+    if (out == NULL) {
+	fprintf(stderr, "%s: unable to open for writing: %s\n",
+		program, alpha_file);
+	exit(64);
+    }
+    if (ent_alpha_write(alpha, out) < 0 || fclose(out) != 0) {
+	fprintf(stderr, "%s: error writing: %s\n", program, alpha_file);
+	exit(64);
+    }
+    ent_alpha_close(alpha);
+    if (alpha_use == 0) {
+	return;
+    }
 
     /*
-     * return tally array
+     * rewind and use the new map
      */
-    return ret;
+    if (rd_rewind(rd) < 0) {
+	fprintf(stderr, "%s: -A alpha_map requires a seekable input_file: %s\n",
+		program, strerror(errno));
+	exit(65);
+    }
+    errbuf[0] = '\0';
+    map = ent_map_load(alpha_file, v_flag, errbuf, sizeof(errbuf));
+    if (map == NULL) {
+	fprintf(stderr, "%s: %s\n", program, errbuf);
+	exit(17);
+    }
+    return;
 }
 
 
 /*
- * alloc_bitslice - allocate and initialize all values given bit position
+ * run_maps - process a single input with more than one map
  *
- * given:
- *	bitnum		bit number in record for which we are allocating
- *	depth	tally depth, in bits
+ * See the multiple maps comment above.
  *
- * returns:
- *	pointer to allocated and initialized bitslice
- *	does not return (exits non-zero) on memory allocation failure
+ * This function does not return.
  */
-static struct bitslice *
-alloc_bitslice(int bitnum, int depth)
+static void
+run_maps(void)
 {
-    struct bitslice *ret;		/* bit position table */
+    struct ent_cfg map_cfg;	/* trimming is done before the map contexts */
+    struct ent_rept rept;	/* entropy report */
+    char rept_buf[BUFSIZ+1];	/* formatted entropy report */
+    struct ent_rept *grid;	/* sweep report grid */
+    struct reader *rd;		/* reader of the file containing records */
+    u_int8_t *raw_buf;		/* raw record, in the reader buffer */
+    int raw_len;		/* length of raw record in octets */
+    int ret;			/* 1 ==> record read, 0 ==> EOF, -1 ==> error */
+    unsigned long seen;		/* records found in the input */
+    unsigned long taken;	/* records of them sampled */
+    size_t used;		/* octets of batch_buf used */
+    u_int8_t *p;		/* grown batch_buf */
+    int m;			/* map number */
     int i;
 
     /*
-     * firewall
+     * open the file containing records
      */
-    if (depth < 1) {
-	fprintf(stderr, "%s: alloc_bittbl: depth: %d must be > 0\n",
-		program, depth);
-	exit(27);
+    rd = rd_new(&framing);
+    if (rd == NULL) {
+	fprintf(stderr, "%s: failed to allocate reader: %s\n",
+		program, strerror(errno));
+	exit(2);
+    }
+    if (rd_open(rd, filename) < 0) {
+	fprintf(stderr, "%s: unable to open for reading: %s: %s\n",
+		program, filename, strerror(errno));
+	exit(1);
     }
 
     /*
-     * allocate the bitslice
+     * open a context for each map, and allocate the batch
      */
-    ret = (struct bitslice *)malloc(sizeof(struct bitslice));
-    if (ret == NULL) {
-	fprintf(stderr, "%s: cannot allocate struct bitslice\n", program);
-	exit(28);
+    map_cfg = cfg;
+    map_cfg.keep_newline = 1;
+    map_cfg.cookie_trim = (cfg.cookie_trim == 2) ? 2 : 0;
+    for (m=0; m < nmaps; ++m) {
+	map_ctx[m] = ent_open(&map_cfg, maps[m]);
+	if (map_ctx[m] == NULL) {
+	    fprintf(stderr, "%s: failed to create entropy context: %s\n",
+		    program, strerror(errno));
+	    exit(3);
+	}
+    }
+    batch_size = (size_t)BATCH_RECS * 64;
+    batch_buf = (u_int8_t *)malloc(batch_size);
+    if (batch_buf == NULL) {
+	fprintf(stderr, "%s: failed to allocate record batch\n", program);
+	exit(2);
+    }
+    if (cfg.conv_cycle > 0) {
+	(void) signal(SIGUSR1, thaw_handler);
     }
 
     /*
-     * initialize bitslice
+     * read, trim and tally a batch of records at a time
      */
-    ret->bitnum = bitnum;
-    ret->history = 0;
-    ret->ops = 0;
-    ret->count = 0;
-    ret->back_lim = back_history;
-    ret->depth_lim = depth;
+    recnum = 0;
+    do {
 
-    /*
-     * clear entropy estimates
-     */
-    for (i=0; i <= MAX_BACK_HISTORY; ++i) {
-	ret->max_ent[i] = INVALID_MAX_ENTROPY;
-	ret->min_ent[i] = INVALID_MIN_ENTROPY;
-    }
-    ret->entropy_high = INVALID_MAX_ENTROPY;
-    ret->entropy_low = INVALID_MIN_ENTROPY;
+	/*
+	 * read and trim a batch
+	 *
+	 * Records are trimmed in the reader buffer, and then copied.
+	 */
+	used = 0;
+	for (batch_recs=0; batch_recs < BATCH_RECS; ++batch_recs) {
+	    ret = rd_next(rd, &raw_buf, &raw_len);
+	    if (ret <= 0) {
+		break;
+	    }
+	    raw_len = ent_trim(&cfg, raw_buf, raw_len);
+	    if (used + raw_len + 1 > batch_size) {
+		p = (u_int8_t *)realloc(batch_buf, 2*batch_size + raw_len + 1);
+		if (p == NULL) {
+		    fprintf(stderr, "%s: failed to allocate record batch\n",
+			    program);
+		    exit(2);
+		}
+		batch_buf = p;
+		batch_size = 2*batch_size + raw_len + 1;
+	    }
+	    memcpy(batch_buf + used, raw_buf, raw_len);
+	    batch_buf[used + raw_len] = '\0';
+	    batch_off[batch_recs] = used;
+	    batch_len[batch_recs] = raw_len;
+	    used += raw_len + 1;
+	}
+	dbg(5, "run_maps: batch of %d records", batch_recs);
+	if (ret < 0) {
+	    fprintf(stderr, "%s: error reading record %lu: %s: %s\n",
+		    program, recnum + batch_recs, filename, strerror(errno));
+	    exit(1);
+	}
+	if (batch_recs <= 0) {
+	    break;
+	}
+	recnum += batch_recs;
+	for (i=0; i < batch_recs; ++i) {
+	    batch_rec[i] = batch_buf + batch_off[i];
+	}
+
+	/*
+	 * feed the batch to each map context
+	 */
+	if (pool_run(workers, nmaps, map_job, NULL) < 0) {
+	    fprintf(stderr, "%s: failed to run worker pool: %s\n",
+		    program, strerror(errno));
+	    exit(52);
+	}
+	for (m=0; m < nmaps; ++m) {
+	    if (map_err[m] != 0) {
+		fprintf(stderr, "%s: failed to process records for map %s: %s\n",
+			program, map_files[m], strerror(map_err[m]));
+		exit(4);
+	    }
+	}
+
+	/*
+	 * thaw bitslices, if needed
+	 */
+	if (thaw_request) {
+	    thaw_request = 0;
+	    for (m=0; m < nmaps; ++m) {
+		ent_thaw(map_ctx[m]);
+	    }
+	}
+    } while (batch_recs == BATCH_RECS);
 
     /*
-     * allocate tally tables for past xor differences
+     * report on each map
+     *
+     * As with a single map, the record count printed is the number of
+     * records given to the context, or the number of cookies with -C -C.
      */
-    for (i=0; i <= back_history; ++i) {
-	ret->hist[i] = alloc_bittally(depth);
-    }
-    while (i <= MAX_BACK_HISTORY) {
-	ret->hist[i++] = NULL;
+    dbg(1, "final entropy processing");
+    for (m=0; m < nmaps; ++m) {
+	(void) ent_report(map_ctx[m], &rept);
+	if (rept.bits <= 0) {
+	    printf("Error: nothing to process\n");
+	}
+	if (sweep) {
+	    grid = rept_grid(&sweep_vals, map_ctx[m]);
+	    if (grid == NULL) {
+		fprintf(stderr, "%s: failed to compute sweep report: %s\n",
+			program, strerror(errno));
+		exit(56);
+	    }
+	    printf("\nEntropy sweep report: %s\n", map_files[m]);
+	    rept_print_grid(&sweep_vals, grid, rept.recnum);
+	    free(grid);
+	} else {
+	    rept_format(rept_buf, sizeof(rept_buf), &rept, rept.recnum);
+	    printf("\nEntropy report: %s\n%s", map_files[m], rept_buf);
+	}
     }
 
     /*
-     * return bitslice
+     * all done!
      */
-    return ret;
+    for (m=0; m < nmaps; ++m) {
+	ent_close(map_ctx[m]);
+	ent_map_free(maps[m]);
+    }
+    free(batch_buf);
+    rd_counts(rd, &seen, &taken);
+    dbg(1, "main: sampled %lu of %lu records", taken, seen);
+    rd_free(rd);
+    dbg(1, "all done!");
+    exit(0);
 }
 
 
 /*
- * record_bit - record and tally a bit value for a given bitslice
+ * map_job - feed the current batch of records to the context of a map
  *
  * given:
- *	slice	bitslice record for a given bit position in our records
- *	value	next value for the given bit position (0 or 1)
+ *	w	worker number
+ *	job	map number
+ *	arg	unused
  */
 static void
-record_bit(struct bitslice *slice, int value)
+map_job(int w, int job, void *arg)
 {
-    int depth;		/* bit depth being processed */
-    int back;		/* number of bits going back into history */
-    u_int32_t offset;	/* tally array offset */
-    u_int32_t cur;	/* current bit values (for a given depth), xor-ed */
-    u_int32_t past;	/* bit values going back into history */
+    if (ent_feed_batch(map_ctx[job], batch_rec, batch_len, batch_recs) < 0) {
+	map_err[job] = errno;
+    }
+    return;
+}
 
-    /*
-     * firewall
-     */
-    if (slice == NULL) {
-	fprintf(stderr, "%s: record_bit: slice is NULL\n", program);
-	exit(29);
+
+/*
+ * parse_group - parse a -G group_key
+ *
+ * given:
+ *	arg	cookie, field:N, kv:key, json:key or prefix:N
+ *
+ * This function does not return on error.
+ */
+static void
+parse_group(const char *arg)
+{
+    const char *key;		/* key after the : */
+    char *end;			/* end of a number */
+    long n;			/* field number or prefix length */
+
+    ent_cfg_init(&group_cfg);
+    key = strchr(arg, ':');
+    key = (key == NULL) ? "" : key+1;
+    n = strtol(key, &end, 10);
+    if (strcmp(arg, "cookie") == 0) {
+	group_mode = GROUP_COOKIE;
+    } else if (strncmp(arg, "field:", sizeof("field:")-1) == 0 &&
+	       end != key && *end == '\0' && n >= 1) {
+	group_mode = GROUP_FIELD;
+	group_cfg.field_mode = ENT_FIELD_DELIM;
+	group_cfg.field_num = n;
+    } else if ((strncmp(arg, "kv:", sizeof("kv:")-1) == 0 ||
+		strncmp(arg, "json:", sizeof("json:")-1) == 0) &&
+	       key[0] != '\0' && strlen(key) <= ENT_MAX_KEY) {
+	group_mode = GROUP_FIELD;
+	group_cfg.field_mode = (arg[0] == 'k') ? ENT_FIELD_KV : ENT_FIELD_JSON;
+	strcpy(group_cfg.field_key, key);
+    } else if (strncmp(arg, "prefix:", sizeof("prefix:")-1) == 0 &&
+	       end != key && *end == '\0' && n >= 1 && n <= BUFSIZ) {
+	group_mode = GROUP_PREFIX;
+	group_prefix = n;
+    } else {
+	fprintf(stderr, "%s: -G group_key must be cookie, field:N, kv:key, "
+			"json:key or prefix:N\n", program);
+	exit(71);
     }
+    return;
+}
+
+
+/*
+ * run_groups - process a single input, with a context for each key
+ *
+ * See the group by key comment above.
+ *
+ * This function does not return.
+ */
+static void
+run_groups(void)
+{
+    struct ent_rept rept;	/* entropy report */
+    char rept_buf[BUFSIZ+1];	/* formatted entropy report */
+    struct ent_rept *grid;	/* sweep report grid */
+    struct reader *rd;		/* reader of the file containing records */
+    u_int8_t *raw_buf;		/* raw record, in the reader buffer */
+    u_int8_t *key_buf;		/* malloc-ed copy of the line to find a key */
+    u_int8_t *rec;		/* rest of the line when -G cookie */
+    const u_int8_t *key;	/* key of the record */
+    int key_len;		/* length of key */
+    int raw_len;		/* length of raw record in octets */
+    int ret;			/* 1 ==> record read, 0 ==> EOF, -1 ==> error */
+    unsigned long seen;		/* records found in the input */
+    unsigned long taken;	/* records of them sampled */
+    int len;			/* length of trimmed record */
+    int val;			/* offset of a cookie value */
+    int val_len;		/* length of a cookie value */
+    int used;			/* octets used by a cookie */
+    int name;			/* offset of a cookie name */
+    int i;
 
     /*
-     * push the value onto the history
-     *
-     * The new value is shifted into the 0th bit position of our history.
-     * Bit values are either 0 and 1 (non-zero).
+     * open the file containing records
      */
-    slice->history <<= 1;
-    if (value != 0) {
-	slice->history |= 1;
+    rd = rd_new(&framing);
+    if (rd == NULL) {
+	fprintf(stderr, "%s: failed to allocate reader: %s\n",
+		program, strerror(errno));
+	exit(2);
+    }
+    if (rd_open(rd, filename) < 0) {
+	fprintf(stderr, "%s: unable to open for reading: %s: %s\n",
+		program, filename, strerror(errno));
+	exit(1);
     }
 
     /*
-     * We do not do anything if we lack a full history.  We want to
-     * be sure that slice->history is full of bit values from actual
-     * records.  Count the bit that we just recorded.
+     * records are trimmed before they are given to a group context
      */
-    if (++slice->ops < back_history+bit_depth) {
-	return;
+    group_ctx_cfg = cfg;
+    group_ctx_cfg.keep_newline = 1;
+    group_ctx_cfg.cookie_trim = 0;
+    group_ctx_cfg.field_mode = ENT_FIELD_NONE;
+    key_buf = (u_int8_t *)malloc(rec_size+1);
+    group_hash_len = 256;
+    group_hash = (struct group **)calloc(group_hash_len,
+					 sizeof(struct group *));
+    if (key_buf == NULL || group_hash == NULL) {
+	fprintf(stderr, "%s: failed to allocate groups\n", program);
+	exit(74);
+    }
+    if (cfg.conv_cycle > 0) {
+	(void) signal(SIGUSR1, thaw_handler);
     }
-    ++slice->count;
 
     /*
-     * process just the values
+     * route each record to the context of its key
      */
-    for (depth=1, offset=2; depth <= bit_depth; ++depth, offset <<= 1) {
+    key = key_buf;
+    key_len = 0;
+    recnum = 0;
+    while ((ret = rd_next(rd, &raw_buf, &raw_len)) > 0) {
+	++recnum;
 
-	/* get the i-depth value - (offset-1) is an i-bit mask of 1's */
-	cur = (u_int32_t)slice->history & (offset-1);
+	/*
+	 * find the key of a field:N, kv:key or json:key group in the line
+	 */
+	if (group_mode == GROUP_FIELD) {
+	    memcpy(key_buf, raw_buf, raw_len);
+	    key_len = ent_trim(&group_cfg, key_buf, raw_len);
+	}
 
-	/* tally the i-depth value - no x-or with history in the 0 case */
-	++slice->hist[0][offset + cur];
+	/*
+	 * trim the record
+	 */
+	len = ent_trim(&cfg, raw_buf, raw_len);
+	if (group_mode == GROUP_PREFIX) {
+	    key = raw_buf;
+	    key_len = (len < group_prefix) ? len : group_prefix;
+	}
 
-	/* tally the i-depth value xor-ed with previous history */
-	for (back=1; back <= back_history; ++back) {
+	/*
+	 * each cookie is a record, in the group of its name
+	 */
+	if (group_mode == GROUP_COOKIE) {
+	    for (rec = raw_buf;
+		 (used = ent_cookie(rec, len, &val, &val_len)) > 0;
+		 rec += used, len -= used) {
+		for (name = val-1; name > 0 && !isspace(rec[name-1]) &&
+				   rec[name-1] != ':' && rec[name-1] != ';';
+		     --name) {
+		}
+		group_feed(rec+name, val-1-name, rec+val, val_len);
+	    }
+	} else {
+	    group_feed(key, key_len, raw_buf, len);
+	}
 
-	    /* get the i-depth value going back in history h bits */
-	    past = (u_int32_t)(slice->history >> back) & (offset-1);
+	/*
+	 * thaw bitslices, if needed
+	 */
+	if (thaw_request) {
+	    thaw_request = 0;
+	    for (i=0; i < ngroups; ++i) {
+		ent_thaw(group[i]->ctx);
+	    }
+	}
+    }
+    if (ret < 0) {
+	fprintf(stderr, "%s: error reading record %lu: %s: %s\n",
+		program, recnum, filename, strerror(errno));
+	exit(1);
+    }
+    dbg(1, "run_groups: %lu records in %d groups", recnum, ngroups);
 
-	    /* tally the i-depth value xor-ed with history back h bits */
-	    ++slice->hist[back][offset + (cur^past)];
+    /*
+     * report on each group, in key order
+     */
+    dbg(1, "final entropy processing");
+    if (ngroups > 0) {
+	qsort(group, ngroups, sizeof(struct group *), group_cmp);
+    }
+    for (i=0; i < ngroups; ++i) {
+	(void) ent_report(group[i]->ctx, &rept);
+	if (rept.bits <= 0) {
+	    printf("Error: nothing to process\n");
+	}
+	if (sweep) {
+	    grid = rept_grid(&sweep_vals, group[i]->ctx);
+	    if (grid == NULL) {
+		fprintf(stderr, "%s: failed to compute sweep report: %s\n",
+			program, strerror(errno));
+		exit(56);
+	    }
+	    printf("\nEntropy sweep report: %s\n",
+		   (group[i]->key_len > 0) ? group[i]->key : "(no key)");
+	    rept_print_grid(&sweep_vals, grid, rept.recnum);
+	    free(grid);
+	} else {
+	    rept_format(rept_buf, sizeof(rept_buf), &rept, rept.recnum);
+	    printf("\nEntropy report: %s\n%s",
+		   (group[i]->key_len > 0) ? group[i]->key : "(no key)",
+		   rept_buf);
 	}
     }
+
+    /*
+     * all done!
+     */
+    for (i=0; i < ngroups; ++i) {
+	ent_close(group[i]->ctx);
+	free(group[i]->key);
+	free(group[i]);
+    }
+    free(group);
+    free(group_hash);
+    free(key_buf);
+    rd_counts(rd, &seen, &taken);
+    dbg(1, "main: sampled %lu of %lu records", taken, seen);
+    rd_free(rd);
+    ent_map_free(map);
+    dbg(1, "all done!");
+    exit(0);
+}
+
+
+/*
+ * group_feed - feed a trimmed record to the context of its group
+ *
+ * given:
+ *	key	key of the record, need not be NUL terminated
+ *	key_len	length of key
+ *	rec	trimmed record
+ *	len	length of rec
+ *
+ * This function does not return on error, or once the groups hold more
+ * than the -M mem_MiB limit.
+ */
+static void
+group_feed(const u_int8_t *key, int key_len, const u_int8_t *rec, int len)
+{
+    struct group *g;		/* group of the record */
+    size_t size;		/* octets held by the group before the record */
+
+    g = find_group(key, key_len);
+    if (g == NULL) {
+	fprintf(stderr, "%s: failed to create group: %.*s\n",
+		program, key_len, (const char *)key);
+	exit(74);
+    }
+    size = ent_size(g->ctx);
+    if (ent_feed(g->ctx, rec, len) < 0) {
+	fprintf(stderr, "%s: failed to process record %lu: %s\n",
+		program, recnum, strerror(errno));
+	exit(4);
+    }
+    group_mem += ent_size(g->ctx) - size;
+    if (mem_max > 0 && group_mem > mem_max) {
+	fprintf(stderr, "%s: %d groups need more than -M %lu MiB at record %lu\n",
+		program, ngroups, (unsigned long)(mem_max / (1024*1024)),
+		recnum);
+	exit(73);
+    }
     return;
 }
 
 
 /*
- * read_record - read the next record from the input file stream
+ * find_group - find, or create, the group of a key
  *
- * given:
- *	input	    input file stream to read
- *	buf	    buffer of buf_size octets if raw_read, else BUFSIZ octets
- *	buf_size    size of raw buffer in octets, if raw_read
- *	read_line   1 ==> lines of up to BUFSIZ octets, 0 ==> binary reads
+ * Groups are kept in a chained hash table, using the FNV-1a hash of
+ * the key.  The table doubles when it holds twice as many groups as
+ * chains.
  *
- * return:
- *	number of octets read, or -1 ==> error
+ * given:
+ *	key	key, need not be NUL terminated
+ *	key_len	length of key
  *
- * NOTE: We will ensure that the octet beyond the end of the buffer is '\0'.
+ * returns:
+ *	group of the key, or NULL ==> malloc error
  */
-static int
-read_record(FILE *input, u_int8_t *buf, int buf_size, int read_line)
+static struct group *
+find_group(const u_int8_t *key, int key_len)
 {
-    int rec_len;		/* length of raw record in octets */
+    struct group **chain;	/* grown hash chains */
+    struct group **list;	/* grown group list */
+    struct group *g;		/* group of key */
+    struct group *next;		/* next group in a chain */
+    u_int32_t hash;		/* FNV-1a hash of key */
+    int i;
 
     /*
-     * setup to read
+     * look for the group
      */
-    clearerr(input);
-    errno = 0;
+    hash = 2166136261U;
+    for (i=0; i < key_len; ++i) {
+	hash = (hash ^ key[i]) * 16777619U;
+    }
+    for (g = group_hash[hash & (group_hash_len-1)]; g != NULL; g = g->next) {
+	if (g->hash == hash && g->key_len == key_len &&
+	    memcmp(g->key, key, key_len) == 0) {
+	    return g;
+	}
+    }
 
     /*
-     * raw read
+     * create the group
      */
-    if (read_line == 0) {
-	rec_len = fread(buf, 1, buf_size, input);
-	if (ferror(input)) {
-	    dbg(1, "fread error: %s", strerror(errno));
-	} else if (feof(input)) {
-	    if (rec_len > 0) {
-		dbg(1, "short fread: %d out of %d octets", rec_len, buf_size);
-	    } else {
-		dbg(1, "EOF in fread");
-	    }
-	} else if (rec_len <= 0) {
-	    dbg(1, "no EOF or error, but fread returned: %d", rec_len);
-	    rec_len = -1;	/* force error */
-	} else {
-	    dbg(6, "fread %d octets for record %lld",
-		    buf_size, (unsigned long)recnum);
+    if ((ngroups & (ngroups-1)) == 0) {
+	list = (struct group **)realloc(group, (ngroups ? ngroups*2 : 1) *
+					       sizeof(struct group *));
+	if (list == NULL) {
+	    return NULL;
 	}
+	group = list;
+    }
+    g = (struct group *)calloc(1, sizeof(struct group));
+    if (g == NULL) {
+	return NULL;
+    }
+    g->key = (char *)malloc(key_len+1);
+    g->ctx = ent_open(&group_ctx_cfg, map);
+    if (g->key == NULL || g->ctx == NULL) {
+	free(g->key);
+	ent_close(g->ctx);
+	free(g);
+	return NULL;
+    }
+    memcpy(g->key, key, key_len);
+    g->key[key_len] = '\0';
+    g->key_len = key_len;
+    g->hash = hash;
+    g->next = group_hash[hash & (group_hash_len-1)];
+    group_hash[hash & (group_hash_len-1)] = g;
+    group[ngroups++] = g;
+    group_mem += ent_size(g->ctx);
+    dbg(2, "find_group: created group %d: %s", ngroups, g->key);
 
     /*
-     * line based read
+     * grow the hash table when the chains get long
      */
-    } else if (fgets((char *)buf, BUFSIZ, input) == NULL) {
-	/* report fgets error */
-	if (ferror(input)) {
-	    dbg(1, "fgets error: %s", strerror(errno));
-	} else if (feof(input)) {
-	    dbg(1, "EOF in fgets");
-	}
-	rec_len = -1;
-    } else {
-	/* obtain line stats */
-	buf[BUFSIZ] = '\0';
-	rec_len = strlen((char *)buf);
-	if (rec_len <= 0) {
-	    dbg(1, "no EOF or error, but fgets returned %d octets", rec_len);
-	    rec_len = -1;	/* force error */
-	} else {
-	    dbg(6, "fgets read %d octet line for record %lld",
-		rec_len, (unsigned long)recnum);
+    if (ngroups > group_hash_len*2) {
+	chain = (struct group **)calloc(group_hash_len*2,
+					sizeof(struct group *));
+	if (chain != NULL) {
+	    for (i=0; i < group_hash_len; ++i) {
+		for (g = group_hash[i]; g != NULL; g = next) {
+		    next = g->next;
+		    g->next = chain[g->hash & (group_hash_len*2-1)];
+		    chain[g->hash & (group_hash_len*2-1)] = g;
+		}
+	    }
+	    free(group_hash);
+	    group_hash = chain;
+	    group_hash_len *= 2;
 	}
+	g = group[ngroups-1];
     }
+    return g;
+}
 
-    /*
-     * force trailing '\0'
-     */
-    if (rec_len > 0) {
-	buf[rec_len] = '\0';
-    } else {
-	buf[0] = '\0';
+
+/*
+ * group_cmp - qsort compare groups by key
+ */
+static int
+group_cmp(const void *a, const void *b)
+{
+    const struct group *ga = *(const struct group * const *)a;
+    const struct group *gb = *(const struct group * const *)b;
+    int ret;
+
+    ret = memcmp(ga->key, gb->key,
+		 (ga->key_len < gb->key_len) ? ga->key_len : gb->key_len);
+    if (ret == 0) {
+	ret = ga->key_len - gb->key_len;
+    }
+    return ret;
+}
+
+
+/*
+ * run_files - process multiple input files on a pool of workers
+ *
+ * When given more than one input_file, a directory, or -p, the input
+ * files are processed by rept_files() (see entrept.h).
+ *
+ * This function does not return.
+ */
+static void
+run_files(void)
+{
+    struct rept_files rf;	/* input files and how to process them */
+    char errbuf[BUFSIZ+1];	/* rept_files() error message */
+    int failed;			/* number of input files that failed */
+
+    memset(&rf, 0, sizeof(rf));
+    rf.program = program;
+    rf.inputs = &inputs;
+    rf.workers = workers;
+    rf.per_file = per_file;
+    rf.cfg = &cfg;
+    rf.map = map;
+    rf.framing = &framing;
+    rf.sw = sweep ? &sweep_vals : NULL;
+    failed = rept_files(&rf, errbuf, sizeof(errbuf));
+    if (failed < 0) {
+	fprintf(stderr, "%s: %s\n", program, errbuf);
+	exit(51);
     }
 
     /*
-     * return result
+     * all done!
      */
-    return rec_len;
+    pool_free(&inputs);
+    ent_map_free(map);
+    dbg(1, "all done!");
+    exit(failed > 0 ? 54 : 0);
 }
 
 
 /*
- * pre_process - convert an input record into bit values to be processed
+ * run_daemon - serve named entropy contexts on a UNIX domain socket
  *
- * This function will pre-process a raw character based record and produce
- * a bit buffer of bits entropy process.  This function is given records
- * that have just been read and produces a set of 0 and 1 bits that will
- * go into the entropy measurements for a given bit position.
+ * See the daemon mode comment above for the protocol.
  *
- * The input buffer of a collection of octets starting at "inbuf" and
- * going for inbuf_len octets.  The input buffer may not be a string.
- * The input buffer may not be NUL terminated.
- *
- * The output buffer is a string of octets of either 0x00 or 0x01 value.
- * This function is given a pointer to the output buffer pointer.
- * This function is given a pointer malloc-ed length of outbuf.
- * The output buffer must be a malloc-ed buffer because, if needed,
- * this function will realloc it to a larger size.
- *
- * given:
- *	inbuf		the raw record buffer
- *	inbuf_len	length of inbuf in octets
- *	outbuf		pointer to a malloc-ed output bit buffer
- *	outbuf_len	pointer to the malloc-ed length of outbuf
- *
- * returns:
- *	the amount of outbuf used
- *
- * NOTE: The inbuf will be altered according to
+ * This function does not return.
  */
-static int
-pre_process(u_int8_t *inbuf, int inbuf_len, u_int8_t **outbuf, int *outbuf_len)
+static void
+run_daemon(void)
 {
-    int orig_inbuf_len = inbuf_len;	/* original inbuf_len value */
-    int outbuf_need;	/* amount of outbuf we will use */
+    struct sockaddr_un addr;	/* socket address */
+    struct stat sbuf;		/* socket_path status */
+    struct pollfd fds[MAX_CLIENTS+1];	/* listen socket and clients */
+    struct client clients[MAX_CLIENTS];	/* connected clients */
+    int nclients;		/* number of connected clients */
+    struct client *c;		/* client being served */
+    struct dctx *d;		/* named context */
+    int sfd;			/* listen socket */
     int i;
-    char *p;
-    u_int8_t *q;
-    u_int8_t *r;
-    char *s;
+    int j;
 
     /*
      * firewall
      */
-    if (inbuf == NULL) {
-	fprintf(stderr, "%s: trim_record: inbuf is NULL\n", program);
-	exit(30);
-    }
-    if (inbuf_len < 0) {
-	fprintf(stderr, "%s: trim_record: buf_len <= 0: %d\n",
-		program, inbuf_len);
-	exit(31);
-    }
-    if (outbuf == NULL) {
-	fprintf(stderr, "%s: trim_record: outbuf is NULL\n", program);
-	exit(32);
-    }
-    if (outbuf_len == NULL) {
-	fprintf(stderr, "%s: trim_record: outbuf_len is NULL\n", program);
-	exit(33);
-    }
-    if (*outbuf == NULL) {
-	fprintf(stderr, "%s: trim_record: outbuf points to a NULL\n", program);
-	exit(34);
-    }
-    if (*outbuf_len <= 0) {
-	fprintf(stderr, "%s: trim_record: outbuf_len points to %d <= 0\n",
-		program, *outbuf_len);
-	exit(35);
+    if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+	fprintf(stderr, "%s: -D socket_path is too long: %s\n",
+		program, sock_path);
+	exit(42);
     }
 
     /*
-     * do nothing if input buffer is empty
+     * remove a stale socket, but nothing else
      */
-    if (line_mode) {
-	dbg(10, "initial inbuf pre newline trim: ((%s))", inbuf);
-    }
-    dbg(9, "pre inbuf len: %d", orig_inbuf_len);
-    if (inbuf_len <= 0) {
-	dbg(5, "trim_record: empty inbuf");
-	return 0;
+    if (lstat(sock_path, &sbuf) == 0) {
+	if (!S_ISSOCK(sbuf.st_mode)) {
+	    fprintf(stderr, "%s: -D socket_path exists and is not a socket: %s\n",
+		    program, sock_path);
+	    exit(43);
+	}
+	(void) unlink(sock_path);
     }
 
     /*
-     * trim newline, if requested
-     *
-     * We trim a trailing \n or a trailing \r\n or a trailing \n\r
-     */
-    if (keep_newline == 0) {
-	if (inbuf[inbuf_len-1] == '\n') {
-	    inbuf[inbuf_len-1] = '\0';
-	    --inbuf_len;
-	    if (inbuf_len > 0 && inbuf[inbuf_len-1] == '\r') {
-		inbuf[inbuf_len-1] = '\0';
-		--inbuf_len;
-	    }
-	} else if (inbuf[inbuf_len-1] == '\r') {
-	    inbuf[inbuf_len-1] = '\0';
-	    --inbuf_len;
-	    if (inbuf_len > 0 && inbuf[inbuf_len-1] == '\n') {
-		inbuf[inbuf_len-1] = '\0';
-		--inbuf_len;
-	    }
-	}
-    }
-    dbg(8, "inbuf len: %d", inbuf_len);
-    if (line_mode) {
-	dbg(8, "1st inbuf: %s", inbuf);
-    }
-    if (inbuf_len <= 0) {
-	/* trimmed the line down to nothing */
-	return 0;
+     * listen on the socket
+     */
+    sfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sfd < 0) {
+	fprintf(stderr, "%s: socket failed: %s\n", program, strerror(errno));
+	exit(44);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sock_path);
+    if (bind(sfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	listen(sfd, SOMAXCONN) < 0) {
+	fprintf(stderr, "%s: cannot listen on %s: %s\n",
+		program, sock_path, strerror(errno));
+	exit(45);
+    }
+    dbg(1, "run_daemon: listening on %s", sock_path);
+
+    /*
+     * setup signals
+     */
+    (void) signal(SIGPIPE, SIG_IGN);
+    (void) signal(SIGINT, stop_handler);
+    (void) signal(SIGTERM, stop_handler);
+    if (cfg.conv_cycle > 0) {
+	(void) signal(SIGUSR1, thaw_handler);
     }
 
     /*
-     * cookie trim, if requested
-     *
-     * Programs such as cookie_monster will output lines of the form:
-     *
-     *    [optional_timestamp:] Set-cookie: COOKIE_NAME=VALUE; stuff ...
-     *
-     * This trim will reduce the above line down to just:
-     *
-     *    VALUE
-     *
-     * NOTE: If the line does not have a = and a ;, then the entire line
-     *	     is discarded.
+     * serve clients until asked to stop
      */
-    if (cookie_trim) {
-	char *equal;	/* first = or NULL */
-	char *semi;	/* first ; or NULL */
+    nclients = 0;
+    while (stop_request == 0) {
 
 	/*
-	 * look for the cookie value boundaries
+	 * thaw all contexts, if requested
 	 */
-	equal = strchr((char *)inbuf, '=');
-	if (equal == NULL) {
-	    dbg(5, "trim_record: line has no =, discarding line");
-	    return 0;
-	}
-	semi = strchr(equal+1, ';');
-	if (semi == NULL) {
-	    dbg(5, "trim_record: no ; after 1st =, discarding line");
-	    return 0;
+	if (thaw_request) {
+	    thaw_request = 0;
+	    for (d = dctx_list; d != NULL; d = d->next) {
+		ent_thaw(d->ctx);
+	    }
 	}
 
 	/*
-	 * copy value to front of buffer
+	 * wait for a new client, client input, or room to send replies
 	 */
-	inbuf_len = semi - equal - 1;
-	memmove(inbuf, equal+1, inbuf_len);
-	inbuf[inbuf_len] = '\0';
-	if (line_mode) {
-	    dbg(9, "cookie tr: %s", inbuf);
+	fds[0].fd = sfd;
+	fds[0].events = POLLIN;
+	for (i=0; i < nclients; ++i) {
+	    c = &clients[i];
+	    fds[i+1].fd = c->fd;
+	    fds[i+1].events = 0;
+	    if (c->closing == 0 && c->out_len < CLIENT_OUT) {
+		fds[i+1].events |= POLLIN;
+	    }
+	    if (c->out_len > 0) {
+		fds[i+1].events |= POLLOUT;
+	    }
+	}
+	if (poll(fds, nclients+1, -1) < 0) {
+	    if (errno != EINTR) {
+		fprintf(stderr, "%s: poll failed: %s\n",
+			program, strerror(errno));
+		exit(46);
+	    }
+	    continue;
 	}
-    }
-
-    /*
-     * character mask, if requested
-     *
-     * If charmask is a string, then we keep only those characters
-     * in the input buffer that correspond to a 'c' in the charmask.
-     */
-    if (char_mask != NULL) {
 
 	/*
-	 * walk the charmask looking for c's
+	 * serve each ready client, dropping those that are done
 	 */
-	if ((i = strlen(char_mask)) > inbuf_len) {
-	    s = char_mask + inbuf_len;
-	} else {
-	    s = char_mask + i;
-	}
-	for (q=inbuf, p=char_mask; *p != '\0' && p < s; ++p) {
-
-	    /* skip non-c chars (presumably x's) */
-	    if (*p != 'c') {
+	for (i=nclients-1; i >= 0; --i) {
+	    if (fds[i+1].revents == 0) {
 		continue;
 	    }
-
-	    /* save this inbuf character */
-	    *q++ = inbuf[p - char_mask];
+	    c = &clients[i];
+	    if (serve_client(c, (fds[i+1].revents & ~POLLOUT) != 0) < 0) {
+		dbg(2, "run_daemon: client on fd %d closed", c->fd);
+		close(c->fd);
+		free(c->buf);
+		free(c->out);
+		for (j=i; j < nclients-1; ++j) {
+		    clients[j] = clients[j+1];
+		}
+		--nclients;
+	    }
 	}
-	inbuf_len = q - inbuf;
-	inbuf[inbuf_len] = '\0';	/* for debugging */
-	if (line_mode) {
-	    dbg(9, "char_mask: %s", char_mask);
-	    dbg(9, "inbuf after char_mask: %s", inbuf);
+
+	/*
+	 * accept a new client
+	 */
+	if (fds[0].revents & POLLIN) {
+	    i = accept(sfd, NULL, NULL);
+	    if (i < 0) {
+		dbg(1, "run_daemon: accept failed: %s", strerror(errno));
+	    } else if (nclients >= MAX_CLIENTS) {
+		dbg(1, "run_daemon: too many clients, closing fd %d", i);
+		close(i);
+	    } else {
+		c = &clients[nclients];
+		memset(c, 0, sizeof(struct client));
+		c->fd = i;
+		c->size = CLIENT_BUF;
+		c->buf = (u_int8_t *)malloc(CLIENT_BUF);
+		if (c->buf == NULL ||
+		    fcntl(i, F_SETFL, fcntl(i, F_GETFL) | O_NONBLOCK) < 0) {
+		    free(c->buf);
+		    close(i);
+		} else {
+		    dbg(2, "run_daemon: new client on fd %d", i);
+		    ++nclients;
+		}
+	    }
 	}
-	dbg(7, "inbuf trimmed to %d octets", inbuf_len);
     }
 
     /*
-     * do nothing if trimmed input buffer is empty
+     * all done!
      */
-    if (inbuf_len <= 0) {
-	dbg(5, "trim_record: trimmed inbuf is empty");
-	return 0;
-    }
+    dbg(1, "run_daemon: stopping");
+    for (i=0; i < nclients; ++i) {
+	close(clients[i].fd);
+	free(clients[i].buf);
+	free(clients[i].out);
+    }
+    close(sfd);
+    (void) unlink(sock_path);
+    while (dctx_list != NULL) {
+	drop_dctx(dctx_list->name, strlen(dctx_list->name));
+    }
+    ent_map_free(map);
+    exit(0);
+}
 
-    /*
-     * determine how many bits we will produce
-     */
-    outbuf_need = 0;
-    for (i=0; i < inbuf_len; ++i) {
-	outbuf_need += strlen(octet_map[inbuf[i]]);
-    }
 
-    /*
-     * do nothing if we will produce no bits
-     */
-    if (outbuf_need <= 0) {
-	dbg(5, "trim_record: line will yield no bits");
-	return 0;
-    }
+/*
+ * serve_client - send replies to, read and process the frames of a client
+ *
+ * Frames are processed until CLIENT_OUT octets of replies are queued.
+ * The rest wait in the input buffer until the client reads its replies.
+ * Once the client has closed, or sent a bad frame, no more is read.
+ *
+ * given:
+ *	c		client
+ *	can_read	1 ==> read what input the client has sent
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> the client should be dropped
+ */
+static int
+serve_client(struct client *c, int can_read)
+{
+    u_int32_t frame_len;	/* length of the frame being processed */
+    size_t used;		/* client input octets already processed */
+    u_int8_t *p;
+    ssize_t r;
 
     /*
-     * be sure we have enough room in our output buffer
+     * send queued replies, making room for more
      */
-    if (*outbuf_len < outbuf_need) {
-
-	/* grow output buffer */
-	*outbuf = (u_int8_t *)realloc(*outbuf, outbuf_need+1);
-	if (outbuf == NULL) {
-	    fprintf(stderr, "%s: trim_record: failed to realloc outbuf from "
-			    "%d octets to %d octets\n",
-		    program, *outbuf_len, outbuf_need);
-	    exit(36);
-	}
-	dbg(8, "outbuf grew from %d octets to %d octets",
-	       *outbuf_len, outbuf_need);
-	*outbuf_len = outbuf_need;
-	*outbuf[outbuf_need] = '\0';
+    if (send_replies(c) < 0) {
+	return -1;
     }
 
     /*
-     * load output buffer with 0x00's and 0x01's
+     * read what we can, growing the buffer for a large frame
      */
-    r = *outbuf;
-    for (i=0; i < inbuf_len; ++i) {
-	/*
-	 * load 0x01's for every '1' and 0x00's otherwise
-	 */
-	for (q = (u_int8_t *)octet_map[inbuf[i]]; *q != '\0'; ++q) {
-	    *r++ = ((*q == '1') ? 0x01 : 0x00);
+    if (can_read && c->closing == 0 && c->out_len < CLIENT_OUT) {
+	if (c->len >= 4) {
+	    memcpy(&frame_len, c->buf, 4);
+	    frame_len = ntohl(frame_len);
+	    if (frame_len <= MAX_FRAME && 4+(size_t)frame_len > c->size) {
+		p = (u_int8_t *)realloc(c->buf, 4+(size_t)frame_len);
+		if (p != NULL) {
+		    c->buf = p;
+		    c->size = 4+(size_t)frame_len;
+		}
+	    }
+	}
+	r = read(c->fd, c->buf+c->len, c->size-c->len);
+	if (r > 0) {
+	    c->len += r;
+	} else if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK &&
+			      errno != EINTR)) {
+	    c->closing = 1;
 	}
     }
-    *r = '\0';
 
     /*
-     * special binary debugging output
+     * process each complete frame, sending the replies as we go
      */
-    if (v_flag >= 7) {
-	r = *outbuf;
-	dbg(7, "initially have %d bits", outbuf_need);
-	fprintf(stderr, "Debug[7]: encoding: ");
-	for (i=0; i < outbuf_need; ++i) {
-	    if (r[i]) {
-		fputc('1', stderr);
-	    } else {
-		fputc('0', stderr);
+    do {
+	used = 0;
+	while (c->len-used >= 4 && (c->closing || c->out_len < CLIENT_OUT)) {
+	    memcpy(&frame_len, c->buf+used, 4);
+	    frame_len = ntohl(frame_len);
+	    if (frame_len > MAX_FRAME) {
+		if (reply(c, "ERR frame length %lu > %d\n",
+			  (unsigned long)frame_len, MAX_FRAME) < 0) {
+		    return -1;
+		}
+		c->closing = 1;
+		used = c->len;
+		break;
+	    }
+	    if (c->len-used < 4+(size_t)frame_len) {
+		break;
 	    }
+	    if (do_frame(c, c->buf+used+4, frame_len) < 0) {
+		return -1;
+	    }
+	    used += 4+(size_t)frame_len;
 	}
-	fputc('\n', stderr);
-    }
+	if (used > 0 && used < c->len) {
+	    memmove(c->buf, c->buf+used, c->len-used);
+	}
+	c->len -= used;
+	if (send_replies(c) < 0) {
+	    return -1;
+	}
+    } while (used > 0 && c->len >= 4 && c->out_len < CLIENT_OUT);
 
     /*
-     * bit mask, if requested
-     *
-     * If bitmask is a string, then we keep only those bits
-     * in the output buffer that correspond to a 'b' in the charmask.
+     * a client that is closing is dropped once its replies are sent
      */
-    if (bit_mask != NULL) {
-
-	/*
-	 * walk the charmask looking for b's
-	 */
-	r = *outbuf;
-	if ((i = strlen(bit_mask)) > outbuf_need) {
-	    s = bit_mask + outbuf_need;
-	} else {
-	    s = bit_mask + i;
+    if (c->closing) {
+	c->len = 0;
+	if (c->out_len == 0) {
+	    return -1;
 	}
-	for (q=r, p=bit_mask; *p != '\0' && p < s; ++p) {
+    }
+    return 0;
+}
 
-	    /* skip non-b chars (presumably x's) */
-	    if (*p != 'b') {
-		continue;
-	    }
 
-	    /* save this inbuf character */
-	    *q++ = r[p - bit_mask];
-	}
-	dbg(9, "bit_mask: %s", bit_mask);
-	dbg(8, "masked %d bits down to %d bits", outbuf_need, q - r);
-	outbuf_need = q - r;
-	r[outbuf_need] = '\0';	/* for debugging */
+/*
+ * find_dctx - find, and optionally create, a named daemon context
+ *
+ * given:
+ *	name	    context name, need not be NUL terminated
+ *	name_len    length of name
+ *	create	    1 ==> create the context if it does not exist
+ *
+ * returns:
+ *	named context or NULL
+ */
+static struct dctx *
+find_dctx(const char *name, int name_len, int create)
+{
+    struct dctx *d;		/* named context */
 
-	/*
-	 * special binary debugging output
-	 */
-	if (v_flag >= 7) {
-	    r = *outbuf;
-	    fprintf(stderr, "Debug[7]: the bits: ");
-	    for (i=0; i < outbuf_need; ++i) {
-		if (r[i]) {
-		    fputc('1', stderr);
-		} else {
-		    fputc('0', stderr);
-		}
-	    }
-	    fputc('\n', stderr);
-	    dbg(7, "masked down to %d octets", outbuf_need);
+    /*
+     * look for the context
+     */
+    for (d = dctx_list; d != NULL; d = d->next) {
+	if (strncmp(d->name, name, name_len) == 0 &&
+	    d->name[name_len] == '\0') {
+	    return d;
 	}
     }
+    if (create == 0) {
+	return NULL;
+    }
 
     /*
-     * return use count
+     * create the context
      */
-    return outbuf_need;
+    d = (struct dctx *)calloc(1, sizeof(struct dctx));
+    if (d == NULL) {
+	return NULL;
+    }
+    d->name = strndup(name, name_len);
+    d->ctx = ent_open(&cfg, map);
+    if (d->name == NULL || d->ctx == NULL) {
+	free(d->name);
+	ent_close(d->ctx);
+	free(d);
+	return NULL;
+    }
+    d->size = ent_size(d->ctx);
+    dctx_mem += d->size;
+    d->next = dctx_list;
+    dctx_list = d;
+    dbg(2, "find_dctx: created context: %s", d->name);
+    return d;
 }
 
 
 /*
- * rept_entropy - report on current entropy estimate
+ * drop_dctx - free a named daemon context
+ *
+ * given:
+ *	name	    context name, need not be NUL terminated
+ *	name_len    length of name
  */
 static void
-rept_entropy(struct bitslice **slice, int bit_buf_used)
+drop_dctx(const char *name, int name_len)
 {
-    unsigned long count;	/* number of bit ops for a bitslice */
-    double inv_count;		/* 1.0/count as a double */
-    int depth_lim;		/* how deep we can calculate entropy */
-    int back_lim;		/* how far back the slice uses history */
-    int bit_num;		/* slice bit number */
-    int hist_num;		/* history level, 0 ==> current */
-    int depth_num;		/* bit depth level */
-    tally_t *tally;		/* tally array for a given bit & history lvl */
-    u_int32_t offset;		/* offset within tally array being used */
-    double p_i;			/* probability of finding an i value */
-    double entropy;		/* entropy sum being calculated */
-    double max_entropy;		/* max entropy found for a given history */
-    int max_ent_depth;		/* depth at which max entropy was found */
-    double min_entropy;		/* min entropy found for a given history */
-    int min_ent_depth;		/* depth at which max entropy was found */
-    double high_bit_ent;	/* high entropy estimate for bit */
-    int high_ent_depth;		/* depth at which max bit entropy was found */
-    int high_ent_hist;		/* hist at which max entropy was found */
-    double low_bit_ent;		/* low entropy estimate for bit */
-    int low_ent_depth;		/* depth at which min bit entropy was found */
-    int low_ent_hist;		/* hist at which min entropy was found */
-    double total_high_ent;	/* overall high entropy total for all bits */
-    int total_high_cnt;		/* number of bits calculating total_high_ent */
-    double total_low_ent;	/* overall low entropy total for all bits */
-    int total_low_cnt;		/* number of bits calculating total_low_ent */
-    int i;
+    struct dctx **pd;		/* pointer to the link to the context */
+    struct dctx *d;		/* named context */
+
+    for (pd = &dctx_list; *pd != NULL; pd = &(*pd)->next) {
+	d = *pd;
+	if (strncmp(d->name, name, name_len) == 0 &&
+	    d->name[name_len] == '\0') {
+	    *pd = d->next;
+	    dbg(2, "drop_dctx: dropped context: %s", d->name);
+	    dctx_mem -= d->size;
+	    ent_close(d->ctx);
+	    free(d->name);
+	    free(d);
+	    return;
+	}
+    }
+    return;
+}
+
+
+/*
+ * do_frame - perform the op of a client frame and queue the reply
+ *
+ * given:
+ *	c	    client
+ *	frame	    frame, not including its length
+ *	frame_len   length of frame
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> the client should be dropped
+ */
+static int
+do_frame(struct client *c, u_int8_t *frame, u_int32_t frame_len)
+{
+    struct ent_rept rept;	/* entropy report */
+    char rept_buf[BUFSIZ+1];	/* formatted entropy report */
+    struct dctx *d;		/* named context */
+    const char *name;		/* context name */
+    int name_len;		/* length of context name */
+    u_int8_t *p;		/* payload */
+    u_int32_t plen;		/* remaining payload octets */
+    u_int32_t rlen;		/* record length */
+    u_int8_t *rec[ENT_BATCH];	/* records of a batch, in the frame */
+    int len[ENT_BATCH];		/* length of each record of the batch */
+    unsigned long fed;		/* records fed */
+    int overrun;		/* 1 ==> a record overruns the frame */
+    int err;			/* errno of a failed feed, or 0 */
+    int n;			/* records in the batch */
+    int op;
 
     /*
-     * firewall
+     * parse the frame header
      */
-    if (slice == NULL) {
-	fprintf(stderr, "%s: rept_entropy: slice array is NULL\n", program);
-	exit(37);
-    }
-    if (bit_buf_used <= 0) {
-	dbg(2, "rept_entropy: no bit slices to process\n");
-	return;
-    }
+    if (frame_len < 2 || frame[1] == 0 || 2+(u_int32_t)frame[1] > frame_len ||
+	memchr(frame+2, 0, frame[1]) != NULL) {
+	return reply(c, "ERR malformed frame\n");
+    }
+    op = frame[0];
+    name_len = frame[1];
+    name = (const char *)frame+2;
+    p = frame+2+name_len;
+    plen = frame_len-2-name_len;
+    dbg(5, "do_frame: op: %c name: %.*s payload: %lu octets",
+	   op, name_len, name, (unsigned long)plen);
 
     /*
-     * calculate entropy of each slice
+     * perform the op
      */
-    total_high_ent = 0.0;
-    total_high_cnt = 0;
-    total_low_ent = 0.0;
-    total_low_cnt = 0;
-    for (bit_num=0; bit_num < bit_buf_used; ++bit_num) {
-
-	/* firewall */
-	if (slice[bit_num] == NULL) {
-	    dbg(5, "rept_entropy: slice[%d] is NULL", bit_num);
-	    continue;
+    switch (op) {
+    case 'F':		/* feed records */
+	if (mem_max > 0 && dctx_mem >= mem_max) {
+	    return reply(c, "ERR contexts hold more than -M %lu MiB\n",
+			 (unsigned long)(mem_max / (1024*1024)));
 	}
-	if (slice[bit_num]->bitnum != bit_num) {
-	    fprintf(stderr, "%s: rept_entropy: slice %d != %d",
-		    program, slice[bit_num]->bitnum, bit_num);
-	    exit(38);
+	d = find_dctx(name, name_len, 1);
+	if (d == NULL) {
+	    return reply(c, "ERR cannot create context: %s\n",
+			 strerror(errno));
 	}
 
 	/*
-	 * determine the parameters of our count
+	 * feed the records, a batch at a time
 	 */
-	count = slice[bit_num]->count;
-	if (count <= 0) {
-	    dbg(9, "rept_entropy: slice[%d] has no count", bit_num);
-	    continue;
-	}
-	inv_count = 1.0 / (double)count;
-	depth_lim = slice[bit_num]->depth_lim;
-	back_lim = slice[bit_num]->back_lim;
-	while (depth_lim > 0 && (count/depth_factor) < (1ULL << depth_lim)) {
-	    --depth_lim;
+	fed = 0;
+	overrun = 0;
+	err = 0;
+	while (plen >= 4 && overrun == 0 && err == 0) {
+	    for (n=0; n < ENT_BATCH && plen >= 4; ++n) {
+		memcpy(&rlen, p, 4);
+		rlen = ntohl(rlen);
+		if (rlen > plen-4) {
+		    overrun = 1;
+		    break;
+		}
+		rec[n] = p+4;
+		len[n] = (int)rlen;
+		p += 4+rlen;
+		plen -= 4+rlen;
+	    }
+	    if (n > 0 && ent_feed_batch(d->ctx, rec, len, n) < 0) {
+		err = errno;
+		break;
+	    }
+	    fed += n;
 	}
-	if (depth_lim <= 0) {
-	    dbg(9, "rept_entropy: slice[%d] has too low of a count: %llu",
-		    bit_num, count);
-	    continue;
+	dctx_mem += ent_size(d->ctx) - d->size;
+	d->size = ent_size(d->ctx);
+	if (err != 0) {
+	    return reply(c, "ERR record %lu: %s\n", fed, strerror(err));
+	} else if (overrun) {
+	    return reply(c, "ERR record %lu overruns frame\n", fed);
+	} else if (plen > 0) {
+	    return reply(c, "ERR %lu trailing octets\n", (unsigned long)plen);
 	}
-	dbg(8, "rept_entropy: slice[%d]: count: %lld  depth_lim: %d  back_lim: %d",
-	       bit_num, count, depth_lim, back_lim);
-
-	/*
-	 * setup to calculate high and low entropy estimates for bit
-	 */
-	high_bit_ent = INVALID_MAX_ENTROPY;
-	high_ent_depth = -1;
-	high_ent_hist = -1;
-	low_bit_ent = INVALID_MIN_ENTROPY;
-	low_ent_depth = -1;
-	low_ent_hist = -1;
+	return reply(c, "OK %lu\n", fed);
 
-	/*
-	 * calculate entropy for the back history of this bit
-	 */
-	for (hist_num=0; hist_num <= back_history; ++hist_num) {
+    case 'R':		/* report */
+	d = find_dctx(name, name_len, 0);
+	if (d == NULL) {
+	    return reply(c, "ERR no such context\n");
+	}
+	(void) ent_report(d->ctx, &rept);
+	rept_format(rept_buf, sizeof(rept_buf), &rept, rept.recnum);
+	return reply(c, "Entropy report: %s\n%s", d->name, rept_buf);
+
+    case 'T':		/* thaw */
+	d = find_dctx(name, name_len, 0);
+	if (d == NULL) {
+	    return reply(c, "ERR no such context\n");
+	}
+	ent_thaw(d->ctx);
+	return reply(c, "OK\n");
 
-	    /*
-	     * setup to process the tally array
-	     */
-	    tally = slice[bit_num]->hist[hist_num];
-	    if (tally == NULL) {
-		fprintf(stderr, "%s: rept_entropy: NULL slice[%d]->hist[%d]",
-			program, bit_num, hist_num);
-		exit(39);
-	    }
-	    max_entropy = INVALID_MAX_ENTROPY;
-	    max_ent_depth = -1;
-	    min_entropy = INVALID_MIN_ENTROPY;
-	    min_ent_depth = -1;
+    case 'X':		/* drop */
+	drop_dctx(name, name_len);
+	return reply(c, "OK\n");
 
-	    /*
-	     * calculate the entropy to appropriate depths
-	     */
-	    for (offset=2, depth_num=1;
-		 depth_num <= depth_lim;
-		 offset <<= 1, ++depth_num) {
-
-		/*
-		 * calculate entropy at this depth
-		 *
-		 * - sum p_i ln_2(p_i);
-		 */
-		entropy = 0.0;
-		for (i=0; i < offset; ++i) {
-
-		    /* ignore of no count */
-		    if (tally[offset+i] > 0) {
-
-			/* proability of find this value at this depth */
-			p_i = (double)tally[offset+i] * inv_count;
-
-			/* add to entropy sum */
-			entropy += p_i * log(p_i);
-		    }
-		}
-		/* entropy is the - sum , and covert log base 2 per bit */
-		entropy = entropy * -INV_LN_2 / depth_num;
-		dbg(9, "rept_entropy: slice[%d]: hist:%d depth:%d: entropy:%f",
-			bit_num, hist_num, depth_num, entropy);
-		if (entropy < 0.0) {
-		    entropy = 0.0;
-		}
+    default:
+	return reply(c, "ERR unknown op\n");
+    }
+}
 
-		/*
-		 * keep track of maximum and minimum entropy levels
-		 */
-		if (entropy > max_entropy) {
-		    max_entropy = entropy;
-		    max_ent_depth = depth_num;
-		    if (max_entropy > high_bit_ent) {
-			high_bit_ent = max_entropy;
-			high_ent_depth = depth_num;
-			high_ent_hist = hist_num;
-			dbg(6, "rept_entropy: slice[%d]: hist:%d depth:%d "
-			       "new max_entropy:%f",
-			       bit_num, high_ent_hist, high_ent_depth,
-			       high_bit_ent);
-		    }
-		}
-		if (entropy < min_entropy) {
-		    min_entropy = entropy;
-		    min_ent_depth = depth_num;
-		    if (min_entropy < low_bit_ent) {
-			low_bit_ent = min_entropy;
-			low_ent_depth = depth_num;
-			low_ent_hist = hist_num;
-			dbg(6, "rept_entropy: slice[%d]: hist:%d depth:%d "
-			       "new min_entropy:%f",
-			       bit_num, low_ent_hist, low_ent_depth,
-			       low_bit_ent);
-		    }
-		}
-	    }
 
-	    /*
-	     * record entropy for this back history
-	     */
-	    if (max_entropy > INVALID_MAX_ENTROPY) {
-		slice[bit_num]->max_ent[hist_num] = max_entropy;
-		dbg(8, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "max_entropy:%f",
-		       bit_num, hist_num, max_ent_depth, max_entropy);
-	    } else {
-		dbg(7, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "no max_entropy",
-		       bit_num, hist_num, max_ent_depth);
-	    }
-	    if (min_entropy < INVALID_MIN_ENTROPY) {
-		slice[bit_num]->min_ent[hist_num] = min_entropy;
-		dbg(8, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "min_entropy:%f",
-		       bit_num, hist_num, min_ent_depth, min_entropy);
-	    } else {
-		dbg(7, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		       "no min_entropy",
-		       bit_num, hist_num, min_ent_depth);
-	    }
-	}
+/*
+ * reply - queue a reply frame for a client
+ *
+ * given:
+ *	c	client
+ *	fmt	printf format of the reply text
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> malloc error
+ */
+static int
+reply(struct client *c, const char *fmt, ...)
+{
+    char buf[BUFSIZ*2+4+1];	/* reply length and text */
+    va_list ap;			/* argument pointer */
+    u_int32_t len;		/* reply text length */
+    size_t size;		/* grown size of the client replies */
+    char *out;			/* grown client replies */
+    int n;
 
-	/*
-	 * record entropy for this bit
-	 */
-	if (high_bit_ent > INVALID_MAX_ENTROPY) {
-	    slice[bit_num]->entropy_high = high_bit_ent;
-	    dbg(4, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		    "bit high entropy:%f",
-		   bit_num, high_ent_hist, high_ent_depth,
-		   high_bit_ent);
-	    total_high_ent += high_bit_ent;
-	    ++total_high_cnt;
-	} else {
-	    dbg(5, "rept_entropy: slice[%d]: bit max_entropy unknown",
-		   bit_num);
-	}
-	if (low_bit_ent < INVALID_MIN_ENTROPY) {
-	    slice[bit_num]->entropy_low = low_bit_ent;
-	    dbg(4, "rept_entropy: slice[%d]: hist:%d depth:%d "
-		    "bit low entropy:%f",
-		   bit_num, low_ent_hist, low_ent_depth,
-		   low_bit_ent);
-	    total_low_ent += low_bit_ent;
-	    ++total_low_cnt;
-	} else {
-	    dbg(5, "rept_entropy: slice[%d]: bit min_entropy unknown",
-		   bit_num);
-	}
+    /*
+     * format the reply after its length
+     */
+    va_start(ap, fmt);
+    n = vsnprintf(buf+4, sizeof(buf)-4, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+	n = 0;
+    } else if (n >= sizeof(buf)-4) {
+	n = sizeof(buf)-4-1;
     }
+    len = htonl((u_int32_t)n);
+    memcpy(buf, &len, 4);
 
     /*
-     * compute overall entropy, if possible
+     * queue the reply
      */
-    if (total_high_cnt > 0) {
-	overall.high_entropy = total_high_ent;
-	overall.high_bit_cnt = total_high_cnt;
-	dbg(3, "rept_entropy: overall high entropy: %f", overall.high_entropy);
-	dbg(3, "rept_entropy: overall high bits: %d", overall.high_bit_cnt);
+    if (c->out_len+4+n > c->out_size) {
+	for (size = (c->out_size > 0) ? c->out_size : sizeof(buf);
+	     size < c->out_len+4+n; size *= 2) {
+	}
+	out = (char *)realloc(c->out, size);
+	if (out == NULL) {
+	    dbg(1, "reply: cannot queue reply for fd %d", c->fd);
+	    return -1;
+	}
+	c->out = out;
+	c->out_size = size;
     }
-    if (total_low_cnt > 0) {
-	overall.low_entropy = total_low_ent;
-	overall.low_bit_cnt = total_low_cnt;
-	dbg(3, "rept_entropy: overall low entropy: %f", overall.low_entropy);
-	dbg(3, "rept_entropy: overall low bits: %d", overall.low_bit_cnt);
+    memcpy(c->out+c->out_len, buf, 4+n);
+    c->out_len += 4+n;
+    return 0;
+}
+
+
+/*
+ * send_replies - send what queued replies a client will take
+ *
+ * given:
+ *	c	client
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> write error
+ */
+static int
+send_replies(struct client *c)
+{
+    size_t done;		/* octets written so far */
+    ssize_t r;
+
+    for (done=0; done < c->out_len; done += r) {
+	r = write(c->fd, c->out+done, c->out_len-done);
+	if (r < 0 && errno == EINTR) {
+	    r = 0;
+	} else if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+	    break;
+	} else if (r <= 0) {
+	    dbg(1, "send_replies: write to fd %d failed: %s",
+		c->fd, strerror(errno));
+	    return -1;
+	}
     }
-    if (total_high_cnt > 0 && total_low_cnt > 0) {
-	overall.med_entropy = (total_high_ent + total_low_ent) / 2.0;
-	dbg(3, "rept_entropy: overall median entropy: %f",
-	       overall.med_entropy);
+    if (done > 0 && done < c->out_len) {
+	memmove(c->out, c->out+done, c->out_len-done);
     }
+    c->out_len -= done;
+    return 0;
+}
+
+
+/*
+ * stop_handler - SIGINT and SIGTERM handler, ask the daemon or -F to stop
+ */
+static void
+stop_handler(int sig)
+{
+    stop_request = 1;
+    return;
+}
+
+
+/*
+ * thaw_handler - SIGUSR1 handler, request that frozen bitslices be thawed
+ */
+static void
+thaw_handler(int sig)
+{
+    thaw_request = 1;
     return;
 }
 
@@ -0,0 +1,246 @@
+/*
+ * entropic.h - libentropic: measure the amount of entropy found within records
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+#if !defined(INCLUDE_ENTROPIC_H)
+#define INCLUDE_ENTROPIC_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+
+/*
+ * official version
+ */
+#define ENT_VERSION "2.27.0 2026-10-18"          /* format: major.minor YYYY-MM-DD */
+
+
+/*
+ * defaults and limits
+ *
+ * ENT_OCTET_BITS	number of bits in an 8 bit octet
+ *
+ * ENT_DEF_DEPTH	default tally depth (-b) for each record bit
+ *
+ * ENT_MAX_HISTORY_BITS
+ *		We must have this many records before we have a full
+ *		history's worth of values for a given bit position in a record.
+ *		Bit histories are kept in an unsigned long.
+ *
+ * ENT_MAX_BACK_HISTORY
+ *		When we form xors of current values and history values,
+ *		we will go back in history up to this many bits.
+ *
+ * ENT_DEF_HISTORY	Default back_history (-B) value.
+ *
+ * ENT_MAX_DEPTH	Deeper tally depths require more memory.  An increase
+ *		in 1 for the depth requires twice as much memory.  A deeper
+ *		tally has a shorter history from which bit differences can be
+ *		examined.
+ *
+ *		For each bit depth, we need ENT_MAX_BACK_HISTORY more bits
+ *		in the history.  So ENT_MAX_DEPTH+ENT_MAX_BACK_HISTORY is
+ *		required to be <= ENT_MAX_HISTORY_BITS.  We go one less so
+ *		that index offsets fit within signed 32 bits.  Most systems
+ *		will not be able to allocate this much memory, but we have
+ *		to draw a limit somewhere.
+ *
+ * ENT_DEF_DEPTH_FACTOR
+ *		When we calculate entropy at a depth of x, we use the
+ *		tally of values from [0 .. (1<<x)-1].
+ *
+ *		However if we have only counted a few bits for a given
+ *		slice, this tally set will not be very populated.
+ *		The required number of cycles to use a depth of x
+ *		in calculating entropy is (1<<x) * depth_factor.
+ *		This value is the default depth_factor (-f).
+ *
+ * ENT_BATCH	Records of a batch that ent_feed_batch() processes stage
+ *		by stage.  Longer batches are processed ENT_BATCH records
+ *		at a time.
+ */
+#define ENT_OCTET_BITS 8
+#define ENT_DEF_DEPTH 8
+#define ENT_MAX_HISTORY_BITS (sizeof(unsigned long)*ENT_OCTET_BITS)
+#define ENT_MAX_BACK_HISTORY (ENT_MAX_HISTORY_BITS/2)
+#define ENT_DEF_HISTORY ENT_MAX_BACK_HISTORY
+#define ENT_MAX_DEPTH (ENT_MAX_BACK_HISTORY-1)
+#define ENT_DEF_DEPTH_FACTOR 4
+#define ENT_BATCH 256
+
+
+/*
+ * field extraction, see the field_mode of struct ent_cfg
+ *
+ * ENT_MAX_KEY	longest field_key
+ */
+#define ENT_FIELD_NONE 0	/* analyze the whole record */
+#define ENT_FIELD_DELIM 1	/* field field_num of field_sep separated fields */
+#define ENT_FIELD_KV 2		/* value of field_key in key=value pairs */
+#define ENT_FIELD_JSON 3	/* value of field_key in a JSON object */
+#define ENT_MAX_KEY 63
+
+
+/*
+ * ent_cfg - analysis parameters of an entropy context
+ *
+ * Initialize with ent_cfg_init() and then change what is needed
+ * before calling ent_open().  The context keeps its own copy.
+ *
+ * text
+ *	1 ==> records are text lines.  This only controls if records
+ *	      may be printed as strings in debug messages.
+ *
+ * keep_newline
+ *	0 ==> discard a trailing \n, \r, \r\n, or \n\r from each record
+ *	1 ==> do not trim newlines
+ *
+ * field_mode
+ *	ENT_FIELD_NONE ==> analyze the whole record
+ *	ENT_FIELD_DELIM ==> keep only field field_num (1st is 1) of the
+ *		fields separated by the field_sep octet.  A field that
+ *		starts with a " ends at the next " not doubled, and the
+ *		outer quotes are dropped.
+ *	ENT_FIELD_KV ==> keep only the value of field_key in a record of
+ *		key=value pairs separated by whitespace, , ; or &.
+ *		A value may be in "'s.
+ *	ENT_FIELD_JSON ==> keep only the value of the top level field_key
+ *		of a JSON object.  The quotes of a string value are dropped,
+ *		its escapes are kept as is.
+ *	Records without the field are skipped.  The field is found after
+ *	the newline is trimmed and before the cookie is trimmed.
+ *
+ * cookie_trim
+ *	1 ==> keep only the text after the 1st = and before the next ;
+ *	      records without both are skipped
+ *	2 ==> each name=value pair of a record is a record of its own:
+ *	      the text after each = up to the next ; or the end of the line
+ *
+ * conv_cycle
+ *	> 0 ==> every conv_cycle records, freeze the bitslices whose
+ *		entropy estimates have converged (see ent_thaw())
+ *
+ * block
+ *	> 0 ==> ent_feed_batch() tallies a batch in blocks of up to block
+ *		records, at most ENT_BATCH: each bitslice records its bits
+ *		of the whole block in turn, so its tallies stay in cache.
+ *		The tallies are the same as record by record.
+ */
+struct ent_cfg {
+    int bit_depth;		/* tally bit depth for each bit in record */
+    int back_history;		/* xor diff back this many records */
+    int depth_factor;		/* ave slot tally needed */
+    int conv_cycle;		/* > 0 ==> check convergence every so many recs */
+    int block;			/* > 0 ==> tally blocks of so many recs by slice */
+    int text;			/* 1 ==> records are text lines */
+    int keep_newline;		/* 0 ==> discard newline, 1 ==> keep them */
+    int cookie_trim;		/* 1 ==> keep after 1st = and before 1st ; */
+				/* 2 ==> each = to ; value is a record */
+    int field_mode;		/* ENT_FIELD_NONE ==> whole record */
+    int field_num;		/* ENT_FIELD_DELIM field number, 1st is 1 */
+    int field_sep;		/* ENT_FIELD_DELIM field separator octet */
+    char field_key[ENT_MAX_KEY+1];	/* ENT_FIELD_KV or _JSON key */
+    int v_flag;			/* debug verbosity level, 0 ==> none */
+};
+
+
+/*
+ * ent_rept - an entropy report
+ *
+ * NOTE: The high_entropy is invalid if high_bit_cnt <= 0.
+ *       The low_entropy is invalid if low_bit_cnt <= 0.
+ *       The med_entropy is invalid unless both are valid.
+ */
+struct ent_rept {
+    unsigned long recnum;	/* records given to ent_feed() so far */
+    int bits;			/* number of bitslices (bit positions) */
+    int frozen;			/* number of frozen bitslices */
+    double high_entropy;	/* high estimate of overall entropy */
+    int high_bit_cnt;		/* bits used to compute high_entropy or -1 */
+    double low_entropy;		/* low estimate of overall entropy */
+    int low_bit_cnt;		/* bits used to compute low_entropy or -1 */
+    double med_entropy;		/* median entropy */
+};
+
+
+/*
+ * opaque library objects
+ *
+ * struct ent_map	a compiled map file (charmask, octet map, bitmask)
+ * struct ent_ctx	an entropy analysis context
+ * struct ent_alpha	the alphabet found in a sample of records
+ *
+ * A struct ent_map is read-only once loaded and may be shared by any
+ * number of contexts in any number of threads.  A struct ent_ctx must
+ * only be used by one thread at a time.  The library has no other state.
+ */
+struct ent_map;
+struct ent_ctx;
+struct ent_alpha;
+
+
+/*
+ * external functions
+ */
+extern void ent_cfg_init(struct ent_cfg *cfg);
+extern struct ent_map *ent_map_load(const char *map_file, int v_flag,
+				    char *errbuf, size_t errlen);
+extern struct ent_map *ent_map_builtin(const char *name,
+				       char *errbuf, size_t errlen);
+extern struct ent_map *ent_map_select(const char *select,
+				      char *errbuf, size_t errlen);
+extern int ent_map_span(const struct ent_map *map);
+extern void ent_map_free(struct ent_map *map);
+extern struct ent_alpha *ent_alpha_open(void);
+extern int ent_alpha_add(struct ent_alpha *alpha, const u_int8_t *rec, int len);
+extern int ent_alpha_write(const struct ent_alpha *alpha, FILE *out);
+extern void ent_alpha_close(struct ent_alpha *alpha);
+extern struct ent_ctx *ent_open(const struct ent_cfg *cfg,
+				const struct ent_map *map);
+extern int ent_feed(struct ent_ctx *ctx, const u_int8_t *rec, int len);
+extern int ent_feed_batch(struct ent_ctx *ctx, u_int8_t *const *rec,
+			  const int *len, int n);
+extern int ent_feed_run(struct ent_ctx *ctx, const u_int8_t *rec, int len,
+			unsigned long count);
+extern int ent_trim(const struct ent_cfg *cfg, u_int8_t *rec, int len);
+extern int ent_cookie(const u_int8_t *rec, int len, int *val, int *val_len);
+extern int ent_report(struct ent_ctx *ctx, struct ent_rept *rept);
+extern int ent_report_at(struct ent_ctx *ctx, int bit_depth, int back_history,
+			 int depth_factor, struct ent_rept *rept);
+extern void ent_thaw(struct ent_ctx *ctx);
+extern void ent_reset(struct ent_ctx *ctx);
+extern void ent_restart(struct ent_ctx *ctx);
+extern int ent_merge(struct ent_ctx *dst, const struct ent_ctx *src);
+extern size_t ent_size(const struct ent_ctx *ctx);
+extern void ent_close(struct ent_ctx *ctx);
+
+#endif /* INCLUDE_ENTROPIC_H */
@@ -0,0 +1,4515 @@
+/*
+ * libentropic - measure the amount of entropy found within records
+ *
+ * Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+ *
+ * Permission to use, copy, modify, and distribute this software and
+ * its documentation for any purpose and without fee is hereby granted,
+ * provided that the above copyright, this permission notice and text
+ * this comment, and the disclaimer below appear in all of the following:
+ *
+ *       supporting documentation
+ *       source copies
+ *       source works derived from this source
+ *       binaries derived from this source or from derived source
+ *
+ * LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll) /\oo/\
+ *
+ * http://www.isthe.com/chongo/index.html
+ * https://github.com/lcn2
+ *
+ * Share and enjoy!  :-)
+ */
+
+
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <sys/errno.h>
+
+#include "entropic.h"
+
+
+/*
+ * internal constants
+ *
+ * INV_LN_2	1.0 / Log base e of 2.
+ *
+ * INVALID_MAX_ENTROPY
+ * INVALID_MIN_ENTROPY
+ *		Impossible entropy values per bit.
+ *
+ * FREEZE_EPSILON
+ *		When conv_cycle > 0, a bitslice whose high and low
+ *		entropy estimates each move by no more than this many bits
+ *		between convergence checks is considered stable.
+ *
+ * FREEZE_STABLE
+ *		A bitslice is frozen once it has been stable for this
+ *		many consecutive convergence checks.
+ *
+ * PACK_BITS	ent_feed_batch() records the rows it has packed once
+ *		they hold this many bits, even if fewer than ENT_BATCH.
+ *		So a block of wide records may be fewer than cfg.block.
+ */
+#define INV_LN_2 ((double)1.442695040888963407359924681001892137426646)
+#define INVALID_MAX_ENTROPY ((double)-10.0)
+#define INVALID_MIN_ENTROPY ((double)10.0)
+#define FREEZE_EPSILON ((double)0.0001)
+#define FREEZE_STABLE 3
+#define PACK_BITS (4*1024*1024)
+
+
+/*
+ * tally_t - tally counter type
+ */
+typedef unsigned long tally_t;
+
+
+/*
+ * bitslice - tables and tally arrays for a given bit position in the record
+ *
+ * hist[i]
+ *	The tally table for the xor of the current bit history with
+ *	the bit history 'i' records back.
+ *
+ *	The layout of a given tally array is defined in alloc_bittally()'s
+ *	comments.  For our example, simply note that hist[i][8] thru
+ *	hist[i][15] hold the 8 tally values for all possible 3-bit
+ *	combinations.  So hist[i][8] is a tally of all '000' 3-bit values.
+ *	And hist[i][9] is a tally of all '001' 3-bit values.
+ *	And hist[i][10] is a tally of all '010' 3-bit values.  ...
+ *
+ *	Therefore hist[5][10] holds a tally of all '010' 3-bit values
+ *	that are computed by the xor of the current bit history
+ *	and the bit history 5 records back.  If b0 is the current
+ *	bit value, b1 is the previous bit value, b2 as the bit value, ...
+ *
+ *	Using the notation that b0 is the current value, b1 previous,
+ *	b2 the bit value before that, we have:
+ *
+ *	    hist[5][10] = count when xor( b2b1b0 , b7b6b5 ) was '010'
+ *	    hist[5][11] = count when xor( b2b1b0 , b7b6b5 ) was '011'
+ *	    hist[5][12] = count when xor( b2b1b0 , b7b6b5 ) was '100'
+ *
+ *	    hist[6][12] = count when xor( b2b1b0 , b8b7b6 ) was '100'
+ *	    hist[7][12] = count when xor( b2b1b0 , b9b8b7 ) was '100'
+ *
+ *	    hist[5][4] = count when xor( b1b0 , b6b5 ) was '00'
+ *	    hist[5][5] = count when xor( b1b0 , b6b5 ) was '01'
+ *	    hist[5][6] = count when xor( b1b0 , b6b5 ) was '10'
+ *	    hist[5][7] = count when xor( b1b0 , b6b5 ) was '11'
+ *
+ *	    hist[4][4] = count when xor( b1b0 , b5b4 ) was '00'
+ *	    hist[4][5] = count when xor( b1b0 , b5b4 ) was '01'
+ *	    hist[4][6] = count when xor( b1b0 , b5b4 ) was '10'
+ *	    hist[4][7] = count when xor( b1b0 , b5b4 ) was '11'
+ *
+ *      assuming that the bit_depth was deep enough and hist[i] != NULL.
+ *
+ *	As a special case, hist[0] points to the tally table
+ *	of the current values only.  No xor is performed, thus:
+ *
+ *	    hist[0][10] = count when b2b1b0 was '010'
+ *	    hist[0][11] = count when b2b1b0 was '100'
+ *	    hist[0][4]  = count when b1b0 was '00'
+ *	    hist[0][7]  = count when b1b0 was '11'
+ *
+ * frozen
+ *	A frozen bitslice has converged (see check_converge()).  Only the
+ *	history of a frozen bitslice is updated by record_bit(): its tally
+ *	arrays, count and entropy estimates are left alone.  Because the
+ *	history is kept current, ent_thaw() may unfreeze a bitslice at
+ *	any time and tallying resumes with the very next bit.
+ */
+struct bitslice {
+    int bitnum;			/* bit position in record, 0 ==> low order bit */
+    unsigned long history;	/* history of bit positions, bit 0 ==> most recent */
+    unsigned long ops;		/* total operations on bit, including ignored ones */
+    unsigned long count;	/* number of bits processed for this position */
+    int depth_lim;		/* bit_depth used in this slice */
+    int back_lim;		/* back_history used in this slice */
+    double max_ent[ENT_MAX_BACK_HISTORY+1];	/* max entropy estimates of hist[i] */
+    double min_ent[ENT_MAX_BACK_HISTORY+1];	/* min entropy estimates of hist[i] */
+    double entropy_high;		/* overall high estimate of entropy */
+    double entropy_low;			/* overall low estimate of entropy */
+    double prev_high;		/* entropy_high at the previous convergence check */
+    double prev_low;		/* entropy_low at the previous convergence check */
+    int stable;			/* consecutive stable convergence checks */
+    int frozen;			/* 1 ==> converged, only history is updated */
+    tally_t *hist[ENT_MAX_BACK_HISTORY+1];  /* cur & historical xor tally arrays */
+};
+struct total_ent {
+    double high_entropy;	/* high estimate of overall entropy */
+    int high_bit_cnt;		/* bits used to compute high_entropy or -1 */
+    double low_entropy;		/* low estimate of overall entropy */
+    int low_bit_cnt;		/* bits used to compute low_entropy or -1 */
+    double med_entropy;		/* median entropy or INVALID_MAX_ENTROPY */
+};
+
+
+/*
+ * ent_code - an octet map compiled for decoding
+ *
+ * An octet map entry of "0"'s and "1"'s is compiled into its length
+ * (bits) and its value (val), most significant bit first.  Records are
+ * decoded by table lookup rather than by walking the entry strings.
+ * A skipped octet has bits == 0.
+ */
+#define MAX_CODE_BITS 32	/* longest octet map entry */
+struct ent_code {
+    u_int32_t val[1 << ENT_OCTET_BITS];	/* value of the bits of an octet */
+    u_int8_t bits[1 << ENT_OCTET_BITS];	/* bits for an octet, 0 ==> skip */
+    struct ent_wide *wide;		/* code points >= U+0080, or NULL */
+};
+
+
+/*
+ * ent_wide - the code and value of the code points >= U+0080 of a map
+ *
+ * A 3 level trie indexed by bits 20-12, 11-6 and 5-0 of the code point.
+ * Node 0 of each level is an empty node: a code point in no U+ line
+ * of the map finds leaf 0 and so yields no bits, without a test.
+ */
+#define UTF8_MAX 0x10ffff	/* largest code point */
+#define UTF8_BAD 0xffffffff	/* an octet that is not valid UTF-8 */
+#define WIDE_ROOT ((UTF8_MAX >> 12) + 1)	/* root node size */
+#define WIDE_NODE 64		/* mid and leaf node size */
+struct wide_leaf {
+    u_int32_t val[WIDE_NODE];	/* value of the bits of a code point */
+    u_int8_t bits[WIDE_NODE];	/* bits for a code point, 0 ==> skip */
+};
+struct ent_wide {
+    int root[WIDE_ROOT];	/* mid node of each 4096 code points */
+    int (*mid)[WIDE_NODE];	/* leaf node of each 64 code points */
+    int nmid;			/* mid nodes in use */
+    struct wide_leaf *leaf;	/* leaf nodes */
+    int nleaf;			/* leaf nodes in use */
+};
+
+
+/*
+ * ent_gather - an octet of a binary record selected by ent_map_select()
+ *
+ * The bits of the octet that are set in mask are gathered, most
+ * significant bit first.  A map gathers its octets in offset order.
+ *
+ * MAX_SELECT	one beyond the largest octet offset that may be selected
+ */
+#define MAX_SELECT (1 << 24)
+struct ent_gather {
+    int off;			/* offset of the octet in the record */
+    u_int8_t mask;		/* bits of the octet to gather */
+};
+
+
+/*
+ * ent_map - a compiled map file
+ *
+ * We will document the pre-processing performed on a record in order.
+ * The keep_newline and cookie_trim steps come from struct ent_cfg,
+ * the rest come from the map file.
+ *
+ * keep_newline
+ *
+ *	keep_newline == 0   ==>   discard trailing \n, \r, \r\n, or \n\r
+ *	keep_newline == 1   ==>   do nothing
+ *
+ * cookie_trim
+ *
+ *	cookie_trim == 0   ==>   do nothing
+ *	cookie_trim == 1   ==>   keep text after 1st = and before 1st ;
+ *
+ * char_mask
+ *
+ *	A string of "x"'s and "c"'s that indicate which chars in
+ *	an input record will be processed.  An "x" means that a
+ *	character in the input record is ignored.  A "c" means
+ *	that the character will be processed.
+ *
+ *	NULL ==> process all characters (the default)
+ *
+ * octet_map[i]
+ *
+ *	A string of ASCII "0"'s and "1"'s representing the bit pattern
+ *	that a the octet 'i' should be converted into during the
+ *	processing of a record.  An empty string means that the
+ *	given octet pattern is skipped.  An entry may have at most
+ *	MAX_CODE_BITS bits.
+ *
+ *	The default octet_map is the 8 bit value of the octet.
+ *
+ * utf8
+ *
+ *	utf8 == 0   ==>   each octet of a record is a character
+ *	utf8 == 1   ==>   records are decoded as UTF-8 into code points
+ *
+ *	A map is in UTF-8 mode when it has a U+ line.  In UTF-8 mode the
+ *	char_mask and cols positions count characters, not octets.  Code
+ *	points below U+0080 use the octet_map, others use the U+ lines.
+ *	An octet that is not part of valid UTF-8 is a character that
+ *	yields no bits.
+ *
+ * cols[i]
+ *
+ *	An octet map for a range of character positions, from a
+ *	columns= section of the map file.  Positions count the
+ *	characters left after the char_mask, starting with 1.
+ *	Octets not given in a section yield no bits at its positions.
+ *	Sections do not overlap, and none starts or ends past
+ *	MAX_COLUMN.
+ *
+ * code
+ *
+ *	The octet_map compiled for decoding (see struct ent_code).
+ *
+ * pos_code[i]
+ *
+ *	The cols compiled into one code per character position:
+ *	pos_code[i] is the code of the character at position i+1.
+ *	Characters past pos_len use tail_code.  When there are no
+ *	columns= sections, pos_code is NULL and every character uses
+ *	code.
+ *
+ * bit_mask
+ *
+ *	A string of "x"'s and "b"'s that indicate which bits will
+ *	be processed.  An "x" means that a bit will be ignored.
+ *	A "b" means that the bit will be processed.
+ *
+ *	NULL ==> process all bits (the default)
+ *
+ * gather
+ *
+ *	The octets and bits of a binary record selected by ent_map_select().
+ *	When gather is not NULL, only these bits are loaded into the bit
+ *	buffer, and the char_mask, octet_map and bit_mask are not used.
+ *	Octets past the end of a short record are not gathered.
+ *
+ *	NULL ==> not a selection map
+ *
+ * MAX_COLUMN	largest columns= position, as long as the longest record
+ *		that entread finds
+ */
+#define MAX_COLUMN (1024*1024)
+struct ent_cols {
+    int first;				/* first character position */
+    int last;				/* last character position, 0 ==> no limit */
+    char *octet_map[1 << ENT_OCTET_BITS];	/* malloced octet to bits map */
+    struct ent_code code;		/* compiled octet_map */
+};
+struct ent_map {
+    char *char_mask;			/* NULL ==> process all chars */
+    char *octet_map[1 << ENT_OCTET_BITS];	/* malloced octet to bits map */
+    char *bit_mask;			/* NULL ==> process all bits */
+    struct ent_cols *cols;		/* malloced column sections or NULL */
+    int ncols;				/* number of column sections */
+    struct ent_code code;		/* compiled octet_map */
+    const struct ent_code **pos_code;	/* malloced code of each position */
+    int pos_len;			/* number of positions in pos_code */
+    const struct ent_code *tail_code;	/* code of positions past pos_len */
+    int utf8;				/* 1 ==> records are UTF-8 */
+    struct ent_gather *gather;		/* malloced selected octets or NULL */
+    int gather_len;			/* number of octets in gather */
+    int gather_bits;			/* bits gathered from a whole record */
+};
+
+
+/*
+ * ent_ctx - an entropy analysis context
+ */
+struct ent_ctx {
+    struct ent_cfg cfg;		/* analysis parameters */
+    const struct ent_map *map;	/* map in use, never NULL */
+    unsigned long recnum;	/* records given to ent_feed() so far */
+    u_int8_t *rec_buf;		/* malloc-ed copy of the record being processed */
+    int rec_len;		/* malloc-ed length of rec_buf, less 1 */
+    u_int8_t *bit_buf;		/* malloc-ed buffer of 0x00 or 0x01 octets */
+    int bit_len;		/* malloc-ed length of bit_buf */
+    u_int32_t *chr_buf;		/* malloc-ed code points of a UTF-8 record */
+    int chr_len;		/* malloc-ed length of chr_buf */
+    struct bitslice **bits;	/* bits[i] points to bitslice for bit i */
+    int bits_len;		/* length of bits pointer array */
+    u_int8_t *pack;		/* malloc-ed ent_feed_batch() rows of bits */
+    size_t pack_len;		/* malloc-ed length of pack */
+    int row[ENT_BATCH];		/* bits in each row of pack */
+    struct total_ent overall;	/* most recent overall entropy estimate */
+};
+
+
+/*
+ * static declarations
+ */
+/* the default code: each octet is its own 8 bit value */
+#define V4(n) (n), (n)+1, (n)+2, (n)+3
+#define V16(n) V4(n), V4((n)+4), V4((n)+8), V4((n)+12)
+#define V64(n) V16(n), V16((n)+16), V16((n)+32), V16((n)+48)
+#define B4 8, 8, 8, 8
+#define B16 B4, B4, B4, B4
+#define B64 B16, B16, B16, B16
+
+/*
+ * builtin_map - encodings known to ent_map_builtin()
+ *
+ * Value i of an encoding is written as alphabet[i], in log2 of the
+ * alphabet length bits.  Octets not in the alphabet, such as = padding,
+ * are skipped.
+ */
+static const struct builtin_map {
+    const char *name;		/* encoding name */
+    const char *alphabet;	/* character of each value, in order */
+    int fold;			/* 1 ==> lower case letters are also mapped */
+} builtin_map[] = {
+    { "hex", "0123456789ABCDEF", 1 },
+    { "b32", "ABCDEFGHIJKLMNOPQRSTUVWXYZ012345", 1 },
+    { "b32rfc", "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567", 1 },
+    { "b64", "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+	     "0123456789+/", 0 },
+    { "b64url", "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+		"0123456789-_", 0 },
+    { NULL, NULL, 0 }
+};
+static struct ent_map default_map = {	/* all chars, 8 bits per octet */
+    NULL,
+    {
+	"00000000", "00000001", "00000010", "00000011",
+	"00000100", "00000101", "00000110", "00000111",
+	"00001000", "00001001", "00001010", "00001011",
+	"00001100", "00001101", "00001110", "00001111",
+	"00010000", "00010001", "00010010", "00010011",
+	"00010100", "00010101", "00010110", "00010111",
+	"00011000", "00011001", "00011010", "00011011",
+	"00011100", "00011101", "00011110", "00011111",
+	"00100000", "00100001", "00100010", "00100011",
+	"00100100", "00100101", "00100110", "00100111",
+	"00101000", "00101001", "00101010", "00101011",
+	"00101100", "00101101", "00101110", "00101111",
+	"00110000", "00110001", "00110010", "00110011",
+	"00110100", "00110101", "00110110", "00110111",
+	"00111000", "00111001", "00111010", "00111011",
+	"00111100", "00111101", "00111110", "00111111",
+	"01000000", "01000001", "01000010", "01000011",
+	"01000100", "01000101", "01000110", "01000111",
+	"01001000", "01001001", "01001010", "01001011",
+	"01001100", "01001101", "01001110", "01001111",
+	"01010000", "01010001", "01010010", "01010011",
+	"01010100", "01010101", "01010110", "01010111",
+	"01011000", "01011001", "01011010", "01011011",
+	"01011100", "01011101", "01011110", "01011111",
+	"01100000", "01100001", "01100010", "01100011",
+	"01100100", "01100101", "01100110", "01100111",
+	"01101000", "01101001", "01101010", "01101011",
+	"01101100", "01101101", "01101110", "01101111",
+	"01110000", "01110001", "01110010", "01110011",
+	"01110100", "01110101", "01110110", "01110111",
+	"01111000", "01111001", "01111010", "01111011",
+	"01111100", "01111101", "01111110", "01111111",
+	"10000000", "10000001", "10000010", "10000011",
+	"10000100", "10000101", "10000110", "10000111",
+	"10001000", "10001001", "10001010", "10001011",
+	"10001100", "10001101", "10001110", "10001111",
+	"10010000", "10010001", "10010010", "10010011",
+	"10010100", "10010101", "10010110", "10010111",
+	"10011000", "10011001", "10011010", "10011011",
+	"10011100", "10011101", "10011110", "10011111",
+	"10100000", "10100001", "10100010", "10100011",
+	"10100100", "10100101", "10100110", "10100111",
+	"10101000", "10101001", "10101010", "10101011",
+	"10101100", "10101101", "10101110", "10101111",
+	"10110000", "10110001", "10110010", "10110011",
+	"10110100", "10110101", "10110110", "10110111",
+	"10111000", "10111001", "10111010", "10111011",
+	"10111100", "10111101", "10111110", "10111111",
+	"11000000", "11000001", "11000010", "11000011",
+	"11000100", "11000101", "11000110", "11000111",
+	"11001000", "11001001", "11001010", "11001011",
+	"11001100", "11001101", "11001110", "11001111",
+	"11010000", "11010001", "11010010", "11010011",
+	"11010100", "11010101", "11010110", "11010111",
+	"11011000", "11011001", "11011010", "11011011",
+	"11011100", "11011101", "11011110", "11011111",
+	"11100000", "11100001", "11100010", "11100011",
+	"11100100", "11100101", "11100110", "11100111",
+	"11101000", "11101001", "11101010", "11101011",
+	"11101100", "11101101", "11101110", "11101111",
+	"11110000", "11110001", "11110010", "11110011",
+	"11110100", "11110101", "11110110", "11110111",
+	"11111000", "11111001", "11111010", "11111011",
+	"11111100", "11111101", "11111110", "11111111"
+    },
+    NULL,
+    NULL,
+    0,
+    {
+	{ V64(0x00), V64(0x40), V64(0x80), V64(0xc0) },
+	{ B64, B64, B64, B64 }
+    },
+    NULL,
+    0,
+    NULL
+};
+static const int hex_to_value[1 << ENT_OCTET_BITS] = {
+    /* 00 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 08 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 10 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 18 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 20 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 28 */	0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 30 */	0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7,
+    /* 38 */    0x8, 0x9, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 40 */    0x0, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf, 0x0,
+    /* 48 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 50 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 58 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 60 */    0x0, 0xA, 0xB, 0xC, 0xD, 0xE, 0xF, 0x0,
+    /* 68 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 70 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 78 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 80 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 88 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 90 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* 98 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* a0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* a8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* b0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* b8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* c0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* c8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* d0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* d8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* e0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* e8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* f0 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+    /* f8 */    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+};
+
+
+/*
+ * ent_alpha - the alphabet seen at each character position
+ *
+ * seen[i] is a bit set of the octets seen at character position i+1:
+ * octet c was seen if seen[i][c/8] has bit (1 << (c%8)) set.
+ */
+#define ALPHA_SET_LEN ((1 << ENT_OCTET_BITS) / ENT_OCTET_BITS)
+struct ent_alpha {
+    unsigned long recnum;		/* records given to ent_alpha_add() */
+    u_int8_t (*seen)[ALPHA_SET_LEN];	/* malloced octet set of each position */
+    int pos_len;			/* positions in seen */
+};
+
+
+/*
+ * forward declarations
+ */
+static int alpha_width(const u_int8_t *set);
+static int alpha_run(const struct ent_alpha *alpha, int first, u_int8_t *run,
+		     int *width);
+static void alpha_write_map(FILE *out, const u_int8_t *set, int width);
+static tally_t *alloc_bittally(int depth);
+static struct bitslice *alloc_bitslice(const struct ent_cfg *cfg, int bitnum);
+static void free_bitslice(struct bitslice *slice);
+static void record_bit(struct bitslice *slice, int value);
+static void record_run(struct bitslice *slice, int value, unsigned long n);
+static int compile_cols(struct ent_map *map);
+static int compile_code(char *const *octet_map, struct ent_code *code);
+static const struct ent_code *col_code(const struct ent_map *map, int pos);
+static int wide_set(struct ent_wide **wp, u_int32_t cp, const char *str);
+static void wide_free(struct ent_wide *w);
+static int utf8_decode(const u_int8_t *inbuf, int inbuf_len, u_int32_t *chr);
+static int utf8_bits(struct ent_ctx *ctx, u_int8_t *inbuf, int inbuf_len);
+static int select_bits(struct ent_ctx *ctx, const u_int8_t *inbuf,
+		       int inbuf_len);
+static int grow_bits(struct ent_ctx *ctx, int need);
+static int mask_bits(struct ent_ctx *ctx, int outbuf_need);
+static int trim_record(const struct ent_cfg *cfg, u_int8_t *inbuf,
+		       int inbuf_len, u_int8_t **start);
+static int find_cookie(const u_int8_t *rec, int len, int *val, int *val_len);
+static int find_field(const struct ent_cfg *cfg, u_int8_t *rec, int len,
+		      u_int8_t **start);
+static int field_delim(const u_int8_t *rec, int len, int num, int sep,
+		       u_int8_t **start);
+static int field_kv(const u_int8_t *rec, int len, const char *key,
+		    u_int8_t **start);
+static int field_json(const u_int8_t *rec, int len, const char *key,
+		      u_int8_t **start);
+static int load_record(struct ent_ctx *ctx, const u_int8_t *rec, int len,
+			u_int8_t **start);
+static int feed_record(struct ent_ctx *ctx, u_int8_t *rec, int len);
+static int grow_slices(struct ent_ctx *ctx, int need);
+static void record_rows(struct ent_ctx *ctx, int rows);
+static int pre_process(struct ent_ctx *ctx, u_int8_t *inbuf, int inbuf_len);
+static void rept_entropy(struct ent_ctx *ctx, int bit_depth, int back_history,
+			 int depth_factor, struct total_ent *overall);
+static void check_converge(struct ent_ctx *ctx);
+static void errmsg(char *errbuf, size_t errlen, const char *fmt, ...);
+static void dbg(int v_flag, int level, const char *fmt, ...);
+
+
+/*
+ * ent_cfg_init - load the default analysis parameters
+ *
+ * given:
+ *	cfg	analysis parameters to initialize
+ */
+void
+ent_cfg_init(struct ent_cfg *cfg)
+{
+    if (cfg == NULL) {
+	return;
+    }
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->bit_depth = ENT_DEF_DEPTH;
+    cfg->back_history = ENT_DEF_HISTORY;
+    cfg->depth_factor = ENT_DEF_DEPTH_FACTOR;
+    cfg->conv_cycle = 0;
+    cfg->block = 0;
+    cfg->text = 0;
+    cfg->keep_newline = 1;
+    cfg->cookie_trim = 0;
+    cfg->field_mode = ENT_FIELD_NONE;
+    cfg->field_num = 1;
+    cfg->field_sep = ',';
+    cfg->v_flag = 0;
+    return;
+}
+
+
+/*
+ * ent_map_load - parse and load a map file
+ *
+ * See the entropic usage string for the map_file syntax.
+ *
+ * given:
+ *	map_file	map filename
+ *	v_flag		debug verbosity level
+ *	errbuf		where to write an error message, or NULL
+ *	errlen		size of errbuf
+ *
+ * returns:
+ *	malloc-ed map, free with ent_map_free(), or NULL on error
+ */
+struct ent_map *
+ent_map_load(const char *map_file, int v_flag, char *errbuf, size_t errlen)
+{
+    struct ent_map *ret;	/* map being loaded */
+    FILE *map;			/* map file stream */
+    char buf[BUFSIZ+1];		/* input buffer */
+    int len;			/* length of input line */
+    int linenum;		/* map file line number */
+    int seen_octet_map;		/* 1 ==> already saw a octet map directive */
+    int octet;			/* octet being mapped */
+    char **cur_map;		/* octet map being loaded */
+    struct ent_wide **cur_wide;	/* code points being loaded */
+    unsigned long cp;		/* code point being mapped */
+    struct ent_cols *cols;	/* expanded column sections */
+    char *end;			/* end of a column number */
+    long first;			/* first position of a column section */
+    long last;			/* last position, 0 ==> no limit */
+    int ok;			/* 0 ==> error found while loading */
+    char *p;
+    int i;
+    int j;
+
+    /*
+     * firewall
+     */
+    if (map_file == NULL) {
+	errmsg(errbuf, errlen, "map_file arg is NULL");
+	errno = EINVAL;
+	return NULL;
+    }
+    buf[BUFSIZ] = '\0';
+
+    /*
+     * allocate the map, starting with the default 8 bit octet map
+     */
+    ret = (struct ent_map *)calloc(1, sizeof(struct ent_map));
+    if (ret == NULL) {
+	errmsg(errbuf, errlen, "failed to malloc map");
+	return NULL;
+    }
+    for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+	ret->octet_map[i] = strdup(default_map.octet_map[i]);
+	if (ret->octet_map[i] == NULL) {
+	    errmsg(errbuf, errlen, "failed to malloc octet map");
+	    ent_map_free(ret);
+	    return NULL;
+	}
+    }
+
+    /*
+     * open the map file
+     */
+    dbg(v_flag, 1, "ent_map_load: opening map file: %s", map_file);
+    map = fopen(map_file, "r");
+    if (map == NULL) {
+	errmsg(errbuf, errlen, "failed to open map file: %s", map_file);
+	ent_map_free(ret);
+	return NULL;
+    }
+
+    /*
+     * read lines until EOF or error
+     */
+    seen_octet_map = 0;
+    cur_map = ret->octet_map;
+    cur_wide = &ret->code.wide;
+    linenum = 0;
+    ok = 1;
+    while (ok && fgets(buf, BUFSIZ, map) != NULL) {
+
+	/*
+	 * remove # comments
+	 */
+	++linenum;
+	p = strchr(buf, '#');
+	if (p != NULL) {
+	    *p = '\0';
+	}
+
+	/*
+	 * remove trailing newline and whitespace
+	 */
+	len = strlen(buf);
+	while (len > 0 && isspace(buf[len-1])) {
+	    buf[len-1] = '\0';
+	    --len;
+	}
+
+	/*
+	 * ignore blank / empty lines
+	 */
+	if (len <= 0) {
+	    continue;
+	}
+	dbg(v_flag, 9, "ent_map_load: line %d: %s", linenum, buf);
+
+	/*
+	 * case: charmask line
+	 */
+	if (strncmp(buf, "charmask=", sizeof("charmask=")-1) == 0) {
+
+	    /*
+	     * must have only one or more x's and c's
+	     */
+	    p = buf + sizeof("charmask=")-1;
+	    dbg(v_flag, 4, "charmask: %s", p);
+	    if (strspn(p, "xc") != len-(sizeof("charmask=")-1)) {
+		errmsg(errbuf, errlen, "map file: %s line %d charmask "
+				       "may only have x's and c's",
+		       map_file, linenum);
+		errno = EINVAL;
+		ok = 0;
+		continue;
+	    }
+
+	    /*
+	     * save charmask
+	     */
+	    if (ret->char_mask != NULL) {
+		free(ret->char_mask);
+	    }
+	    ret->char_mask = strdup(p);
+	    if (ret->char_mask == NULL) {
+		errmsg(errbuf, errlen, "failed to malloc charmask");
+		ok = 0;
+		continue;
+	    }
+
+	/*
+	 * case: bitmask line
+	 */
+	} else if (strncmp(buf, "bitmask=", sizeof("bitmask=")-1) == 0) {
+
+	    /*
+	     * must have only one or more x's and b's
+	     */
+	    p = buf + sizeof("bitmask=")-1;
+	    dbg(v_flag, 4, "bit mask: %s", p);
+	    if (strspn(p, "xb") != len-(sizeof("bitmask=")-1)) {
+		errmsg(errbuf, errlen, "map file: %s line %d bitmask "
+				       "may only have x's and b's",
+		       map_file, linenum);
+		errno = EINVAL;
+		ok = 0;
+		continue;
+	    }
+
+	    /*
+	     * save bitmask
+	     */
+	    if (ret->bit_mask != NULL) {
+		free(ret->bit_mask);
+	    }
+	    ret->bit_mask = strdup(p);
+	    if (ret->bit_mask == NULL) {
+		errmsg(errbuf, errlen, "failed to malloc bitmask");
+		ok = 0;
+		continue;
+	    }
+
+	/*
+	 * case: columns line, start an octet map for a range of positions
+	 */
+	} else if (strncmp(buf, "columns=", sizeof("columns=")-1) == 0) {
+
+	    /*
+	     * add a column section
+	     */
+	    cols = (struct ent_cols *)realloc(ret->cols,
+					      (ret->ncols+1) *
+					      sizeof(struct ent_cols));
+	    if (cols == NULL) {
+		errmsg(errbuf, errlen, "failed to malloc columns");
+		ok = 0;
+		continue;
+	    }
+	    ret->cols = cols;
+	    cols = &ret->cols[ret->ncols++];
+	    memset(cols, 0, sizeof(struct ent_cols));
+
+	    /*
+	     * parse N, N-M or N-
+	     */
+	    p = buf + sizeof("columns=")-1;
+	    dbg(v_flag, 4, "columns: %s", p);
+	    first = strtol(p, &end, 10);
+	    last = first;
+	    if (end == p) {
+		first = 0;	/* force error */
+	    } else if (*end == '-' && end[1] == '\0') {
+		last = 0;
+		++end;
+	    } else if (*end == '-') {
+		p = end+1;
+		last = strtol(p, &end, 10);
+		if (end == p) {
+		    first = 0;	/* force error */
+		}
+	    }
+	    if (*end != '\0' || first < 1 || first > MAX_COLUMN ||
+		last > MAX_COLUMN || (last != 0 && last < first)) {
+		errmsg(errbuf, errlen, "map file: %s line %d columns "
+				       "must be N, N-M or N- with 1 <= N <= M "
+				       "<= %d",
+		       map_file, linenum, MAX_COLUMN);
+		errno = EINVAL;
+		ok = 0;
+		continue;
+	    }
+
+	    /*
+	     * sections may not overlap, sections in error have a first of 0
+	     */
+	    for (i=0; i < ret->ncols-1; ++i) {
+		if (ret->cols[i].first > 0 &&
+		    (ret->cols[i].last == 0 || first <= ret->cols[i].last) &&
+		    (last == 0 || ret->cols[i].first <= last)) {
+		    break;
+		}
+	    }
+	    if (i < ret->ncols-1 && ret->cols[i].last == 0) {
+		errmsg(errbuf, errlen, "map file: %s line %d columns "
+				       "overlap the earlier columns=%d-",
+		       map_file, linenum, ret->cols[i].first);
+		errno = EINVAL;
+		ok = 0;
+		continue;
+	    } else if (i < ret->ncols-1) {
+		errmsg(errbuf, errlen, "map file: %s line %d columns "
+				       "overlap the earlier columns=%d-%d",
+		       map_file, linenum, ret->cols[i].first, ret->cols[i].last);
+		errno = EINVAL;
+		ok = 0;
+		continue;
+	    }
+	    cols->first = (int)first;
+	    cols->last = (int)last;
+
+	    /*
+	     * octets not given in this section yield no bits
+	     */
+	    for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+		cols->octet_map[i] = strdup("");
+		if (cols->octet_map[i] == NULL) {
+		    errmsg(errbuf, errlen, "failed to malloc octet map");
+		    ok = 0;
+		    break;
+		}
+	    }
+	    cur_map = cols->octet_map;
+	    cur_wide = &cols->code.wide;
+
+	/*
+	 * octet map line
+	 */
+	} else if (isxdigit(buf[0]) && isxdigit(buf[1]) && buf[2] == '=') {
+
+	    /*
+	     * clear old octet map if we found our first octet map directive
+	     */
+	    if (seen_octet_map == 0 && cur_map == ret->octet_map) {
+		for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+		    ret->octet_map[i][0] = '\0';
+		}
+		seen_octet_map = 1;
+	    }
+
+	    /*
+	     * determine which octet is being mapped
+	     */
+	    octet = (hex_to_value[(int)buf[0]]<<4) + hex_to_value[(int)buf[1]];
+
+	    /*
+	     * add to octet map
+	     */
+	    free(cur_map[octet]);
+	    cur_map[octet] = strdup(buf+3);
+	    if (cur_map[octet] == NULL) {
+		errmsg(errbuf, errlen, "failed to malloc octet map");
+		ok = 0;
+		continue;
+	    }
+
+	/*
+	 * code point map line, puts the map in UTF-8 mode
+	 */
+	} else if (buf[0] == 'U' && buf[1] == '+' && isxdigit(buf[2])) {
+
+	    /*
+	     * determine which code point is being mapped
+	     */
+	    cp = strtoul(buf+2, &end, 16);
+	    if (*end != '=' || cp > UTF8_MAX ||
+		(cp >= 0xd800 && cp <= 0xdfff)) {
+		errmsg(errbuf, errlen, "map file: %s line %d code point "
+				       "must be U+0000 to U+10FFFF and "
+				       "not a surrogate", map_file, linenum);
+		errno = EINVAL;
+		ok = 0;
+		continue;
+	    }
+	    if (strlen(end+1) > MAX_CODE_BITS) {
+		errmsg(errbuf, errlen, "map file: %s line %d maps to more "
+				       "than %d bits",
+		       map_file, linenum, MAX_CODE_BITS);
+		errno = EINVAL;
+		ok = 0;
+		continue;
+	    }
+	    ret->utf8 = 1;
+
+	    /*
+	     * clear old octet map if we found our first octet map directive
+	     */
+	    if (seen_octet_map == 0 && cur_map == ret->octet_map) {
+		for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+		    ret->octet_map[i][0] = '\0';
+		}
+		seen_octet_map = 1;
+	    }
+
+	    /*
+	     * code points below U+0080 are in the octet map
+	     */
+	    if (cp < 0x80) {
+		free(cur_map[cp]);
+		cur_map[cp] = strdup(end+1);
+		if (cur_map[cp] == NULL) {
+		    errmsg(errbuf, errlen, "failed to malloc octet map");
+		    ok = 0;
+		    continue;
+		}
+	    } else if (wide_set(cur_wide, (u_int32_t)cp, end+1) < 0) {
+		errmsg(errbuf, errlen, "failed to malloc code point map");
+		ok = 0;
+		continue;
+	    }
+
+	/*
+	 * unknown line
+	 */
+	} else {
+	    errmsg(errbuf, errlen, "map file: %s line %d unknown directive",
+		   map_file, linenum);
+	    errno = EINVAL;
+	    ok = 0;
+	    continue;
+	}
+    }
+
+    /*
+     * check for read errors
+     */
+    if (ok && ferror(map)) {
+	errmsg(errbuf, errlen, "error reading map file: %s", map_file);
+	ok = 0;
+    }
+    if (ok && (i = compile_code(ret->octet_map, &ret->code)) >= 0) {
+	errmsg(errbuf, errlen, "map file: %s octet %02x maps to more "
+			       "than %d bits", map_file, i, MAX_CODE_BITS);
+	errno = EINVAL;
+	ok = 0;
+    }
+    for (j=0; ok && j < ret->ncols; ++j) {
+	if ((i = compile_code(ret->cols[j].octet_map,
+			      &ret->cols[j].code)) >= 0) {
+	    errmsg(errbuf, errlen, "map file: %s octet %02x maps to more "
+				   "than %d bits in columns=%d section",
+		   map_file, i, MAX_CODE_BITS, ret->cols[j].first);
+	    errno = EINVAL;
+	    ok = 0;
+	}
+    }
+    if (ok && compile_cols(ret) < 0) {
+	errmsg(errbuf, errlen, "failed to malloc column maps");
+	ok = 0;
+    }
+    if (!ok) {
+	fclose(map);
+	ent_map_free(ret);
+	return NULL;
+    }
+    fclose(map);
+    dbg(v_flag, 4, "ent_map_load: processed %d lines from map file: %s",
+		   linenum, map_file);
+    return ret;
+}
+
+
+/*
+ * ent_map_free - free a map returned by ent_map_load(), ent_map_builtin()
+ *		  or ent_map_select()
+ *
+ * given:
+ *	map	map to free, or NULL
+ */
+void
+ent_map_free(struct ent_map *map)
+{
+    int i;
+    int j;
+
+    if (map == NULL || map == &default_map) {
+	return;
+    }
+    if (map->char_mask != NULL) {
+	free(map->char_mask);
+    }
+    for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+	if (map->octet_map[i] != NULL) {
+	    free(map->octet_map[i]);
+	}
+    }
+    if (map->bit_mask != NULL) {
+	free(map->bit_mask);
+    }
+    wide_free(map->code.wide);
+    for (i=0; i < map->ncols; ++i) {
+	for (j=0; j < 1 << ENT_OCTET_BITS; ++j) {
+	    if (map->cols[i].octet_map[j] != NULL) {
+		free(map->cols[i].octet_map[j]);
+	    }
+	}
+	wide_free(map->cols[i].code.wide);
+    }
+    if (map->cols != NULL) {
+	free(map->cols);
+    }
+    if (map->pos_code != NULL) {
+	free(map->pos_code);
+    }
+    if (map->gather != NULL) {
+	free(map->gather);
+    }
+    free(map);
+    return;
+}
+
+
+/*
+ * ent_map_builtin - return the map of a built-in encoding
+ *
+ * The built-in encodings are:
+ *
+ *	hex	0-9 A-F, 4 bits per character (as hex.map)
+ *	b32	A-Z 0-5, 5 bits per character (as b32.map)
+ *	b32rfc	A-Z 2-7, 5 bits per character (RFC 4648 base32)
+ *	b64	A-Z a-z 0-9 + /, 6 bits per character (as b64.map)
+ *	b64url	A-Z a-z 0-9 - _, 6 bits per character (RFC 4648 base64url)
+ *
+ * Letters of hex, b32 and b32rfc may be in either case.  Characters not
+ * in the encoding, such as = padding, yield no bits.
+ *
+ * given:
+ *	name		encoding name
+ *	errbuf		where to write an error message, or NULL
+ *	errlen		size of errbuf
+ *
+ * returns:
+ *	malloc-ed map, free with ent_map_free(), or NULL on error
+ */
+struct ent_map *
+ent_map_builtin(const char *name, char *errbuf, size_t errlen)
+{
+    const struct builtin_map *b;	/* built-in encoding */
+    struct ent_map *ret;	/* map being built */
+    int width;			/* bits per character */
+    int octet;			/* octet being mapped */
+    int i;
+    int j;
+
+    /*
+     * firewall
+     */
+    if (name == NULL) {
+	errmsg(errbuf, errlen, "name arg is NULL");
+	errno = EINVAL;
+	return NULL;
+    }
+    for (b = builtin_map; b->name != NULL; ++b) {
+	if (strcmp(name, b->name) == 0) {
+	    break;
+	}
+    }
+    if (b->name == NULL) {
+	errmsg(errbuf, errlen, "unknown encoding: %s", name);
+	errno = EINVAL;
+	return NULL;
+    }
+
+    /*
+     * allocate the map, with every octet skipped
+     */
+    ret = (struct ent_map *)calloc(1, sizeof(struct ent_map));
+    if (ret == NULL) {
+	errmsg(errbuf, errlen, "failed to malloc map");
+	return NULL;
+    }
+    for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+	ret->octet_map[i] = (char *)calloc(1, MAX_CODE_BITS+1);
+	if (ret->octet_map[i] == NULL) {
+	    errmsg(errbuf, errlen, "failed to malloc octet map");
+	    ent_map_free(ret);
+	    return NULL;
+	}
+    }
+
+    /*
+     * map each character of the alphabet to its value
+     */
+    width = 0;
+    while ((1 << width) < (int)strlen(b->alphabet)) {
+	++width;
+    }
+    for (i=0; b->alphabet[i] != '\0'; ++i) {
+	octet = (u_int8_t)b->alphabet[i];
+	for (j=0; j < width; ++j) {
+	    ret->octet_map[octet][j] = ((i >> (width-1-j)) & 1) ? '1' : '0';
+	}
+	if (b->fold && isupper(octet)) {
+	    strcpy(ret->octet_map[tolower(octet)], ret->octet_map[octet]);
+	}
+    }
+    (void) compile_code(ret->octet_map, &ret->code);
+    return ret;
+}
+
+
+/*
+ * ent_map_select - return a map that selects octets and bits of binary records
+ *
+ * The select string is a comma separated list of:
+ *
+ *	N	octet N (the 1st octet is 0)
+ *	N-M	octets N thru M
+ *	N-M:K	the low K bits of octets N thru M, as a big-endian number
+ *	bN-M	bits N thru M (bit 0 is the high bit of octet 0)
+ *
+ * N and M may be given in hex as 0x...  For example "16-47,48-49:12"
+ * selects octets 16 thru 47 and the low 12 bits of octets 48 and 49.
+ * The bits selected are processed in record order, whatever the order
+ * of the list.  Octets that are not selected are never expanded into
+ * bits.
+ *
+ * given:
+ *	select		select string
+ *	errbuf		where to write an error message, or NULL
+ *	errlen		size of errbuf
+ *
+ * returns:
+ *	malloc-ed map, free with ent_map_free(), or NULL on error
+ */
+struct ent_map *
+ent_map_select(const char *select, char *errbuf, size_t errlen)
+{
+    struct ent_map *ret;	/* map being built */
+    u_int8_t *mask;		/* malloc-ed mask of each octet */
+    u_int8_t *m;		/* grown mask */
+    int mask_len;		/* octets in mask */
+    const char *p;		/* next item of select */
+    char *end;			/* end of a number */
+    long first;			/* first octet or bit of an item */
+    long last;			/* last octet or bit of an item */
+    long low;			/* N-M:K low bits, 0 ==> all */
+    int bit;			/* 1 ==> bN-M item */
+    int ok;			/* 1 ==> whole select string parsed */
+    long k;			/* bit being selected */
+    int n;
+    int i;
+
+    /*
+     * firewall
+     */
+    if (select == NULL) {
+	errmsg(errbuf, errlen, "select arg is NULL");
+	errno = EINVAL;
+	return NULL;
+    }
+
+    /*
+     * mark the selected bits of each octet
+     */
+    mask = NULL;
+    mask_len = 0;
+    ok = 0;
+    for (p = select; ; p = end+1) {
+
+	/*
+	 * parse N, N-M, N-M:K or bN-M
+	 */
+	bit = (*p == 'b');
+	if (bit) {
+	    ++p;
+	}
+	if (!isdigit((u_int8_t)*p)) {
+	    break;
+	}
+	first = strtol(p, &end, 0);
+	last = first;
+	low = 0;
+	if (*end == '-') {
+	    if (!isdigit((u_int8_t)end[1])) {
+		break;
+	    }
+	    last = strtol(end+1, &end, 0);
+	}
+	if (*end == ':' && !bit) {
+	    if (!isdigit((u_int8_t)end[1])) {
+		break;
+	    }
+	    low = strtol(end+1, &end, 0);
+	    if (low < 1 || low > 8*(last-first+1)) {
+		break;
+	    }
+	}
+	if ((*end != ',' && *end != '\0') || first > last ||
+	    last >= (bit ? 8L*MAX_SELECT : MAX_SELECT)) {
+	    break;
+	}
+
+	/*
+	 * convert to a range of bits
+	 */
+	if (!bit) {
+	    first = (low > 0) ? 8*(last+1) - low : 8*first;
+	    last = 8*last + 7;
+	}
+
+	/*
+	 * mark the bits
+	 */
+	if (last/8 >= mask_len) {
+	    m = (u_int8_t *)realloc(mask, last/8 + 1);
+	    if (m == NULL) {
+		free(mask);
+		errmsg(errbuf, errlen, "failed to malloc select mask");
+		return NULL;
+	    }
+	    memset(m + mask_len, 0, last/8 + 1 - mask_len);
+	    mask = m;
+	    mask_len = last/8 + 1;
+	}
+	for (k=first; k <= last; ++k) {
+	    mask[k/8] |= 0x80 >> (k%8);
+	}
+	if (*end == '\0') {
+	    ok = 1;
+	    break;
+	}
+    }
+    if (!ok) {
+	free(mask);
+	errmsg(errbuf, errlen, "bad select: %s", select);
+	errno = EINVAL;
+	return NULL;
+    }
+
+    /*
+     * gather the octets with selected bits, in offset order
+     */
+    ret = (struct ent_map *)calloc(1, sizeof(struct ent_map));
+    if (ret == NULL) {
+	free(mask);
+	errmsg(errbuf, errlen, "failed to malloc map");
+	return NULL;
+    }
+    for (n=0, i=0; i < mask_len; ++i) {
+	n += (mask[i] != 0);
+    }
+    ret->gather = (struct ent_gather *)malloc(n * sizeof(struct ent_gather));
+    if (ret->gather == NULL) {
+	free(mask);
+	ent_map_free(ret);
+	errmsg(errbuf, errlen, "failed to malloc gather list");
+	return NULL;
+    }
+    for (i=0; i < mask_len; ++i) {
+	if (mask[i] == 0) {
+	    continue;
+	}
+	ret->gather[ret->gather_len].off = i;
+	ret->gather[ret->gather_len].mask = mask[i];
+	++ret->gather_len;
+	for (k = mask[i]; k != 0; k >>= 1) {
+	    ret->gather_bits += (k & 1);
+	}
+    }
+    free(mask);
+    return ret;
+}
+
+
+/*
+ * ent_map_span - octets a record needs to hold every octet a map selects
+ *
+ * given:
+ *	map	map
+ *
+ * returns:
+ *	1 + offset of the last selected octet, 0 ==> not a selection map
+ */
+int
+ent_map_span(const struct ent_map *map)
+{
+    if (map == NULL || map->gather == NULL || map->gather_len <= 0) {
+	return 0;
+    }
+    return map->gather[map->gather_len-1].off + 1;
+}
+
+
+/*
+ * ent_alpha_open - start collecting the alphabet of a sample of records
+ *
+ * returns:
+ *	malloc-ed alphabet, free with ent_alpha_close(), or NULL on error
+ */
+struct ent_alpha *
+ent_alpha_open(void)
+{
+    return (struct ent_alpha *)calloc(1, sizeof(struct ent_alpha));
+}
+
+
+/*
+ * ent_alpha_add - note the octets of a record at each character position
+ *
+ * given:
+ *	alpha	alphabet being collected
+ *	rec	record, already trimmed (see ent_trim())
+ *	len	length of rec in octets
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+int
+ent_alpha_add(struct ent_alpha *alpha, const u_int8_t *rec, int len)
+{
+    u_int8_t (*seen)[ALPHA_SET_LEN];	/* expanded octet sets */
+    int i;
+
+    /*
+     * firewall
+     */
+    if (alpha == NULL || len < 0 || (rec == NULL && len > 0)) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * expand the octet sets for new positions
+     */
+    if (len > alpha->pos_len) {
+	seen = realloc(alpha->seen, len * sizeof(alpha->seen[0]));
+	if (seen == NULL) {
+	    return -1;
+	}
+	memset(seen[alpha->pos_len], 0,
+	       (len - alpha->pos_len) * sizeof(alpha->seen[0]));
+	alpha->seen = seen;
+	alpha->pos_len = len;
+    }
+
+    /*
+     * note each octet
+     */
+    for (i=0; i < len; ++i) {
+	alpha->seen[i][rec[i] / ENT_OCTET_BITS] |= 1 << (rec[i] % ENT_OCTET_BITS);
+    }
+    ++alpha->recnum;
+    return 0;
+}
+
+
+/*
+ * ent_alpha_write - write a dense map file for the alphabet collected
+ *
+ * Each octet seen is given a code of the fewest bits that can tell
+ * the octets apart, in octet order.  A position where only one octet
+ * was seen yields no bits at all.
+ *
+ * When every position has the same alphabet, a plain map is written.
+ * Otherwise, runs of positions whose alphabets can share a code of
+ * the same width are written as columns= sections, the last of which
+ * extends to the end of the record.
+ *
+ * given:
+ *	alpha	alphabet collected
+ *	out	where to write the map file
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+int
+ent_alpha_write(const struct ent_alpha *alpha, FILE *out)
+{
+    u_int8_t run[ALPHA_SET_LEN];	/* union of the alphabets of a run */
+    int first;			/* first position of the run */
+    int width;			/* bits per octet of the run */
+    int runs;			/* number of runs */
+    int i;
+
+    /*
+     * firewall
+     */
+    if (alpha == NULL || out == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * count the runs
+     */
+    runs = 0;
+    for (i=0; i < alpha->pos_len; ++runs) {
+	i = alpha_run(alpha, i, run, &width);
+    }
+
+    /*
+     * write the map
+     */
+    fprintf(out, "# dense map of the alphabet found in %lu records\n",
+		 alpha->recnum);
+    fprintf(out, "#\n# %d character positions, %d column sections\n",
+		 alpha->pos_len, (runs > 1) ? runs : 0);
+    for (i=0; i < alpha->pos_len; ) {
+	first = i;
+	i = alpha_run(alpha, i, run, &width);
+	fputc('\n', out);
+	if (runs > 1) {
+	    if (i < alpha->pos_len) {
+		fprintf(out, "columns=%d-%d\t# %d bits per char\n",
+			first+1, i, width);
+	    } else {
+		fprintf(out, "columns=%d-\t# %d bits per char\n",
+			first+1, width);
+	    }
+	}
+	alpha_write_map(out, run, width);
+    }
+    fflush(out);
+    return ferror(out) ? -1 : 0;
+}
+
+
+/*
+ * ent_alpha_close - free an alphabet
+ *
+ * given:
+ *	alpha	alphabet to free, or NULL
+ */
+void
+ent_alpha_close(struct ent_alpha *alpha)
+{
+    if (alpha == NULL) {
+	return;
+    }
+    if (alpha->seen != NULL) {
+	free(alpha->seen);
+    }
+    free(alpha);
+    return;
+}
+
+
+/*
+ * ent_open - create an entropy analysis context
+ *
+ * given:
+ *	cfg	analysis parameters, NULL ==> defaults from ent_cfg_init()
+ *	map	map to use, NULL ==> all chars, 8 bits per octet
+ *
+ * returns:
+ *	malloc-ed context, free with ent_close(), or NULL on error
+ *
+ * NOTE: The map is not copied.  It must outlive the context.
+ */
+struct ent_ctx *
+ent_open(const struct ent_cfg *cfg, const struct ent_map *map)
+{
+    struct ent_ctx *ret;	/* context being created */
+
+    /*
+     * allocate the context
+     */
+    ret = (struct ent_ctx *)calloc(1, sizeof(struct ent_ctx));
+    if (ret == NULL) {
+	return NULL;
+    }
+    if (cfg == NULL) {
+	ent_cfg_init(&ret->cfg);
+    } else {
+	ret->cfg = *cfg;
+    }
+    ret->map = (map == NULL) ? &default_map : map;
+
+    /*
+     * firewall
+     */
+    if (ret->cfg.bit_depth < 1 || ret->cfg.bit_depth > ENT_MAX_DEPTH ||
+	ret->cfg.back_history < 1 ||
+	ret->cfg.back_history > ENT_MAX_BACK_HISTORY ||
+	ret->cfg.depth_factor < 1 || ret->cfg.conv_cycle < 0 ||
+	ret->cfg.block < 0 || ret->cfg.block > ENT_BATCH) {
+	free(ret);
+	errno = EINVAL;
+	return NULL;
+    }
+
+    /*
+     * allocate record buffer and bit buffer with extra room in each
+     */
+    ret->rec_len = BUFSIZ;
+    ret->rec_buf = (u_int8_t *)malloc(ret->rec_len+1);
+    ret->bit_len = BUFSIZ * ENT_OCTET_BITS;
+    ret->bit_buf = (u_int8_t *)malloc(ret->bit_len+1);
+    if (ret->rec_buf == NULL || ret->bit_buf == NULL) {
+	ent_close(ret);
+	return NULL;
+    }
+
+    /*
+     * setup for overall entropy calculation
+     */
+    ret->overall.high_entropy = INVALID_MAX_ENTROPY;
+    ret->overall.high_bit_cnt = 0;
+    ret->overall.low_entropy = INVALID_MIN_ENTROPY;
+    ret->overall.low_bit_cnt = 0;
+    ret->overall.med_entropy = INVALID_MAX_ENTROPY;
+    return ret;
+}
+
+
+/*
+ * ent_feed - process the next record
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	rec	the raw record, need not be NUL terminated
+ *	len	length of rec in octets
+ *
+ * returns:
+ *	number of bits processed for this record,
+ *	0 ==> the record was skipped (it yields no bits),
+ *	-1 ==> error, errno is set
+ *
+ * NOTE: Every record given counts towards the record number,
+ *	 even when it yields no bits.
+ */
+int
+ent_feed(struct ent_ctx *ctx, const u_int8_t *rec, int len)
+{
+    u_int8_t *p;		/* trimmed record */
+    int val;			/* offset of a cookie value */
+    int val_len;		/* length of a cookie value */
+    int used;			/* octets used by a cookie */
+    int found;			/* cookies found in the record */
+    int total;			/* bits processed for all cookies */
+    int ret;
+
+    /*
+     * firewall
+     */
+    if (ctx == NULL || len < 0 || (rec == NULL && len > 0)) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * copy the record, and trim newline and cookie, if requested
+     */
+    len = load_record(ctx, rec, len, &p);
+    if (len < 0) {
+	return -1;
+    }
+    if (ctx->cfg.cookie_trim != 2) {
+	return feed_record(ctx, p, len);
+    }
+
+    /*
+     * each cookie in the line is a record of its own
+     *
+     * The next cookie is found before a value is pre-processed,
+     * as pre_process() may write just past the end of the value.
+     */
+    found = 0;
+    total = 0;
+    while ((used = find_cookie(p, len, &val, &val_len)) > 0) {
+	ret = feed_record(ctx, p+val, val_len);
+	if (ret < 0) {
+	    return -1;
+	}
+	total += ret;
+	++found;
+	p += used;
+	len -= used;
+    }
+    if (found == 0) {
+	dbg(ctx->cfg.v_flag, 5, "ent_feed: line has no cookies");
+	return feed_record(ctx, p, 0);
+    }
+    return total;
+}
+
+
+/*
+ * ent_feed_batch - process a batch of records
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	rec	rec[i] is the ith raw record, need not be NUL terminated
+ *	len	len[i] is the length of rec[i] in octets
+ *	n	records in the batch, >= 0
+ *
+ * returns:
+ *	number of bits processed for the last record of the batch,
+ *	0 ==> it was skipped (it yields no bits), or the batch is empty,
+ *	-1 ==> error, errno is set
+ *
+ * The tallies are just as if each record were given to ent_feed() in
+ * turn.  Up to ENT_BATCH records at a time are processed stage by
+ * stage: each record is trimmed and pre-processed into a row of bits,
+ * the bitslices are grown once for the widest row, and then the rows
+ * are recorded.  The checks and calls that ent_feed() makes for each
+ * record are made once for the batch.
+ */
+int
+ent_feed_batch(struct ent_ctx *ctx, u_int8_t *const *rec, const int *len,
+	       int n)
+{
+    u_int8_t *p;		/* trimmed record, or grown pack */
+    size_t used;		/* octets of pack used */
+    int rows;			/* rows of bits packed */
+    int wide;			/* bits in the widest row */
+    int ret;
+    int i;
+
+    /*
+     * firewall
+     */
+    if (ctx == NULL || n < 0 || (n > 0 && (rec == NULL || len == NULL))) {
+	errno = EINVAL;
+	return -1;
+    }
+    for (i=0; i < n; ++i) {
+	if (len[i] < 0 || (rec[i] == NULL && len[i] > 0)) {
+	    errno = EINVAL;
+	    return -1;
+	}
+    }
+
+    /*
+     * each cookie is a record of its own, a row is not one a record
+     */
+    if (ctx->cfg.cookie_trim == 2) {
+	for (ret=0, i=0; i < n; ++i) {
+	    ret = ent_feed(ctx, rec[i], len[i]);
+	    if (ret < 0) {
+		return -1;
+	    }
+	}
+	return ret;
+    }
+
+    ret = 0;
+    for (i=0; i < n; i += rows) {
+
+	/*
+	 * pack each record into a row of bits
+	 */
+	used = 0;
+	wide = 0;
+	for (rows=0; rows < ENT_BATCH && i+rows < n && used < PACK_BITS;
+	     ++rows) {
+	    ret = load_record(ctx, rec[i+rows], len[i+rows], &p);
+	    if (ret < 0) {
+		return -1;
+	    }
+	    ret = pre_process(ctx, p, ret);
+	    if (ret < 0) {
+		return -1;
+	    }
+	    if (used + ret > ctx->pack_len) {
+		p = (u_int8_t *)realloc(ctx->pack, 2*ctx->pack_len + ret);
+		if (p == NULL) {
+		    return -1;
+		}
+		ctx->pack = p;
+		ctx->pack_len = 2*ctx->pack_len + ret;
+	    }
+	    if (ret > 0) {
+		memcpy(ctx->pack + used, ctx->bit_buf, ret);
+	    }
+	    ctx->row[rows] = ret;
+	    used += ret;
+	    if (ret > wide) {
+		wide = ret;
+	    }
+	}
+	dbg(ctx->cfg.v_flag, 5, "ent_feed_batch: %d rows of up to %d bits",
+	    rows, wide);
+
+	/*
+	 * bitslices for the widest row, then record the rows
+	 */
+	if (grow_slices(ctx, wide) < 0) {
+	    return -1;
+	}
+	record_rows(ctx, rows);
+    }
+    return ret;
+}
+
+
+/*
+ * ent_feed_run - process a record that repeats count times in a row
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	rec	the raw record, need not be NUL terminated
+ *	len	length of rec in octets
+ *	count	times rec repeats, >= 1
+ *
+ * returns:
+ *	number of bits processed for each record,
+ *	0 ==> the records were skipped (they yield no bits),
+ *	-1 ==> error, errno is set
+ *
+ * The tallies are just as if rec were given to ent_feed() count times.
+ * Once the history of each bit position is full of its one value, the
+ * rest of the records add to the same tally slots, so they are added
+ * in bulk.  Runs of all-zero records in disk images are cheap this way.
+ */
+int
+ent_feed_run(struct ent_ctx *ctx, const u_int8_t *rec, int len,
+	     unsigned long count)
+{
+    unsigned long left;		/* records left to add */
+    unsigned long n;		/* records added before a convergence check */
+    int ret;
+    int i;
+
+    /*
+     * firewall
+     */
+    if (ctx == NULL || count < 1) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * each cookie is a record of its own, the run is not of one record
+     */
+    if (ctx->cfg.cookie_trim == 2) {
+	for (ret=0; count > 0; --count) {
+	    ret = ent_feed(ctx, rec, len);
+	    if (ret < 0) {
+		return -1;
+	    }
+	}
+	return ret;
+    }
+
+    /*
+     * the 1st record finds the bits that every record yields
+     */
+    ret = ent_feed(ctx, rec, len);
+    if (ret <= 0) {
+	if (ret == 0) {
+	    ctx->recnum += count-1;
+	}
+	return ret;
+    }
+
+    /*
+     * add the rest, up to each convergence check
+     */
+    for (left = count-1; left > 0; left -= n) {
+	n = left;
+	if (ctx->cfg.conv_cycle > 0 &&
+	    n > ctx->cfg.conv_cycle - ctx->recnum % ctx->cfg.conv_cycle) {
+	    n = ctx->cfg.conv_cycle - ctx->recnum % ctx->cfg.conv_cycle;
+	}
+	for (i=0; i < ret; ++i) {
+	    record_run(ctx->bits[i], ctx->bit_buf[i], n);
+	}
+	ctx->recnum += n;
+	if (ctx->cfg.conv_cycle > 0 &&
+	    (ctx->recnum % ctx->cfg.conv_cycle) == 0) {
+	    check_converge(ctx);
+	}
+    }
+    return ret;
+}
+
+
+/*
+ * ent_trim - trim the newline and cookie from a record
+ *
+ * Perform the keep_newline and cookie_trim steps of ent_feed() once,
+ * so that the trimmed record may be given to several contexts that
+ * were opened with keep_newline = 1 and cookie_trim = 0.  Such contexts
+ * count a record trimmed to 0 octets just like ent_feed() would have.
+ *
+ * With cookie_trim == 2, only the newline is trimmed.  Use ent_cookie()
+ * to find each cookie of the trimmed record.
+ *
+ * given:
+ *	cfg	analysis parameters (keep_newline, cookie_trim, v_flag)
+ *	rec	record, rec[len] must be writable
+ *	len	length of rec in octets
+ *
+ * returns:
+ *	length of the trimmed record, now at the front of rec,
+ *	0 ==> nothing left or the record is to be discarded
+ */
+int
+ent_trim(const struct ent_cfg *cfg, u_int8_t *rec, int len)
+{
+    u_int8_t *start;		/* start of the trimmed record */
+
+    if (cfg == NULL || rec == NULL || len <= 0) {
+	return 0;
+    }
+    len = trim_record(cfg, rec, len, &start);
+    if (start != rec && len > 0) {
+	memmove(rec, start, len);
+    }
+    rec[len] = '\0';
+    return len;
+}
+
+
+/*
+ * ent_cookie - find the next name=value cookie in a header line
+ *
+ * This is how ent_feed() splits a line when cookie_trim == 2.  The value
+ * starts after the next = and ends at the ; that follows it, or at the
+ * end of the line.  Text without a =, such as HttpOnly, is skipped.
+ *
+ * given:
+ *	rec	rest of the line
+ *	len	length of rec in octets
+ *	val	where to return the offset of the value in rec
+ *	val_len	where to return the length of the value
+ *
+ * returns:
+ *	octets of rec used, up to and including the ; after the value,
+ *	0 ==> no more cookies
+ */
+int
+ent_cookie(const u_int8_t *rec, int len, int *val, int *val_len)
+{
+    if (rec == NULL || val == NULL || val_len == NULL) {
+	return 0;
+    }
+    return find_cookie(rec, len, val, val_len);
+}
+
+
+/*
+ * ent_report - compute the current entropy estimate
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	rept	where to store the report
+ *
+ * returns:
+ *	0 ==> report computed, -1 ==> error, errno is set
+ *
+ * NOTE: An overall estimate that cannot be computed keeps the value
+ *	 from the most recent report that could.
+ */
+int
+ent_report(struct ent_ctx *ctx, struct ent_rept *rept)
+{
+    int i;
+
+    /*
+     * firewall
+     */
+    if (ctx == NULL || rept == NULL) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * compute and copy out the estimate
+     */
+    rept_entropy(ctx, ctx->cfg.bit_depth, ctx->cfg.back_history,
+		 ctx->cfg.depth_factor, &ctx->overall);
+    rept->recnum = ctx->recnum;
+    rept->bits = ctx->bits_len;
+    rept->frozen = 0;
+    for (i=0; i < ctx->bits_len; ++i) {
+	if (ctx->bits[i]->frozen) {
+	    ++rept->frozen;
+	}
+    }
+    rept->high_entropy = ctx->overall.high_entropy;
+    rept->high_bit_cnt = ctx->overall.high_bit_cnt;
+    rept->low_entropy = ctx->overall.low_entropy;
+    rept->low_bit_cnt = ctx->overall.low_bit_cnt;
+    rept->med_entropy = ctx->overall.med_entropy;
+    return 0;
+}
+
+
+/*
+ * ent_report_at - compute an entropy estimate with smaller parameters
+ *
+ * Estimate the entropy as if the context had been opened with the
+ * given bit_depth, back_history and depth_factor.  The tallies of a
+ * context cover every smaller depth and history, so one pass over the
+ * records can be reported under many parameter sets.
+ *
+ * The only difference from a separate run with the smaller parameters
+ * is that tallying started after the warm-up of the context's own,
+ * larger, bit_depth + back_history bits.
+ *
+ * given:
+ *	ctx		entropy analysis context
+ *	bit_depth	1 to the context's bit_depth
+ *	back_history	1 to the context's back_history
+ *	depth_factor	> 0
+ *	rept		where to store the report
+ *
+ * returns:
+ *	0 ==> report computed, -1 ==> error, errno is set
+ *
+ * NOTE: Unlike ent_report(), an estimate that cannot be computed is
+ *	 simply marked invalid in the report.
+ */
+int
+ent_report_at(struct ent_ctx *ctx, int bit_depth, int back_history,
+	      int depth_factor, struct ent_rept *rept)
+{
+    struct total_ent overall;	/* overall estimate */
+    int i;
+
+    /*
+     * firewall
+     */
+    if (ctx == NULL || rept == NULL ||
+	bit_depth < 1 || bit_depth > ctx->cfg.bit_depth ||
+	back_history < 1 || back_history > ctx->cfg.back_history ||
+	depth_factor < 1) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * compute and copy out the estimate
+     */
+    overall.high_entropy = INVALID_MAX_ENTROPY;
+    overall.high_bit_cnt = 0;
+    overall.low_entropy = INVALID_MIN_ENTROPY;
+    overall.low_bit_cnt = 0;
+    overall.med_entropy = INVALID_MAX_ENTROPY;
+    rept_entropy(ctx, bit_depth, back_history, depth_factor, &overall);
+    rept->recnum = ctx->recnum;
+    rept->bits = ctx->bits_len;
+    rept->frozen = 0;
+    for (i=0; i < ctx->bits_len; ++i) {
+	if (ctx->bits[i]->frozen) {
+	    ++rept->frozen;
+	}
+    }
+    rept->high_entropy = overall.high_entropy;
+    rept->high_bit_cnt = overall.high_bit_cnt;
+    rept->low_entropy = overall.low_entropy;
+    rept->low_bit_cnt = overall.low_bit_cnt;
+    rept->med_entropy = overall.med_entropy;
+    return 0;
+}
+
+
+/*
+ * ent_thaw - unfreeze all frozen bitslices
+ *
+ * The history of a frozen bitslice is kept current by record_bit(), so
+ * a thawed bitslice resumes tallying with its very next bit.
+ *
+ * given:
+ *	ctx	entropy analysis context
+ */
+void
+ent_thaw(struct ent_ctx *ctx)
+{
+    struct bitslice *s;		/* bitslice being thawed */
+    int thawed;			/* bitslices thawed */
+    int i;
+
+    if (ctx == NULL) {
+	return;
+    }
+    thawed = 0;
+    for (i=0; i < ctx->bits_len; ++i) {
+	s = ctx->bits[i];
+	if (s->frozen) {
+	    s->frozen = 0;
+	    s->stable = 0;
+	    s->prev_high = INVALID_MAX_ENTROPY;
+	    s->prev_low = INVALID_MIN_ENTROPY;
+	    ++thawed;
+	}
+    }
+    dbg(ctx->cfg.v_flag, 1, "ent_thaw: thawed %d bitslices", thawed);
+    return;
+}
+
+
+/*
+ * ent_reset - return a context to its freshly opened state
+ *
+ * All tallies, histories, estimates and the record count are cleared,
+ * but the bitslices and buffers are kept for reuse.  This is much
+ * cheaper than ent_close() followed by ent_open() when analyzing many
+ * inputs with the same parameters.
+ *
+ * given:
+ *	ctx	entropy analysis context
+ */
+void
+ent_reset(struct ent_ctx *ctx)
+{
+    struct bitslice *s;		/* bitslice being reset */
+    int i;
+    int j;
+
+    if (ctx == NULL) {
+	return;
+    }
+    for (i=0; i < ctx->bits_len; ++i) {
+	s = ctx->bits[i];
+	s->history = 0;
+	s->ops = 0;
+	s->count = 0;
+	for (j=0; j <= ENT_MAX_BACK_HISTORY; ++j) {
+	    s->max_ent[j] = INVALID_MAX_ENTROPY;
+	    s->min_ent[j] = INVALID_MIN_ENTROPY;
+	}
+	s->entropy_high = INVALID_MAX_ENTROPY;
+	s->entropy_low = INVALID_MIN_ENTROPY;
+	s->prev_high = INVALID_MAX_ENTROPY;
+	s->prev_low = INVALID_MIN_ENTROPY;
+	s->stable = 0;
+	s->frozen = 0;
+	for (j=0; j <= s->back_lim; ++j) {
+	    /* keep the tally length in [0] */
+	    memset(s->hist[j]+1, 0, (s->hist[j][0]-1) * sizeof(tally_t));
+	}
+    }
+    ctx->recnum = 0;
+    ctx->overall.high_entropy = INVALID_MAX_ENTROPY;
+    ctx->overall.high_bit_cnt = 0;
+    ctx->overall.low_entropy = INVALID_MIN_ENTROPY;
+    ctx->overall.low_bit_cnt = 0;
+    ctx->overall.med_entropy = INVALID_MAX_ENTROPY;
+    return;
+}
+
+
+/*
+ * ent_restart - start a new, independent stream of records
+ *
+ * The bit histories are forgotten, so no xor difference is formed
+ * between a record of the old stream and a record of the new one.
+ * Tallies and the record count are kept.  Use this between files that
+ * are to be analyzed as one aggregate.
+ *
+ * given:
+ *	ctx	entropy analysis context
+ */
+void
+ent_restart(struct ent_ctx *ctx)
+{
+    int i;
+
+    if (ctx == NULL) {
+	return;
+    }
+    for (i=0; i < ctx->bits_len; ++i) {
+	ctx->bits[i]->history = 0;
+	ctx->bits[i]->ops = 0;
+    }
+    return;
+}
+
+
+/*
+ * ent_merge - add the tallies of one context into another
+ *
+ * The result is as if the records of src had been given to dst as an
+ * independent stream (see ent_restart()).  Both contexts must use the
+ * same bit_depth and back_history.
+ *
+ * given:
+ *	dst	context to add tallies to
+ *	src	context whose tallies are added, src is not changed
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> error, errno is set
+ */
+int
+ent_merge(struct ent_ctx *dst, const struct ent_ctx *src)
+{
+    struct bitslice **bits;	/* expanded bits pointer array */
+    struct bitslice *d;		/* bitslice being added to */
+    struct bitslice *s;		/* bitslice being added from */
+    tally_t len;		/* tally array length */
+    tally_t k;
+    int i;
+    int j;
+
+    /*
+     * firewall
+     */
+    if (dst == NULL || src == NULL || dst == src ||
+	dst->cfg.bit_depth != src->cfg.bit_depth ||
+	dst->cfg.back_history != src->cfg.back_history) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    /*
+     * allocate bitslices for any new bit positions
+     */
+    if (src->bits_len > dst->bits_len) {
+	bits = (struct bitslice **)realloc(dst->bits,
+					   src->bits_len *
+					   sizeof(struct bitslice *));
+	if (bits == NULL) {
+	    return -1;
+	}
+	dst->bits = bits;
+	for (i=dst->bits_len; i < src->bits_len; ++i) {
+	    dst->bits[i] = alloc_bitslice(&dst->cfg, i);
+	    if (dst->bits[i] == NULL) {
+		dst->bits_len = i;
+		return -1;
+	    }
+	}
+	dst->bits_len = src->bits_len;
+    }
+
+    /*
+     * add tallies
+     */
+    for (i=0; i < src->bits_len; ++i) {
+	s = src->bits[i];
+	d = dst->bits[i];
+	if (s->count == 0) {
+	    continue;
+	}
+	for (j=0; j <= s->back_lim; ++j) {
+	    len = s->hist[j][0];
+	    for (k=2; k < len; ++k) {
+		d->hist[j][k] += s->hist[j][k];
+	    }
+	}
+	d->count += s->count;
+    }
+    dst->recnum += src->recnum;
+    return 0;
+}
+
+
+/*
+ * ent_size - octets of memory held by an entropy analysis context
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *
+ * returns:
+ *	octets held by ctx, not counting its map
+ *
+ * Most of it is in the tallies of each bit position of the longest
+ * record so far: (back_history+1) * 2**(bit_depth+1) tallies a bit.
+ */
+size_t
+ent_size(const struct ent_ctx *ctx)
+{
+    size_t slice;	/* octets of a bitslice and its tallies */
+    size_t ret;		/* octets held */
+
+    if (ctx == NULL) {
+	return 0;
+    }
+    slice = sizeof(struct bitslice) + (size_t)(ctx->cfg.back_history+1) *
+	    ((size_t)1 << (ctx->cfg.bit_depth+1)) * sizeof(tally_t);
+    ret = sizeof(struct ent_ctx) + (size_t)ctx->bits_len *
+	  (sizeof(struct bitslice *) + slice);
+    ret += (size_t)ctx->rec_len+1 + (size_t)ctx->bit_len+1;
+    ret += (size_t)ctx->chr_len * sizeof(u_int32_t) + ctx->pack_len;
+    return ret;
+}
+
+
+/*
+ * ent_close - free an entropy analysis context
+ *
+ * given:
+ *	ctx	context to free, or NULL
+ *
+ * NOTE: The map given to ent_open() is not freed.
+ */
+void
+ent_close(struct ent_ctx *ctx)
+{
+    int i;
+
+    if (ctx == NULL) {
+	return;
+    }
+    for (i=0; i < ctx->bits_len; ++i) {
+	free_bitslice(ctx->bits[i]);
+    }
+    if (ctx->bits != NULL) {
+	free(ctx->bits);
+    }
+    if (ctx->rec_buf != NULL) {
+	free(ctx->rec_buf);
+    }
+    if (ctx->bit_buf != NULL) {
+	free(ctx->bit_buf);
+    }
+    if (ctx->chr_buf != NULL) {
+	free(ctx->chr_buf);
+    }
+    if (ctx->pack != NULL) {
+	free(ctx->pack);
+    }
+    free(ctx);
+    return;
+}
+
+
+/*
+ * alloc_bittally - allocate and initialize the tally array for a bit
+ *
+ * given:
+ *	depth	tally depth, in bits
+ *
+ * returns:
+ *	pointer to allocated and initialized tally array or NULL on error
+ *
+ * The tally array layout:
+ *
+ *	length in values		(1 value)
+ *	unused				(1 value)
+ *	tally for depth of 1 bit	(2 values)
+ *	tally for depth of 2 bits	(4 values)
+ *	tally for depth of 3 bits	(8 values)
+ *	...
+ *	tally for depth of 'depth' bits	(2**depth values)
+ *
+ * The total size of the bitslice array is 2**(depth+1) values.
+ *
+ * The bitslice array is initialized to 0 values.
+ */
+static tally_t *
+alloc_bittally(int depth)
+{
+    tally_t *ret;	/* allocated bitslice tally layout */
+    size_t values;	/* number of values in tally array */
+
+    /*
+     * firewall
+     */
+    if (depth < 1 || depth > ENT_MAX_DEPTH) {
+	errno = EINVAL;
+	return NULL;
+    }
+    values = ((size_t)1 << (depth+1));
+
+    /*
+     * allocate and zero
+     */
+    ret = (tally_t *)calloc(values, sizeof(tally_t));
+    if (ret == NULL) {
+	return NULL;
+    }
+
+    /*
+     * record tally length
+     */
+    ret[0] = values;
+
+    /*
+     * return tally array
+     */
+    return ret;
+}
+
+
+/*
+ * alloc_bitslice - allocate and initialize all values given bit position
+ *
+ * given:
+ *	cfg		analysis parameters
+ *	bitnum		bit number in record for which we are allocating
+ *
+ * returns:
+ *	pointer to allocated and initialized bitslice or NULL on error
+ */
+static struct bitslice *
+alloc_bitslice(const struct ent_cfg *cfg, int bitnum)
+{
+    struct bitslice *ret;		/* bit position table */
+    int i;
+
+    /*
+     * allocate the bitslice
+     */
+    ret = (struct bitslice *)calloc(1, sizeof(struct bitslice));
+    if (ret == NULL) {
+	return NULL;
+    }
+
+    /*
+     * initialize bitslice
+     */
+    ret->bitnum = bitnum;
+    ret->history = 0;
+    ret->ops = 0;
+    ret->count = 0;
+    ret->back_lim = cfg->back_history;
+    ret->depth_lim = cfg->bit_depth;
+
+    /*
+     * clear entropy estimates
+     */
+    for (i=0; i <= ENT_MAX_BACK_HISTORY; ++i) {
+	ret->max_ent[i] = INVALID_MAX_ENTROPY;
+	ret->min_ent[i] = INVALID_MIN_ENTROPY;
+    }
+    ret->entropy_high = INVALID_MAX_ENTROPY;
+    ret->entropy_low = INVALID_MIN_ENTROPY;
+    ret->prev_high = INVALID_MAX_ENTROPY;
+    ret->prev_low = INVALID_MIN_ENTROPY;
+    ret->stable = 0;
+    ret->frozen = 0;
+
+    /*
+     * allocate tally tables for past xor differences
+     */
+    for (i=0; i <= ret->back_lim; ++i) {
+	ret->hist[i] = alloc_bittally(ret->depth_lim);
+	if (ret->hist[i] == NULL) {
+	    free_bitslice(ret);
+	    return NULL;
+	}
+    }
+
+    /*
+     * return bitslice
+     */
+    return ret;
+}
+
+
+/*
+ * free_bitslice - free a bitslice and its tally arrays
+ *
+ * given:
+ *	slice	bitslice to free, or NULL
+ */
+static void
+free_bitslice(struct bitslice *slice)
+{
+    int i;
+
+    if (slice == NULL) {
+	return;
+    }
+    for (i=0; i <= ENT_MAX_BACK_HISTORY; ++i) {
+	if (slice->hist[i] != NULL) {
+	    free(slice->hist[i]);
+	}
+    }
+    free(slice);
+    return;
+}
+
+
+/*
+ * record_bit - record and tally a bit value for a given bitslice
+ *
+ * given:
+ *	slice	bitslice record for a given bit position in our records
+ *	value	next value for the given bit position (0 or 1)
+ */
+static void
+record_bit(struct bitslice *slice, int value)
+{
+    int depth;		/* bit depth being processed */
+    int back;		/* number of bits going back into history */
+    u_int32_t offset;	/* tally array offset */
+    u_int32_t cur;	/* current bit values (for a given depth), xor-ed */
+    u_int32_t past;	/* bit values going back into history */
+
+    /*
+     * push the value onto the history
+     *
+     * The new value is shifted into the 0th bit position of our history.
+     * Bit values are either 0 and 1 (non-zero).
+     */
+    slice->history <<= 1;
+    if (value != 0) {
+	slice->history |= 1;
+    }
+
+    /*
+     * A frozen slice has converged: keep its history current, but
+     * do not tally.
+     */
+    if (slice->frozen) {
+	++slice->ops;
+	return;
+    }
+
+    /*
+     * We do not do anything if we lack a full history.  We want to
+     * be sure that slice->history is full of bit values from actual
+     * records.  Count the bit that we just recorded.
+     */
+    if (++slice->ops < slice->back_lim+slice->depth_lim) {
+	return;
+    }
+    ++slice->count;
+
+    /*
+     * process just the values
+     */
+    for (depth=1, offset=2; depth <= slice->depth_lim; ++depth, offset <<= 1) {
+
+	/* get the i-depth value - (offset-1) is an i-bit mask of 1's */
+	cur = (u_int32_t)slice->history & (offset-1);
+
+	/* tally the i-depth value - no x-or with history in the 0 case */
+	++slice->hist[0][offset + cur];
+
+	/* tally the i-depth value xor-ed with previous history */
+	for (back=1; back <= slice->back_lim; ++back) {
+
+	    /* get the i-depth value going back in history h bits */
+	    past = (u_int32_t)(slice->history >> back) & (offset-1);
+
+	    /* tally the i-depth value xor-ed with history back h bits */
+	    ++slice->hist[back][offset + (cur^past)];
+	}
+    }
+    return;
+}
+
+
+/*
+ * record_run - record and tally a bit value n times for a given bitslice
+ *
+ * given:
+ *	slice	bitslice record for a given bit position in our records
+ *	value	next value for the given bit position (0 or 1)
+ *	n	times the value is recorded
+ *
+ * The same as n calls of record_bit().  Once back_lim+depth_lim values
+ * are recorded, each i-depth value is all value bits and each xor with
+ * history is 0, so the rest are tallied n at a time.
+ */
+static void
+record_run(struct bitslice *slice, int value, unsigned long n)
+{
+    int depth;		/* bit depth being processed */
+    int back;		/* number of bits going back into history */
+    u_int32_t offset;	/* tally array offset */
+    u_int32_t cur;	/* current bit values (for a given depth) */
+    unsigned long full;	/* values until the history is all value */
+
+    /*
+     * record one at a time until the history used is all value
+     */
+    full = (unsigned long)(slice->back_lim + slice->depth_lim);
+    for (; n > 0 && full > 0; --n, --full) {
+	record_bit(slice, value);
+    }
+    if (n == 0) {
+	return;
+    }
+
+    /*
+     * shift the rest onto the history
+     */
+    if (n >= ENT_MAX_HISTORY_BITS) {
+	slice->history = (value != 0) ? ~0UL : 0UL;
+    } else {
+	slice->history <<= n;
+	if (value != 0) {
+	    slice->history |= (1UL << n) - 1;
+	}
+    }
+    slice->ops += n;
+    if (slice->frozen) {
+	return;
+    }
+    slice->count += n;
+
+    /*
+     * tally them in bulk
+     */
+    for (depth=1, offset=2; depth <= slice->depth_lim; ++depth, offset <<= 1) {
+	cur = (value != 0) ? offset-1 : 0;
+	slice->hist[0][offset + cur] += n;
+	for (back=1; back <= slice->back_lim; ++back) {
+	    slice->hist[back][offset] += n;
+	}
+    }
+    return;
+}
+
+
+/*
+ * alpha_width - bits needed to tell apart the octets of an octet set
+ *
+ * given:
+ *	set	octet set
+ *
+ * returns:
+ *	bits needed, 0 ==> no more than 1 octet in the set
+ */
+static int
+alpha_width(const u_int8_t *set)
+{
+    int n;			/* octets in set */
+    int width;			/* bits needed */
+    int i;
+
+    n = 0;
+    for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+	if (set[i / ENT_OCTET_BITS] & (1 << (i % ENT_OCTET_BITS))) {
+	    ++n;
+	}
+    }
+    for (width=0; (1 << width) < n; ++width) {
+    }
+    return width;
+}
+
+
+/*
+ * alpha_run - find a run of positions that can share one octet map
+ *
+ * A position joins the run when its own alphabet needs as many bits
+ * as the run does, and so does the union of the two.  No position in
+ * a run needs more bits than it would by itself.  Positions with a
+ * single octet need no bits, so they all map their octet to no bits
+ * and always share a run.
+ *
+ * given:
+ *	alpha	alphabet collected
+ *	first	first position of the run, 0 ==> 1st character
+ *	run	where to store the union of the alphabets of the run
+ *	width	where to store the bits per octet of the run
+ *
+ * returns:
+ *	position just beyond the run
+ */
+static int
+alpha_run(const struct ent_alpha *alpha, int first, u_int8_t *run, int *width)
+{
+    u_int8_t set[ALPHA_SET_LEN];	/* union with the next position */
+    int i;
+    int j;
+
+    memcpy(run, alpha->seen[first], ALPHA_SET_LEN);
+    *width = alpha_width(run);
+    for (i=first+1; i < alpha->pos_len; ++i) {
+	for (j=0; j < ALPHA_SET_LEN; ++j) {
+	    set[j] = run[j] | alpha->seen[i][j];
+	}
+	if (alpha_width(alpha->seen[i]) != *width ||
+	    (*width > 0 && alpha_width(set) != *width)) {
+	    break;
+	}
+	memcpy(run, set, ALPHA_SET_LEN);
+    }
+    return i;
+}
+
+
+/*
+ * alpha_write_map - write the octet map lines for an octet set
+ *
+ * given:
+ *	out	where to write
+ *	set	octet set
+ *	width	bits per octet, 0 ==> every octet yields no bits
+ */
+static void
+alpha_write_map(FILE *out, const u_int8_t *set, int width)
+{
+    int code;			/* code of the next octet */
+    int i;
+    int b;
+
+    code = 0;
+    for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+	if ((set[i / ENT_OCTET_BITS] & (1 << (i % ENT_OCTET_BITS))) == 0) {
+	    continue;
+	}
+	fprintf(out, "%02x=", i);
+	for (b=width-1; b >= 0; --b) {
+	    fputc((code & (1 << b)) ? '1' : '0', out);
+	}
+	if (isgraph(i)) {
+	    fprintf(out, "\t# '%c'\n", i);
+	} else {
+	    fputc('\n', out);
+	}
+	++code;
+    }
+    return;
+}
+
+
+/*
+ * compile_code - compile an octet map for decoding
+ *
+ * given:
+ *	octet_map	octet map to compile
+ *	code		where to compile it
+ *
+ * returns:
+ *	-1 ==> OK, else the octet whose entry is longer than MAX_CODE_BITS
+ */
+static int
+compile_code(char *const *octet_map, struct ent_code *code)
+{
+    const char *q;		/* octet map entry */
+    int i;
+
+    for (i=0; i < 1 << ENT_OCTET_BITS; ++i) {
+	if (strlen(octet_map[i]) > MAX_CODE_BITS) {
+	    return i;
+	}
+	code->val[i] = 0;
+	code->bits[i] = 0;
+	for (q = octet_map[i]; *q != '\0'; ++q) {
+	    /* 1 for every '1' and 0 otherwise */
+	    code->val[i] = (code->val[i] << 1) | (*q == '1');
+	    ++code->bits[i];
+	}
+    }
+    return -1;
+}
+
+
+/*
+ * compile_cols - compile column sections into per-position codes
+ *
+ * Column sections do not overlap.  Positions not in any section use
+ * the octet_map.
+ *
+ * given:
+ *	map	map with cols loaded and compiled
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> malloc error
+ */
+static int
+compile_cols(struct ent_map *map)
+{
+    struct ent_cols *c;		/* column section */
+    int i;
+    int j;
+
+    /*
+     * nothing to do without column sections
+     */
+    if (map->ncols <= 0) {
+	return 0;
+    }
+
+    /*
+     * positions past the last start or end of a section are all alike
+     */
+    map->pos_len = 0;
+    for (i=0; i < map->ncols; ++i) {
+	c = &map->cols[i];
+	if (c->last > map->pos_len) {
+	    map->pos_len = c->last;
+	}
+	if (c->first > map->pos_len) {
+	    map->pos_len = c->first;
+	}
+    }
+    map->pos_code = (const struct ent_code **)
+		    malloc(map->pos_len * sizeof(struct ent_code *));
+    if (map->pos_code == NULL) {
+	return -1;
+    }
+
+    /*
+     * each position uses the section that covers it
+     */
+    for (j=0; j < map->pos_len; ++j) {
+	map->pos_code[j] = &map->code;
+    }
+    map->tail_code = &map->code;
+    for (i=0; i < map->ncols; ++i) {
+	c = &map->cols[i];
+	for (j=c->first-1; j < map->pos_len && (c->last == 0 || j < c->last);
+	     ++j) {
+	    map->pos_code[j] = &c->code;
+	}
+	if (c->last == 0) {
+	    map->tail_code = &c->code;
+	}
+    }
+    return 0;
+}
+
+
+/*
+ * col_code - return the code of a character position
+ *
+ * given:
+ *	map	map being used
+ *	pos	character position after the char_mask, 0 ==> 1st character
+ *
+ * returns:
+ *	code to use for the character
+ */
+static inline const struct ent_code *
+col_code(const struct ent_map *map, int pos)
+{
+    if (map->pos_code == NULL) {
+	return &map->code;
+    }
+    return (pos < map->pos_len) ? map->pos_code[pos] : map->tail_code;
+}
+
+
+/*
+ * wide_set - set the code of a code point >= U+0080
+ *
+ * given:
+ *	wp	pointer to the trie of a code, *wp == NULL ==> empty trie
+ *	cp	code point, U+0080 to U+10FFFF
+ *	str	string of "0"'s and "1"'s, at most MAX_CODE_BITS long
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> malloc error
+ */
+static int
+wide_set(struct ent_wide **wp, u_int32_t cp, const char *str)
+{
+    struct ent_wide *w = *wp;	/* trie being set */
+    int (*mid)[WIDE_NODE];	/* grown mid nodes */
+    struct wide_leaf *leaf;	/* grown leaf nodes */
+    int m;			/* mid node of cp */
+    int l;			/* leaf node of cp */
+    int i;
+
+    /*
+     * start with only the empty nodes
+     */
+    if (w == NULL) {
+	w = (struct ent_wide *)calloc(1, sizeof(struct ent_wide));
+	if (w == NULL) {
+	    return -1;
+	}
+	w->mid = (int (*)[WIDE_NODE])calloc(1, sizeof(*w->mid));
+	w->leaf = (struct wide_leaf *)calloc(1, sizeof(struct wide_leaf));
+	if (w->mid == NULL || w->leaf == NULL) {
+	    wide_free(w);
+	    return -1;
+	}
+	w->nmid = 1;
+	w->nleaf = 1;
+	*wp = w;
+    }
+
+    /*
+     * find or add the mid node and leaf node of the code point
+     */
+    m = w->root[cp >> 12];
+    if (m == 0) {
+	mid = (int (*)[WIDE_NODE])realloc(w->mid,
+					  (w->nmid+1) * sizeof(*w->mid));
+	if (mid == NULL) {
+	    return -1;
+	}
+	w->mid = mid;
+	memset(w->mid[w->nmid], 0, sizeof(*w->mid));
+	m = w->root[cp >> 12] = w->nmid++;
+    }
+    l = w->mid[m][(cp >> 6) & (WIDE_NODE-1)];
+    if (l == 0) {
+	leaf = (struct wide_leaf *)realloc(w->leaf, (w->nleaf+1) *
+						    sizeof(struct wide_leaf));
+	if (leaf == NULL) {
+	    return -1;
+	}
+	w->leaf = leaf;
+	memset(&w->leaf[w->nleaf], 0, sizeof(struct wide_leaf));
+	l = w->mid[m][(cp >> 6) & (WIDE_NODE-1)] = w->nleaf++;
+    }
+
+    /*
+     * 1 for every '1' and 0 otherwise
+     */
+    i = cp & (WIDE_NODE-1);
+    w->leaf[l].val[i] = 0;
+    w->leaf[l].bits[i] = 0;
+    for (; *str != '\0'; ++str) {
+	w->leaf[l].val[i] = (w->leaf[l].val[i] << 1) | (*str == '1');
+	++w->leaf[l].bits[i];
+    }
+    return 0;
+}
+
+
+/*
+ * wide_free - free a code point trie
+ *
+ * given:
+ *	w	trie to free, or NULL
+ */
+static void
+wide_free(struct ent_wide *w)
+{
+    if (w == NULL) {
+	return;
+    }
+    if (w->mid != NULL) {
+	free(w->mid);
+    }
+    if (w->leaf != NULL) {
+	free(w->leaf);
+    }
+    free(w);
+    return;
+}
+
+
+/*
+ * chr_code - return the code of a character
+ *
+ * given:
+ *	code	code of the character position
+ *	chr	code point, or UTF8_BAD
+ *	val	where to return the value of the bits
+ *
+ * returns:
+ *	number of bits, 0 ==> character is skipped
+ */
+static inline int
+chr_code(const struct ent_code *code, u_int32_t chr, u_int32_t *val)
+{
+    const struct wide_leaf *leaf;	/* leaf node of chr */
+
+    if (chr < 0x80) {
+	*val = code->val[chr];
+	return code->bits[chr];
+    }
+    if (code->wide == NULL || chr > UTF8_MAX) {
+	return 0;
+    }
+    leaf = &code->wide->leaf[code->wide->mid[code->wide->root[chr >> 12]]
+					    [(chr >> 6) & (WIDE_NODE-1)]];
+    *val = leaf->val[chr & (WIDE_NODE-1)];
+    return leaf->bits[chr & (WIDE_NODE-1)];
+}
+
+
+/*
+ * utf8_decode - validate and decode a UTF-8 record into code points
+ *
+ * Runs of ASCII are found 8 octets at a time.  Overlong forms,
+ * surrogates and code points beyond U+10FFFF are not valid UTF-8.
+ * An octet that does not start a valid sequence is decoded as UTF8_BAD
+ * and decoding resumes with the next octet.
+ *
+ * given:
+ *	inbuf		record to decode
+ *	inbuf_len	length of the record in octets
+ *	chr		where to store the code points, inbuf_len long
+ *
+ * returns:
+ *	number of code points stored
+ */
+static int
+utf8_decode(const u_int8_t *inbuf, int inbuf_len, u_int32_t *chr)
+{
+    u_int64_t word;		/* 8 octets of inbuf */
+    u_int32_t cp;		/* code point being decoded */
+    u_int32_t min;		/* smallest code point of the sequence length */
+    int need;			/* continuation octets in the sequence */
+    int n;			/* code points stored */
+    int i;
+    int j;
+
+    n = 0;
+    i = 0;
+    while (i < inbuf_len) {
+
+	/*
+	 * copy runs of ASCII
+	 */
+	while (i+8 <= inbuf_len) {
+	    memcpy(&word, inbuf+i, sizeof(word));
+	    if (word & 0x8080808080808080ULL) {
+		break;
+	    }
+	    for (j=0; j < 8; ++j) {
+		chr[n++] = inbuf[i+j];
+	    }
+	    i += 8;
+	}
+	if (i >= inbuf_len) {
+	    break;
+	}
+	if (inbuf[i] < 0x80) {
+	    chr[n++] = inbuf[i++];
+	    continue;
+	}
+
+	/*
+	 * decode a multi-octet sequence
+	 */
+	if (inbuf[i] >= 0xc2 && inbuf[i] <= 0xdf) {
+	    need = 1;
+	    cp = inbuf[i] & 0x1f;
+	    min = 0x80;
+	} else if (inbuf[i] >= 0xe0 && inbuf[i] <= 0xef) {
+	    need = 2;
+	    cp = inbuf[i] & 0x0f;
+	    min = 0x800;
+	} else if (inbuf[i] >= 0xf0 && inbuf[i] <= 0xf4) {
+	    need = 3;
+	    cp = inbuf[i] & 0x07;
+	    min = 0x10000;
+	} else {
+	    need = inbuf_len;	/* not a start octet */
+	    cp = 0;
+	    min = 0;
+	}
+	if (i+need >= inbuf_len) {
+	    chr[n++] = UTF8_BAD;
+	    ++i;
+	    continue;
+	}
+	for (j=1; j <= need; ++j) {
+	    if ((inbuf[i+j] & 0xc0) != 0x80) {
+		break;
+	    }
+	    cp = (cp << 6) | (inbuf[i+j] & 0x3f);
+	}
+	if (j <= need || cp < min || cp > UTF8_MAX ||
+	    (cp >= 0xd800 && cp <= 0xdfff)) {
+	    chr[n++] = UTF8_BAD;
+	    ++i;
+	    continue;
+	}
+	chr[n++] = cp;
+	i += need+1;
+    }
+    return n;
+}
+
+
+/*
+ * utf8_bits - convert a trimmed UTF-8 record into bit values
+ *
+ * The record is decoded into ctx->chr_buf, the char_mask is applied
+ * to its characters, and the code of each character is loaded into
+ * ctx->bit_buf.
+ *
+ * given:
+ *	ctx		entropy analysis context
+ *	inbuf		trimmed record
+ *	inbuf_len	length of the trimmed record in octets
+ *
+ * returns:
+ *	the amount of bit_buf used, or -1 ==> error
+ */
+static int
+utf8_bits(struct ent_ctx *ctx, u_int8_t *inbuf, int inbuf_len)
+{
+    const struct ent_map *map = ctx->map;	/* map being used */
+    int v_flag = ctx->cfg.v_flag;	/* debug verbosity level */
+    u_int32_t *chr;		/* decoded characters */
+    int chr_len;		/* number of decoded characters */
+    int outbuf_need;		/* amount of outbuf we will use */
+    u_int32_t v;		/* value of a character's code */
+    int n;			/* bits of a character's code left to load */
+    u_int8_t *r;
+    int i;
+
+    /*
+     * decode, there is at most one character per octet
+     */
+    if (ctx->chr_len < inbuf_len) {
+	chr = (u_int32_t *)realloc(ctx->chr_buf, inbuf_len * sizeof(u_int32_t));
+	if (chr == NULL) {
+	    return -1;
+	}
+	ctx->chr_buf = chr;
+	ctx->chr_len = inbuf_len;
+    }
+    chr = ctx->chr_buf;
+    chr_len = utf8_decode(inbuf, inbuf_len, chr);
+    dbg(v_flag, 7, "utf8_bits: %d octets decoded into %d characters",
+	   inbuf_len, chr_len);
+
+    /*
+     * character mask, if requested
+     */
+    if (map->char_mask != NULL) {
+	for (n=0, i=0; i < chr_len && map->char_mask[i] != '\0'; ++i) {
+	    if (map->char_mask[i] == 'c') {
+		chr[n++] = chr[i];
+	    }
+	}
+	chr_len = n;
+	dbg(v_flag, 7, "utf8_bits: char_mask kept %d characters", chr_len);
+    }
+
+    /*
+     * determine how many bits we will produce
+     */
+    outbuf_need = 0;
+    for (i=0; i < chr_len; ++i) {
+	outbuf_need += chr_code(col_code(map, i), chr[i], &v);
+    }
+    if (outbuf_need <= 0) {
+	dbg(v_flag, 5, "utf8_bits: line will yield no bits");
+	return 0;
+    }
+    if (grow_bits(ctx, outbuf_need) < 0) {
+	return -1;
+    }
+
+    /*
+     * load output buffer with 0x00's and 0x01's
+     */
+    r = ctx->bit_buf;
+    for (i=0; i < chr_len; ++i) {
+	for (n = chr_code(col_code(map, i), chr[i], &v); n > 0; --n) {
+	    *r++ = (v >> (n-1)) & 0x01;
+	}
+    }
+    *r = '\0';
+    return outbuf_need;
+}
+
+
+/*
+ * load_record - copy a record into the context and trim it
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	rec	the raw record, need not be NUL terminated
+ *	len	length of rec in octets, >= 0
+ *	start	where to return the start of the trimmed record
+ *
+ * returns:
+ *	length of the trimmed record at *start, within ctx->rec_buf,
+ *	-1 ==> malloc error
+ */
+static int
+load_record(struct ent_ctx *ctx, const u_int8_t *rec, int len,
+	    u_int8_t **start)
+{
+    u_int8_t *p;
+
+    /*
+     * copy the record so that pre-processing may alter it
+     */
+    if (len > ctx->rec_len) {
+	p = (u_int8_t *)realloc(ctx->rec_buf, len+1);
+	if (p == NULL) {
+	    return -1;
+	}
+	ctx->rec_buf = p;
+	ctx->rec_len = len;
+    }
+    if (len > 0) {
+	memcpy(ctx->rec_buf, rec, len);
+    }
+    ctx->rec_buf[len] = '\0';
+    if (ctx->cfg.text) {
+	dbg(ctx->cfg.v_flag, 10, "initial inbuf pre newline trim: ((%s))",
+	    ctx->rec_buf);
+    }
+
+    /*
+     * trim newline and cookie, if requested
+     */
+    return trim_record(&ctx->cfg, ctx->rec_buf, len, start);
+}
+
+
+/*
+ * feed_record - process a trimmed record
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	rec	trimmed record within ctx->rec_buf
+ *	len	length of rec in octets
+ *
+ * returns:
+ *	number of bits processed for this record,
+ *	0 ==> the record was skipped (it yields no bits),
+ *	-1 ==> error, errno is set
+ */
+static int
+feed_record(struct ent_ctx *ctx, u_int8_t *rec, int len)
+{
+    int bit_buf_used;		/* number of octets in bit_buf being used */
+    int i;
+
+    /*
+     * pre-process raw record and produce a bit buffer
+     */
+    bit_buf_used = pre_process(ctx, rec, len);
+    ++ctx->recnum;
+    if (bit_buf_used <= 0) {
+	return bit_buf_used;
+    }
+    dbg(ctx->cfg.v_flag, 5, "ent_feed: bit buffer has %d bits", bit_buf_used);
+
+    /*
+     * allocate bitslices for any new bit positions
+     */
+    if (grow_slices(ctx, bit_buf_used) < 0) {
+	return -1;
+    }
+
+    /*
+     * record bit values for this record
+     */
+    for (i=0; i < bit_buf_used; ++i) {
+	record_bit(ctx->bits[i], ctx->bit_buf[i]);
+    }
+
+    /*
+     * freeze bitslices, if needed
+     */
+    if (ctx->cfg.conv_cycle > 0 && (ctx->recnum % ctx->cfg.conv_cycle) == 0) {
+	check_converge(ctx);
+    }
+    return bit_buf_used;
+}
+
+
+/*
+ * grow_slices - be sure there is a bitslice for a number of bit positions
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	need	number of bit positions
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> malloc error
+ */
+static int
+grow_slices(struct ent_ctx *ctx, int need)
+{
+    struct bitslice **bits;	/* expanded bits pointer array */
+    int i;
+
+    if (need <= ctx->bits_len) {
+	return 0;
+    }
+
+    /*
+     * expand or create bits pointer array
+     */
+    if (ctx->bits == NULL) {
+	dbg(ctx->cfg.v_flag, 2, "creating bits up thru %d", need);
+    } else {
+	dbg(ctx->cfg.v_flag, 2, "expanding bits from %d bits to %d bits",
+	    ctx->bits_len, need);
+    }
+    bits = (struct bitslice **)realloc(ctx->bits,
+				       need * sizeof(struct bitslice *));
+    if (bits == NULL) {
+	return -1;
+    }
+    ctx->bits = bits;
+
+    /*
+     * create new bitslices for the new bits
+     */
+    for (i=ctx->bits_len; i < need; ++i) {
+	ctx->bits[i] = alloc_bitslice(&ctx->cfg, i);
+	if (ctx->bits[i] == NULL) {
+	    ctx->bits_len = i;
+	    return -1;
+	}
+    }
+    ctx->bits_len = need;
+    return 0;
+}
+
+
+/*
+ * record_rows - record the rows of bits packed by ent_feed_batch()
+ *
+ * given:
+ *	ctx	entropy analysis context, with a bitslice for each bit
+ *		of the widest row
+ *	rows	rows in ctx->pack, each ctx->row[i] bits long
+ *
+ * Each row is a record, recorded in turn as feed_record() would.
+ *
+ * With cfg.block, the rows are recorded a block at a time instead:
+ * bit i of every row in the block is recorded in bitslice i, then bit
+ * i+1 in bitslice i+1, and so on.  A bitslice sees the same values in
+ * the same order either way.  A block ends with a record that checks
+ * convergence, so the bitslices are frozen just as record by record.
+ */
+static void
+record_rows(struct ent_ctx *ctx, int rows)
+{
+    const u_int8_t *p = ctx->pack;	/* bits of the next row */
+    size_t off[ENT_BATCH];	/* where each row starts in pack */
+    struct bitslice *slice;	/* bitslice being recorded */
+    int first;			/* 1st row of the block */
+    int last;			/* row after the block */
+    int wide;			/* bits in the widest row of the block */
+    int check;			/* 1 ==> check convergence after the block */
+    int r;
+    int i;
+
+    /*
+     * slice by slice, a block of rows at a time
+     */
+    if (ctx->cfg.block > 0) {
+	off[0] = 0;
+	for (r=1; r < rows; ++r) {
+	    off[r] = off[r-1] + ctx->row[r-1];
+	}
+	for (first=0; first < rows; first = last) {
+
+	    /*
+	     * find the block
+	     */
+	    wide = 0;
+	    check = 0;
+	    for (last=first; last < rows && last-first < ctx->cfg.block; ) {
+		++ctx->recnum;
+		if (ctx->row[last] > wide) {
+		    wide = ctx->row[last];
+		}
+		if (ctx->row[last++] > 0 && ctx->cfg.conv_cycle > 0 &&
+		    (ctx->recnum % ctx->cfg.conv_cycle) == 0) {
+		    check = 1;
+		    break;
+		}
+	    }
+
+	    /*
+	     * replay the bits of each slice back to back
+	     */
+	    for (i=0; i < wide; ++i) {
+		slice = ctx->bits[i];
+		for (r=first; r < last; ++r) {
+		    if (i < ctx->row[r]) {
+			record_bit(slice, p[off[r] + i]);
+		    }
+		}
+	    }
+	    if (check) {
+		check_converge(ctx);
+	    }
+	}
+	return;
+    }
+
+    /*
+     * record by record
+     */
+    for (r=0; r < rows; ++r) {
+	++ctx->recnum;
+	if (ctx->row[r] <= 0) {
+	    continue;
+	}
+	for (i=0; i < ctx->row[r]; ++i) {
+	    record_bit(ctx->bits[i], p[i]);
+	}
+	p += ctx->row[r];
+	if (ctx->cfg.conv_cycle > 0 &&
+	    (ctx->recnum % ctx->cfg.conv_cycle) == 0) {
+	    check_converge(ctx);
+	}
+    }
+    return;
+}
+
+
+
+/*
+ * trim_record - trim the newline, field and cookie from a record
+ *
+ * The record is not altered: the trimmed record is returned as a
+ * start and length within inbuf.
+ *
+ * given:
+ *	cfg		analysis parameters (keep_newline, field_mode, ...)
+ *	inbuf		record
+ *	inbuf_len	length of the record in octets
+ *	start		where to return the start of the trimmed record
+ *
+ * returns:
+ *	length of the trimmed record at *start,
+ *	0 ==> nothing left or the record is to be discarded
+ *
+ * NOTE: With cookie_trim == 2, only the newline is trimmed.  The
+ *	 cookies are then found with find_cookie().
+ */
+static int
+trim_record(const struct ent_cfg *cfg, u_int8_t *inbuf, int inbuf_len,
+	    u_int8_t **start)
+{
+    int v_flag = cfg->v_flag;	/* debug verbosity level */
+
+    *start = inbuf;
+    if (inbuf_len <= 0) {
+	return 0;
+    }
+
+    /*
+     * trim newline, if requested
+     *
+     * We trim a trailing \n or a trailing \r\n or a trailing \n\r
+     */
+    if (cfg->keep_newline == 0) {
+	if (inbuf[inbuf_len-1] == '\n') {
+	    --inbuf_len;
+	    if (inbuf_len > 0 && inbuf[inbuf_len-1] == '\r') {
+		--inbuf_len;
+	    }
+	} else if (inbuf[inbuf_len-1] == '\r') {
+	    --inbuf_len;
+	    if (inbuf_len > 0 && inbuf[inbuf_len-1] == '\n') {
+		--inbuf_len;
+	    }
+	}
+	dbg(v_flag, 8, "inbuf len: %d", inbuf_len);
+	if (cfg->text) {
+	    dbg(v_flag, 8, "1st inbuf: %.*s", inbuf_len, inbuf);
+	}
+	if (inbuf_len <= 0) {
+	    /* trimmed the line down to nothing */
+	    return 0;
+	}
+    }
+
+    /*
+     * field extraction, if requested
+     */
+    if (cfg->field_mode != ENT_FIELD_NONE) {
+	inbuf_len = find_field(cfg, inbuf, inbuf_len, start);
+	if (inbuf_len < 0) {
+	    dbg(v_flag, 5, "trim_record: line has no field, discarding line");
+	    return 0;
+	}
+	inbuf = *start;
+	if (cfg->text) {
+	    dbg(v_flag, 9, "field: %.*s", inbuf_len, inbuf);
+	}
+	if (inbuf_len <= 0) {
+	    return 0;
+	}
+    }
+
+    /*
+     * cookie trim, if requested
+     *
+     * Programs such as cookie_monster will output lines of the form:
+     *
+     *    [optional_timestamp:] Set-cookie: COOKIE_NAME=VALUE; stuff ...
+     *
+     * This trim will reduce the above line down to just:
+     *
+     *    VALUE
+     *
+     * NOTE: If the line does not have a = and a ;, then the entire line
+     *	     is discarded.
+     */
+    if (cfg->cookie_trim == 1) {
+	u_int8_t *equal;	/* first = or NULL */
+	u_int8_t *semi;		/* first ; after the = or NULL */
+
+	/*
+	 * look for the cookie value boundaries
+	 */
+	equal = (u_int8_t *)memchr(inbuf, '=', inbuf_len);
+	if (equal == NULL) {
+	    dbg(v_flag, 5, "trim_record: line has no =, discarding line");
+	    return 0;
+	}
+	semi = (u_int8_t *)memchr(equal+1, ';', inbuf + inbuf_len - (equal+1));
+	if (semi == NULL) {
+	    dbg(v_flag, 5, "trim_record: no ; after 1st =, discarding line");
+	    return 0;
+	}
+
+	/*
+	 * the value is the trimmed record
+	 */
+	*start = equal+1;
+	inbuf_len = semi - equal - 1;
+	if (cfg->text) {
+	    dbg(v_flag, 9, "cookie tr: %.*s", inbuf_len, *start);
+	}
+    }
+
+    return inbuf_len;
+}
+
+
+/*
+ * find_field - find the field of a record selected by field_mode
+ *
+ * given:
+ *	cfg	analysis parameters (field_mode, field_num, field_sep, field_key)
+ *	rec	record
+ *	len	length of rec in octets
+ *	start	where to return the start of the field
+ *
+ * returns:
+ *	length of the field at *start, -1 ==> record has no such field
+ */
+static int
+find_field(const struct ent_cfg *cfg, u_int8_t *rec, int len,
+	   u_int8_t **start)
+{
+    switch (cfg->field_mode) {
+    case ENT_FIELD_DELIM:
+	return field_delim(rec, len, cfg->field_num, cfg->field_sep, start);
+    case ENT_FIELD_KV:
+	return field_kv(rec, len, cfg->field_key, start);
+    case ENT_FIELD_JSON:
+	return field_json(rec, len, cfg->field_key, start);
+    }
+    *start = rec;
+    return len;
+}
+
+
+/*
+ * field_delim - find field num of a separated record
+ *
+ * Separators are found with memchr().  A field that starts with a "
+ * ends at the next " that is not doubled, so it may hold separators.
+ * The outer quotes are dropped, doubled quotes within are kept as is.
+ *
+ * given:
+ *	rec	record
+ *	len	length of rec in octets
+ *	num	field number, 1st field is 1
+ *	sep	field separator octet
+ *	start	where to return the start of the field
+ *
+ * returns:
+ *	length of the field at *start, -1 ==> record has too few fields
+ */
+static int
+field_delim(const u_int8_t *rec, int len, int num, int sep, u_int8_t **start)
+{
+    const u_int8_t *end = rec + len;	/* end of the record */
+    const u_int8_t *p = rec;	/* start of the current field */
+    const u_int8_t *q;		/* end of the current field */
+    const u_int8_t *close;	/* closing quote of a quoted field, or end */
+    int f;			/* current field number */
+
+    for (f=1; ; ++f) {
+
+	/*
+	 * find the end of this field
+	 */
+	if (p < end && *p == '"' && sep != '"') {
+	    for (close = p+1; close < end; ++close) {
+		if (*close == '"') {
+		    if (close+1 < end && close[1] == '"') {
+			++close;	/* doubled quote */
+		    } else {
+			break;
+		    }
+		}
+	    }
+	    q = (close < end) ?
+		(const u_int8_t *)memchr(close, sep, end - close) : NULL;
+	    if (f == num) {
+		*start = (u_int8_t *)p+1;
+		return close - (p+1);
+	    }
+	} else {
+	    q = (const u_int8_t *)memchr(p, sep, end - p);
+	    if (f == num) {
+		*start = (u_int8_t *)p;
+		return ((q == NULL) ? end : q) - p;
+	    }
+	}
+
+	/*
+	 * move on to the next field
+	 */
+	if (q == NULL) {
+	    return -1;
+	}
+	p = q+1;
+    }
+}
+
+
+/*
+ * field_kv - find the value of a key in a record of key=value pairs
+ *
+ * Pairs are separated by whitespace, commas, semicolons or ampersands,
+ * as in logfmt, HTTP parameters and query strings.  A value that starts
+ * with a " ends at the next ", and the quotes are dropped.
+ *
+ * given:
+ *	rec	record
+ *	len	length of rec in octets
+ *	key	key to find
+ *	start	where to return the start of the value
+ *
+ * returns:
+ *	length of the value at *start, -1 ==> record has no such key
+ */
+static int
+field_kv(const u_int8_t *rec, int len, const char *key, u_int8_t **start)
+{
+    const u_int8_t *end = rec + len;	/* end of the record */
+    const u_int8_t *p = rec;	/* start of the current pair */
+    const u_int8_t *q;		/* scan pointer */
+    int key_len = strlen(key);	/* length of key */
+
+    while (p < end) {
+
+	/*
+	 * skip separators
+	 */
+	while (p < end && (isspace(*p) || *p == ',' || *p == ';' || *p == '&')) {
+	    ++p;
+	}
+
+	/*
+	 * the value of our key
+	 */
+	if (end - p > key_len && memcmp(p, key, key_len) == 0 &&
+	    p[key_len] == '=') {
+	    p += key_len+1;
+	    if (p < end && *p == '"') {
+		q = (const u_int8_t *)memchr(p+1, '"', end - (p+1));
+		*start = (u_int8_t *)p+1;
+		return (q == NULL) ? end - (p+1) : q - (p+1);
+	    }
+	    for (q = p; q < end && !isspace(*q) && *q != ',' && *q != ';' &&
+			*q != '&'; ++q) {
+	    }
+	    *start = (u_int8_t *)p;
+	    return q - p;
+	}
+
+	/*
+	 * skip this pair, including a quoted value
+	 */
+	while (p < end && !isspace(*p) && *p != ',' && *p != ';' && *p != '&') {
+	    if (*p == '"') {
+		q = (const u_int8_t *)memchr(p+1, '"', end - (p+1));
+		p = (q == NULL) ? end : q;
+	    }
+	    ++p;
+	}
+    }
+    return -1;
+}
+
+
+/*
+ * field_json - find the value of a top level key of a JSON object
+ *
+ * This is not a JSON validator: the record is scanned just enough to
+ * follow strings and nesting, so that keys of nested objects and text
+ * within strings are not mistaken for the key.  A string value is
+ * returned without its quotes and with its escapes as is.  An object
+ * or array is returned with its brackets, up to the one that closes
+ * it.  Any other value is returned up to the , or } that ends it.
+ *
+ * given:
+ *	rec	record
+ *	len	length of rec in octets
+ *	key	key to find
+ *	start	where to return the start of the value
+ *
+ * returns:
+ *	length of the value at *start, -1 ==> record has no such key
+ */
+static int
+field_json(const u_int8_t *rec, int len, const char *key, u_int8_t **start)
+{
+    const u_int8_t *end = rec + len;	/* end of the record */
+    const u_int8_t *p;		/* scan pointer */
+    const u_int8_t *str;	/* start of the current string */
+    int key_len = strlen(key);	/* length of key */
+    int depth = 0;		/* object and array nesting depth */
+    int is_key;			/* 1 ==> string is a top level key */
+
+    for (p = rec; p < end; ++p) {
+	switch (*p) {
+	case '{':
+	case '[':
+	    ++depth;
+	    break;
+	case '}':
+	case ']':
+	    --depth;
+	    break;
+	case '"':
+	    /*
+	     * skip the string, noting if it is our key
+	     */
+	    str = ++p;
+	    while (p < end && *p != '"') {
+		p += (*p == '\\' && p+1 < end) ? 2 : 1;
+	    }
+	    if (p >= end) {
+		return -1;
+	    }
+	    is_key = (depth == 1 && p - str == key_len &&
+		      memcmp(str, key, key_len) == 0);
+	    if (!is_key) {
+		break;
+	    }
+
+	    /*
+	     * our key must be followed by a :
+	     */
+	    for (++p; p < end && isspace(*p); ++p) {
+	    }
+	    if (p >= end || *p != ':') {
+		--p;
+		break;
+	    }
+	    for (++p; p < end && isspace(*p); ++p) {
+	    }
+	    if (p >= end) {
+		return -1;
+	    }
+
+	    /*
+	     * return the value
+	     */
+	    if (*p == '"') {
+		str = ++p;
+		while (p < end && *p != '"') {
+		    p += (*p == '\\' && p+1 < end) ? 2 : 1;
+		}
+		*start = (u_int8_t *)str;
+		return p - str;
+	    }
+	    if (*p == '{' || *p == '[') {
+		/*
+		 * an object or array runs to its matching close
+		 */
+		str = p;
+		depth = 0;
+		for (; p < end; ++p) {
+		    if (*p == '{' || *p == '[') {
+			++depth;
+		    } else if (*p == '}' || *p == ']') {
+			if (--depth == 0) {
+			    *start = (u_int8_t *)str;
+			    return p+1 - str;
+			}
+		    } else if (*p == '"') {
+			for (++p; p < end && *p != '"'; ) {
+			    p += (*p == '\\' && p+1 < end) ? 2 : 1;
+			}
+			if (p >= end) {
+			    return -1;
+			}
+		    }
+		}
+		return -1;
+	    }
+	    for (str = p; p < end && *p != ',' && *p != '}' && *p != ']' &&
+			  !isspace(*p); ++p) {
+	    }
+	    *start = (u_int8_t *)str;
+	    return p - str;
+	}
+    }
+    return -1;
+}
+
+
+/*
+ * find_cookie - find the next name=value cookie in a header line
+ *
+ * See ent_cookie().  Cookie attributes such as Path=/ are name=value
+ * pairs too.
+ *
+ * given:
+ *	rec	rest of the line
+ *	len	length of rec in octets
+ *	val	where to return the offset of the value in rec
+ *	val_len	where to return the length of the value
+ *
+ * returns:
+ *	octets of rec used, up to and including the ; after the value,
+ *	0 ==> no more cookies
+ */
+static int
+find_cookie(const u_int8_t *rec, int len, int *val, int *val_len)
+{
+    const u_int8_t *equal;	/* next = or NULL */
+    const u_int8_t *semi;	/* ; after the = or NULL */
+
+    if (len <= 0) {
+	return 0;
+    }
+    equal = (const u_int8_t *)memchr(rec, '=', len);
+    if (equal == NULL) {
+	return 0;
+    }
+    *val = equal+1 - rec;
+    semi = (const u_int8_t *)memchr(equal+1, ';', len - *val);
+    if (semi == NULL) {
+	*val_len = len - *val;
+	return len;
+    }
+    *val_len = semi - (equal+1);
+    return semi+1 - rec;
+}
+
+
+/*
+ * pre_process - convert an input record into bit values to be processed
+ *
+ * This function will pre-process a raw character based record and produce
+ * a bit buffer of bits entropy process.  This function is given records
+ * that have just been read and produces a set of 0 and 1 bits that will
+ * go into the entropy measurements for a given bit position.
+ *
+ * The input buffer is a record, already trimmed by trim_record(), within
+ * the context's rec_buf.  The input buffer may contain NULs.
+ *
+ * The output buffer is the context's bit_buf, a string of octets of
+ * either 0x00 or 0x01 value.  If needed, this function will realloc
+ * the output buffer to a larger size.
+ *
+ * given:
+ *	ctx		entropy analysis context
+ *	inbuf		trimmed record within ctx->rec_buf
+ *	inbuf_len	length of the trimmed record in octets
+ *
+ * returns:
+ *	the amount of bit_buf used, or -1 ==> error
+ *
+ * NOTE: The rec_buf will be altered according to the pre-processing steps,
+ *	 from inbuf up to and including inbuf[inbuf_len].
+ */
+static int
+pre_process(struct ent_ctx *ctx, u_int8_t *inbuf, int inbuf_len)
+{
+    const struct ent_map *map = ctx->map;	/* map being used */
+    int v_flag = ctx->cfg.v_flag;	/* debug verbosity level */
+    int outbuf_need;	/* amount of outbuf we will use */
+    const struct ent_code *code;	/* code of a character position */
+    u_int32_t v;	/* value of an octet's code */
+    int n;		/* bits of an octet's code left to load */
+    int i;
+    char *p;
+    u_int8_t *q;
+    u_int8_t *r;
+    char *s;
+
+    /*
+     * do nothing if input buffer is empty
+     */
+    dbg(v_flag, 9, "pre inbuf len: %d", inbuf_len);
+    if (inbuf_len <= 0) {
+	dbg(v_flag, 5, "pre_process: empty inbuf");
+	return 0;
+    }
+
+    /*
+     * selection maps gather their bits straight from the record
+     */
+    if (map->gather != NULL) {
+	outbuf_need = select_bits(ctx, inbuf, inbuf_len);
+	if (outbuf_need <= 0) {
+	    return outbuf_need;
+	}
+	return mask_bits(ctx, outbuf_need);
+    }
+
+    /*
+     * UTF-8 maps decode the record into characters first
+     */
+    if (map->utf8) {
+	outbuf_need = utf8_bits(ctx, inbuf, inbuf_len);
+	if (outbuf_need <= 0) {
+	    return outbuf_need;
+	}
+	return mask_bits(ctx, outbuf_need);
+    }
+
+    /*
+     * character mask, if requested
+     *
+     * If charmask is a string, then we keep only those characters
+     * in the input buffer that correspond to a 'c' in the charmask.
+     */
+    if (map->char_mask != NULL) {
+
+	/*
+	 * walk the charmask looking for c's
+	 */
+	if ((i = strlen(map->char_mask)) > inbuf_len) {
+	    s = map->char_mask + inbuf_len;
+	} else {
+	    s = map->char_mask + i;
+	}
+	for (q=inbuf, p=map->char_mask; *p != '\0' && p < s; ++p) {
+
+	    /* skip non-c chars (presumably x's) */
+	    if (*p != 'c') {
+		continue;
+	    }
+
+	    /* save this inbuf character */
+	    *q++ = inbuf[p - map->char_mask];
+	}
+	inbuf_len = q - inbuf;
+	inbuf[inbuf_len] = '\0';	/* for debugging */
+	if (ctx->cfg.text) {
+	    dbg(v_flag, 9, "char_mask: %s", map->char_mask);
+	    dbg(v_flag, 9, "inbuf after char_mask: %s", inbuf);
+	}
+	dbg(v_flag, 7, "inbuf trimmed to %d octets", inbuf_len);
+    }
+
+    /*
+     * do nothing if trimmed input buffer is empty
+     */
+    if (inbuf_len <= 0) {
+	dbg(v_flag, 5, "pre_process: trimmed inbuf is empty");
+	return 0;
+    }
+
+    /*
+     * determine how many bits we will produce
+     */
+    outbuf_need = 0;
+    if (map->pos_code == NULL) {
+	for (i=0; i < inbuf_len; ++i) {
+	    outbuf_need += map->code.bits[inbuf[i]];
+	}
+    } else {
+	for (i=0; i < inbuf_len; ++i) {
+	    outbuf_need += col_code(map, i)->bits[inbuf[i]];
+	}
+    }
+
+    /*
+     * do nothing if we will produce no bits
+     */
+    if (outbuf_need <= 0) {
+	dbg(v_flag, 5, "pre_process: line will yield no bits");
+	return 0;
+    }
+
+    /*
+     * be sure we have enough room in our output buffer
+     */
+    if (grow_bits(ctx, outbuf_need) < 0) {
+	return -1;
+    }
+
+    /*
+     * load output buffer with 0x00's and 0x01's
+     */
+    r = ctx->bit_buf;
+    for (i=0; i < inbuf_len; ++i) {
+	/*
+	 * load the bits of the octet's code, most significant bit first
+	 */
+	code = col_code(map, i);
+	v = code->val[inbuf[i]];
+	for (n = code->bits[inbuf[i]]; n > 0; --n) {
+	    *r++ = (v >> (n-1)) & 0x01;
+	}
+    }
+    *r = '\0';
+
+    /*
+     * bit mask, if requested
+     */
+    return mask_bits(ctx, outbuf_need);
+}
+
+
+/*
+ * select_bits - gather the selected bits of a binary record
+ *
+ * Only the octets in the gather list of the map are looked at.  Whole
+ * octets, the common case, are loaded 8 bits at a time.
+ *
+ * given:
+ *	ctx		entropy analysis context
+ *	inbuf		trimmed record
+ *	inbuf_len	length of the trimmed record in octets
+ *
+ * returns:
+ *	the amount of bit_buf used, or -1 ==> error
+ */
+static int
+select_bits(struct ent_ctx *ctx, const u_int8_t *inbuf, int inbuf_len)
+{
+    const struct ent_gather *g = ctx->map->gather;	/* next octet to gather */
+    const struct ent_gather *g_end = g + ctx->map->gather_len;
+    u_int8_t *r;		/* next bit of bit_buf */
+    u_int8_t v;			/* octet being gathered */
+    int n;
+
+    /*
+     * be sure we have room for all the bits of a whole record
+     */
+    if (grow_bits(ctx, ctx->map->gather_bits) < 0) {
+	return -1;
+    }
+
+    /*
+     * load the selected bits, most significant bit first
+     */
+    r = ctx->bit_buf;
+    for (; g < g_end && g->off < inbuf_len; ++g) {
+	v = inbuf[g->off];
+	if (g->mask == 0xff) {
+	    r[0] = v >> 7;
+	    r[1] = (v >> 6) & 0x01;
+	    r[2] = (v >> 5) & 0x01;
+	    r[3] = (v >> 4) & 0x01;
+	    r[4] = (v >> 3) & 0x01;
+	    r[5] = (v >> 2) & 0x01;
+	    r[6] = (v >> 1) & 0x01;
+	    r[7] = v & 0x01;
+	    r += 8;
+	} else {
+	    for (n=7; n >= 0; --n) {
+		if ((g->mask >> n) & 0x01) {
+		    *r++ = (v >> n) & 0x01;
+		}
+	    }
+	}
+    }
+    *r = '\0';
+    dbg(ctx->cfg.v_flag, 8, "select_bits: gathered %d bits",
+	(int)(r - ctx->bit_buf));
+    return r - ctx->bit_buf;
+}
+
+
+/*
+ * grow_bits - be sure the bit buffer has room for a number of bits
+ *
+ * given:
+ *	ctx	entropy analysis context
+ *	need	number of 0x00 or 0x01 octets needed in ctx->bit_buf
+ *
+ * returns:
+ *	0 ==> OK, -1 ==> malloc error
+ */
+static int
+grow_bits(struct ent_ctx *ctx, int need)
+{
+    u_int8_t *r;
+
+    if (ctx->bit_len < need) {
+
+	/* grow output buffer */
+	r = (u_int8_t *)realloc(ctx->bit_buf, need+1);
+	if (r == NULL) {
+	    return -1;
+	}
+	dbg(ctx->cfg.v_flag, 8, "outbuf grew from %d octets to %d octets",
+	       ctx->bit_len, need);
+	ctx->bit_buf = r;
+	ctx->bit_len = need;
+	ctx->bit_buf[need] = '\0';
+    }
+    return 0;
+}
+
+
+/*
+ * mask_bits - apply the bit mask of the map to the bit buffer
+ *
+ * If bitmask is a string, then we keep only those bits in the
+ * output buffer that correspond to a 'b' in the bitmask.
+ *
+ * given:
+ *	ctx		entropy analysis context
+ *	outbuf_need	number of bits in ctx->bit_buf
+ *
+ * returns:
+ *	the amount of bit_buf used
+ */
+static int
+mask_bits(struct ent_ctx *ctx, int outbuf_need)
+{
+    const struct ent_map *map = ctx->map;	/* map being used */
+    int v_flag = ctx->cfg.v_flag;	/* debug verbosity level */
+    int i;
+    char *p;
+    u_int8_t *q;
+    u_int8_t *r;
+    char *s;
+
+    /*
+     * special binary debugging output
+     */
+    if (v_flag >= 7) {
+	r = ctx->bit_buf;
+	dbg(v_flag, 7, "initially have %d bits", outbuf_need);
+	fprintf(stderr, "Debug[7]: encoding: ");
+	for (i=0; i < outbuf_need; ++i) {
+	    if (r[i]) {
+		fputc('1', stderr);
+	    } else {
+		fputc('0', stderr);
+	    }
+	}
+	fputc('\n', stderr);
+    }
+
+    /*
+     * bit mask, if requested
+     *
+     * If bitmask is a string, then we keep only those bits
+     * in the output buffer that correspond to a 'b' in the charmask.
+     */
+    if (map->bit_mask != NULL) {
+
+	/*
+	 * walk the charmask looking for b's
+	 */
+	r = ctx->bit_buf;
+	if ((i = strlen(map->bit_mask)) > outbuf_need) {
+	    s = map->bit_mask + outbuf_need;
+	} else {
+	    s = map->bit_mask + i;
+	}
+	for (q=r, p=map->bit_mask; *p != '\0' && p < s; ++p) {
+
+	    /* skip non-b chars (presumably x's) */
+	    if (*p != 'b') {
+		continue;
+	    }
+
+	    /* save this inbuf character */
+	    *q++ = r[p - map->bit_mask];
+	}
+	dbg(v_flag, 9, "bit_mask: %s", map->bit_mask);
+	dbg(v_flag, 8, "masked %d bits down to %d bits", outbuf_need, q - r);
+	outbuf_need = q - r;
+	r[outbuf_need] = '\0';	/* for debugging */
+
+	/*
+	 * special binary debugging output
+	 */
+	if (v_flag >= 7) {
+	    r = ctx->bit_buf;
+	    fprintf(stderr, "Debug[7]: the bits: ");
+	    for (i=0; i < outbuf_need; ++i) {
+		if (r[i]) {
+		    fputc('1', stderr);
+		} else {
+		    fputc('0', stderr);
+		}
+	    }
+	    fputc('\n', stderr);
+	    dbg(v_flag, 7, "masked down to %d octets", outbuf_need);
+	}
+    }
+
+    /*
+     * return use count
+     */
+    return outbuf_need;
+}
+
+
+/*
+ * rept_entropy - compute the current entropy estimate of a context
+ *
+ * The tallies of a bitslice hold every depth up to its depth_lim and
+ * every history up to its back_lim, so an estimate for a smaller
+ * bit_depth or back_history is computed from the same tallies.
+ *
+ * The overall estimate is stored in *overall.  When overall is
+ * &ctx->overall, the per-slice estimates are also stored in each
+ * bitslice for use by check_converge().
+ *
+ * given:
+ *	ctx		entropy analysis context
+ *	bit_depth	deepest tally depth to use
+ *	back_history	furthest back history to use
+ *	depth_factor	ave slot tally needed
+ *	overall		where to store the overall estimate
+ */
+static void
+rept_entropy(struct ent_ctx *ctx, int bit_depth, int back_history,
+	     int depth_factor, struct total_ent *overall)
+{
+    struct bitslice **slice = ctx->bits;	/* bitslices to report on */
+    int v_flag = ctx->cfg.v_flag;	/* debug verbosity level */
+    unsigned long count;	/* number of bit ops for a bitslice */
+    double inv_count;		/* 1.0/count as a double */
+    int depth_lim;		/* how deep we can calculate entropy */
+    int back_lim;		/* how far back the slice uses history */
+    int bit_num;		/* slice bit number */
+    int hist_num;		/* history level, 0 ==> current */
+    int depth_num;		/* bit depth level */
+    tally_t *tally;		/* tally array for a given bit & history lvl */
+    u_int32_t offset;		/* offset within tally array being used */
+    double p_i;			/* probability of finding an i value */
+    double entropy;		/* entropy sum being calculated */
+    double max_entropy;		/* max entropy found for a given history */
+    int max_ent_depth;		/* depth at which max entropy was found */
+    double min_entropy;		/* min entropy found for a given history */
+    int min_ent_depth;		/* depth at which max entropy was found */
+    double high_bit_ent;	/* high entropy estimate for bit */
+    int high_ent_depth;		/* depth at which max bit entropy was found */
+    int high_ent_hist;		/* hist at which max entropy was found */
+    double low_bit_ent;		/* low entropy estimate for bit */
+    int low_ent_depth;		/* depth at which min bit entropy was found */
+    int low_ent_hist;		/* hist at which min entropy was found */
+    double total_high_ent;	/* overall high entropy total for all bits */
+    int total_high_cnt;		/* number of bits calculating total_high_ent */
+    double total_low_ent;	/* overall low entropy total for all bits */
+    int total_low_cnt;		/* number of bits calculating total_low_ent */
+    int keep;			/* 1 ==> store per-slice estimates */
+    int i;
+
+    /*
+     * firewall
+     */
+    keep = (overall == &ctx->overall);
+    if (slice == NULL || ctx->bits_len <= 0) {
+	dbg(v_flag, 2, "rept_entropy: no bit slices to process");
+	return;
+    }
+
+    /*
+     * calculate entropy of each slice
+     */
+    total_high_ent = 0.0;
+    total_high_cnt = 0;
+    total_low_ent = 0.0;
+    total_low_cnt = 0;
+    for (bit_num=0; bit_num < ctx->bits_len; ++bit_num) {
+
+	/*
+	 * determine the parameters of our count
+	 */
+	count = slice[bit_num]->count;
+	if (count <= 0) {
+	    dbg(v_flag, 9, "rept_entropy: slice[%d] has no count", bit_num);
+	    continue;
+	}
+	inv_count = 1.0 / (double)count;
+	depth_lim = slice[bit_num]->depth_lim;
+	if (depth_lim > bit_depth) {
+	    depth_lim = bit_depth;
+	}
+	back_lim = slice[bit_num]->back_lim;
+	if (back_lim > back_history) {
+	    back_lim = back_history;
+	}
+	while (depth_lim > 0 &&
+	       (count/depth_factor) < (1ULL << depth_lim)) {
+	    --depth_lim;
+	}
+	if (depth_lim <= 0) {
+	    dbg(v_flag, 9, "rept_entropy: slice[%d] has too low of a count: %lu",
+		    bit_num, count);
+	    continue;
+	}
+	dbg(v_flag, 8, "rept_entropy: slice[%d]: count: %lu  depth_lim: %d  "
+		       "back_lim: %d",
+	       bit_num, count, depth_lim, back_lim);
+
+	/*
+	 * setup to calculate high and low entropy estimates for bit
+	 */
+	high_bit_ent = INVALID_MAX_ENTROPY;
+	high_ent_depth = -1;
+	high_ent_hist = -1;
+	low_bit_ent = INVALID_MIN_ENTROPY;
+	low_ent_depth = -1;
+	low_ent_hist = -1;
+
+	/*
+	 * calculate entropy for the back history of this bit
+	 */
+	for (hist_num=0; hist_num <= back_lim; ++hist_num) {
+
+	    /*
+	     * setup to process the tally array
+	     */
+	    tally = slice[bit_num]->hist[hist_num];
+	    max_entropy = INVALID_MAX_ENTROPY;
+	    max_ent_depth = -1;
+	    min_entropy = INVALID_MIN_ENTROPY;
+	    min_ent_depth = -1;
+
+	    /*
+	     * calculate the entropy to appropriate depths
+	     */
+	    for (offset=2, depth_num=1;
+		 depth_num <= depth_lim;
+		 offset <<= 1, ++depth_num) {
+
+		/*
+		 * calculate entropy at this depth
+		 *
+		 * - sum p_i ln_2(p_i);
+		 */
+		entropy = 0.0;
+		for (i=0; i < offset; ++i) {
+
+		    /* ignore of no count */
+		    if (tally[offset+i] > 0) {
+
+			/* probability of find this value at this depth */
+			p_i = (double)tally[offset+i] * inv_count;
+
+			/* add to entropy sum */
+			entropy += p_i * log(p_i);
+		    }
+		}
+		/* entropy is the - sum , and covert log base 2 per bit */
+		entropy = entropy * -INV_LN_2 / depth_num;
+		dbg(v_flag, 9, "rept_entropy: slice[%d]: hist:%d depth:%d: "
+			       "entropy:%f",
+			bit_num, hist_num, depth_num, entropy);
+		if (entropy < 0.0) {
+		    entropy = 0.0;
+		}
+
+		/*
+		 * keep track of maximum and minimum entropy levels
+		 */
+		if (entropy > max_entropy) {
+		    max_entropy = entropy;
+		    max_ent_depth = depth_num;
+		    if (max_entropy > high_bit_ent) {
+			high_bit_ent = max_entropy;
+			high_ent_depth = depth_num;
+			high_ent_hist = hist_num;
+			dbg(v_flag, 6, "rept_entropy: slice[%d]: hist:%d depth:%d "
+			       "new max_entropy:%f",
+			       bit_num, high_ent_hist, high_ent_depth,
+			       high_bit_ent);
+		    }
+		}
+		if (entropy < min_entropy) {
+		    min_entropy = entropy;
+		    min_ent_depth = depth_num;
+		    if (min_entropy < low_bit_ent) {
+			low_bit_ent = min_entropy;
+			low_ent_depth = depth_num;
+			low_ent_hist = hist_num;
+			dbg(v_flag, 6, "rept_entropy: slice[%d]: hist:%d depth:%d "
+			       "new min_entropy:%f",
+			       bit_num, low_ent_hist, low_ent_depth,
+			       low_bit_ent);
+		    }
+		}
+	    }
+
+	    /*
+	     * record entropy for this back history
+	     */
+	    if (max_entropy > INVALID_MAX_ENTROPY) {
+		if (keep) {
+		    slice[bit_num]->max_ent[hist_num] = max_entropy;
+		}
+		dbg(v_flag, 8, "rept_entropy: slice[%d]: hist:%d depth:%d "
+		       "max_entropy:%f",
+		       bit_num, hist_num, max_ent_depth, max_entropy);
+	    } else {
+		dbg(v_flag, 7, "rept_entropy: slice[%d]: hist:%d depth:%d "
+		       "no max_entropy",
+		       bit_num, hist_num, max_ent_depth);
+	    }
+	    if (min_entropy < INVALID_MIN_ENTROPY) {
+		if (keep) {
+		    slice[bit_num]->min_ent[hist_num] = min_entropy;
+		}
+		dbg(v_flag, 8, "rept_entropy: slice[%d]: hist:%d depth:%d "
+		       "min_entropy:%f",
+		       bit_num, hist_num, min_ent_depth, min_entropy);
+	    } else {
+		dbg(v_flag, 7, "rept_entropy: slice[%d]: hist:%d depth:%d "
+		       "no min_entropy",
+		       bit_num, hist_num, min_ent_depth);
+	    }
+	}
+
+	/*
+	 * record entropy for this bit
+	 */
+	if (high_bit_ent > INVALID_MAX_ENTROPY) {
+	    if (keep) {
+		slice[bit_num]->entropy_high = high_bit_ent;
+	    }
+	    dbg(v_flag, 4, "rept_entropy: slice[%d]: hist:%d depth:%d "
+		    "bit high entropy:%f",
+		   bit_num, high_ent_hist, high_ent_depth,
+		   high_bit_ent);
+	    total_high_ent += high_bit_ent;
+	    ++total_high_cnt;
+	} else {
+	    dbg(v_flag, 5, "rept_entropy: slice[%d]: bit max_entropy unknown",
+		   bit_num);
+	}
+	if (low_bit_ent < INVALID_MIN_ENTROPY) {
+	    if (keep) {
+		slice[bit_num]->entropy_low = low_bit_ent;
+	    }
+	    dbg(v_flag, 4, "rept_entropy: slice[%d]: hist:%d depth:%d "
+		    "bit low entropy:%f",
+		   bit_num, low_ent_hist, low_ent_depth,
+		   low_bit_ent);
+	    total_low_ent += low_bit_ent;
+	    ++total_low_cnt;
+	} else {
+	    dbg(v_flag, 5, "rept_entropy: slice[%d]: bit min_entropy unknown",
+		   bit_num);
+	}
+    }
+
+    /*
+     * compute overall entropy, if possible
+     */
+    if (total_high_cnt > 0) {
+	overall->high_entropy = total_high_ent;
+	overall->high_bit_cnt = total_high_cnt;
+	dbg(v_flag, 3, "rept_entropy: overall high entropy: %f",
+		       overall->high_entropy);
+	dbg(v_flag, 3, "rept_entropy: overall high bits: %d",
+		       overall->high_bit_cnt);
+    }
+    if (total_low_cnt > 0) {
+	overall->low_entropy = total_low_ent;
+	overall->low_bit_cnt = total_low_cnt;
+	dbg(v_flag, 3, "rept_entropy: overall low entropy: %f",
+		       overall->low_entropy);
+	dbg(v_flag, 3, "rept_entropy: overall low bits: %d",
+		       overall->low_bit_cnt);
+    }
+    if (total_high_cnt > 0 && total_low_cnt > 0) {
+	overall->med_entropy = (total_high_ent + total_low_ent) / 2.0;
+	dbg(v_flag, 3, "rept_entropy: overall median entropy: %f",
+		       overall->med_entropy);
+    }
+    return;
+}
+
+
+/*
+ * check_converge - freeze bitslices whose entropy estimates have converged
+ *
+ * Each bitslice whose high and low entropy estimates have moved by no more
+ * than FREEZE_EPSILON over FREEZE_STABLE consecutive calls is frozen.
+ * Only bitslices that already have enough count to use their full
+ * depth_lim are candidates: a shallower estimate may still change
+ * once the deeper tallies become usable.
+ *
+ * given:
+ *	ctx	entropy analysis context
+ */
+static void
+check_converge(struct ent_ctx *ctx)
+{
+    struct bitslice *s;		/* bitslice being checked */
+    int newly_frozen;		/* bitslices frozen by this call */
+    int frozen;			/* total frozen bitslices */
+    int i;
+
+    /*
+     * refresh the per-slice entropy estimates
+     */
+    if (ctx->bits_len <= 0) {
+	return;
+    }
+    rept_entropy(ctx, ctx->cfg.bit_depth, ctx->cfg.back_history,
+		 ctx->cfg.depth_factor, &ctx->overall);
+
+    /*
+     * look for bitslices that have stopped changing
+     */
+    newly_frozen = 0;
+    frozen = 0;
+    for (i=0; i < ctx->bits_len; ++i) {
+	s = ctx->bits[i];
+	if (s->frozen) {
+	    ++frozen;
+	    continue;
+	}
+
+	/* both estimates must be valid and at full depth */
+	if (s->entropy_high <= INVALID_MAX_ENTROPY ||
+	    s->entropy_low >= INVALID_MIN_ENTROPY ||
+	    (s->count/ctx->cfg.depth_factor) < (1ULL << s->depth_lim)) {
+	    s->stable = 0;
+	    continue;
+	}
+
+	/* compare with the previous check */
+	if (fabs(s->entropy_high - s->prev_high) <= FREEZE_EPSILON &&
+	    fabs(s->entropy_low - s->prev_low) <= FREEZE_EPSILON) {
+	    if (++s->stable >= FREEZE_STABLE) {
+		s->frozen = 1;
+		++newly_frozen;
+		++frozen;
+		dbg(ctx->cfg.v_flag, 4, "check_converge: slice[%d]: "
+					"frozen after %lu bits",
+		       i, s->count);
+	    }
+	} else {
+	    s->stable = 0;
+	}
+	s->prev_high = s->entropy_high;
+	s->prev_low = s->entropy_low;
+    }
+    dbg(ctx->cfg.v_flag, 1, "check_converge: after record %lu: "
+			    "%d newly frozen, %d of %d frozen",
+	   ctx->recnum, newly_frozen, frozen, ctx->bits_len);
+    return;
+}
+
+
+/*
+ * errmsg - format an error message into a caller supplied buffer
+ *
+ * given:
+ *	errbuf	where to write the message, or NULL ==> do nothing
+ *	errlen	size of errbuf
+ *	fmt	printf format of the message
+ */
+static void
+errmsg(char *errbuf, size_t errlen, const char *fmt, ...)
+{
+    va_list ap;		/* argument pointer */
+    int saved_errno;	/* errno on entry */
+
+    if (errbuf == NULL || errlen <= 0) {
+	return;
+    }
+    saved_errno = errno;
+    va_start(ap, fmt);
+    vsnprintf(errbuf, errlen, fmt, ap);
+    va_end(ap);
+    errno = saved_errno;
+    return;
+}
+
+
+/*
+ * dbg - print a debug message, if the verbosity level is high enough
+ *
+ * given:
+ *	v_flag	debug verbosity level
+ *	level	print if level <= v_flag
+ *	fmt	printf format of the message
+ */
+static void
+dbg(int v_flag, int level, const char *fmt, ...)
+{
+    va_list ap;		/* argument pointer */
+
+    /* start the var arg setup and fetch our first arg */
+    va_start(ap, fmt);
+
+    /* if high enough debug, print a message */
+    if (level <= v_flag) {
+
+	/* print the message */
+	fprintf(stderr, "Debug[%d]: ", level);
+	if (fmt == NULL) {
+	    fmt = "<<NULL>> format";
+	}
+	vfprintf(stderr, fmt, ap);
+	fputc('\n', stderr);
+	fflush(stderr);
+    }
+
+    /* clean up */
+    va_end(ap);
+    return;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env bash
+#
+# test_batch.sh - check that -L block and ent_binary -Z change no report
+#
+# Records tallied a block at a time with -L, with or without -z
+# freezing converged bits, must report exactly as records tallied one
+# by one.  ent_binary -Z on a sparse file, tallying its runs of zero
+# records in bulk, must report exactly as a run without -Z.
+#
+# usage:
+#	test_batch.sh [entropic [ent_binary]]
+#
+# Exit 0 ==> all reports match, 1 ==> not, 2 ==> cannot run.
+#
+# Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+#
+# Permission to use, copy, modify, and distribute this software and
+# its documentation for any purpose and without fee is hereby granted,
+# provided that the above copyright, this permission notice and text
+# this comment, and the disclaimer below appear in all of the following:
+#
+#       supporting documentation
+#       source copies
+#       source works derived from this source
+#       binaries derived from this source or from derived source
+#
+# LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+# INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+# EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+# USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+#
+# chongo (Landon Curt Noll) /\oo/\
+#
+# Share and enjoy!  :-)
+
+ENTROPIC="${1:-./entropic}"
+ENT_BINARY="${2:-./ent_binary}"
+for prog in "$ENTROPIC" "$ENT_BINARY"; do
+    if [[ ! -x $prog ]]; then
+	echo "$0: ERROR: not executable: $prog" 1>&2
+	exit 2
+    fi
+done
+TMP=$(mktemp -d "${TMPDIR:-/tmp}/test_batch.XXXXXX")
+if [[ -z $TMP ]]; then
+    echo "$0: ERROR: cannot make a temporary directory" 1>&2
+    exit 2
+fi
+trap 'rm -rf "$TMP"' EXIT
+
+# 2000 lines of 8 to 28 hex digits, the first 4 mostly the same
+#
+awk 'BEGIN {
+    srand(1);
+    for (i=0; i < 2000; ++i) {
+	line = (rand() < 0.9) ? "c0de" : sprintf("%04x", int(rand()*65536));
+	n = 4 + int(rand()*21);
+	for (j=0; j < n; ++j) {
+	    line = line sprintf("%x", int(rand()*16));
+	}
+	print line;
+    }
+}' > "$TMP/in.txt"
+
+# a 64 KiB sparse file: 8 KiB of data at 0, 24 KiB and 52 KiB
+#
+: > "$TMP/sparse.bin"
+for at in 0 24 52; do
+    head -c 8192 "$TMP/in.txt" |
+	dd of="$TMP/sparse.bin" bs=1024 seek="$at" conv=notrunc 2>/dev/null
+done
+truncate -s 64K "$TMP/sparse.bin"
+
+# same - report a run whose output differs from that of a reference run
+#
+# given:
+#	$1	command of the run that must match the last want run
+#
+status=0
+same() {
+    eval "$1" > "$TMP/got.out" 2>&1
+    if [[ ! -s $TMP/want.out ]] || ! cmp -s "$TMP/want.out" "$TMP/got.out"; then
+	echo "$0: FAIL: $1" 1>&2
+	status=1
+    fi
+}
+
+# want - run the reference that same compares with
+#
+# given:
+#	$1	command of the reference run
+#
+want() {
+    eval "$1" > "$TMP/want.out" 2>&1
+}
+
+# entropic: record by record against -L block
+#
+for opts in "" "-c 700" "-z 50" "-z 50 -c 700" "-b 4 -B 8 -z 20" \
+	    "-m hex.map" "-C" "-S every:3"; do
+    want "\"$ENTROPIC\" $opts \"$TMP/in.txt\""
+    for block in 1 7 256; do
+	same "\"$ENTROPIC\" $opts -L $block \"$TMP/in.txt\""
+    done
+done
+
+# ent_binary: record by record against -L block, and against -Z
+#
+for opts in "-r 16" "-r 16 -z 30" "-r 16 -c 1500"; do
+    want "\"$ENT_BINARY\" $opts \"$TMP/sparse.bin\""
+    same "\"$ENT_BINARY\" $opts -L 16 \"$TMP/sparse.bin\""
+    same "\"$ENT_BINARY\" $opts -Z \"$TMP/sparse.bin\""
+    same "\"$ENT_BINARY\" $opts -Z -L 16 \"$TMP/sparse.bin\""
+done
+
+if [[ $status -eq 0 ]]; then
+    echo "$0: PASS"
+fi
+exit "$status"
@@ -0,0 +1,143 @@
+#!/usr/bin/env bash
+#
+# test_daemon.sh - check a round trip of entropic -D frames
+#
+# Records fed to a -D context with F must report the same as the same
+# records read from a file with -p.  R of a dropped (X) context, a record
+# length past the end of its frame, and a context name with a NUL in
+# it must each get an ERR reply and leave the daemon serving.
+#
+# usage:
+#	test_daemon.sh [entropic]
+#
+# Exit 0 ==> all replies as expected, 1 ==> not, 2 ==> cannot run.
+#
+# Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+#
+# Permission to use, copy, modify, and distribute this software and
+# its documentation for any purpose and without fee is hereby granted,
+# provided that the above copyright, this permission notice and text
+# this comment, and the disclaimer below appear in all of the following:
+#
+#       supporting documentation
+#       source copies
+#       source works derived from this source
+#       binaries derived from this source or from derived source
+#
+# LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+# INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+# EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+# USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+#
+# chongo (Landon Curt Noll) /\oo/\
+#
+# Share and enjoy!  :-)
+
+ENTROPIC="${1:-./entropic}"
+if [[ ! -x $ENTROPIC ]]; then
+    echo "$0: ERROR: not executable: $ENTROPIC" 1>&2
+    exit 2
+fi
+PYTHON=$(type -P python3)
+if [[ -z $PYTHON ]]; then
+    echo "$0: ERROR: python3 is needed to speak the -D frame protocol" 1>&2
+    exit 2
+fi
+TMP=$(mktemp -d "${TMPDIR:-/tmp}/test_daemon.XXXXXX")
+if [[ -z $TMP ]]; then
+    echo "$0: ERROR: cannot make a temporary directory" 1>&2
+    exit 2
+fi
+trap 'kill "$pid" 2>/dev/null; rm -rf "$TMP"' EXIT
+
+# 500 lines of 8 hex digits
+#
+awk 'BEGIN {
+    srand(1);
+    for (i=0; i < 500; ++i) {
+	printf("%08x\n", int(rand()*4294967296));
+    }
+}' > "$TMP/in.txt"
+"$ENTROPIC" -p "$TMP/in.txt" | sed 1,2d > "$TMP/file.out"
+
+# start the daemon and wait for its socket
+#
+"$ENTROPIC" -D "$TMP/sock" &
+pid=$!
+for ((i=0; i < 50; ++i)); do
+    [[ -S $TMP/sock ]] && break
+    sleep 0.1
+done
+if [[ ! -S $TMP/sock ]]; then
+    echo "$0: ERROR: daemon did not make its socket" 1>&2
+    exit 2
+fi
+
+# speak the frames, check each reply
+#
+"$PYTHON" - "$TMP/sock" "$TMP/in.txt" "$TMP/file.out" <<'PYEOF'
+import socket, struct, sys
+
+def frame(op, name, payload=b''):
+    body = bytes([ord(op), len(name)]) + name + payload
+    return struct.pack('>I', len(body)) + body
+
+def recs(lst):
+    return b''.join(struct.pack('>I', len(r)) + r for r in lst)
+
+def recv_all(s, n):
+    buf = b''
+    while len(buf) < n:
+        part = s.recv(n - len(buf))
+        if not part:
+            raise EOFError('daemon closed the connection')
+        buf += part
+    return buf
+
+def ask(s, data):
+    s.sendall(data)
+    n = struct.unpack('>I', recv_all(s, 4))[0]
+    return recv_all(s, n).decode()
+
+sock_path, in_path, out_path = sys.argv[1:4]
+lines = open(in_path, 'rb').read().split(b'\n')[:-1]
+want = open(out_path).read()
+s = socket.socket(socket.AF_UNIX)
+s.settimeout(10)
+s.connect(sock_path)
+fail = 0
+checks = [
+    ('F', frame('F', b'a', recs(lines)), lambda r: r == 'OK %d\n' % len(lines)),
+    ('R', frame('R', b'a'), lambda r: r.split('\n', 1)[1] == want),
+    ('bad length', frame('F', b'a', b'\0\0\0\x09zz'),
+     lambda r: r.startswith('ERR ')),
+    ('NUL in name', frame('R', b'a\0' + b'b' * 40),
+     lambda r: r == 'ERR malformed frame\n'),
+    ('F NUL in name', frame('F', b'a\0b', recs(lines)),
+     lambda r: r == 'ERR malformed frame\n'),
+    ('R unchanged', frame('R', b'a'), lambda r: r.split('\n', 1)[1] == want),
+    ('X', frame('X', b'a'), lambda r: r == 'OK\n'),
+    ('R dropped', frame('R', b'a'), lambda r: r.startswith('ERR ')),
+    ('F again', frame('F', b'a', recs(lines[:5])), lambda r: r == 'OK 5\n'),
+]
+for what, data, ok in checks:
+    try:
+        r = ask(s, data)
+    except (OSError, EOFError) as e:
+        print('FAIL: %s: %s' % (what, e), file=sys.stderr)
+        sys.exit(1)
+    if not ok(r):
+        print('FAIL: %s: reply: %r' % (what, r), file=sys.stderr)
+        fail = 1
+sys.exit(fail)
+PYEOF
+status=$?
+if [[ $status -eq 0 ]]; then
+    echo "$0: PASS"
+else
+    echo "$0: FAIL" 1>&2
+fi
+exit "$status"
@@ -0,0 +1,83 @@
+#!/usr/bin/env bash
+#
+# test_deadline.sh - check that -S deadline: samples the whole input
+#
+# A deadline: sample must be spread over the input, not be the head of
+# it.  The input is 20000 lines, each starting with a, b, c or d for the
+# quarter of the input it is in, too many to tally in the time given.
+# The groups of -G prefix:1 show which quarters were sampled.
+#
+# usage:
+#	test_deadline.sh [entropic]
+#
+# Exit 0 ==> all quarters sampled, 1 ==> not, 2 ==> cannot run.
+#
+# Copyright (c) 2003,2006,2015,2021,2023,2025 by Landon Curt Noll.  All Rights Reserved.
+#
+# Permission to use, copy, modify, and distribute this software and
+# its documentation for any purpose and without fee is hereby granted,
+# provided that the above copyright, this permission notice and text
+# this comment, and the disclaimer below appear in all of the following:
+#
+#       supporting documentation
+#       source copies
+#       source works derived from this source
+#       binaries derived from this source or from derived source
+#
+# LANDON CURT NOLL DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+# INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+# EVENT SHALL LANDON CURT NOLL BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+# USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+#
+# chongo (Landon Curt Noll) /\oo/\
+#
+# Share and enjoy!  :-)
+
+ENTROPIC="${1:-./entropic}"
+if [[ ! -x $ENTROPIC ]]; then
+    echo "$0: ERROR: not executable: $ENTROPIC" 1>&2
+    exit 2
+fi
+TMP=$(mktemp -d "${TMPDIR:-/tmp}/test_deadline.XXXXXX")
+if [[ -z $TMP ]]; then
+    echo "$0: ERROR: cannot make a temporary directory" 1>&2
+    exit 2
+fi
+trap 'rm -rf "$TMP"' EXIT
+
+# 20000 lines of a quarter letter and 24 pseudo-random hex digits
+#
+awk 'BEGIN {
+    srand(1);
+    for (i=0; i < 20000; ++i) {
+	line = substr("abcd", int(i*4/20000)+1, 1);
+	for (j=0; j < 24; ++j) {
+	    line = line sprintf("%x", int(rand()*16));
+	}
+	print line;
+    }
+}' > "$TMP/in.txt"
+
+# sample for 1 second, and for 1 second of gzip input
+#
+status=0
+for input in "$TMP/in.txt" "$TMP/in.txt.gz"; do
+    if [[ $input == *.gz ]]; then
+	if ! gzip -c "$TMP/in.txt" > "$input" 2>/dev/null; then
+	    continue
+	fi
+    fi
+    groups=$("$ENTROPIC" -G prefix:1 -S deadline:1 "$input" |
+	     sed -n 's/^Entropy report: //p' | sort | tr -d '\n')
+    if [[ $groups != abcd ]]; then
+	echo "$0: FAIL: $input: -S deadline:1 sampled quarters: ${groups:-none}" 1>&2
+	status=1
+    fi
+done
+if [[ $status -eq 0 ]]; then
+    echo "$0: PASS"
+fi
+exit "$status"